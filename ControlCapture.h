@@ -0,0 +1,367 @@
+/*
+ * CONTROL CAPTURE - Pot and button streams logged for exact offline replay
+ *
+ * Records everything the audio callback feeds the engine, per block, so
+ * replay/ can re-render (and profile) a performance sample for sample.
+ *
+ * WHAT IS LOGGED:
+ *   - the six control values the callback maps (pot or MIDI CC, config
+ *     value for pots not fitted), 12-bit with hysteresis. While capturing
+ *     the firmware itself runs on the logged values, so the replay sees
+ *     exactly what the engine saw.
+ *   - button mask changes (1ms scan; informational: chords, strums)
+ *   - every pluck (7-bit level, also used by the firmware while capturing)
+ *     and string pitch change, at its sample offset within the block
+ *     (buttons, strums, MIDI and demo notes alike)
+ *
+ * FORMAT (little-endian, in SDRAM, dumped as hex over serial):
+ *   header  u32 "KCAP"  u16 version  u8 flags  u8 voices  u16 block size
+ *           u32 sample rate
+ *   record  varint blocks since the previous record, u8 tag, payload:
+ *     CAPTURE_POT | pot      zigzag varint change (12-bit steps)
+ *     CAPTURE_BUTTONS        u8 mask (bit n = button n+1 down)
+ *     CAPTURE_PLUCK | string varint offset, zigzag octave, u8 level 0-127
+ *     CAPTURE_PITCH | string varint offset, f32 Hz
+ *     CAPTURE_END            last record (log stopped or full)
+ *   A moving pot costs ~3 bytes per block, a still one nothing.
+ *
+ * THREADS:
+ *   Writes happen in the audio callback only. The main loop asks for
+ *   Start / Stop; they take effect at the next BeginBlock(), and Data()
+ *   is only read once Stopped().
+ *
+ * Portable (no libDaisy dependency): replay/ reads logs with
+ * ControlCaptureReader.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+const uint32_t CAPTURE_MAGIC       = 0x5041434B;  // "KCAP"
+const uint16_t CAPTURE_VERSION     = 1;
+const size_t   CAPTURE_HEADER_SIZE = 14;
+const int      CAPTURE_NUM_POTS    = 6;
+const int      CAPTURE_MAX_STRINGS = 16;
+const float    CAPTURE_POT_STEPS   = 4095.0f;   // 12 bits
+const float    CAPTURE_HYSTERESIS  = 0.75f;     // Steps
+const size_t   CAPTURE_MAX_RECORD  = 5 + 1 + 9;  // Delta + tag + largest payload
+
+// Header flags
+const uint8_t CAPTURE_FLAG_COLD = 0x01;  // Started at power-on: engine silent
+
+enum CaptureTag : uint8_t {
+    CAPTURE_POT     = 0x00,
+    CAPTURE_BUTTONS = 0x10,
+    CAPTURE_PLUCK   = 0x20,
+    CAPTURE_PITCH   = 0x30,
+    CAPTURE_END     = 0xF0
+};
+
+// ============================================
+// Audio thread → log
+// ============================================
+class ControlCaptureWriter {
+  public:
+    void Init(uint8_t* buffer, size_t size, float sample_rate, uint16_t block_size, uint8_t voices) {
+        buffer_      = buffer;
+        capacity_    = size;
+        sample_rate_ = (uint32_t)sample_rate;
+        block_size_  = block_size;
+        voices_      = voices;
+        size_        = 0;
+        active_      = false;
+        stopped_.store(true, std::memory_order_relaxed);
+    }
+
+    // Main loop: log from the next block on (drops any previous log).
+    // `cold` = nothing has sounded yet (power-on).
+    void RequestStart(bool cold) {
+        start_cold_ = cold;
+        stop_request_.store(false, std::memory_order_relaxed);
+        start_request_.store(true, std::memory_order_release);
+    }
+    void RequestStop() { stop_request_.store(true, std::memory_order_release); }
+
+    // Main loop: true once the log is closed (and no request is pending),
+    // so Data() can be read
+    bool Stopped() const {
+        return stopped_.load(std::memory_order_acquire) && !start_request_.load(std::memory_order_relaxed)
+               && !stop_request_.load(std::memory_order_relaxed);
+    }
+
+    // Audio thread, first thing in every block; true if a capture just
+    // started (log the current pitches then)
+    bool BeginBlock() {
+        bool started = false;
+        if (start_request_.exchange(false, std::memory_order_acquire)) {
+            Start();
+            started = true;
+        }
+        if (stop_request_.exchange(false, std::memory_order_acquire) && active_) {
+            Close();
+        }
+        blocks_since_++;
+        offset_ = 0;
+        return started;
+    }
+
+    bool Active() const { return active_; }
+
+    // Sample offset within the block of the following records
+    void At(uint32_t offset) { offset_ = offset; }
+
+    // Control value (0..1) → the value to use: quantized while capturing
+    float Pot(int p, float value) {
+        if (!active_) return value;
+        float steps = value * CAPTURE_POT_STEPS;
+        float diff  = steps - pot_[p];
+        if (pot_[p] < 0 || diff > CAPTURE_HYSTERESIS || diff < -CAPTURE_HYSTERESIS) {
+            int32_t q = (int32_t)(steps + 0.5f);
+            if (q != pot_[p] && Begin(CAPTURE_POT | p)) {
+                VarInt(ZigZag(q - (pot_[p] < 0 ? 0 : pot_[p])));
+                pot_[p] = q;
+            }
+        }
+        return pot_[p] < 0 ? value : pot_[p] * (1.0f / CAPTURE_POT_STEPS);
+    }
+
+    void Buttons(uint8_t mask) {
+        if (!active_ || mask == buttons_ || !Begin(CAPTURE_BUTTONS)) return;
+        Byte(mask);
+        buttons_ = mask;
+    }
+
+    // Pluck level → the level to use: 7-bit while capturing
+    float Pluck(int s, int octave, float level) {
+        if (!active_ || !Begin(CAPTURE_PLUCK | s)) return level;
+        VarInt(offset_);
+        VarInt(ZigZag(octave));
+        int l = (int)(level * 127.0f + 0.5f);
+        l     = l < 0 ? 0 : (l > 127 ? 127 : l);
+        Byte(l);
+        return l / 127.0f;
+    }
+
+    void Pitch(int s, float freq) {
+        if (!active_ || freq == pitch_[s] || !Begin(CAPTURE_PITCH | s)) return;
+        VarInt(offset_);
+        uint32_t bits;
+        memcpy(&bits, &freq, sizeof(bits));
+        for (int i = 0; i < 4; i++) Byte(bits >> (8 * i));
+        pitch_[s] = freq;
+    }
+
+    const uint8_t* Data() const { return buffer_; }
+    size_t         Size() const { return size_; }
+    bool           Full() const { return full_; }
+
+  private:
+    void Start() {
+        size_         = 0;
+        full_         = false;
+        buttons_      = 0xFF;  // Forces the first mask into the log
+        blocks_since_ = 0;
+        for (int p = 0; p < CAPTURE_NUM_POTS; p++) pot_[p] = -1;
+        for (int s = 0; s < CAPTURE_MAX_STRINGS; s++) pitch_[s] = -1.0f;
+
+        U32(CAPTURE_MAGIC);
+        Byte(CAPTURE_VERSION & 0xFF);
+        Byte(CAPTURE_VERSION >> 8);
+        Byte(start_cold_ ? CAPTURE_FLAG_COLD : 0);
+        Byte(voices_);
+        Byte(block_size_ & 0xFF);
+        Byte(block_size_ >> 8);
+        U32(sample_rate_);
+        active_ = true;
+        stopped_.store(false, std::memory_order_release);
+    }
+
+    void Close() {
+        // Room for END is always kept back by Begin()
+        VarInt(blocks_since_ > 0 ? blocks_since_ - 1 : 0);
+        Byte(CAPTURE_END);
+        active_ = false;
+        stopped_.store(true, std::memory_order_release);
+    }
+
+    // Record header; false (and the log closed) when it would not fit
+    bool Begin(uint8_t tag) {
+        if (size_ + CAPTURE_MAX_RECORD + 6 > capacity_) {
+            full_ = true;
+            Close();
+            return false;
+        }
+        VarInt(blocks_since_ - 1);  // BeginBlock() already counted this block
+        blocks_since_ = 1;
+        Byte(tag);
+        return true;
+    }
+
+    static uint32_t ZigZag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+
+    void VarInt(uint32_t v) {
+        while (v >= 0x80) {
+            Byte((v & 0x7F) | 0x80);
+            v >>= 7;
+        }
+        Byte(v);
+    }
+
+    void U32(uint32_t v) {
+        for (int i = 0; i < 4; i++) Byte(v >> (8 * i));
+    }
+
+    void Byte(uint32_t v) { buffer_[size_++] = (uint8_t)v; }
+
+    uint8_t* buffer_       = nullptr;
+    size_t   capacity_     = 0;
+    size_t   size_         = 0;
+    bool     full_         = false;
+    bool     active_       = false;
+    bool     start_cold_   = false;
+    uint32_t sample_rate_  = 48000;
+    uint16_t block_size_   = 4;
+    uint8_t  voices_       = 7;
+    uint32_t blocks_since_ = 0;
+    uint32_t offset_       = 0;
+    uint8_t  buttons_      = 0;
+    int32_t  pot_[CAPTURE_NUM_POTS];
+    float    pitch_[CAPTURE_MAX_STRINGS];
+
+    std::atomic<bool> start_request_{false};
+    std::atomic<bool> stop_request_{false};
+    std::atomic<bool> stopped_{true};
+};
+
+// ============================================
+// Log → events (host / replay)
+// ============================================
+struct CaptureEvent {
+    uint32_t block;   // Absolute block number from the start of the log
+    uint8_t  tag;     // CaptureTag without the index
+    uint8_t  index;   // Pot or string
+    uint32_t offset;  // Sample in the block (PLUCK / PITCH)
+    int32_t  value;   // POT: 12-bit value, BUTTONS: mask, PLUCK: octave
+    float    level;   // PLUCK: 0..1
+    float    freq;    // PITCH: Hz
+};
+
+class ControlCaptureReader {
+  public:
+    // False if the header is not a capture log this version understands
+    bool Open(const uint8_t* data, size_t size) {
+        data_ = data;
+        size_ = size;
+        pos_  = 0;
+        if (size < CAPTURE_HEADER_SIZE) return false;
+        uint32_t magic   = U32();
+        uint16_t version = U16();
+        flags_           = U8();
+        voices_          = U8();
+        block_size_      = U16();
+        sample_rate_     = U32();
+        block_           = 0;
+        ended_           = false;
+        truncated_       = false;
+        for (int p = 0; p < CAPTURE_NUM_POTS; p++) pot_[p] = 0;
+        return magic == CAPTURE_MAGIC && version == CAPTURE_VERSION && block_size_ > 0;
+    }
+
+    // Next event, false at END (or a truncated log: Truncated())
+    bool Next(CaptureEvent* e) {
+        uint32_t delta;
+        if (!VarInt(&delta) || pos_ >= size_) return Truncate();
+        block_ += delta;
+        uint8_t tag = U8();
+
+        e->block  = block_;
+        e->tag    = tag & 0xF0;
+        e->index  = tag & 0x0F;
+        e->offset = 0;
+        e->value  = 0;
+        e->level  = 0.0f;
+        e->freq   = 0.0f;
+
+        uint32_t v;
+        switch (e->tag) {
+            case CAPTURE_POT:
+                if (e->index >= CAPTURE_NUM_POTS || !VarInt(&v)) return Truncate();
+                pot_[e->index] += UnZigZag(v);
+                e->value = pot_[e->index];
+                return true;
+            case CAPTURE_BUTTONS:
+                if (pos_ >= size_) return Truncate();
+                e->value = U8();
+                return true;
+            case CAPTURE_PLUCK:
+                if (!VarInt(&e->offset) || !VarInt(&v) || pos_ >= size_) return Truncate();
+                e->value = UnZigZag(v);
+                e->level = U8() / 127.0f;
+                return e->offset < block_size_ || Truncate();
+            case CAPTURE_PITCH: {
+                if (!VarInt(&e->offset) || pos_ + 4 > size_) return Truncate();
+                uint32_t bits = U32();
+                memcpy(&e->freq, &bits, sizeof(e->freq));
+                return e->offset < block_size_ || Truncate();
+            }
+            case CAPTURE_END:
+                ended_ = true;
+                return false;
+            default:
+                return Truncate();
+        }
+    }
+
+    bool     Cold() const { return flags_ & CAPTURE_FLAG_COLD; }
+    bool     Ended() const { return ended_; }
+    uint32_t Blocks() const { return block_ + 1; }  // Length, once Ended()
+    bool     Truncated() const { return truncated_; }
+    int      Voices() const { return voices_; }
+    uint32_t BlockSize() const { return block_size_; }
+    uint32_t SampleRate() const { return sample_rate_; }
+
+  private:
+    bool Truncate() {
+        truncated_ = true;
+        return false;
+    }
+
+    static int32_t UnZigZag(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+    bool VarInt(uint32_t* v) {
+        *v = 0;
+        for (int shift = 0; shift < 35 && pos_ < size_; shift += 7) {
+            uint8_t b = U8();
+            *v |= (uint32_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) return true;
+        }
+        return false;
+    }
+
+    uint8_t  U8() { return data_[pos_++]; }
+    uint16_t U16() {
+        uint16_t lo = U8();
+        return lo | (U8() << 8);
+    }
+    uint32_t U32() {
+        uint32_t v = 0;
+        for (int i = 0; i < 4; i++) v |= (uint32_t)U8() << (8 * i);
+        return v;
+    }
+
+    const uint8_t* data_        = nullptr;
+    size_t         size_        = 0;
+    size_t         pos_         = 0;
+    uint8_t        flags_       = 0;
+    uint8_t        voices_      = 0;
+    uint32_t       block_size_  = 0;
+    uint32_t       sample_rate_ = 0;
+    uint32_t       block_       = 0;
+    int32_t        pot_[CAPTURE_NUM_POTS];
+    bool           ended_       = false;
+    bool           truncated_   = false;
+};
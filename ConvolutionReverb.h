@@ -0,0 +1,573 @@
+/*
+ * CONVOLUTION REVERB - Multi-second impulse responses (sampled spaces),
+ * non-uniformly partitioned, tail computed by the main loop
+ *
+ * PARTITIONS (taps of the impulse response):
+ *        0 ..   64   direct FIR, audio thread, every sample
+ *       64 ..  512   partitions of 64, audio thread, on the spot every
+ *                    64 samples
+ *      512 .. 4096   partitions of 256, audio thread, in slices: a fixed
+ *                    number of steps per block
+ *     4096 .. end    partitions of 2048, main loop (Service())
+ *   Each FFT level is a uniformly partitioned overlap-save convolution
+ *   (FFT size 2N, frequency-domain delay line of its input spectra). No
+ *   latency on top of the audio block: the direct head covers the taps
+ *   the FFT levels can't be in time for.
+ *
+ * DEADLINES:
+ *   A level with partition size N posts a job every N input samples. A
+ *   level that starts at tap 2N has N samples between the post and the
+ *   first output sample of the job (~43ms for the tail level), which is
+ *   what makes it possible to compute it away from the audio thread. The
+ *   level at 64 starts at N: it runs at once, in the block that posts it.
+ *
+ * HANDOFF (lock-free, single producer / single consumer per level):
+ *   the audio thread writes the input ring, then publishes the job number
+ *   (release); the worker reads the ring, runs the job in small steps,
+ *   writes one of two output buffers and publishes the job as done. The
+ *   audio thread only reads a job's output if it was done before the
+ *   job's first output sample: then the buffer is complete and the worker
+ *   is writing the other one.
+ *
+ * LATE PARTITIONS:
+ *   A job not done in time is counted in Late() and its N samples of the
+ *   tail are left out; the worker still brings the input spectrum into
+ *   the delay line (so later jobs stay correct) but skips the rest. If it
+ *   falls so far behind that the input ring has been overwritten, that
+ *   frame's spectrum is silent. MinSlack() is the tightest finish before
+ *   a deadline so far (samples), to see how close it gets.
+ *
+ * MEMORY:
+ *   Everything big comes from one float arena (SDRAM on the Daisy, 3.3MB
+ *   for CONV_MAX_SECONDS): input ring, per level the transform buffers,
+ *   the impulse response spectra and the input spectra. Given a MemOps,
+ *   Init() clears the input spectra (1.5MB for a 4s IR) on the MDMA while
+ *   the CPU transforms the impulse response.
+ *
+ * Portable (no libDaisy dependency). Clocks as in SelfBench.h.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <atomic>
+
+#include "MemOps.h"
+
+const size_t CONV_HEAD        = 64;     // Direct FIR taps
+const size_t CONV_GRAIN       = 64;     // Smallest partition: all boundaries fall on it
+const size_t CONV_RING        = 16384;  // Input history (power of two, 8 tail partitions)
+const size_t CONV_STEP_OPS    = 64;     // Samples / butterflies / bins per step
+const float  CONV_MAX_SECONDS = 4.0f;
+const size_t CONV_MAX_TAPS    = 196608;  // 4.1s at 48kHz
+
+// FFT levels: partition size, first tap, last tap (0: rest of the IR)
+enum ConvRunner { CONV_AUDIO_NOW, CONV_AUDIO_SLICED, CONV_MAIN_LOOP };
+
+struct ConvLevelSpec {
+    size_t     size;
+    size_t     start;
+    size_t     end;
+    ConvRunner runner;
+};
+
+const int           CONV_LEVELS = 3;
+const ConvLevelSpec CONV_LEVEL_SPECS[CONV_LEVELS] = {
+    {64, 64, 512, CONV_AUDIO_NOW},
+    {256, 512, 4096, CONV_AUDIO_SLICED},
+    {2048, 4096, 0, CONV_MAIN_LOOP},
+};
+
+// ============================================
+// One uniformly partitioned level
+// ============================================
+class ConvLevel {
+  public:
+    static size_t Parts(const ConvLevelSpec& spec, size_t ir_length) {
+        size_t end = spec.end && spec.end < ir_length ? spec.end : ir_length;
+        return end > spec.start ? (end - spec.start + spec.size - 1) / spec.size : 0;
+    }
+
+    // Floats Init() takes from the arena
+    static size_t ArenaFloats(size_t size, size_t parts) {
+        size_t bins = size + 1;
+        return parts == 0 ? 0 : 4 * size                 // Transform (re, im)
+                                    + 2 * size           // Twiddles
+                                    + 4 * parts * bins   // IR spectra + input spectra
+                                    + 2 * bins           // Accumulator
+                                    + 2 * size;          // Output, double buffered
+    }
+
+    // Not real time: carves the buffers out of `arena` and transforms taps
+    // start .. start + parts x size of the impulse response. With mem_ops
+    // the input spectra are cleared asynchronously (wait for Cleared())
+    void Init(const ConvLevelSpec& spec, const float* ir, size_t ir_length, const float* ring,
+              const std::atomic<uint32_t>* now, float*& arena, MemOps* mem_ops) {
+        size_   = spec.size;
+        start_  = spec.start;
+        parts_  = Parts(spec, ir_length);
+        ring_   = ring;
+        now_    = now;
+        fft_    = 2 * size_;
+        bits_   = 0;
+        while (((size_t)1 << bits_) < fft_) bits_++;
+        lost_after_ = CONV_RING / size_ - 3;
+
+        state_     = IDLE;
+        job_       = 0;
+        consuming_.store(0);
+        block_     = nullptr;
+        posted_.store(0);
+        done_.store(0);
+        late_.store(0);
+        min_slack_.store(INT32_MAX);
+        if (parts_ == 0) return;
+
+        size_t bins = size_ + 1;
+        re_    = Take(arena, fft_);
+        im_    = Take(arena, fft_);
+        cos_   = Take(arena, size_);
+        sin_   = Take(arena, size_);
+        ir_re_ = Take(arena, parts_ * bins);
+        ir_im_ = Take(arena, parts_ * bins);
+        x_re_  = Take(arena, parts_ * bins);
+        x_im_  = Take(arena, parts_ * bins);
+        a_re_  = Take(arena, bins);
+        a_im_  = Take(arena, bins);
+        out_[0] = Take(arena, size_);
+        out_[1] = Take(arena, size_);
+        // x_re_ and x_im_ are adjacent: one clear
+        if (mem_ops) {
+            mem_ops->Fill(&clear_op_, x_re_, 0, 2 * parts_ * bins * sizeof(float));
+        } else {
+            memset(x_re_, 0, 2 * parts_ * bins * sizeof(float));
+        }
+
+        const float two_pi = 6.28318530718f;
+        for (size_t i = 0; i < size_; i++) {
+            cos_[i] = cosf(two_pi * i / fft_);
+            sin_[i] = sinf(two_pi * i / fft_);
+        }
+
+        // IR spectra, scaled by 1 / FFT size (saves it on the way back)
+        for (size_t k = 0; k < parts_; k++) {
+            for (size_t i = 0; i < fft_; i++) {
+                size_t tap      = start_ + k * size_ + i;
+                re_[Reverse(i)] = i < size_ && tap < ir_length ? ir[tap] / fft_ : 0.0f;
+                im_[Reverse(i)] = 0.0f;
+            }
+            Next(FORWARD);
+            while (state_ == FORWARD) Butterflies();
+            memcpy(ir_re_ + k * bins, re_, bins * sizeof(float));
+            memcpy(ir_im_ + k * bins, im_, bins * sizeof(float));
+        }
+        state_ = IDLE;
+    }
+
+    bool   Active() const { return parts_ > 0; }
+    bool   Cleared() const { return clear_op_.Done(); }
+    size_t Size() const { return size_; }
+
+    // Steps one job takes (for the sliced level's quota)
+    size_t JobSteps() const {
+        size_t per_pass = (fft_ + CONV_STEP_OPS - 1) / CONV_STEP_OPS;
+        size_t per_bins = (size_ + 1 + CONV_STEP_OPS - 1) / CONV_STEP_OPS;
+        size_t per_fft  = bits_ * ((size_ + CONV_STEP_OPS - 1) / CONV_STEP_OPS);
+        return 1 + per_pass + per_fft + per_bins + parts_ * per_bins + per_pass + per_fft
+               + (size_ + CONV_STEP_OPS - 1) / CONV_STEP_OPS;
+    }
+
+    // ============================================
+    // Audio thread
+    // ============================================
+
+    // At sample `pos` (a multiple of CONV_GRAIN), before it is written:
+    // post the job whose input just completed, then pick up the job whose
+    // output starts here (if it is done)
+    void Boundary(uint64_t pos, bool run_now) {
+        if (pos % size_ == 0 && pos > 0) {
+            posted_.store((uint32_t)(pos / size_), std::memory_order_release);
+            if (run_now) {
+                while (Step()) {
+                }
+            }
+        }
+        if ((pos + size_ - start_) % size_ == 0 && pos + size_ > start_) {
+            uint32_t job = (uint32_t)((pos + size_ - start_) / size_);
+            block_       = nullptr;
+            offset_      = 0;
+            if (job == 0) return;
+            consuming_.store(job, std::memory_order_release);
+            if ((int32_t)(done_.load(std::memory_order_acquire) - job) >= 0) {
+                block_ = out_[job & 1];
+            } else {
+                late_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Adds n output samples (never across a CONV_GRAIN boundary)
+    void Output(float* wet, size_t n) {
+        if (block_) {
+            const float* y = block_ + offset_;
+            for (size_t i = 0; i < n; i++) wet[i] += y[i];
+        }
+        offset_ += n;
+    }
+
+    uint32_t Late() const { return late_.load(std::memory_order_relaxed); }
+    int32_t  MinSlack() const { return min_slack_.load(std::memory_order_relaxed); }
+
+    // ============================================
+    // Worker (the main loop, or the audio thread for the audio levels)
+    // ============================================
+
+    // One step of the current job; false when there is nothing to do
+    bool Step() {
+        if (parts_ == 0) return false;
+        size_t bins = size_ + 1;
+        switch (state_) {
+            case IDLE: {
+                if (posted_.load(std::memory_order_acquire) == job_) return false;
+                job_++;  // In order: every frame's spectrum is needed
+                Next(LOAD);
+                return true;
+            }
+            case LOAD: {
+                // Overlap-save window: the last 2N input samples
+                uint32_t first = (uint32_t)(job_ * size_ - 2 * size_);
+                size_t   end   = Limit(fft_);
+                for (; pos_ < end; pos_++) {
+                    size_t j = Reverse(pos_);
+                    re_[j]   = ring_[(first + pos_) & (CONV_RING - 1)];
+                    im_[j]   = 0.0f;
+                }
+                if (pos_ == fft_) {
+                    // Audio lapped the ring while we were behind: silence
+                    if (posted_.load(std::memory_order_acquire) - job_ > lost_after_) {
+                        memset(re_, 0, fft_ * sizeof(float));
+                    }
+                    Next(FORWARD);
+                }
+                return true;
+            }
+            case FORWARD:
+            case INVERSE: {
+                Butterflies();
+                return true;
+            }
+            case STORE: {
+                // Input spectrum into the delay line (slot job mod parts)
+                size_t slot = (job_ % parts_) * bins;
+                size_t end  = Limit(bins);
+                memcpy(x_re_ + slot + pos_, re_ + pos_, (end - pos_) * sizeof(float));
+                memcpy(x_im_ + slot + pos_, im_ + pos_, (end - pos_) * sizeof(float));
+                pos_ = end;
+                if (pos_ == bins) {
+                    // Deadline already passed: the output would not be used
+                    if ((int32_t)(consuming_.load(std::memory_order_acquire) - job_) >= 0) {
+                        Finish(false);
+                    } else {
+                        Next(MAC);
+                    }
+                }
+                return true;
+            }
+            case MAC: {
+                // acc += X[job - part] x H[part], bins pos_..
+                size_t       slot = ((job_ % parts_ + parts_ - part_) % parts_) * bins;
+                const float* xr   = x_re_ + slot;
+                const float* xi   = x_im_ + slot;
+                const float* hr   = ir_re_ + part_ * bins;
+                const float* hi   = ir_im_ + part_ * bins;
+                size_t       end  = Limit(bins);
+                if (part_ == 0) {
+                    for (size_t b = pos_; b < end; b++) {
+                        a_re_[b] = xr[b] * hr[b] - xi[b] * hi[b];
+                        a_im_[b] = xr[b] * hi[b] + xi[b] * hr[b];
+                    }
+                } else {
+                    for (size_t b = pos_; b < end; b++) {
+                        a_re_[b] += xr[b] * hr[b] - xi[b] * hi[b];
+                        a_im_[b] += xr[b] * hi[b] + xi[b] * hr[b];
+                    }
+                }
+                pos_ = end;
+                if (pos_ == bins) {
+                    pos_ = 0;
+                    if (++part_ == parts_) Next(MIRROR);
+                }
+                return true;
+            }
+            case MIRROR: {
+                // conj(Y) over all bins (Y is conjugate-symmetric), bit
+                // reversed: the forward transform of it is the inverse
+                size_t end = Limit(fft_);
+                for (; pos_ < end; pos_++) {
+                    size_t j = Reverse(pos_);
+                    if (pos_ <= size_) {
+                        re_[j] = a_re_[pos_];
+                        im_[j] = -a_im_[pos_];
+                    } else {
+                        re_[j] = a_re_[fft_ - pos_];
+                        im_[j] = a_im_[fft_ - pos_];
+                    }
+                }
+                if (pos_ == fft_) Next(INVERSE);
+                return true;
+            }
+            case OUTPUT: {
+                // Second half of the overlap-save window is valid
+                float* out = out_[job_ & 1];
+                size_t end = Limit(size_);
+                memcpy(out + pos_, re_ + size_ + pos_, (end - pos_) * sizeof(float));
+                pos_ = end;
+                if (pos_ == size_) Finish(true);
+                return true;
+            }
+        }
+        return false;
+    }
+
+  private:
+    enum State { IDLE, LOAD, FORWARD, STORE, MAC, MIRROR, INVERSE, OUTPUT };
+
+    static float* Take(float*& arena, size_t floats) {
+        float* p = arena;
+        arena += floats;
+        return p;
+    }
+
+    void Next(State state) {
+        state_ = state;
+        pos_   = 0;
+        stage_ = 0;
+        part_  = 0;
+    }
+
+    size_t Limit(size_t total) const {
+        return pos_ + CONV_STEP_OPS < total ? pos_ + CONV_STEP_OPS : total;
+    }
+
+    size_t Reverse(size_t i) const {
+        size_t r = 0;
+        for (int b = 0; b < bits_; b++) r = (r << 1) | ((i >> b) & 1);
+        return r;
+    }
+
+    // Radix-2 butterflies of stage stage_, pos_.. (FFT size / 2 per stage)
+    void Butterflies() {
+        size_t half   = (size_t)1 << stage_;
+        size_t stride = fft_ / (half * 2);
+        size_t end    = Limit(size_);
+        for (; pos_ < end; pos_++) {
+            size_t group = pos_ >> stage_;
+            size_t k     = pos_ & (half - 1);
+            size_t a     = group * half * 2 + k;
+            size_t b     = a + half;
+            float  wr    = cos_[k * stride];
+            float  wi    = -sin_[k * stride];
+            float  tr    = re_[b] * wr - im_[b] * wi;
+            float  ti    = re_[b] * wi + im_[b] * wr;
+            re_[b] = re_[a] - tr;
+            im_[b] = im_[a] - ti;
+            re_[a] += tr;
+            im_[a] += ti;
+        }
+        if (pos_ == size_) {
+            pos_ = 0;
+            if (++stage_ == bits_) {
+                State next = state_ == FORWARD ? STORE : OUTPUT;
+                Next(next);
+            }
+        }
+    }
+
+    void Finish(bool output) {
+        if (output) {
+            // Samples to spare before the job's first output sample
+            uint32_t first = (uint32_t)(job_ * size_ - size_ + start_);
+            int32_t  slack = (int32_t)(first - now_->load(std::memory_order_relaxed));
+            if (slack < min_slack_.load(std::memory_order_relaxed)) {
+                min_slack_.store(slack, std::memory_order_relaxed);
+            }
+        }
+        done_.store(job_, std::memory_order_release);
+        state_ = IDLE;
+    }
+
+    size_t size_  = 0;
+    size_t start_ = 0;
+    size_t parts_ = 0;
+    size_t fft_   = 0;
+    int    bits_  = 0;
+
+    const float*                 ring_ = nullptr;
+    const std::atomic<uint32_t>* now_  = nullptr;
+    uint32_t                     lost_after_ = 0;  // Jobs behind = ring overwritten
+
+    float* re_    = nullptr;
+    float* im_    = nullptr;
+    float* cos_   = nullptr;
+    float* sin_   = nullptr;
+    float* ir_re_ = nullptr;  // [part][bin]
+    float* ir_im_ = nullptr;
+    float* x_re_  = nullptr;  // [job mod parts][bin]
+    float* x_im_  = nullptr;
+    float* a_re_  = nullptr;
+    float* a_im_  = nullptr;
+    float* out_[2] = {nullptr, nullptr};
+
+    MemOps::Op clear_op_;  // Input spectra clear at Init()
+
+    // Worker
+    State    state_ = IDLE;
+    uint32_t job_   = 0;
+    size_t   pos_   = 0;
+    int      stage_ = 0;
+    size_t   part_  = 0;
+
+    // Audio thread
+    const float* block_  = nullptr;
+    size_t       offset_ = 0;
+
+    std::atomic<uint32_t> posted_{0};     // Audio → worker: last job posted
+    std::atomic<uint32_t> done_{0};       // Worker → audio: last job finished
+    std::atomic<uint32_t> consuming_{0};  // Audio → worker: job being played
+    std::atomic<uint32_t> late_{0};
+    std::atomic<int32_t>  min_slack_{INT32_MAX};
+};
+
+// ============================================
+// The reverb: direct head + FFT levels
+// ============================================
+class ConvolutionReverb {
+  public:
+    // Arena floats needed for an impulse response of ir_length taps
+    static size_t ArenaFloats(size_t ir_length) {
+        size_t total = CONV_RING;
+        for (int l = 0; l < CONV_LEVELS; l++) {
+            const ConvLevelSpec& spec = CONV_LEVEL_SPECS[l];
+            total += ConvLevel::ArenaFloats(spec.size, ConvLevel::Parts(spec, ir_length));
+        }
+        return total;
+    }
+
+    // Not real time (transforms the whole IR: call before audio starts).
+    // False if the arena is too small; ir_length is capped at CONV_MAX_TAPS.
+    // mem_ops (optional, idle): clears the input spectra on the MDMA
+    bool Init(float* arena, size_t arena_floats, const float* ir, size_t ir_length, size_t block_size,
+              MemOps* mem_ops = nullptr) {
+        ready_ = false;
+        if (ir_length > CONV_MAX_TAPS) ir_length = CONV_MAX_TAPS;
+        if (ArenaFloats(ir_length) > arena_floats) return false;
+
+        ring_ = arena;
+        arena += CONV_RING;
+        memset(ring_, 0, CONV_RING * sizeof(float));
+        memset(head_, 0, sizeof(head_));
+        memset(history_, 0, sizeof(history_));
+        for (size_t i = 0; i < CONV_HEAD && i < ir_length; i++) head_[i] = ir[i];
+        history_pos_ = 0;
+        pos_         = 0;
+        now_.store(0);
+
+        for (int l = 0; l < CONV_LEVELS; l++) {
+            levels_[l].Init(CONV_LEVEL_SPECS[l], ir, ir_length, ring_, &now_, arena, mem_ops);
+        }
+        for (int l = 0; l < CONV_LEVELS; l++) {
+            while (!levels_[l].Cleared()) {}
+        }
+
+        // Sliced level: enough steps per block to finish a job in N samples
+        quota_ = 0;
+        for (int l = 0; l < CONV_LEVELS; l++) {
+            if (CONV_LEVEL_SPECS[l].runner != CONV_AUDIO_SLICED || !levels_[l].Active()) continue;
+            size_t blocks = levels_[l].Size() / block_size;
+            quota_        = (levels_[l].JobSteps() + blocks - 1) / blocks + 1;
+        }
+        ready_ = true;
+        return true;
+    }
+
+    bool Ready() const { return ready_; }
+
+    // Audio thread: wet signal of `in` into `wet` (may be the same buffer)
+    void Process(const float* in, float* wet, size_t size) {
+        while (size > 0) {
+            if (pos_ % CONV_GRAIN == 0) {
+                for (int l = 0; l < CONV_LEVELS; l++) {
+                    if (levels_[l].Active()) {
+                        levels_[l].Boundary(pos_, CONV_LEVEL_SPECS[l].runner == CONV_AUDIO_NOW);
+                    }
+                }
+            }
+            size_t n = CONV_GRAIN - pos_ % CONV_GRAIN;
+            if (n > size) n = size;
+
+            // Direct head (newest CONV_HEAD inputs contiguous: ring written twice)
+            for (size_t i = 0; i < n; i++) {
+                float x = in[i];
+                ring_[(pos_ + i) & (CONV_RING - 1)] = x;
+                history_pos_ = history_pos_ == 0 ? CONV_HEAD - 1 : history_pos_ - 1;
+                history_[history_pos_]             = x;
+                history_[history_pos_ + CONV_HEAD] = x;
+                const float* h   = history_ + history_pos_;
+                float        acc = 0.0f;
+                for (size_t k = 0; k < CONV_HEAD; k++) acc += head_[k] * h[k];
+                wet[i] = acc;
+            }
+            for (int l = 0; l < CONV_LEVELS; l++) {
+                if (levels_[l].Active()) levels_[l].Output(wet, n);
+            }
+            in += n;
+            wet += n;
+            size -= n;
+            pos_ += n;
+        }
+        now_.store((uint32_t)pos_, std::memory_order_relaxed);
+
+        for (int l = 0; l < CONV_LEVELS; l++) {
+            if (CONV_LEVEL_SPECS[l].runner != CONV_AUDIO_SLICED) continue;
+            for (size_t s = 0; s < quota_ && levels_[l].Step(); s++) {
+            }
+        }
+    }
+
+    // Main loop: work on the tail until done or `budget` Clock ticks
+    // have passed
+    template <typename Clock>
+    void Service(uint32_t budget) {
+        if (!ready_) return;
+        uint32_t start = Clock::Now();
+        for (int l = 0; l < CONV_LEVELS; l++) {
+            if (CONV_LEVEL_SPECS[l].runner != CONV_MAIN_LOOP) continue;
+            while (levels_[l].Step()) {
+                if (Clock::Elapsed(start) >= budget) return;
+            }
+        }
+    }
+
+    // Late partitions so far, all levels (audio levels are never late)
+    uint32_t Late() const {
+        uint32_t late = 0;
+        for (int l = 0; l < CONV_LEVELS; l++) late += levels_[l].Late();
+        return late;
+    }
+
+    const ConvLevel& Level(int l) const { return levels_[l]; }
+
+  private:
+    ConvLevel             levels_[CONV_LEVELS];
+    float*                ring_ = nullptr;
+    float                 head_[CONV_HEAD];
+    float                 history_[CONV_HEAD * 2];
+    size_t                history_pos_ = 0;
+    uint64_t              pos_         = 0;  // Input samples so far
+    std::atomic<uint32_t> now_{0};           // pos_ for the worker's slack
+    size_t                quota_ = 0;        // Steps per block, sliced level
+    bool                  ready_ = false;
+};
@@ -0,0 +1,243 @@
+/*
+ * CV INPUT - Eurorack gates and 1V/oct pitch CV from ADC frames,
+ * block-wise
+ *
+ * INPUT:
+ *   Interleaved ADC frames [frame][channel], 16-bit: GATES gate channels,
+ *   then CVS control voltages. Jacks through a divider to the ADC range
+ *   (full scale = full_scale_v at the jack) and an RC low-pass of about
+ *   one frame - the anti-alias filter, and what lets an edge be placed
+ *   between two frames.
+ *
+ * GATES (block-wise):
+ *   One pass takes every gate's minimum and maximum over the block. A
+ *   gate that is low and stays under GATE_HIGH_V, or high and stays over
+ *   GATE_LOW_V, costs two compares per block; only a gate that may cross
+ *   is scanned frame by frame (Schmitt trigger). A rising edge is placed
+ *   between the two frames around the crossing by linear interpolation,
+ *   so its time carries no frame grid: the same RC delay for every edge,
+ *   jitter well under one frame.
+ *
+ * CV PER EDGE:
+ *   Sequencers change the pitch on the gate edge, or just before it. The
+ *   CVs an edge reports are averaged over the last CV_AVERAGE_MS of the
+ *   CV_SETTLE_MS after it, once the divider / RC have settled. A new edge
+ *   within CV_SETTLE_MS of the last one on the same gate is ignored.
+ *
+ * TIMING:
+ *   An edge is reported at most LatencyFrames() after it; adding that as
+ *   a fixed latency plays every edge with the same delay.
+ *
+ * QUANTIZER:
+ *   CvQuantizer maps 1V/oct onto a row of pitches (every string of the
+ *   active scale in every octave, 0V = the row's first entry): nearest
+ *   pitch, with CV_HYSTERESIS_V in favour of the last note so a CV right
+ *   between two notes doesn't flip between them.
+ *
+ * Portable (no libDaisy dependency).
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+const float CV_FULL_SCALE_V = 5.0f;  // At the jack, for ADC full scale (divider)
+const float GATE_HIGH_V     = 2.0f;  // Schmitt trigger
+const float GATE_LOW_V      = 1.0f;
+const float CV_SETTLE_MS    = 1.0f;  // Pitch read after a gate edge ...
+const float CV_AVERAGE_MS   = 0.25f;  // ... averaged over the end of that
+const float CV_HYSTERESIS_V = 1.0f / 48.0f;  // A quarter semitone
+const int   CV_ROW_MAX      = 64;
+
+// ============================================
+// Gate edges + CV
+// ============================================
+template <int GATES, int CVS>
+class GateCvInput {
+  public:
+    static const int CHANNELS = GATES + CVS;
+
+    struct Edge {
+        int      gate;
+        uint32_t frame;     // Last frame under the threshold (frames since Init())
+        float    fraction;  // Crossing, 0..1 of the way to the next frame
+        float    cv[CVS > 0 ? CVS : 1];  // Volts, settled after the edge
+    };
+
+    // frame_rate: ADC frames per second (per channel)
+    void Init(float frame_rate, float full_scale_v = CV_FULL_SCALE_V) {
+        frame_         = 0;
+        high_          = GATE_HIGH_V / full_scale_v * 65535.0f;
+        low_           = GATE_LOW_V / full_scale_v * 65535.0f;
+        volts_         = full_scale_v / 65535.0f;
+        settle_frames_ = (uint32_t)(CV_SETTLE_MS * 0.001f * frame_rate + 0.5f);
+        average_frames_ = (uint32_t)(CV_AVERAGE_MS * 0.001f * frame_rate + 0.5f);
+        if (settle_frames_ < 1) settle_frames_ = 1;
+        if (average_frames_ < 1) average_frames_ = 1;
+        if (average_frames_ > settle_frames_) average_frames_ = settle_frames_;
+        memset(gates_, 0, sizeof(gates_));
+        for (int g = 0; g < GATES; g++) gates_[g].last_edge = 0u - settle_frames_;  // Long ago
+    }
+
+    // Edges are reported this long after the frame before them at most,
+    // for blocks of up to `block` frames
+    uint32_t LatencyFrames(size_t block) const { return settle_frames_ + (uint32_t)block; }
+
+    // One buffer of `count` frames (count <= the settle time, so at most
+    // one edge per gate): edges into `edges` (room for GATES), returns
+    // how many
+    size_t Process(const uint16_t* frames, size_t count, Edge* edges) {
+        uint16_t low[GATES], high[GATES];
+        GateRange(frames, count, low, high);
+
+        size_t n = 0;
+        for (int g = 0; g < GATES; g++) {
+            Gate& gate = gates_[g];
+            bool  idle = gate.high ? low[g] > low_ : high[g] < high_;
+            if (idle && !gate.pending) {
+                gate.prev = frames[(count - 1) * CHANNELS + g];
+                continue;  // No crossing possible: the common case
+            }
+            for (size_t f = 0; f < count; f++) {
+                const uint16_t* x   = frames + f * CHANNELS;
+                uint32_t        now = frame_ + (uint32_t)f;
+                if (!gate.high && x[g] >= high_) {
+                    gate.high = true;
+                    if (!gate.pending && now - gate.last_edge >= settle_frames_) {
+                        gate.pending   = true;
+                        gate.last_edge = now;
+                        gate.fraction  = (high_ - gate.prev) / (float)(x[g] - gate.prev);
+                        gate.samples   = 0;
+                        for (int c = 0; c < CVS; c++) gate.sum[c] = 0;
+                    }
+                } else if (gate.high && x[g] <= low_) {
+                    gate.high = false;
+                }
+                gate.prev = x[g];
+
+                // Settle window of a pending edge: average its end
+                if (!gate.pending) continue;
+                uint32_t until = gate.last_edge + settle_frames_;
+                if (until - now <= average_frames_) {
+                    for (int c = 0; c < CVS; c++) gate.sum[c] += x[GATES + c];
+                    gate.samples++;
+                }
+                if (now + 1 == until) {
+                    Edge& e    = edges[n++];
+                    e.gate     = g;
+                    e.frame    = gate.last_edge - 1;
+                    e.fraction = gate.fraction;
+                    for (int c = 0; c < CVS; c++) e.cv[c] = gate.sum[c] * volts_ / gate.samples;
+                    gate.pending = false;
+                }
+            }
+        }
+        frame_ += (uint32_t)count;
+        return n;
+    }
+
+    bool     High(int gate) const { return gates_[gate].high; }
+    uint32_t Frame() const { return frame_; }
+
+  private:
+    struct Gate {
+        bool     high;       // Schmitt state
+        bool     pending;    // Edge waiting for its CV to settle
+        uint16_t prev;       // Last frame's value
+        uint32_t last_edge;  // First frame over the threshold
+        float    fraction;
+        uint32_t samples;    // CV frames averaged so far
+        uint32_t sum[CVS > 0 ? CVS : 1];
+    };
+
+    // Every gate's minimum and maximum over the block
+    static void GateRange(const uint16_t* frames, size_t count, uint16_t* low, uint16_t* high) {
+        for (int g = 0; g < GATES; g++) {
+            low[g]  = 0xFFFF;
+            high[g] = 0;
+        }
+        for (size_t f = 0; f < count; f++) {
+            const uint16_t* x = frames + f * CHANNELS;
+            for (int g = 0; g < GATES; g++) {
+                low[g]  = x[g] < low[g] ? x[g] : low[g];
+                high[g] = x[g] > high[g] ? x[g] : high[g];
+            }
+        }
+    }
+
+    Gate     gates_[GATES];
+    uint32_t frame_          = 0;
+    float    high_           = 0.0f;  // ADC counts
+    float    low_            = 0.0f;
+    float    volts_          = 0.0f;  // Per ADC count
+    uint32_t settle_frames_  = 1;
+    uint32_t average_frames_ = 1;
+};
+
+// ============================================
+// 1V/oct → a row of pitches
+// ============================================
+class CvQuantizer {
+  public:
+    struct Note {
+        int index;  // Into the row, -1 = empty row
+        int major;  // index / minor_count (the octave of a [octave][string] row)
+        int minor;  // index % minor_count (the string)
+    };
+
+    // Row of count pitches in Hz; with minor_count per group, e.g.
+    // freq[octave][string] and minor_count = strings. 0V = pitches[0].
+    void SetRow(const float* pitches, int count, int minor_count) {
+        count_ = count < CV_ROW_MAX ? count : CV_ROW_MAX;
+        minor_ = minor_count > 0 ? minor_count : 1;
+        last_  = -1;
+        for (int i = 0; i < count_; i++) {
+            // Sorted by pitch (insertion sort, a few dozen entries)
+            float v = log2f(pitches[i] / pitches[0]);
+            int   j = i;
+            while (j > 0 && volts_[j - 1] > v) {
+                volts_[j] = volts_[j - 1];
+                index_[j] = index_[j - 1];
+                j--;
+            }
+            volts_[j] = v;
+            index_[j] = i;
+        }
+    }
+
+    Note Quantize(float volts) {
+        Note note = {-1, 0, 0};
+        if (count_ == 0) return note;
+
+        // Nearest by binary search, then the neighbour on the other side
+        int lo = 0, hi = count_ - 1;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (volts_[mid] < volts) lo = mid + 1;
+            else hi = mid;
+        }
+        int best = lo;
+        if (lo > 0 && volts - volts_[lo - 1] < volts_[lo] - volts) best = lo - 1;
+
+        // Stay on the last note unless the new one is clearly nearer
+        if (last_ >= 0 && last_ != best
+            && fabsf(volts - volts_[last_]) - fabsf(volts - volts_[best]) < CV_HYSTERESIS_V) {
+            best = last_;
+        }
+        last_      = best;
+        note.index = index_[best];
+        note.major = note.index / minor_;
+        note.minor = note.index % minor_;
+        return note;
+    }
+
+  private:
+    float volts_[CV_ROW_MAX];  // Sorted, relative to pitches[0]
+    int   index_[CV_ROW_MAX];  // → position in the row
+    int   count_ = 0;
+    int   minor_ = 1;
+    int   last_  = -1;  // Sorted position of the last note
+};
@@ -27,10 +27,92 @@
  * OLED DISPLAY (0.96" SSD1306 I2C):
  *   SCL → Pin 12 (D12, GPIO PB8, I2C1_SCL)
  *   SDA → Pin 13 (D13, GPIO PB9, I2C1_SDA)
- *   Shows: Current scale, octave, active buttons, parameters
+ *   Shows: Current scale, octave, level bar per string, parameters
+ *   Only pages that changed are sent (OledPages.h). SPI modules: build
+ *   with -DKALIMBA_OLED_SPI (not with KALIMBA_KEY_SCANNER): SCK D8, MOSI
+ *   D10, CS D9, DC D11, RES D12; the frame goes out by DMA in ~1ms
+ *   instead of ~25ms of blocking I2C.
+ *
+ * MIDI INPUT (omni):
+ *   TRS/DIN MIDI → optocoupler → D14 (Pin 15, USART1 RX)
+ *   USB-MIDI on the external USB port, D29/D30 (build with -DKALIMBA_USB_MIDI)
+ *   Note On: note 60 (C4) = Button 1 ... 66 = Button 7, every 7 notes
+ *            up/down = one octave up/down on that string; velocity = pluck strength
+ *   CC 74 = Brightness, CC 72 = Decay, CC 91 = Reverb Mix, CC 92 = Reverb Time
+ *            (the pot takes over again as soon as it is moved)
+ *   CC 71 = Per-note filter resonance (0 = filter off, the default),
+ *   CC 70 = Filter lowpass → bandpass (cutoff follows each note and its velocity)
+ *   CC 75 = Strum spacing, 1ms per step
  *
  * LED: Blinks when any note is triggered
  *
+ * SETTINGS SECTOR: pots that aren't fitted, button pins and a custom scale
+ *   come from a CRC-checked block in QSPI flash, written by the web
+ *   flasher without a reflash (see KalimbaConfig.h). Invalid = defaults.
+ *
+ * RUNTIME TUNING: new scales as text lines over USB serial or SysEx
+ *   F0 7D <text> F7 (UART or USB MIDI), e.g.
+ *   SCALE 3 Hijaz D3=146.83 Eb3=155.56 F#3=185 G3=196 A3=220 Bb3=233.08 C4=261.63
+ *   then COMMIT (RESET = power-on scales). Swapped in between audio
+ *   blocks, never persisted (see TuningTable.h).
+ *
+ * SELF-BENCH: hold Button 1 at power-on - cycles per DSP stage and an output
+ *   checksum go to the serial log and the OLED (see SelfBench.h)
+ *
+ * CAPTURE: hold Button 2 at power-on (or send CAPTURE START over USB
+ *   serial) to log every control value, pluck and pitch change to SDRAM;
+ *   CAPTURE STOP, then CAPTURE DUMP prints the log as hex for
+ *   replay/ to re-render and profile (see ControlCapture.h)
+ *
+ * LOOPER CHORDS (hold Button 7, then press; Button 7 alone plays its
+ * note when released):
+ *   Button 1: Record → Play → Overdub → Play ...
+ *   Button 2: Undo last overdub
+ *   Button 3: Stop & clear loop
+ *   Button 4: Start/stop WAV recording to SD (KALIMBA_SD_CARD builds)
+ *   Button 5: Next exciter: Impulse → EXC_0.WAV → EXC_1.WAV ... (SD builds)
+ *   Button 6: Strum mode: Off → Strum Up → Strum Down → Off
+ *   (nothing, held 1s): Next screen: Status → Scope → Spectrum
+ *
+ * SCOPE / SPECTRUM SCREENS (for workshops, see ScopeView.h):
+ *   Output waveform, auto-ranged, and a 64-band spectrum up to 12kHz
+ *   (16kHz at a 32kHz sample rate). The FFT runs in short slices in the
+ *   main loop; the frame rate backs off when the audio leaves little CPU
+ *   over.
+ *
+ * KEY CHAIN (optional, build with -DKALIMBA_KEY_SCANNER):
+ *   Up to 32 keys on 4 x 74HC165: SCK D8, MISO D9, SH/LD D10. Debounced
+ *   in bulk, played like MIDI notes (KeyScanner.h); the 7 buttons and
+ *   their chords still work.
+ *
+ * PIEZO PADS (optional, build with -DKALIMBA_PIEZO):
+ *   3 piezos (clamped) on A6-A8 (D21-D23) pluck strings 1, 3 and 5 with
+ *   the strength of the hit, a fixed ~2ms after it (PiezoTrigger.h).
+ *   Sampled at 12kHz at every audio rate by a TIM5 interrupt.
+ *
+ * EURORACK GATES / CV (optional, build with -DKALIMBA_CV, not with SD):
+ *   Gate 1 → A9 (D24), Gate 2 → A10 (D25), pitch CV (1V/oct, 0-5V) →
+ *   A11 (D28), through dividers. Gate 1 plucks the CV's note of the
+ *   current scale, gate 2 strums the chord rooted on it; edges land on
+ *   their own sample, a fixed 2ms after the gate (CvInput.h).
+ *
+ * STRUM MODE:
+ *   Each button strums a 4-note chord rooted on its string (every other
+ *   string: 1-3-5-7, 2-4-6-1'...), one note every 30ms at power-on;
+ *   CC 75 (0-127ms) or STRUM <ms> over serial/SysEx (0-250) changes it.
+ *   Notes are scheduled on exact future samples, not fired in one block
+ *   (Strummer.h).
+ *
+ * SD CARD (optional, build with -DKALIMBA_SD_CARD):
+ *   SDMMC1 shares D1-D6 with buttons 1-6, so those move to
+ *   D0, D26, D27, D28, D25, D24. Recordings are KAL_nnnn.WAV (16-bit mono,
+ *   at the sample rate). Exciter samples are EXC_0.WAV ... EXC_7.WAV
+ *   (16-bit mono). IR.WAV (16-bit mono, up to 4s at 48kHz, 2s at 96kHz) =
+ *   impulse response: replaces ReverbSc with a convolution reverb, mixed
+ *   by A4 / CC 91 (see ConvolutionReverb.h). Late tail partitions go to
+ *   the serial log. Files play sample for sample: record them at the
+ *   rate set in the settings block.
+ *
  * FEATURES:
  *   - Full polyphony (all 7 buttons can sound simultaneously)
  *   - 5 musical scales covering diverse musical traditions
@@ -39,13 +121,45 @@
  *   - Dual LFO modulation (vibrato + tremolo)
  *   - Karplus-Strong physical modeling synthesis
  *   - Real-time OLED feedback
+ *   - 60 second SDRAM looper with overdub + undo
+ *   - Streaming WAV recording to SD card (optional)
+ *   - Pluck strings with WAV samples streamed from SD (optional)
+ *   - Convolution reverb with a sampled space from SD (optional)
+ *   - MIDI input (TRS + USB) with sample-accurate note timing
+ *   - Strum mode: one press plays a sample-accurately spaced chord
  *   - Production-ready with safety features
  *   - Optimized CPU usage (~18-25% with ReverbSc)
+ *
+ * DSP lives in KalimbaEngine.h (block-wise, hardware-free); bench/ measures
+ * it on an emulated Cortex-M7.
  */
 
 #include "daisy_seed.h"
 #include "daisysp.h"
 #include "dev/oled_ssd130x.h"
+#ifdef KALIMBA_SD_CARD
+#include "fatfs.h"
+#endif
+#include "MemOps.h"
+#include "Looper.h"
+#include "WavRecorder.h"
+#include "SampleExciter.h"
+#include "ConvolutionReverb.h"
+#include "EngineEvents.h"
+#include "MidiInput.h"
+#include "KeyScanner.h"
+#include "PiezoTrigger.h"
+#include "CvInput.h"
+#include "Strummer.h"
+#include "KalimbaEngine.h"
+#include "KalimbaScales.h"
+#include "LevelMeter.h"
+#include "ScopeView.h"
+#include "OledPages.h"
+#include "KalimbaConfig.h"
+#include "TuningTable.h"
+#include "ControlCapture.h"
+#include "SelfBench.h"
 
 using namespace daisy;
 using namespace daisysp;
@@ -53,94 +167,247 @@ using namespace daisysp;
 // Hardware
 DaisySeed hw;
 
-// OLED Display
-OledDisplay<SSD130xI2c128x64Driver> display;
+// ============================================
+// OLED DISPLAY - SSD1306, changed pages only (OledPages.h)
+// ============================================
 
-// DSP modules - 7 independent Karplus-Strong strings (user has 7 buttons)
-const int NUM_STRINGS = 7;
-String strings[NUM_STRINGS];
+// I2C: one blocking transaction per command burst / run of pages
+class OledI2cTransport {
+  public:
+    struct Config {
+        uint8_t           i2c_address;
+        I2CHandle::Config i2c_config;
+    };
+    static const bool ONE_WINDOW = false;
+    static bool Busy() { return false; }
+
+    void Init(const Config& config) {
+        address_ = config.i2c_address;
+        i2c_.Init(config.i2c_config);
+    }
+    void Commands(const uint8_t* bytes, size_t n) { Send(0x00, bytes, n); }
+    void Data(const uint8_t* bytes, size_t n) { Send(0x40, bytes, n); }
+
+  private:
+    void Send(uint8_t control, const uint8_t* bytes, size_t n) {
+        buf_[0] = control;  // Co = 0: the rest is all commands / all data
+        memcpy(buf_ + 1, bytes, n);
+        i2c_.TransmitBlocking(address_, buf_, (uint16_t)(n + 1), 100);
+    }
 
-// LFO modulation (vibrato + tremolo)
-Oscillator lfo_vibrato;
-Oscillator lfo_tremolo;
+    I2CHandle i2c_;
+    uint8_t   address_ = 0x3C;
+    uint8_t   buf_[1 + 128 * 8];
+};
 
-// ReverbSc for spatial depth and ambience
-ReverbSc reverb;
+#ifdef KALIMBA_OLED_SPI
+#ifdef KALIMBA_KEY_SCANNER
+#error "KALIMBA_OLED_SPI and KALIMBA_KEY_SCANNER both need SPI1 on D8-D10"
+#endif
+// SPI1 transmit-only: commands blocking, each frame's pages in one DMA
+// transfer the main loop doesn't wait for
+uint8_t DMA_BUFFER_MEM_SECTION oled_dma_buffer[128 * 8];
+
+class OledSpiDmaTransport {
+  public:
+    struct Config {
+        SpiHandle::Config spi_config;
+        Pin               dc, cs, reset;
+    };
+    static const bool ONE_WINDOW = true;
+    static bool Busy() { return busy_; }
+
+    void Init(const Config& config) {
+        dc_.Init(config.dc, GPIO::Mode::OUTPUT);
+        cs_.Init(config.cs, GPIO::Mode::OUTPUT);
+        reset_.Init(config.reset, GPIO::Mode::OUTPUT);
+        cs_.Write(true);
+        reset_.Write(false);  // Reset pulse (3us minimum)
+        System::DelayUs(10);
+        reset_.Write(true);
+        System::DelayUs(10);
+        spi_.Init(config.spi_config);
+    }
+    void Commands(const uint8_t* bytes, size_t n) {
+        while (busy_) {}
+        dc_.Write(false);
+        cs_.Write(false);
+        spi_.BlockingTransmit(const_cast<uint8_t*>(bytes), n, 100);
+        cs_.Write(true);
+    }
+    void Data(const uint8_t* bytes, size_t n) {
+        while (busy_) {}
+        memcpy(oled_dma_buffer, bytes, n);
+        dc_.Write(true);
+        cs_.Write(false);
+        busy_ = true;
+        spi_.DmaTransmit(oled_dma_buffer, n, nullptr, Done, this);
+    }
 
-// DC blocker (essential for Karplus-Strong)
-DcBlock dc_blocker;
+  private:
+    // DMA complete (interrupt)
+    static void Done(void* context, SpiHandle::Result result) {
+        static_cast<OledSpiDmaTransport*>(context)->cs_.Write(true);
+        busy_ = false;
+    }
 
-// ============================================
-// OPTIMIZATION: Octave Ratio Lookup Table
-// ============================================
-// Pre-calculated 2^octave ratios (-2 to +2 octaves)
-const float OCTAVE_RATIOS[5] = {
-    0.25f,  // -2 octaves (2^-2)
-    0.5f,   // -1 octave  (2^-1)
-    1.0f,   // 0 octaves  (2^0)
-    2.0f,   // +1 octave  (2^1)
-    4.0f    // +2 octaves (2^2)
+    SpiHandle spi_;
+    GPIO      dc_, cs_, reset_;
+    static volatile bool busy_;  // DMA transfer in flight
 };
+volatile bool OledSpiDmaTransport::busy_ = false;
+
+typedef OledSpiDmaTransport OledTransport;
+#else
+typedef OledI2cTransport OledTransport;
+#endif
+
+typedef PagedOledDriver<128, 64, OledTransport> OledDriver;
+OledDisplay<OledDriver> display;
+
+// DSP engine - 7 independent Karplus-Strong strings (user has 7 buttons),
+// LFOs, DC blocker, ReverbSc and saturator (see KalimbaEngine.h).
+// Stage timing (DWT cycles) is only switched on by the self-bench.
+// NUM_STRINGS, scales and pot mappings: KalimbaScales.h
+KalimbaEngine<NUM_STRINGS, StageProfiler<DwtClock>> engine;
+
+// Self-bench: hold Button 1 at power-on (see SelfBench.h)
+const int SELF_BENCH_BUTTON = 0;
+SelfBenchReport self_bench;
+bool self_bench_ran = false;
+volatile bool self_bench_show = false;  // Results on the OLED until a press
+
+// Looper (after the saturator) - loop + undo layers in 64MB SDRAM
+const size_t LOOPER_MAX_SAMPLES = 48000 * 60;  // 60 seconds at 48kHz (90 at 32kHz, 30 at 96kHz)
+float DSY_SDRAM_BSS looper_buffer[LOOPER_MAX_SAMPLES];
+float DSY_SDRAM_BSS looper_undo_buffer[LOOPER_MAX_SAMPLES];
+Looper looper;
+
+// Bulk memory moves (looper undo restore, reverb clear at boot) on the MDMA
+MemOps mem_ops;
+const size_t MEMOPS_CALIBRATE_BYTES = 65536;
+
+extern "C" void MDMA_IRQHandler(void) {
+    mem_ops.IrqHandler();
+}
 
-// Button GPIO pins (D1-D7, Pins 2-8)
+// Looper chords: hold SHIFT button, press an action button
+const int LOOPER_SHIFT_BUTTON  = 6;  // Button 7
+const int LOOPER_RECORD_BUTTON = 0;  // Button 1
+const int LOOPER_UNDO_BUTTON   = 1;  // Button 2
+const int LOOPER_CLEAR_BUTTON  = 2;  // Button 3
+const int WAV_RECORD_BUTTON    = 3;  // Button 4 (SD builds only)
+const int EXCITER_BUTTON       = 4;  // Button 5 (SD builds only)
+const int STRUM_MODE_BUTTON    = 5;  // Button 6
+
+#ifdef KALIMBA_SD_CARD
+// SD card + WAV recorder - ~21 seconds of slack in SDRAM for slow cards
+SdmmcHandler   sdcard;
+FatFSInterface fsi;
+bool           sd_available = false;
+
+const uint32_t WAV_RING_SAMPLES = 1 << 20;  // Power of two, multiple of CHUNK
+int16_t DSY_SDRAM_BSS __attribute__((aligned(32))) wav_ring[WAV_RING_SAMPLES];
+FatFsWavSink              wav_sink;
+WavRecorder<FatFsWavSink> wav_recorder;
+
+// Sample exciter - resident head + per-string double buffers (AXI SRAM,
+// reachable by SDMMC DMA)
+const float EXCITER_GAIN = 0.5f;  // Samples carry far more energy than the impulse
+FatFsSampleSource                             exciter_source;
+SampleExciter<FatFsSampleSource, NUM_STRINGS> sample_exciter;
+
+// Convolution reverb - IR.WAV on the card replaces ReverbSc (A4 / CC 91
+// still sets the mix). Tail partitions are computed in the main loop.
+const size_t      CONV_ARENA_FLOATS = 832 * 1024;  // >= ArenaFloats(CONV_MAX_TAPS) = 826706
+const size_t      CONV_LOAD_CHUNK   = 512;         // Samples per card read at boot
+const uint32_t    CONV_SLICE_US     = 2000;        // Longest tail slice per main loop pass
+float DSY_SDRAM_BSS conv_arena[CONV_ARENA_FLOATS];
+float DSY_SDRAM_BSS conv_ir[CONV_MAX_TAPS];
+ConvolutionReverb conv_reverb;
+volatile bool     conv_running = false;  // Set by the main loop once it is servicing the tail
+#endif
+
+// Button GPIO pins (D1-D7, Pins 2-8) - D numbers, the config block can
+// move them (DaisySeed::GetPin)
 GPIO buttons[NUM_STRINGS];
-const Pin button_pins[NUM_STRINGS] = {
-    daisy::seed::D1,  // Button 1 (Pin 2)
-    daisy::seed::D2,  // Button 2 (Pin 3)
-    daisy::seed::D3,  // Button 3 (Pin 4)
-    daisy::seed::D4,  // Button 4 (Pin 5)
-    daisy::seed::D5,  // Button 5 (Pin 6)
-    daisy::seed::D6,  // Button 6 (Pin 7)
-    daisy::seed::D7   // Button 7 (Pin 8)
+#ifdef KALIMBA_SD_CARD
+// D1-D6 are the SDMMC1 bus: buttons 1-6 move to free pins
+#ifdef KALIMBA_CV
+#error "KALIMBA_CV needs A9-A11 (D24, D25, D28), which SD builds give to buttons 4-6"
+#endif
+const uint8_t button_pins[NUM_STRINGS] = {
+    0,   // Button 1: D0  (Pin 1)
+    26,  // Button 2: D26 (Pin 33)
+    27,  // Button 3: D27 (Pin 34)
+    28,  // Button 4: D28 (Pin 35)
+    25,  // Button 5: D25 (Pin 32)
+    24,  // Button 6: D24 (Pin 31)
+    7    // Button 7: D7  (Pin 8)
+};
+#else
+const uint8_t button_pins[NUM_STRINGS] = {
+    1,  // Button 1: D1 (Pin 2)
+    2,  // Button 2: D2 (Pin 3)
+    3,  // Button 3: D3 (Pin 4)
+    4,  // Button 4: D4 (Pin 5)
+    5,  // Button 5: D5 (Pin 6)
+    6,  // Button 6: D6 (Pin 7)
+    7   // Button 7: D7 (Pin 8)
 };
+#endif
+
+// D pins the config block may not give to a button: OLED (D11/D12, SPI
+// also D8-D10),
+// MIDI UART (D13/D14), pots A0-A5 (D15-D20), SDMMC1 / external USB
+const uint64_t CONFIG_RESERVED_PINS = (1ull << 11) | (1ull << 12) | (1ull << 13) | (1ull << 14)
+                                    | (0x3Full << 15)
+#ifdef KALIMBA_SD_CARD
+                                    | (0x3Full << 1)
+#endif
+#ifdef KALIMBA_USB_MIDI
+                                    | (1ull << 29) | (1ull << 30)
+#endif
+#if defined(KALIMBA_KEY_SCANNER) || defined(KALIMBA_OLED_SPI)
+                                    | (1ull << 8) | (1ull << 9) | (1ull << 10)
+#endif
+#ifdef KALIMBA_PIEZO
+                                    | (0x7ull << 21)
+#endif
+#ifdef KALIMBA_CV
+                                    | (1ull << 24) | (1ull << 25) | (1ull << 28)
+#endif
+    ;
+
+// Control capture for offline replay (ControlCapture.h, replay/): hold
+// Button 2 at power-on, or CAPTURE START / STOP / DUMP over USB serial
+const int CAPTURE_BUTTON = 1;
+const size_t CAPTURE_LOG_BYTES = 8 * 1024 * 1024;  // Hours of normal playing
+const size_t CAPTURE_DUMP_LINE = 48;               // Bytes per serial line
+uint8_t DSY_SDRAM_BSS capture_log[CAPTURE_LOG_BYTES];
+ControlCaptureWriter capture;
+bool capture_dump_pending = false;
+
+// Settings block in QSPI flash, written by the web flasher (KalimbaConfig.h)
+KalimbaConfig       config;
+KalimbaConfigStatus config_status;
 
 // ============================================
-// MULTI-SCALE SYSTEM - 5 Scales Available
+// MULTI-SCALE SYSTEM - scales in KalimbaScales.h, replaceable at runtime
 // ============================================
 
-#define NUM_SCALES 5
+// Scales in use (TuningTable.h): RAM double buffer, the audio thread
+// switches at a block start. Power-on table = KalimbaScales.h with the
+// config block's custom scale over its slot.
+TuningTables       tuning;
+TuningLoader       tuning_loader;
+const TuningTable* tuning_active;  // Audio thread: table of the current block
 
-// Scale names for display
-const char* scale_names[NUM_SCALES] = {
-    "Pentatonic Maj",  // G Major Pentatonic
-    "Dorian Mode",     // D Dorian
-    "Chromatic",       // Chromatic from C3
-    "Kalimba Trad",    // Traditional kalimba voicing
-    "Just/LaMonte"     // La Monte Young just intonation
-};
-
-// Note names for each scale
-const char* scale_note_names[NUM_SCALES][NUM_STRINGS] = {
-    // Pentatonic Major (G Major)
-    {"G3", "A3", "B3", "D4", "E4", "G4", "A4"},
-    // Dorian Mode (D Dorian)
-    {"D3", "E3", "F3", "G3", "A3", "B3", "C4"},
-    // Chromatic
-    {"C3", "C#3", "D3", "D#3", "E3", "F3", "F#3"},
-    // Kalimba Traditional
-    {"G3", "A3", "D4", "E4", "G4", "B4", "A4"},
-    // Just Intonation / La Monte Young
-    {"C3", "E3", "G3", "Bb3", "C4", "D4", "F4"}
-};
-
-// Base frequencies for each scale (in Hz)
-const float scale_frequencies[NUM_SCALES][NUM_STRINGS] = {
-    // Pentatonic Major (G Major): G3, A3, B3, D4, E4, G4, A4
-    {196.00f, 220.00f, 246.94f, 293.66f, 329.63f, 392.00f, 440.00f},
-
-    // Dorian Mode (D Dorian): D3, E3, F3, G3, A3, B3, C4
-    {146.83f, 164.81f, 174.61f, 196.00f, 220.00f, 246.94f, 261.63f},
-
-    // Chromatic: C3, C#3, D3, D#3, E3, F3, F#3
-    {130.81f, 138.59f, 146.83f, 155.56f, 164.81f, 174.61f, 185.00f},
-
-    // Kalimba Traditional (alternate G Major voicing): G3, A3, D4, E4, G4, B4, A4
-    {196.00f, 220.00f, 293.66f, 329.63f, 392.00f, 493.88f, 440.00f},
-
-    // Just Intonation / La Monte Young (based on C harmonic series)
-    // C3(1:1), E3(5:4), G3(3:2), Bb3(7:4), C4(2:1), D4(9:8), F4(11:8)
-    {130.81f, 163.51f, 196.22f, 229.28f, 261.63f, 293.66f, 323.08f}
-};
+// Tuning command lines: USB serial (interrupt → main loop) and text SysEx
+ByteQueue<512> serial_rx;
+LineReader     serial_lines;
+LineReader     midi_uart_lines;
+LineReader     midi_usb_lines;
 
 // Current scale selection
 int current_scale = 0;  // Default to Pentatonic Major
@@ -148,8 +415,19 @@ int current_scale = 0;  // Default to Pentatonic Major
 // Octave shift (-2 to +2 octaves, 5 octave total range)
 int octave_offset = 0;  // Default: no octave shift
 
-// Controls
-AdcChannelConfig adc_config[6];
+// Controls: pots A0-A5, then the piezo pads (A6-A8) in KALIMBA_PIEZO builds
+// and the Eurorack inputs (A9-A11) in KALIMBA_CV builds
+#ifdef KALIMBA_PIEZO
+const int PIEZO_CHANNELS = 3;
+#else
+const int PIEZO_CHANNELS = 0;
+#endif
+#ifdef KALIMBA_CV
+const int CV_CHANNELS = 3;  // Gate 1, gate 2, pitch
+#else
+const int CV_CHANNELS = 0;
+#endif
+AdcChannelConfig adc_config[6 + PIEZO_CHANNELS + CV_CHANNELS];
 AnalogControl controls[6];
 
 // Control parameters
@@ -158,41 +436,455 @@ float global_decay = 0.95f;       // Global damping coefficient
 float reverb_mix = 0.3f;          // Reverb dry/wet mix (0-1)
 float reverb_feedback = 0.85f;    // Reverb time/feedback (0.6-0.999)
 float reverb_lpfreq = 10000.0f;   // Reverb lowpass filter (500-20000 Hz)
-float lfo_depth = 0.1f;           // Unified LFO depth for vibrato + tremolo
-const float LFO_RATE = 2.0f;      // Fixed LFO rate (2 Hz for musical modulation)
+float filter_resonance = 0.0f;    // Per-note filter (CC 71), off at 0
+float filter_morph = 0.0f;        // Lowpass → bandpass (CC 70)
+const float FILTER_TRACKING = 4.0f;  // Cutoff = 4x the note at mid velocity
 
 // Button state tracking
 bool button_state[NUM_STRINGS];
-volatile bool button_triggered[NUM_STRINGS];
+int string_octave[NUM_STRINGS];    // Per-string octave on top of A2 (set by MIDI notes)
+
+// ============================================
+// MIDI INPUT
+// ============================================
+// Audio block size (samples) - also sets the MIDI scheduling latency
+const size_t AUDIO_BLOCK_SIZE = 4;
+
+// Sample rate from the settings block (32 / 48 / 96kHz), fixed at boot:
+// timers below are kept in ms and turned into samples / blocks then.
+// Buttons, keys, piezos and CV are scanned every 1ms = scan_blocks blocks.
+const size_t SCAN_BLOCKS_MAX = 96000 / AUDIO_BLOCK_SIZE / 1000;
+uint32_t scan_blocks = 48000 / AUDIO_BLOCK_SIZE / 1000;  // Set at boot
+
+// Events are played 2 blocks after arrival: always in a block that has not
+// been rendered yet, so the delay is constant (0.17ms at 48kHz) instead of
+// jittery
+const uint32_t MIDI_LATENCY = 2 * AUDIO_BLOCK_SIZE;
+const uint32_t MIDI_QUEUE_SIZE = 64;
+const int MIDI_BASE_NOTE = 60;  // C4 → Button 1
+
+// CC numbers → pot index they override
+const int MIDI_CC_BRIGHTNESS  = 74;
+const int MIDI_CC_DECAY       = 72;
+const int MIDI_CC_REVERB_MIX  = 91;
+const int MIDI_CC_REVERB_TIME = 92;
+const int MIDI_CC_FILTER_RESONANCE = 71;  // No pot: set directly
+const int MIDI_CC_FILTER_MORPH     = 70;
+const int MIDI_CC_STRUM_SPACING    = 75;  // 1ms per step
+
+typedef MidiInput<MIDI_QUEUE_SIZE> KalimbaMidiIn;
+
+SampleClock       sample_clock;          // Sample index ↔ System tick
+uint32_t          audio_sample_count = 0;
+MidiUartTransport midi_uart;             // USART1: RX = D14, TX = D13
+KalimbaMidiIn     midi_uart_in;
+#ifdef KALIMBA_USB_MIDI
+MidiUsbTransport  midi_usb;              // External USB port (D29/D30)
+KalimbaMidiIn     midi_usb_in;
+#endif
+
+#ifdef KALIMBA_KEY_SCANNER
+// Key chain: KEY_CHIPS x 74HC165 on SPI1, latched and read by DMA every
+// 1ms with the buttons (see KeyScanner.h). Key k plays like MIDI note
+// KEY_BASE_NOTE + k: key 0 = Button 1 an octave down, every 7 keys one
+// octave up.
+const int     KEY_CHIPS     = 4;  // 32 keys
+const uint8_t KEY_BASE_NOTE = MIDI_BASE_NOTE - NUM_STRINGS;
+SpiHandle     key_spi;           // SCK = D8, MISO = D9 (QH of the first chip)
+GPIO          key_latch;         // SH/LD = D10 (low = load the inputs)
+uint8_t DMA_BUFFER_MEM_SECTION key_bytes[KEY_CHIPS];
+KeyScanner<MIDI_QUEUE_SIZE> key_scanner;
+volatile uint32_t key_latch_tick = 0;      // When the keys were sampled
+volatile bool     key_scan_busy  = false;  // DMA read in flight
+
+// SPI DMA complete (interrupt): debounce, queue note events
+void KeyScanDone(void* context, SpiHandle::Result result) {
+    if (result == SpiHandle::Result::OK) {
+        key_scanner.OnScan(ShiftRegisterKeys(key_bytes, KEY_CHIPS),
+                           sample_clock.Now(key_latch_tick) + MIDI_LATENCY);
+    }
+    key_scan_busy = false;
+}
+
+// Latch every key at once, then read the chain in the background
+void StartKeyScan() {
+    if (key_scan_busy) return;  // Previous read still running: skip this scan
+    key_latch.Write(false);
+    System::DelayUs(1);  // SH/LD pulse (100ns minimum at 2V)
+    key_latch.Write(true);
+    key_latch_tick = System::GetTick();
+    key_scan_busy  = true;
+    key_spi.DmaReceive(key_bytes, KEY_CHIPS, nullptr, KeyScanDone, nullptr);
+}
+#endif
+
+// CC soft takeover: a CC overrides its pot until the pot is moved
+bool  cc_active[6];
+float cc_value[6];
+float cc_pot_ref[6];  // Pot position when the CC arrived
+
+// ============================================
+// STRUM MODE
+// ============================================
+enum StrumMode { STRUM_OFF, STRUM_UP, STRUM_DOWN };
+StrumMode strum_mode = STRUM_OFF;
+
+// Future plucks (audio thread only) - room for 8 overlapping strums
+Strummer<NUM_STRINGS, 32> strummer;
 
 // Demo mode (auto-play until user presses a button or turns a knob)
 volatile bool demo_mode = true;
-uint32_t demo_timer = 0;
-const uint32_t DEMO_INTERVAL = 24000;  // Trigger note every 500ms
+uint32_t demo_timer = 0;  // Samples
+const uint32_t DEMO_INTERVAL_MS = 2000;  // Trigger note every 2s
+uint32_t demo_interval = 0;  // Samples, set at boot
 int demo_note_index = 0;
 
 // Potentiometer change detection
 float last_pot_values[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
 const float POT_MOVE_THRESHOLD = 0.02f; // Sensitivity threshold for stopping demo
 
+#ifdef KALIMBA_PIEZO
+// Piezo pads: the ADC's DMA converts them along with the pots. libDaisy's
+// AdcHandle keeps a single frame (no half-buffer callback), and one frame
+// per audio block would only be 8kHz at 32kHz, so a timer interrupt
+// takes one at PIEZO_FRAME_RATE - the same at every sample rate - into a
+// ring. The audio callback searches it for hits 1ms (PIEZO_PASS_FRAMES)
+// at a time (see PiezoTrigger.h). A hit is due
+// PiezoDetector::LatencyFrames() + one audio block (a pass waits for the
+// next callback) after its onset: every hit gets the same delay.
+const int      piezo_strings[PIEZO_CHANNELS] = {0, 2, 4};  // Strings 1, 3, 5
+const uint32_t PIEZO_FRAME_RATE              = 12000;      // Hz, >= 10kHz for the peak window
+const size_t   PIEZO_PASS_FRAMES             = PIEZO_FRAME_RATE / 1000;
+const uint32_t PIEZO_RING_FRAMES             = 64;  // Power of 2: 5ms of frames
+PiezoDetector<PIEZO_CHANNELS> piezo;
+TimerHandle        piezo_timer;
+uint16_t           piezo_ring[PIEZO_RING_FRAMES * PIEZO_CHANNELS];
+volatile uint32_t  piezo_written = 0;  // Frames taken (timer interrupt)
+uint32_t           piezo_read    = 0;  // Frames searched (audio thread)
+uint16_t           piezo_frames[PIEZO_PASS_FRAMES * PIEZO_CHANNELS];
+float              piezo_frame_samples = 4.0f;  // Audio samples per frame, set at boot
+uint32_t           piezo_latency       = 0;     // Samples, set at boot
+EventScheduler<16> piezo_scheduler;             // Audio thread only
+
+// Timer interrupt: the ADC's current frame into the ring
+void PiezoTimer(void* data) {
+    uint32_t  written = piezo_written;
+    uint16_t* frame   = piezo_ring + (written & (PIEZO_RING_FRAMES - 1)) * PIEZO_CHANNELS;
+    for (int c = 0; c < PIEZO_CHANNELS; c++) frame[c] = *hw.adc.GetPtr(6 + c);
+    piezo_written = written + 1;
+}
+
+// Every whole pass the timer has taken: hits scheduled as plucks
+void PiezoFrames(uint32_t now) {
+    uint32_t written = piezo_written;
+    if (written - piezo_read > PIEZO_RING_FRAMES / 2) {
+        piezo_read = written - PIEZO_PASS_FRAMES;  // Stalled: on from the newest pass
+    }
+    while (written - piezo_read >= PIEZO_PASS_FRAMES) {
+        for (size_t f = 0; f < PIEZO_PASS_FRAMES; f++) {
+            const uint16_t* frame = piezo_ring + ((piezo_read + f) & (PIEZO_RING_FRAMES - 1)) * PIEZO_CHANNELS;
+            for (int c = 0; c < PIEZO_CHANNELS; c++) piezo_frames[f * PIEZO_CHANNELS + c] = frame[c];
+        }
+
+        // A hit's frame was taken `age` frames before the newest (≈ now)
+        uint32_t first = piezo.Frame();
+        PiezoHit hits[PIEZO_CHANNELS];
+        size_t   n = piezo.Process(piezo_frames, PIEZO_PASS_FRAMES, hits);
+        for (size_t h = 0; h < n; h++) {
+            uint32_t    age = written - 1 - (piezo_read + (hits[h].frame - first));
+            EngineEvent e;
+            e.time   = now - (uint32_t)(age * piezo_frame_samples + 0.5f) + piezo_latency;
+            e.type   = EngineEvent::PLUCK;
+            e.data1  = piezo_strings[hits[h].channel];
+            e.data2  = (uint8_t)(1.5f + 126.0f * hits[h].velocity);  // 1..127
+            e.octave = 0;
+            piezo_scheduler.Schedule(e);
+            demo_mode = false;
+        }
+        piezo_read += PIEZO_PASS_FRAMES;
+    }
+}
+#endif
+
 // LED timing
 volatile uint32_t led_timer = 0;
-const uint32_t LED_ON_TIME = 4800;  // 100ms at 48kHz
+const uint32_t LED_ON_MS = 100;
+uint32_t led_on_samples = 0;  // Set at boot
 
 // Display state
 bool display_initialized = false;
 bool display_available = false;
 uint32_t display_update_timer = 0;
-const uint32_t DISPLAY_UPDATE_INTERVAL = 4800;  // ~100ms
+const uint32_t DISPLAY_UPDATE_MS = 100;
+uint32_t display_update_samples = 0;  // Set at boot
+
+// Per-string level bars (block peaks from the engine, decayed at display rate)
+LevelMeters<NUM_STRINGS> string_meters;
+const int METER_BAR_HEIGHT = 7;  // Pixels
+
+// Workshop screens (ScopeView.h): hold Button 7 on its own to cycle
+// status → scope → spectrum
+enum DisplayView { VIEW_STATUS, VIEW_SCOPE, VIEW_SPECTRUM, NUM_VIEWS };
+volatile DisplayView display_view = VIEW_STATUS;
+const uint32_t VIEW_HOLD_MS = 1000;
+uint32_t display_interval = 0;  // Samples; scope views pace themselves
+SnapshotRing scope_snapshots;
+SlicedFft    scope_fft;
+ScopePacer   scope_pacer;
+const float* scope_frame  = nullptr;  // Frame on screen / being transformed
+uint32_t     scope_fft_us = 0;        // FFT time since the last frame
+const uint32_t SCOPE_SLICE_US = 200;  // Longest FFT slice per main loop pass
+
+// Audio callback load, for the scope's refresh pacing
+CpuLoadMeter cpu_load;
+
+struct MicrosClock {
+    static inline uint32_t Now() { return System::GetUs(); }
+    static inline uint32_t Elapsed(uint32_t start) { return System::GetUs() - start; }
+};
+
+// Pot position, or the config block's fixed value if that pot isn't fitted
+float PotValue(int p) {
+    return config.PotFitted(p) ? fclamp(controls[p].Value(), 0.0f, 1.0f) : config.pot_values[p];
+}
+
+// Pot value, unless a MIDI CC currently owns the parameter
+float PotOrCc(int p) {
+    float pot = PotValue(p);
+    if (cc_active[p] && fabsf(pot - cc_pot_ref[p]) > POT_MOVE_THRESHOLD) {
+        cc_active[p] = false;  // Pot moved: hand control back
+    }
+    return cc_active[p] ? cc_value[p] : pot;
+}
 
-// Track active notes for display
-volatile bool notes_active[NUM_STRINGS];
-uint32_t note_activity_timer[NUM_STRINGS];
-const uint32_t NOTE_DISPLAY_TIME = 48000;  // 1 second
+// Built-in scales, then the config block's custom scale (if any) over its slot
+void InitTuning() {
+    static TuningTable initial;
+    for (int i = 0; i < NUM_SCALES; i++) {
+        initial.SetScale(i, scale_names[i], scale_note_names[i], scale_frequencies[i]);
+    }
+    int slot = config.custom_scale_slot;
+    if (slot >= 0) {
+        const char* notes[NUM_STRINGS];
+        for (int s = 0; s < NUM_STRINGS; s++) notes[s] = config.custom_note_names[s];
+        initial.SetScale(slot, config.custom_scale_name, notes, config.custom_freqs);
+    }
+    initial.Prepare();  // Config pitches are range-checked already
+
+    tuning.Init(initial);
+    tuning_loader.Init(&tuning, initial);
+    tuning_active = tuning.Published();
+}
+
+// Engine pitch of one string (logged while capturing)
+void SetStringFreq(int s, float freq) {
+    engine.SetVoiceFreq(s, freq);
+    capture.Pitch(s, freq);
+}
+
+// Engine pitch of every string: precomputed scale note x octave (global A2
+// shift + the string's own MIDI octave)
+void UpdateStringFreqs() {
+    for (int s = 0; s < NUM_STRINGS; s++) {
+        SetStringFreq(s, tuning_active->Freq(current_scale, octave_offset + string_octave[s], s));
+    }
+}
+
+// Pluck one string on the next sample processed
+void Pluck(int s, int octave, float level) {
+    string_octave[s] = octave;
+    SetStringFreq(s, tuning_active->Freq(current_scale, octave_offset + octave, s));
+    engine.Trigger(s, capture.Pluck(s, octave, level));
+
+    // Blink LED on any trigger
+    led_timer = led_on_samples;
+}
+
+#ifdef KALIMBA_SD_CARD
+// Engine exciter hook: streamed WAV that starts on the exact trigger sample
+float SampleExcite(int s, bool trigger, void* context) {
+    if (trigger) sample_exciter.Start(s);
+    return sample_exciter.Process(s);
+}
+
+// Engine reverb hook: the convolution reverb in ReverbSc's place, ahead of
+// the saturator. Silent until the main loop services the tail, so the
+// boot splash can't make partitions late.
+void ConvolutionReverbHook(const float* in, float* wet, size_t size, void* context) {
+    if (!conv_running) {
+        for (size_t k = 0; k < size; k++) wet[k] = 0.0f;
+        return;
+    }
+    conv_reverb.Process(in, wet, size);
+}
+
+// Boot: IR.WAV (16-bit mono) → conv_ir, scaled to unit energy so the wet
+// signal sits at about the dry level, then transformed (not real time:
+// before the codec starts). False = no card / no file / bad format.
+bool LoadImpulseResponse(size_t block_size) {
+    FatFsSampleSource source;
+    if (!source.Open("IR.WAV")) return false;
+    size_t   offset = 0;
+    uint32_t taps   = 0;
+    bool     ok     = FindWavData(&source, &offset, &taps);
+    if (taps > CONV_MAX_TAPS) taps = CONV_MAX_TAPS;
+
+    int16_t pcm[CONV_LOAD_CHUNK];
+    size_t  got = 0;
+    while (ok && got < taps) {
+        size_t n = taps - got < CONV_LOAD_CHUNK ? taps - got : CONV_LOAD_CHUNK;
+        ok       = source.ReadAt(offset + got * 2, pcm, n * 2) == n * 2;
+        for (size_t i = 0; ok && i < n; i++) conv_ir[got + i] = pcm[i] * (1.0f / 32768.0f);
+        got += n;
+    }
+    source.Close();
+    if (!ok || taps == 0) return false;
+
+    float energy = 0.0f;
+    for (size_t i = 0; i < taps; i++) energy += conv_ir[i] * conv_ir[i];
+    if (energy <= 0.0f) return false;
+    float scale = 1.0f / sqrtf(energy);
+    for (size_t i = 0; i < taps; i++) conv_ir[i] *= scale;
+    return conv_reverb.Init(conv_arena, CONV_ARENA_FLOATS, conv_ir, taps, block_size, &mem_ops);
+}
+#endif
+
+void MidiNoteOn(uint8_t note, uint8_t velocity) {
+    // Scale degree → string, every 7 notes = one octave on that string
+    int degree = (int)note - MIDI_BASE_NOTE;
+    int octave = degree >= 0 ? degree / NUM_STRINGS
+                             : -((NUM_STRINGS - 1 - degree) / NUM_STRINGS);
+    Pluck(degree - octave * NUM_STRINGS, octave, velocity / 127.0f);
+    demo_mode = false;
+}
+
+// Schedule a chord rooted on string `root` (`octave` up/down), first
+// note on sample `start` (dropped whole if the scheduler is full)
+void StrumChord(int root, uint32_t start, int octave = 0) {
+    strummer.Strum(root, start, octave, strum_mode == STRUM_DOWN);
+}
+
+#ifdef KALIMBA_CV
+// Eurorack inputs: one frame taken per audio block and searched 1ms
+// (scan_blocks frames) at a time (CvInput.h). An edge is placed between
+// frames, so it lands on its own sample, CvInput's fixed latency after
+// the gate.
+// The pitch CV is absolute 1V/oct over the current scale's 5 octaves
+// (0V = string 1 two octaves down), the A2 pot doesn't shift it.
+const int          CV_ADC = 6 + PIEZO_CHANNELS;  // First CV channel in adc_config
+GateCvInput<2, 1>  cv_input;
+CvQuantizer        cv_quantizer;
+const TuningTable* cv_row_table = nullptr;  // Row the quantizer holds
+int                cv_row_scale = -1;
+uint16_t           cv_frames[SCAN_BLOCKS_MAX * CV_CHANNELS];
+size_t             cv_count   = 0;
+uint32_t           cv_latency = 0;  // Samples, set at boot
+EventScheduler<16> cv_scheduler;    // Audio thread only
+
+// Take this block's frame; a full pass turns gate edges into plucks /
+// strums
+void CvFrame(uint32_t now) {
+    for (int c = 0; c < CV_CHANNELS; c++) {
+        cv_frames[cv_count * CV_CHANNELS + c] = *hw.adc.GetPtr(CV_ADC + c);
+    }
+    if (++cv_count < scan_blocks) return;
+    cv_count = 0;
+
+    // Control rate: quantize to the active scale row
+    if (tuning_active != cv_row_table || current_scale != cv_row_scale) {
+        cv_row_table = tuning_active;
+        cv_row_scale = current_scale;
+        cv_quantizer.SetRow(&tuning_active->freq[current_scale][0][0], TUNING_OCTAVES * NUM_STRINGS, NUM_STRINGS);
+    }
+
+    // Frame f was taken (last - f) blocks before `now`
+    uint32_t                last = cv_input.Frame() + scan_blocks - 1;
+    GateCvInput<2, 1>::Edge edges[2];
+    size_t                  n = cv_input.Process(cv_frames, scan_blocks, edges);
+    for (size_t i = 0; i < n; i++) {
+        const GateCvInput<2, 1>::Edge& edge = edges[i];
+        uint32_t at = now - (last - edge.frame) * AUDIO_BLOCK_SIZE
+                    + (uint32_t)(edge.fraction * AUDIO_BLOCK_SIZE + 0.5f) + cv_latency;
+        CvQuantizer::Note note   = cv_quantizer.Quantize(edge.cv[0]);
+        int               octave = note.major - 2 - octave_offset;  // Row octave 0 = -2
+        if (edge.gate == 0) {
+            EngineEvent e;
+            e.time   = at;
+            e.type   = EngineEvent::PLUCK;
+            e.data1  = note.minor;
+            e.data2  = 127;
+            e.octave = octave;
+            cv_scheduler.Schedule(e);
+        } else {
+            StrumChord(note.minor, at, octave);
+        }
+        demo_mode = false;
+    }
+}
+#endif
+
+void MidiControlChange(uint8_t cc, uint8_t value) {
+    int p;
+    switch (cc) {
+        case MIDI_CC_FILTER_RESONANCE: filter_resonance = value / 127.0f; return;
+        case MIDI_CC_FILTER_MORPH:     filter_morph = value / 127.0f; return;
+        case MIDI_CC_STRUM_SPACING:    strummer.SetSpacing(value, hw.AudioSampleRate()); return;
+        case MIDI_CC_BRIGHTNESS:  p = 0; break;  // A0
+        case MIDI_CC_DECAY:       p = 1; break;  // A1
+        case MIDI_CC_REVERB_MIX:  p = 4; break;  // A4
+        case MIDI_CC_REVERB_TIME: p = 5; break;  // A5
+        default: return;
+    }
+    cc_value[p] = value / 127.0f;
+    cc_pot_ref[p] = PotValue(p);
+    cc_active[p] = true;
+}
+
+// Apply every queued/scheduled event that is due on sample `now`
+template <typename Events>
+void ApplyDueEvents(Events& events, uint32_t now) {
+    EngineEvent e;
+    while (events.Peek(&e) && EventDue(e.time, now)) {
+        events.Pop();
+        switch (e.type) {
+            case EngineEvent::NOTE_ON: MidiNoteOn(e.data1, e.data2); break;
+            case EngineEvent::CONTROL_CHANGE: MidiControlChange(e.data1, e.data2); break;
+            case EngineEvent::PLUCK: Pluck(e.data1, e.octave, e.data2 / 127.0f); break;
+            case EngineEvent::NOTE_OFF: break;  // Tines ring out naturally
+        }
+    }
+}
+
+// A button's own note: a strum in strum mode, else a pluck now
+void PlayButton(int i) {
+    if (strum_mode != STRUM_OFF) {
+        // First note lands on the first sample of this block
+        StrumChord(i, audio_sample_count);
+    } else {
+        Pluck(i, 0, 1.0f);
+    }
+}
 
 void AudioCallback(AudioHandle::InputBuffer in,
                    AudioHandle::OutputBuffer out,
                    size_t size) {
+    cpu_load.OnBlockStart();
+
+    // Mark where this block starts in time (MIDI timestamps refer to it)
+    sample_clock.OnBlock(System::GetTick(), audio_sample_count);
+
+    // New tuning table published by the main loop: switch at this block
+    // boundary (pitches are precomputed, only 7 loads)
+    const TuningTable* tuning_now = tuning.Acquire();
+    if (tuning_now != tuning_active) {
+        tuning_active = tuning_now;
+        UpdateStringFreqs();
+    }
+
+    // Control capture: a new log starts with the pitches in use
+    if (capture.BeginBlock()) {
+        UpdateStringFreqs();
+    }
 
     // Update controls (once per block)
     for (int i = 0; i < 6; i++) {
@@ -212,68 +904,112 @@ void AudioCallback(AudioHandle::InputBuffer in,
     }
 
     // BUTTON SCANNING (Moved to AudioCallback to ensure it runs)
-    // Decimate: Only scan buttons every 12th callback (4 samples * 12 = 48 samples = 1ms)
-    static int callback_count = 0;
+    // Decimate: Only scan buttons every scan_blocks callbacks (1ms; 12 x 4 samples at 48kHz)
+    static uint32_t callback_count = 0;
+    static uint32_t shift_hold_ms = 0;
+    static bool shift_chorded = false;
     callback_count++;
-    if (callback_count >= 12) {
+    if (callback_count >= scan_blocks) {
         callback_count = 0;
+#ifdef KALIMBA_KEY_SCANNER
+        StartKeyScan();
+#endif
         
+        uint8_t button_mask = 0;
         for (int i = 0; i < NUM_STRINGS; i++) {
             // Read button (Active Low)
             bool current = !buttons[i].Read();
             
             // Rising edge detection
             if (current && !button_state[i]) {
-                button_triggered[i] = true;
                 demo_mode = false; // Stop demo on press
+                if (button_state[LOOPER_SHIFT_BUTTON]) shift_chorded = true;
+
+                // First press after a self-bench only closes the results
+                if (self_bench_show) {
+                    self_bench_show = false;
+                    if (i == LOOPER_SHIFT_BUTTON) shift_chorded = true;  // No note on release
+                // SHIFT's own note waits for its release: it may start a chord
+                } else if (i == LOOPER_SHIFT_BUTTON) {
+                // Looper chord: SHIFT held → action instead of a note
+                } else if (button_state[LOOPER_SHIFT_BUTTON] && i == LOOPER_RECORD_BUTTON) {
+                    looper.RecordPress();
+                } else if (button_state[LOOPER_SHIFT_BUTTON] && i == LOOPER_UNDO_BUTTON) {
+                    looper.Undo();
+                } else if (button_state[LOOPER_SHIFT_BUTTON] && i == LOOPER_CLEAR_BUTTON) {
+                    looper.Clear();
+                } else if (button_state[LOOPER_SHIFT_BUTTON] && i == STRUM_MODE_BUTTON) {
+                    strum_mode = (StrumMode)((strum_mode + 1) % 3);
+#ifdef KALIMBA_SD_CARD
+                } else if (button_state[LOOPER_SHIFT_BUTTON] && i == WAV_RECORD_BUTTON) {
+                    if (sd_available) wav_recorder.TogglePress();
+                } else if (button_state[LOOPER_SHIFT_BUTTON] && i == EXCITER_BUTTON) {
+                    if (sd_available) sample_exciter.SelectNext();
+#endif
+                } else {
+                    PlayButton(i);
+                }
+            } else if (!current && button_state[i] && i == LOOPER_SHIFT_BUTTON) {
+                // SHIFT let go without a chord or a screen switch: its note
+                if (!shift_chorded && shift_hold_ms < VIEW_HOLD_MS) PlayButton(i);
             }
             button_state[i] = current;
+            button_mask |= current << i;
+        }
+        capture.Buttons(button_mask);
+
+        // Button 7 held on its own (no chord) → next screen
+        if (button_state[LOOPER_SHIFT_BUTTON]) {
+            if (++shift_hold_ms == VIEW_HOLD_MS && !shift_chorded) {
+                display_view = (DisplayView)((display_view + 1) % NUM_VIEWS);
+            }
+        } else {
+            shift_hold_ms = 0;
+            shift_chorded = false;
         }
     }
 
     // Read control values with safety clamping
-    float pot_brightness   = fclamp(controls[0].Value(), 0.0f, 1.0f);  // A0
-    float pot_decay        = fclamp(controls[1].Value(), 0.0f, 1.0f);  // A1
-    float pot_octave       = fclamp(controls[2].Value(), 0.0f, 1.0f);  // A2 - Octave control
-    float pot_scale_select = fclamp(controls[3].Value(), 0.0f, 1.0f);  // A3 - Scale selector
-    float pot_reverb_mix   = fclamp(controls[4].Value(), 0.0f, 1.0f);  // A4 - Reverb mix
-    float pot_reverb_time  = fclamp(controls[5].Value(), 0.0f, 1.0f);  // A5 - Reverb time/feedback
-
-    // Map controls to parameters
-    global_brightness = 0.5f + (pot_brightness * 0.5f);  // 0.5 - 1.0
-    global_decay = 0.5f + (pot_decay * 0.5f);            // 0.5 - 1.0 damping coefficient
-    reverb_mix = pot_reverb_mix;                         // 0.0 - 1.0 dry/wet
-    reverb_feedback = 0.6f + (pot_reverb_time * 0.399f); // 0.6 - 0.999 (safe range, no infinite feedback)
-
-    // Update reverb parameters (once per block)
-    reverb.SetFeedback(reverb_feedback);
-    reverb.SetLpFreq(reverb_lpfreq);  // Fixed at 10kHz for warm, natural sound
+    // (12-bit and logged while capturing)
+    float pot_brightness   = capture.Pot(0, PotOrCc(0));               // A0 (or CC 74)
+    float pot_decay        = capture.Pot(1, PotOrCc(1));               // A1 (or CC 72)
+    float pot_octave       = capture.Pot(2, PotValue(2));              // A2 - Octave control
+    float pot_scale_select = capture.Pot(3, PotValue(3));              // A3 - Scale selector
+    float pot_reverb_mix   = capture.Pot(4, PotOrCc(4));               // A4 - Reverb mix (or CC 91)
+    float pot_reverb_time  = capture.Pot(5, PotOrCc(5));               // A5 - Reverb time (or CC 92)
+
+    // Map controls to parameters (ranges in KalimbaScales.h)
+    global_brightness = PotToBrightness(pot_brightness);
+    global_decay      = PotToDecay(pot_decay);
+    reverb_mix        = PotToReverbMix(pot_reverb_mix);
+    reverb_feedback   = PotToReverbFeedback(pot_reverb_time);
+
+    // Update engine parameters (once per block)
+    engine.SetBrightness(global_brightness);
+    engine.SetDecay(global_decay);
+    engine.SetReverb(reverb_mix, reverb_feedback, reverb_lpfreq);  // LP fixed at 10kHz for warm, natural sound
+#ifdef KALIMBA_SD_CARD
+    engine.SetReverbHook(conv_reverb.Ready() ? ConvolutionReverbHook : nullptr, nullptr);  // IR.WAV: instead of ReverbSc
+#endif
+    engine.SetFilter(filter_resonance > 0.0f, FILTER_TRACKING, filter_resonance, filter_morph);
+#ifdef KALIMBA_SD_CARD
+    engine.SetExciter(sample_exciter.Loaded() ? SampleExcite : nullptr, nullptr);
+#endif
 
     // NEW: Scale selection (5 scales, divide pot range into zones)
-    int new_scale = (int)(pot_scale_select * 4.99f);  // Maps 0.0-1.0 to 0-4
-    new_scale = fclamp(new_scale, 0, NUM_SCALES - 1);  // Safety bounds check
+    int new_scale = PotToScale(pot_scale_select);
     if (new_scale != current_scale) {
         current_scale = new_scale;
         // Update all string frequencies when scale changes
-        for (int s = 0; s < NUM_STRINGS; s++) {
-            float base_freq = scale_frequencies[current_scale][s];
-            // Apply octave shift using lookup table (optimized!)
-            float octave_ratio = OCTAVE_RATIOS[octave_offset + 2];  // +2 to map -2..+2 to 0..4
-            strings[s].SetFreq(base_freq * octave_ratio);
-        }
+        UpdateStringFreqs();
     }
 
     // NEW: Octave control (-2 to +2 octaves, 5 octave range)
-    int new_octave = (int)((pot_octave * 4.99f)) - 2;  // Maps 0.0-1.0 to -2..+2
-    new_octave = fclamp(new_octave, -2, 2);  // Safety bounds check
+    int new_octave = PotToOctave(pot_octave);
     if (new_octave != octave_offset) {
         octave_offset = new_octave;
         // Update all string frequencies when octave changes
-        for (int s = 0; s < NUM_STRINGS; s++) {
-            float base_freq = scale_frequencies[current_scale][s];
-            float octave_ratio = OCTAVE_RATIOS[octave_offset + 2];  // +2 to map -2..+2 to 0..4
-            strings[s].SetFreq(base_freq * octave_ratio);
-        }
+        UpdateStringFreqs();
     }
 
     // LFOs are fixed rate (no need to update every callback)
@@ -281,117 +1017,351 @@ void AudioCallback(AudioHandle::InputBuffer in,
 
     // DEMO MODE: Auto-play notes in sequence until user presses a button
     if (demo_mode) {
-        demo_timer++;
-        if (demo_timer >= DEMO_INTERVAL) {
+        demo_timer += size;
+        if (demo_timer >= demo_interval) {
             // Trigger the next note in sequence
-            button_triggered[demo_note_index] = true;
+            Pluck(demo_note_index, 0, 1.0f);
             demo_note_index = (demo_note_index + 1) % NUM_STRINGS;
             demo_timer = 0;
         }
     }
 
-    // Process audio samples
+#ifdef KALIMBA_PIEZO
+    PiezoFrames(audio_sample_count);
+#endif
+#ifdef KALIMBA_CV
+    CvFrame(audio_sample_count);
+#endif
+
+    // Render in segments that end where the next event is due: every
+    // MIDI / strum event lands on its exact sample, while the engine still
+    // works on whole runs of samples
+    size_t done = 0;
+    while (done < size) {
+        uint32_t now = audio_sample_count + done;
+        capture.At(done);
+        ApplyDueEvents(midi_uart_in.Queue(), now);
+#ifdef KALIMBA_USB_MIDI
+        ApplyDueEvents(midi_usb_in.Queue(), now);
+#endif
+#ifdef KALIMBA_KEY_SCANNER
+        ApplyDueEvents(key_scanner.Queue(), now);
+#endif
+        ApplyDueEvents(strummer.Scheduler(), now);
+#ifdef KALIMBA_PIEZO
+        ApplyDueEvents(piezo_scheduler, now);
+#endif
+#ifdef KALIMBA_CV
+        ApplyDueEvents(cv_scheduler, now);
+#endif
+
+        size_t n = size - done;
+        n = SamplesUntilNextEvent(midi_uart_in.Queue(), now, n);
+#ifdef KALIMBA_USB_MIDI
+        n = SamplesUntilNextEvent(midi_usb_in.Queue(), now, n);
+#endif
+#ifdef KALIMBA_KEY_SCANNER
+        n = SamplesUntilNextEvent(key_scanner.Queue(), now, n);
+#endif
+        n = SamplesUntilNextEvent(strummer.Scheduler(), now, n);
+#ifdef KALIMBA_PIEZO
+        n = SamplesUntilNextEvent(piezo_scheduler, now, n);
+#endif
+#ifdef KALIMBA_CV
+        n = SamplesUntilNextEvent(cv_scheduler, now, n);
+#endif
+
+        // Left channel doubles as the block buffer for the looper
+        engine.Process(out[0] + done, n);
+        done += n;
+    }
+
+    // Block peaks of every string for the level bars
+    for (int s = 0; s < NUM_STRINGS; s++) {
+        string_meters.Capture(s, engine.TakeVoicePeak(s));
+    }
+
+    // Timers advance by the whole block (LED, display refresh)
+    led_timer = led_timer > size ? led_timer - size : 0;
+    display_update_timer += size;
+
+    // Looper: record/overdub + playback, whole block at once
+    looper.Process(out[0], size);
+
+#ifdef KALIMBA_SD_CARD
+    // Hand the final mix to the SD writer (never blocks, drops on overrun)
+    wav_recorder.Push(out[0], size);
+#endif
+
+    // Final mix for the scope / spectrum screens
+    if (display_view != VIEW_STATUS) {
+        scope_snapshots.Push(out[0], size);
+    }
+
+    // Output MONO to both channels (for troubleshooting)
     for (size_t i = 0; i < size; i++) {
-        float output = 0.0f;
-
-        // Process LFOs for vibrato + tremolo modulation
-        float vibrato_sig = lfo_vibrato.Process();   // Sine wave for pitch
-        float tremolo_sig = lfo_tremolo.Process();   // Triangle wave for amplitude
-
-        // Process all 7 strings (full polyphony)
-        for (int s = 0; s < NUM_STRINGS; s++) {
-            // Check for trigger
-            bool trigger = button_triggered[s];
-            if (trigger) {
-                button_triggered[s] = false;  // Clear trigger flag
-                notes_active[s] = true;
-                note_activity_timer[s] = NOTE_DISPLAY_TIME;
-
-                // Blink LED on any trigger
-                led_timer = LED_ON_TIME;
-            }
+        out[1][i] = out[0][i];
+    }
 
-            // Update string parameters with global controls
-            strings[s].SetDamping(global_decay);
+    audio_sample_count += size;
+    cpu_load.OnBlockEnd();
+}
 
-            // Apply vibrato modulation (pitch) - only modulate, don't recalculate base freq
-            float base_freq = scale_frequencies[current_scale][s];
-            float octave_ratio = OCTAVE_RATIOS[octave_offset + 2];
-            float pitch_mod = 1.0f + (vibrato_sig * 0.02f * lfo_depth);  // ±2% vibrato
+// Self-bench results: load against the real-time budget of one block
+uint32_t SelfBenchBudget() {
+    return (uint32_t)((float)System::GetSysClkFreq() * self_bench.block_size / SELF_BENCH_SAMPLE_RATE);
+}
 
-            // Nyquist frequency safety check
-            float final_freq = base_freq * octave_ratio * pitch_mod;
-            const float NYQUIST_LIMIT = 24000.0f;  // 48kHz / 2
-            if (final_freq > NYQUIST_LIMIT) {
-                final_freq = NYQUIST_LIMIT;
-            }
-            strings[s].SetFreq(final_freq);
+void PrintSelfBench() {
+    const SelfBenchReport& r = self_bench;
+    uint32_t budget = SelfBenchBudget();
+    uint32_t load   = r.MeanBlock() * 1000 / budget;  // 0.1% steps
+    hw.PrintLine("SELFBENCH voices=%d block=%u blocks=%u cycles/block mean=%u max=%u load=%u.%u%% checksum=%08x",
+                 r.voices, (unsigned)r.block_size, (unsigned)r.blocks,
+                 (unsigned)r.MeanBlock(), (unsigned)r.max_block,
+                 (unsigned)(load / 10), (unsigned)(load % 10), (unsigned)r.checksum);
+    for (int s = 0; s < engine.NUM_STAGES; s++) {
+        hw.PrintLine("SELFBENCH stage=%s cycles/block=%u",
+                     SELF_BENCH_STAGE_NAMES[s], (unsigned)r.MeanStage(s));
+    }
+}
 
-            // Apply global brightness
-            float adjusted_brightness = fclamp(global_brightness, 0.5f, 1.0f);
-            strings[s].SetBrightness(adjusted_brightness);
+void DrawSelfBench() {
+    const SelfBenchReport& r = self_bench;
+    uint32_t budget = SelfBenchBudget();
+    uint32_t load   = r.MeanBlock() * 1000 / budget;
+    uint32_t peak   = r.max_block * 1000 / budget;
+    char str_buf[32];
 
-            // Generate string output
-            float string_output = strings[s].Process(trigger);
+    display.Fill(false);
+    display.SetCursor(0, 0);
+    snprintf(str_buf, sizeof(str_buf), "SELF BENCH %dv x%u", r.voices, (unsigned)r.block_size);
+    display.WriteString(str_buf, Font_6x8, true);
 
-            // Apply tremolo (amplitude modulation)
-            float amp_mod = 1.0f - (fabsf(tremolo_sig) * 0.3f * lfo_depth);  // Up to 30% amplitude variation
-            string_output *= amp_mod;
+    display.SetCursor(0, 10);
+    snprintf(str_buf, sizeof(str_buf), "Load %u.%u%% max %u.%u%%",
+             (unsigned)(load / 10), (unsigned)(load % 10),
+             (unsigned)(peak / 10), (unsigned)(peak % 10));
+    display.WriteString(str_buf, Font_6x8, true);
 
-            output += string_output;
-        }
+    // Cycles per block for each stage
+    display.SetCursor(0, 20);
+    snprintf(str_buf, sizeof(str_buf), "Str:%u Rvb:%u",
+             (unsigned)r.MeanStage(engine.STAGE_STRINGS), (unsigned)r.MeanStage(engine.STAGE_REVERB));
+    display.WriteString(str_buf, Font_6x8, true);
 
-        // Scale down polyphonic output to prevent clipping
-        output *= (1.0f / NUM_STRINGS);  // Scale down polyphonic output to prevent clipping
+    display.SetCursor(0, 30);
+    snprintf(str_buf, sizeof(str_buf), "Lfo:%u Mix:%u Sat:%u",
+             (unsigned)r.MeanStage(engine.STAGE_LFO), (unsigned)r.MeanStage(engine.STAGE_MIX),
+             (unsigned)r.MeanStage(engine.STAGE_SATURATOR));
+    display.WriteString(str_buf, Font_6x8, true);
 
-        // Remove DC offset (critical for Karplus-Strong)
-        output = dc_blocker.Process(output);
+    display.SetCursor(0, 40);
+    snprintf(str_buf, sizeof(str_buf), "Sum:%08X", (unsigned)r.checksum);
+    display.WriteString(str_buf, Font_6x8, true);
 
-        // Process reverb (mono output for troubleshooting)
-        float wet_l, wet_r;
-        reverb.Process(output, output, &wet_l, &wet_r);
+    display.SetCursor(0, 54);
+    display.WriteString("Press to play", Font_6x8, true);
 
-        // Mix dry and wet signals (blend stereo reverb to mono)
-        float reverb_mono = (wet_l + wet_r) * 0.5f;
-        output = output + (reverb_mono * reverb_mix);
+    display.Update();
+}
 
-        // Soft saturation for warmth
-        output = tanhf(output * 1.2f) * 0.8f;
+// CPU time the MDMA saved so far, per operation type
+void PrintMemOpsStats() {
+    const char* names[MemOps::NUM_KINDS] = {"copy", "fill"};
+    uint32_t cycles_per_us = System::GetSysClkFreq() / 1000000;
+    for (int k = 0; k < MemOps::NUM_KINDS; k++) {
+        MemOps::Stats st = mem_ops.GetStats((MemOps::Kind)k);
+        if (st.ops == 0) continue;
+        hw.PrintLine("MDMA %s: %u ops, %u KB, CPU %u us instead of %u us (saved %u us)",
+                     names[k], (unsigned)st.ops, (unsigned)(st.bytes / 1024),
+                     (unsigned)(st.cpu_cycles / cycles_per_us),
+                     (unsigned)(st.CpuOnlyCycles() / cycles_per_us),
+                     (unsigned)(st.SavedCycles() / cycles_per_us));
+    }
+}
 
-        // Output MONO to both channels (for troubleshooting)
-        out[0][i] = output;
-        out[1][i] = output;
+// Settings block rate → the codec's (KalimbaConfigParse() only lets
+// KALIMBA_CONFIG_RATES_KHZ through)
+SaiHandle::Config::SampleRate SaiRate(uint8_t khz) {
+    switch (khz) {
+        case 32: return SaiHandle::Config::SampleRate::SAI_32KHZ;
+        case 96: return SaiHandle::Config::SampleRate::SAI_96KHZ;
+        default: return SaiHandle::Config::SampleRate::SAI_48KHZ;
+    }
+}
 
-        // Decrement LED timer
-        if (led_timer > 0) {
-            led_timer--;
-        }
+// What the settings block changed (or why it was ignored)
+void PrintConfig() {
+    hw.PrintLine("CONFIG %s", KalimbaConfigStatusName(config_status));
+    if (config_status != CONFIG_OK) return;
+    hw.PrintLine("CONFIG rate=%ukHz pots fitted=%02x buttons=D%u D%u D%u D%u D%u D%u D%u",
+                 config.sample_rate_khz, config.pots_fitted, config.button_pins[0], config.button_pins[1],
+                 config.button_pins[2], config.button_pins[3], config.button_pins[4],
+                 config.button_pins[5], config.button_pins[6]);
+    if (config.custom_scale_slot >= 0) {
+        hw.PrintLine("CONFIG scale %d = %s", config.custom_scale_slot + 1, config.custom_scale_name);
+    }
+}
 
-        // Increment display update timer
-        display_update_timer++;
+// USB serial receive (interrupt): bytes for the text command lines
+void SerialRx(uint8_t* buf, uint32_t* len) {
+    for (uint32_t i = 0; i < *len; i++) serial_rx.Push(buf[i]);
+}
 
-        // Decrement note activity timers
-        for (int s = 0; s < NUM_STRINGS; s++) {
-            if (note_activity_timer[s] > 0) {
-                note_activity_timer[s]--;
-                if (note_activity_timer[s] == 0) {
-                    notes_active[s] = false;
-                }
-            }
+// Capture log as hex lines, read back by replay/ from a saved serial log
+void DumpCapture() {
+    static const char hex[] = "0123456789abcdef";
+    const uint8_t* data = capture.Data();
+    size_t size = capture.Size();
+    if (size == 0) {
+        hw.PrintLine("CAPTURE empty");
+        return;
+    }
+    hw.PrintLine("CAPTURE BEGIN size=%u crc=%08x", (unsigned)size, (unsigned)KalimbaCrc32(data, size));
+    char line[2 * CAPTURE_DUMP_LINE + 1];
+    for (size_t pos = 0; pos < size; pos += CAPTURE_DUMP_LINE) {
+        size_t n = size - pos < CAPTURE_DUMP_LINE ? size - pos : CAPTURE_DUMP_LINE;
+        for (size_t i = 0; i < n; i++) {
+            line[2 * i]     = hex[data[pos + i] >> 4];
+            line[2 * i + 1] = hex[data[pos + i] & 0xF];
         }
+        line[2 * n] = '\0';
+        hw.PrintLine("CAPTURE %s", line);
     }
+    hw.PrintLine("CAPTURE END");
+}
+
+// CAPTURE START | STOP | DUMP (DUMP stops first)
+void CaptureCommand(const char* args) {
+    while (*args == ' ') args++;
+    if (strcmp(args, "START") == 0) {
+        capture.RequestStart(false);
+        hw.PrintLine("CAPTURE started (strings already ringing are not in the log)");
+    } else if (strcmp(args, "STOP") == 0) {
+        capture.RequestStop();
+    } else if (strcmp(args, "DUMP") == 0) {
+        capture.RequestStop();
+        capture_dump_pending = true;
+    } else {
+        hw.PrintLine("CAPTURE error: START, STOP or DUMP");
+    }
+}
+
+// STRUM <ms>: spacing of strummed notes (0-250ms)
+void StrumCommand(const char* args) {
+    char* end;
+    float ms = strtof(args, &end);
+    if (end == args) {
+        hw.PrintLine("STRUM error: STRUM <ms>");
+        return;
+    }
+    strummer.SetSpacing(ms, hw.AudioSampleRate());
+    hw.PrintLine("STRUM spacing %u samples, %u chords dropped (scheduler full)",
+                 (unsigned)strummer.Spacing(), (unsigned)strummer.Dropped());
+}
+
+// One text command line: CAPTURE ..., STRUM ..., anything else is for the
+// tuning loader
+void Command(const char* line) {
+    if (!line) return;
+    if (strncmp(line, "CAPTURE", 7) == 0) {
+        CaptureCommand(line + 7);
+    } else if (strncmp(line, "STRUM", 5) == 0) {
+        StrumCommand(line + 5);
+    } else if (tuning_loader.Command(line) != TuningLoader::NONE) {
+        hw.PrintLine("TUNING %s", tuning_loader.Message());
+    }
+}
+
+// Commands from every source, then a COMMIT that waited for the swap and
+// a capture that stopped (command or full log)
+void ServiceCommands() {
+    Command(serial_lines.Read(serial_rx));
+    Command(midi_uart_lines.Read(midi_uart_in.TextQueue()));
+#ifdef KALIMBA_USB_MIDI
+    Command(midi_usb_lines.Read(midi_usb_in.TextQueue()));
+#endif
+    if (tuning_loader.Service() == TuningLoader::INSTALLED) {
+        hw.PrintLine("TUNING %s", tuning_loader.Message());
+    }
+
+    static bool was_capturing = false;
+    bool capturing = !capture.Stopped();
+    if (was_capturing && !capturing) {
+        hw.PrintLine("CAPTURE stopped: %u bytes%s", (unsigned)capture.Size(), capture.Full() ? " (log full)" : "");
+    }
+    was_capturing = capturing;
+    if (capture_dump_pending && !capturing) {
+        DumpCapture();
+        capture_dump_pending = false;
+    }
+}
+
+// Scope / spectrum: newest snapshot in, FFT slices out (main loop, every pass)
+void ServiceScope() {
+    if (!scope_fft.Busy()) {
+        const float* frame = scope_snapshots.Acquire();
+        if (!frame) return;
+        scope_frame = frame;
+        if (display_view == VIEW_SPECTRUM) scope_fft.Start(frame);
+    }
+    uint32_t start = System::GetUs();
+    scope_fft.Run<MicrosClock>(SCOPE_SLICE_US);
+    scope_fft_us += System::GetUs() - start;
+}
+
+void DrawScopeView() {
+    uint32_t start = System::GetUs();
+    char str_buf[32];
+
+    display.Fill(false);
+    display.SetCursor(0, 0);
+    if (display_view == VIEW_SCOPE) {
+        float gain = scope_frame ? DrawScope(display, scope_frame) : 1.0f;
+        snprintf(str_buf, sizeof(str_buf), "SCOPE x%.1f", gain);
+    } else {
+        DrawSpectrum(display, scope_fft.Bands());
+        int top_khz = (int)(hw.AudioSampleRate() / scope_snapshots.Decimation() / 2000.0f + 0.5f);
+        snprintf(str_buf, sizeof(str_buf), "SPECTRUM 0-%dk", top_khz);
+    }
+    display.WriteString(str_buf, Font_6x8, true);
+
+    display.SetCursor(98, 0);
+    snprintf(str_buf, sizeof(str_buf), "%2dfps", (int)(1.0f / scope_pacer.Last() + 0.5f));
+    display.WriteString(str_buf, Font_6x8, true);
+    display.Update();
+
+    // Next frame once this one's cost (FFT + drawing + the part of the
+    // transfer that blocks: all of it on I2C) fits the CPU share the
+    // audio leaves over
+    float cost = (scope_fft_us + System::GetUs() - start) * 1e-6f;
+    scope_fft_us = 0;
+    display_interval = (uint32_t)(scope_pacer.Interval(cost, cpu_load.GetAvgCpuLoad()) * hw.AudioSampleRate());
 }
 
 void UpdateDisplay() {
     if (!display_available) return;
 
+    if (self_bench_show) {
+        DrawSelfBench();
+        return;
+    }
+
+    if (display_view != VIEW_STATUS) {
+        DrawScopeView();
+        return;
+    }
+    display_interval = display_update_samples;
+
     // Clear display
     display.Fill(false);
     char str_buf[32];
 
     // Line 1: Current scale name (SAFETY: Use snprintf)
     display.SetCursor(0, 0);
-    snprintf(str_buf, sizeof(str_buf), "SCALE:%s", scale_names[current_scale]);
+    const TuningTable* table = tuning.Published();
+    snprintf(str_buf, sizeof(str_buf), "SCALE:%s", table->scale_names[current_scale]);
     display.WriteString(str_buf, Font_6x8, true);
 
     // Line 2: Octave shift (SAFETY: Use snprintf)
@@ -403,31 +1373,56 @@ void UpdateDisplay() {
     }
     display.WriteString(str_buf, Font_6x8, true);
 
-    // Line 3: Active buttons visualization (7 dots)
+#ifdef KALIMBA_SD_CARD
+    // WAV recording indicator
+    if (wav_recorder.IsRecording()) {
+        display.SetCursor(90, 10);
+        display.WriteString("WAV", Font_6x8, true);
+    }
+
+    // Exciter sample in use
+    if (sample_exciter.FileIndex() >= 0) {
+        display.SetCursor(66, 10);
+        snprintf(str_buf, sizeof(str_buf), "X%d", sample_exciter.FileIndex());
+        display.WriteString(str_buf, Font_6x8, true);
+    }
+#endif
+
+    // Line 3: Level bar per string (still ringing = bar, silent = dot)
     display.SetCursor(0, 22);
-    display.WriteString("Btns:", Font_6x8, true);
-    display.SetCursor(36, 22);
-    char button_viz[NUM_STRINGS + 1];
+    const char* btn_labels[] = {"Btns:", "Strm>", "Strm<"};
+    display.WriteString(btn_labels[strum_mode], Font_6x8, true);
+    string_meters.Update();
     for (int i = 0; i < NUM_STRINGS; i++) {
-        button_viz[i] = notes_active[i] ? 'O' : '.';
+        int x   = 36 + i * 7;
+        int bar = string_meters.Bar(i, METER_BAR_HEIGHT);
+        if (bar > 0) {
+            display.DrawRect(x, 29 - bar + 1, x + 4, 29, true, true);
+        } else {
+            display.DrawPixel(x + 2, 29, true);
+        }
     }
-    button_viz[NUM_STRINGS] = '\0';
-    display.WriteString(button_viz, Font_6x8, true);
+
+    // Looper state (right of the button dots)
+    const char* looper_labels[] = {"", "REC", "PLAY", "DUB"};
+    display.SetCursor(90, 22);
+    display.WriteString(looper.UndoPending() ? "UNDO" : looper_labels[(int)looper.GetState()],
+                        Font_6x8, true);
 
     // Line 4: Note names for current scale (SAFETY: Use snprintf)
     display.SetCursor(0, 32);
     snprintf(str_buf, sizeof(str_buf), "%s %s %s %s",
-            scale_note_names[current_scale][0],
-            scale_note_names[current_scale][1],
-            scale_note_names[current_scale][2],
-            scale_note_names[current_scale][3]);
+            table->note_names[current_scale][0],
+            table->note_names[current_scale][1],
+            table->note_names[current_scale][2],
+            table->note_names[current_scale][3]);
     display.WriteString(str_buf, Font_6x8, true);
 
     display.SetCursor(0, 40);
     snprintf(str_buf, sizeof(str_buf), "%s %s %s",
-            scale_note_names[current_scale][4],
-            scale_note_names[current_scale][5],
-            scale_note_names[current_scale][6]);
+            table->note_names[current_scale][4],
+            table->note_names[current_scale][5],
+            table->note_names[current_scale][6]);
     display.WriteString(str_buf, Font_6x8, true);
 
     // Line 5-6: Parameters (SAFETY: Use snprintf)
@@ -446,8 +1441,21 @@ void UpdateDisplay() {
 int main(void) {
     // Initialize hardware
     hw.Init();
-    hw.SetAudioBlockSize(4);  // Low latency (Reverted from 48)
+
+    // Settings block (QSPI is memory mapped after hw.Init()); anything
+    // invalid falls back to the built-in defaults
+    config_status = KalimbaConfigParse((const uint8_t*)hw.qspi.GetData(KALIMBA_CONFIG_QSPI_OFFSET),
+                                       KALIMBA_CONFIG_MAX_SIZE, CONFIG_RESERVED_PINS, button_pins, &config);
+    InitTuning();
+    hw.SetAudioBlockSize(AUDIO_BLOCK_SIZE);  // Low latency (Reverted from 48)
+    hw.SetAudioSampleRate(SaiRate(config.sample_rate_khz));
     float sample_rate = hw.AudioSampleRate();
+    scan_blocks            = (uint32_t)(sample_rate / AUDIO_BLOCK_SIZE / 1000.0f + 0.5f);
+    led_on_samples         = (uint32_t)(LED_ON_MS * 0.001f * sample_rate);
+    display_update_samples = (uint32_t)(DISPLAY_UPDATE_MS * 0.001f * sample_rate);
+    display_interval       = display_update_samples;
+    demo_interval          = (uint32_t)(DEMO_INTERVAL_MS * 0.001f * sample_rate);
+    scope_snapshots.SetDecimation(ScopeDecimation(sample_rate));
 
     // CRITICAL: Audio codec stabilization delay (AK4556 requires 1000ms per datasheet)
     System::Delay(1000);
@@ -459,8 +1467,42 @@ int main(void) {
     adc_config[3].InitSingle(seed::A3);
     adc_config[4].InitSingle(seed::A4);
     adc_config[5].InitSingle(seed::A5);
+#ifdef KALIMBA_PIEZO
+    // + the piezo pads
+    adc_config[6].InitSingle(seed::A6);
+    adc_config[7].InitSingle(seed::A7);
+    adc_config[8].InitSingle(seed::A8);
+    piezo.Init(PIEZO_FRAME_RATE);
+    piezo_frame_samples = sample_rate / PIEZO_FRAME_RATE;
+    piezo_latency = (uint32_t)(piezo.LatencyFrames(PIEZO_PASS_FRAMES) * piezo_frame_samples + 0.5f) + AUDIO_BLOCK_SIZE;
+#endif
+#ifdef KALIMBA_CV
+    // + gate 1, gate 2, pitch CV
+    adc_config[CV_ADC + 0].InitSingle(seed::A9);
+    adc_config[CV_ADC + 1].InitSingle(seed::A10);
+    adc_config[CV_ADC + 2].InitSingle(seed::A11);
+    cv_input.Init(sample_rate / AUDIO_BLOCK_SIZE);
+    cv_latency = cv_input.LatencyFrames(scan_blocks) * AUDIO_BLOCK_SIZE;
+#endif
+#if defined(KALIMBA_PIEZO) || defined(KALIMBA_CV)
+    // 4x oversampling instead of the default 32x: the DMA has to refresh
+    // every channel faster than the frames are taken (piezos 12kHz, CV one
+    // per audio block: up to 24kHz at 96kHz)
+    hw.adc.Init(adc_config, 6 + PIEZO_CHANNELS + CV_CHANNELS, AdcHandle::OVS_4);
+#else
     hw.adc.Init(adc_config, 6);
+#endif
     hw.adc.Start();
+#ifdef KALIMBA_PIEZO
+    // Piezo frames: TIM5 (TIM2 is libDaisy's System clock)
+    TimerHandle::Config piezo_timer_config;
+    piezo_timer_config.periph     = TimerHandle::Config::Peripheral::TIM_5;
+    piezo_timer_config.enable_irq = true;
+    piezo_timer.Init(piezo_timer_config);
+    piezo_timer.SetPeriod(piezo_timer.GetFreq() / PIEZO_FRAME_RATE - 1);
+    piezo_timer.SetCallback(PiezoTimer);
+    piezo_timer.Start();
+#endif
 
     // Initialize analog controls
     for (int i = 0; i < 6; i++) {
@@ -469,49 +1511,115 @@ int main(void) {
 
     // Initialize buttons with pull-up resistors (active-low)
     for (int i = 0; i < NUM_STRINGS; i++) {
-        buttons[i].Init(button_pins[i], GPIO::Mode::INPUT, GPIO::Pull::PULLUP);
+        buttons[i].Init(DaisySeed::GetPin(config.button_pins[i]), GPIO::Mode::INPUT, GPIO::Pull::PULLUP);
         button_state[i] = false;
-        button_triggered[i] = false;
-        notes_active[i] = false;
-        note_activity_timer[i] = 0;
+        string_octave[i] = 0;
     }
     
-    // ... (String/DSP Init) ...
-    // Initialize Karplus-Strong strings with initial scale (Pentatonic Major)
-    for (int i = 0; i < NUM_STRINGS; i++) {
-        strings[i].Init(sample_rate);
-        strings[i].SetFreq(scale_frequencies[0][i]);  // Start with scale 0
-        strings[i].SetDamping(global_decay);          // Use global damping
-        strings[i].SetBrightness(global_brightness);  // Use global brightness
-        strings[i].SetNonLinearity(0.1f);            // Metallic kalimba character
+    // Self-bench (Button 1 held at power-on): fixed render through the
+    // whole chain before the codec is started, so nothing is heard
+    System::Delay(1);  // Let the pull-ups settle
+    if (!buttons[SELF_BENCH_BUTTON].Read()) {
+        DwtClock::Enable();
+        RunSelfBench(engine, AUDIO_BLOCK_SIZE, &self_bench);
+        self_bench_ran  = true;
+        self_bench_show = true;
+        button_state[SELF_BENCH_BUTTON] = true;  // Held button is not a pluck
     }
 
-    // Initialize LFOs (vibrato + tremolo)
-    lfo_vibrato.Init(sample_rate);
-    lfo_vibrato.SetWaveform(Oscillator::WAVE_SIN);  // Sine for smooth pitch modulation
-    lfo_vibrato.SetAmp(1.0f);
-    lfo_vibrato.SetFreq(LFO_RATE);  // Fixed 2 Hz
-
-    lfo_tremolo.Init(sample_rate);
-    lfo_tremolo.SetWaveform(Oscillator::WAVE_TRI);  // Triangle for amplitude modulation
-    lfo_tremolo.SetAmp(1.0f);
-    lfo_tremolo.SetFreq(LFO_RATE * 0.7f);  // Slightly slower than vibrato (1.4 Hz)
-
-    // Initialize reverb (ReverbSc from DaisySP-LGPL)
-    reverb.Init(sample_rate);
-    reverb.SetFeedback(reverb_feedback);  // Initial reverb time (0.85)
-    reverb.SetLpFreq(reverb_lpfreq);      // Initial lowpass at 10kHz for warmth
+    // Capture (Button 2 held at power-on): log from the first audio block
+    capture.Init(capture_log, CAPTURE_LOG_BYTES, sample_rate, AUDIO_BLOCK_SIZE, NUM_STRINGS);
+    if (!buttons[CAPTURE_BUTTON].Read()) {
+        capture.RequestStart(true);
+        button_state[CAPTURE_BUTTON] = true;
+    }
 
-    // Initialize DC blocker
-    dc_blocker.Init(sample_rate);
+    // Initialize the DSP engine with the initial scale (Pentatonic Major)
+    engine.Init(sample_rate);
+    scope_fft.Init();
+    cpu_load.Init(sample_rate, AUDIO_BLOCK_SIZE);
+    engine.SetReverb(reverb_mix, reverb_feedback, reverb_lpfreq);
+    UpdateStringFreqs();
+
+    // Initialize looper (SDRAM is up after hw.Init()); undo restores run
+    // on the MDMA. Calibrate on the looper buffers = what the CPU would pay.
+    DwtClock::Enable();
+    mem_ops.Init();
+    mem_ops.Calibrate(looper_buffer, looper_undo_buffer, MEMOPS_CALIBRATE_BYTES);
+    looper.Init(looper_buffer, looper_undo_buffer, LOOPER_MAX_SAMPLES);
+    looper.SetMemOps(&mem_ops);
+
+#ifdef KALIMBA_SD_CARD
+    // Mount SD card (4-bit SDMMC1). No card = recording chord does nothing.
+    SdmmcHandler::Config sd_cfg;
+    sd_cfg.Defaults();
+    sd_cfg.speed = SdmmcHandler::Speed::FAST;
+    sd_cfg.width = SdmmcHandler::BusWidth::BITS_4;
+    sdcard.Init(sd_cfg);
+    fsi.Init(FatFSInterface::Config::MEDIA_SD);
+    sd_available = (f_mount(&fsi.GetSDFileSystem(), fsi.GetSDPath(), 1) == FR_OK);
+    wav_recorder.Init(&wav_sink, wav_ring, WAV_RING_SAMPLES, sample_rate);
+    sample_exciter.Init(&exciter_source, EXCITER_GAIN);
+    if (sd_available) LoadImpulseResponse(AUDIO_BLOCK_SIZE);
+#endif
+
+    // Strum spacing in samples (scheduled, so exact regardless of block size)
+    strummer.Init(sample_rate);
+
+#ifdef KALIMBA_KEY_SCANNER
+    // Key chain: SPI1 receive-only, mode 0 (74HC165 shifts on the rising
+    // edge); /16 gives a few MHz, the whole chain is read in microseconds
+    key_latch.Init(seed::D10, GPIO::Mode::OUTPUT);
+    key_latch.Write(true);
+    SpiHandle::Config key_cfg;
+    key_cfg.periph         = SpiHandle::Config::Peripheral::SPI_1;
+    key_cfg.mode           = SpiHandle::Config::Mode::MASTER;
+    key_cfg.direction      = SpiHandle::Config::Direction::TWO_LINES_RX_ONLY;
+    key_cfg.datasize       = 8;
+    key_cfg.clock_polarity = SpiHandle::Config::ClockPolarity::LOW;
+    key_cfg.clock_phase    = SpiHandle::Config::ClockPhase::ONE_EDGE;
+    key_cfg.nss            = SpiHandle::Config::NSS::SOFT;
+    key_cfg.baud_prescaler = SpiHandle::Config::BaudPrescaler::PS_16;
+    key_cfg.pin_config.sclk = seed::D8;
+    key_cfg.pin_config.miso = seed::D9;
+    key_cfg.pin_config.mosi = Pin();
+    key_cfg.pin_config.nss  = Pin();
+    key_spi.Init(key_cfg);
+    key_scanner.Init(KEY_CHIPS * 8, KEY_BASE_NOTE);
+#endif
 
     // Start audio BEFORE OLED init
+    sample_clock.Init(sample_rate, System::GetTickFreq());
     hw.StartAudio(AudioCallback);
 
+    // MIDI input: parsed + timestamped in the receive interrupt
+    midi_uart_in.Init(&sample_clock, System::GetTick, MIDI_LATENCY);
+    MidiUartTransport::Config midi_uart_cfg;  // Defaults: USART1, RX D14, TX D13
+    midi_uart.Init(midi_uart_cfg);
+    midi_uart.StartRx(KalimbaMidiIn::RxCallback, &midi_uart_in);
+#ifdef KALIMBA_USB_MIDI
+    midi_usb_in.Init(&sample_clock, System::GetTick, MIDI_LATENCY);
+    MidiUsbTransport::Config midi_usb_cfg;
+    midi_usb_cfg.periph = MidiUsbTransport::Config::EXTERNAL;  // Micro USB keeps the serial log
+    midi_usb.Init(midi_usb_cfg);
+    midi_usb.StartRx(KalimbaMidiIn::RxCallback, &midi_usb_in);
+#endif
+
     // Initialize Serial Logger (for debugging)
     // false = do not wait for PC connection (prevents blocking if USB is flaky)
     hw.StartLog(false);
-    hw.PrintLine("Digital Kalimba Started");
+    hw.PrintLine("Digital Kalimba Started (%ukHz)", (unsigned)(sample_rate / 1000.0f + 0.5f));
+    hw.usb_handle.SetReceiveCallback(SerialRx, UsbHandle::FS_INTERNAL);  // Text commands
+    PrintConfig();
+    if (self_bench_ran) PrintSelfBench();
+    if (!capture.Stopped()) hw.PrintLine("CAPTURE started at power-on");
+#ifdef KALIMBA_SD_CARD
+    hw.PrintLine(sd_available ? "SD card mounted" : "SD card not found - recording disabled");
+    if (conv_reverb.Ready()) {
+        hw.PrintLine("IR.WAV loaded - convolution reverb");
+        PrintMemOpsStats();  // Input spectra cleared on the MDMA
+    }
+#endif
 
     // Startup Flash: Blink LED 3 times to confirm reset
     for(int k=0; k<3; k++) {
@@ -536,43 +1644,110 @@ int main(void) {
 
         // Initialize OLED on first iteration
         if (!display_initialized) {
-            OledDisplay<SSD130xI2c128x64Driver>::Config disp_cfg;
-
-            // Try common I2C addresses
-            uint8_t addresses[] = {0x3C, 0x3D};
-            bool display_found = false;
-
-            for(int addr_idx = 0; addr_idx < 2 && !display_found; addr_idx++) {
-                disp_cfg.driver_config.transport_config.i2c_address = addresses[addr_idx];
-                disp_cfg.driver_config.transport_config.i2c_config.periph = I2CHandle::Config::Peripheral::I2C_1;
-                disp_cfg.driver_config.transport_config.i2c_config.speed = I2CHandle::Config::Speed::I2C_400KHZ;
-                disp_cfg.driver_config.transport_config.i2c_config.pin_config.scl = seed::D11;  // Back to original
-                disp_cfg.driver_config.transport_config.i2c_config.pin_config.sda = seed::D12;  // Back to original
-
-                display.Init(disp_cfg);
-
-                // Show splash screen
-                display.Fill(false);
-                display.SetCursor(10, 20);
-                display.WriteString("DIGITAL", Font_7x10, true);
-                display.SetCursor(20, 35);
-                display.WriteString("KALIMBA", Font_7x10, true);
-                display.Update();
-
-                display_found = true;
-                display_available = true;
-            }
+            OledDisplay<OledDriver>::Config disp_cfg;
+#ifdef KALIMBA_OLED_SPI
+            // SPI1 transmit-only, mode 0; /32 keeps SCK under the
+            // SSD1306's 10MHz
+            SpiHandle::Config& spi_cfg = disp_cfg.driver_config.transport_config.spi_config;
+            spi_cfg.periph          = SpiHandle::Config::Peripheral::SPI_1;
+            spi_cfg.mode            = SpiHandle::Config::Mode::MASTER;
+            spi_cfg.direction       = SpiHandle::Config::Direction::TWO_LINES_TX_ONLY;
+            spi_cfg.datasize        = 8;
+            spi_cfg.clock_polarity  = SpiHandle::Config::ClockPolarity::LOW;
+            spi_cfg.clock_phase     = SpiHandle::Config::ClockPhase::ONE_EDGE;
+            spi_cfg.nss             = SpiHandle::Config::NSS::SOFT;
+            spi_cfg.baud_prescaler  = SpiHandle::Config::BaudPrescaler::PS_32;
+            spi_cfg.pin_config.sclk = seed::D8;
+            spi_cfg.pin_config.mosi = seed::D10;
+            spi_cfg.pin_config.miso = Pin();
+            spi_cfg.pin_config.nss  = Pin();
+            disp_cfg.driver_config.transport_config.cs    = seed::D9;
+            disp_cfg.driver_config.transport_config.dc    = seed::D11;
+            disp_cfg.driver_config.transport_config.reset = seed::D12;
+#else
+            disp_cfg.driver_config.transport_config.i2c_address = 0x3C;  // 0x3D on some modules
+            disp_cfg.driver_config.transport_config.i2c_config.periph = I2CHandle::Config::Peripheral::I2C_1;
+            disp_cfg.driver_config.transport_config.i2c_config.speed = I2CHandle::Config::Speed::I2C_400KHZ;
+            disp_cfg.driver_config.transport_config.i2c_config.pin_config.scl = seed::D11;
+            disp_cfg.driver_config.transport_config.i2c_config.pin_config.sda = seed::D12;
+#endif
+            display.Init(disp_cfg);
+
+            // Show splash screen: the first Update() sends every page,
+            // timed to the end of the transfer
+            display.Fill(false);
+            display.SetCursor(10, 20);
+            display.WriteString("DIGITAL", Font_7x10, true);
+            display.SetCursor(20, 35);
+            display.WriteString("KALIMBA", Font_7x10, true);
+            uint32_t frame_start = System::GetUs();
+            display.Update();
+            uint32_t frame_cpu = System::GetUs() - frame_start;
+            while (OledTransport::Busy()) {}
+            hw.PrintLine("OLED %s: full frame %uus, main loop blocked %uus",
+#ifdef KALIMBA_OLED_SPI
+                         "SPI DMA",
+#else
+                         "I2C",
+#endif
+                         (unsigned)(System::GetUs() - frame_start), (unsigned)frame_cpu);
+            display_available = true;
 
             display_initialized = true;
             System::Delay(1000);  // Show splash
         }
 
+        // Scope / spectrum screens: FFT in budgeted slices between frames
+        if (display_view != VIEW_STATUS) {
+            ServiceScope();
+        }
+
         // Time-sliced display updates
-        if (display_update_timer >= DISPLAY_UPDATE_INTERVAL) {
+        if (display_update_timer >= display_interval) {
             UpdateDisplay();
             display_update_timer = 0;
         }
 
+        // Text commands (USB serial / SysEx): tuning tables, capture
+        ServiceCommands();
+
+        // Finish any pending looper undo (MDMA copy, off the audio thread)
+        static bool was_undoing = false;
+        looper.Service();
+        if (was_undoing && !looper.UndoPending()) {
+            PrintMemOpsStats();
+        }
+        was_undoing = looper.UndoPending();
+
+#ifdef KALIMBA_SD_CARD
+        // Flush recorded audio to SD (one 32KB chunk per pass)
+        static bool was_recording = false;
+        wav_recorder.Service();
+        if (was_recording && !wav_recorder.IsRecording()) {
+            hw.PrintLine("WAV saved: %u bytes, %u overruns, %u write errors%s",
+                         (unsigned)wav_recorder.BytesWritten(),
+                         (unsigned)wav_recorder.Overruns(),
+                         (unsigned)wav_recorder.WriteErrors(),
+                         wav_recorder.WriteErrors() ? " (card error, recording stopped)" : "");
+        }
+        was_recording = wav_recorder.IsRecording();
+
+        // Refill exciter stream buffers (read-ahead, one half per string)
+        sample_exciter.Service();
+
+        // Convolution reverb tail, in budgeted slices (a partition not
+        // finished in time is left out and counted)
+        if (conv_reverb.Ready()) {
+            static uint32_t conv_late = 0;
+            conv_running = true;
+            conv_reverb.Service<MicrosClock>(CONV_SLICE_US);
+            if (conv_reverb.Late() != conv_late) {
+                conv_late = conv_reverb.Late();
+                hw.PrintLine("CONV late partitions: %u", (unsigned)conv_late);
+            }
+        }
+#endif
+
         // Main loop delay
         System::Delay(1);
         loop_counter++;
@@ -0,0 +1,149 @@
+/*
+ * ENGINE EVENTS - Timestamped events for the Digital Kalimba audio engine
+ *
+ * Every event carries the absolute sample index it is due on. The audio
+ * callback applies due events inside its per-sample loop, so notes land on
+ * exact samples no matter where the block boundaries fall.
+ *
+ *   EventQueue     - lock-free SPSC FIFO, from an interrupt into the audio
+ *                    thread (events arrive in time order)
+ *   EventScheduler - time-ordered list owned by the audio thread, for
+ *                    events it schedules into its own future (strums)
+ *   ByteQueue      - lock-free SPSC byte FIFO, from an interrupt into the
+ *                    main loop (serial / SysEx text commands)
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// ============================================
+// Engine event (time in samples)
+// ============================================
+struct EngineEvent {
+    enum Type : uint8_t { NOTE_ON, NOTE_OFF, CONTROL_CHANGE, PLUCK };
+
+    uint32_t time;    // Absolute sample index the event is due
+    Type     type;
+    uint8_t  data1;   // Note number / CC number / string (PLUCK)
+    uint8_t  data2;   // Velocity / CC value
+    int8_t   octave;  // Per-string octave (PLUCK)
+};
+
+// True if `time` is due at sample `now` (wrap-safe)
+inline bool EventDue(uint32_t time, uint32_t now) {
+    return (int32_t)(time - now) <= 0;
+}
+
+// Samples from `now` until the next pending event (at most `limit`):
+// the audio callback renders up to there, then applies it
+template <typename Events>
+size_t SamplesUntilNextEvent(Events& events, uint32_t now, size_t limit) {
+    EngineEvent e;
+    if (events.Peek(&e) && !EventDue(e.time, now) && e.time - now < limit) {
+        return e.time - now;
+    }
+    return limit;
+}
+
+// ============================================
+// Lock-free single-producer / single-consumer queue
+// ============================================
+template <uint32_t SIZE>  // Power of two
+class EventQueue {
+  public:
+    bool Push(const EngineEvent& e) {
+        uint32_t w = write_.load(std::memory_order_relaxed);
+        if (w - read_.load(std::memory_order_acquire) >= SIZE) return false;
+        buf_[w & (SIZE - 1)] = e;
+        write_.store(w + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Next event without removing it
+    bool Peek(EngineEvent* e) const {
+        uint32_t r = read_.load(std::memory_order_relaxed);
+        if (r == write_.load(std::memory_order_acquire)) return false;
+        *e = buf_[r & (SIZE - 1)];
+        return true;
+    }
+
+    void Pop() { read_.store(read_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+  private:
+    EngineEvent           buf_[SIZE];
+    std::atomic<uint32_t> write_{0};
+    std::atomic<uint32_t> read_{0};
+};
+
+// ============================================
+// Future events, audio thread only
+// ============================================
+template <size_t SIZE>
+class EventScheduler {
+  public:
+    // Insertion sort: SIZE is small and strums arrive nearly in order
+    bool Schedule(const EngineEvent& e) {
+        if (count_ >= SIZE) return false;
+        size_t i = count_;
+        while (i > 0 && (int32_t)(events_[i - 1].time - e.time) > 0) {
+            events_[i] = events_[i - 1];
+            i--;
+        }
+        events_[i] = e;
+        count_++;
+        return true;
+    }
+
+    bool Peek(EngineEvent* e) const {
+        if (count_ == 0) return false;
+        *e = events_[0];
+        return true;
+    }
+
+    void Pop() {
+        for (size_t i = 1; i < count_; i++) {
+            events_[i - 1] = events_[i];
+        }
+        count_--;
+    }
+
+    void   Clear() { count_ = 0; }
+    size_t Count() const { return count_; }
+
+  private:
+    EngineEvent events_[SIZE];
+    size_t      count_ = 0;
+};
+
+// ============================================
+// Lock-free single-producer / single-consumer byte FIFO
+// ============================================
+const uint8_t BYTE_QUEUE_CANCEL = 0x18;  // ASCII CAN: drop the partial line
+
+template <uint32_t SIZE>  // Power of two
+class ByteQueue {
+  public:
+    bool Push(uint8_t b) {
+        uint32_t w = write_.load(std::memory_order_relaxed);
+        if (w - read_.load(std::memory_order_acquire) >= SIZE) return false;
+        buf_[w & (SIZE - 1)] = b;
+        write_.store(w + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool Pop(uint8_t* b) {
+        uint32_t r = read_.load(std::memory_order_relaxed);
+        if (r == write_.load(std::memory_order_acquire)) return false;
+        *b = buf_[r & (SIZE - 1)];
+        read_.store(r + 1, std::memory_order_release);
+        return true;
+    }
+
+  private:
+    uint8_t               buf_[SIZE];
+    std::atomic<uint32_t> write_{0};
+    std::atomic<uint32_t> read_{0};
+};
@@ -0,0 +1,224 @@
+/*
+ * KALIMBA CONFIG - Settings block in QSPI flash, read at boot
+ *
+ * Lets the web flasher change settings by rewriting one flash sector
+ * instead of the whole firmware image.
+ *
+ * WHERE:
+ *   QSPI offset KALIMBA_CONFIG_QSPI_OFFSET (0x907F0000, the last 64KB
+ *   block of the 8MB chip, reserved for this block). The H750's internal
+ *   flash is a single 128KB sector holding the firmware, so it can't host
+ *   a separately erasable block. Written over DFU through the Daisy
+ *   bootloader's QSPI region.
+ *
+ * LAYOUT (little-endian, packed):
+ *   header   u32 magic "KCFG"  u16 version  u16 length  u32 crc32(payload)
+ *   payload  version 1, KALIMBA_CONFIG_V1_SIZE bytes:
+ *     u8       pots_fitted        bit p = pot Ap is wired (0x3F = all)
+ *     f32[6]   pot_values         used instead of pots that are not fitted
+ *     u8[7]    button_pins        Daisy Seed D number, 0xFF = default pin
+ *     u8       custom_scale_slot  scale replaced by the custom one, 0xFF = none
+ *     char[16] custom_scale_name
+ *     char[7][4] custom_note_names
+ *     f32[7]   custom_freqs       Hz
+ *   payload  version 2, KALIMBA_CONFIG_V2_SIZE bytes: version 1's, then
+ *     u8       sample_rate_khz    32, 48 or 96 (engine and codec)
+ *   Version 1 blocks still load, at 48kHz.
+ *
+ * FALLBACK:
+ *   Anything wrong (erased flash, bad magic / version / length / CRC, out
+ *   of range values, pin clashes) → every setting back to the firmware
+ *   defaults, never a partial config. The status says why.
+ *
+ * Portable (no libDaisy dependency); web-flasher/config.js writes the
+ * same layout.
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "KalimbaScales.h"
+
+const uint32_t KALIMBA_CONFIG_MAGIC       = 0x4746434B;  // "KCFG"
+const uint16_t KALIMBA_CONFIG_VERSION     = 2;
+const uint32_t KALIMBA_CONFIG_QSPI_OFFSET = 0x7F0000;    // 0x90000000 + offset
+const size_t   KALIMBA_CONFIG_HEADER_SIZE = 12;
+const size_t   KALIMBA_CONFIG_V1_SIZE     = 1 + 6 * 4 + NUM_STRINGS + 1 + 16 + NUM_STRINGS * 4 + NUM_STRINGS * 4;
+const size_t   KALIMBA_CONFIG_V2_SIZE     = KALIMBA_CONFIG_V1_SIZE + 1;
+const size_t   KALIMBA_CONFIG_MAX_SIZE    = 4096;        // One QSPI sector
+
+const int     KALIMBA_CONFIG_NUM_POTS    = 6;
+const uint8_t KALIMBA_CONFIG_PIN_DEFAULT = 0xFF;
+const uint8_t KALIMBA_CONFIG_MAX_PIN     = 32;           // D0 - D32
+const uint8_t KALIMBA_CONFIG_NO_SCALE    = 0xFF;
+const float   KALIMBA_CONFIG_MIN_FREQ    = 20.0f;
+const float   KALIMBA_CONFIG_MAX_FREQ    = 4000.0f;      // x4 octave shift stays < Nyquist (32kHz: at it)
+const uint8_t KALIMBA_CONFIG_RATES_KHZ[] = {32, 48, 96};  // SAI rates the codec runs at
+const uint8_t KALIMBA_CONFIG_DEFAULT_KHZ = 48;
+
+enum KalimbaConfigStatus {
+    CONFIG_OK,
+    CONFIG_EMPTY,        // Erased flash: nothing written yet
+    CONFIG_BAD_MAGIC,
+    CONFIG_BAD_VERSION,  // Written by a newer flasher
+    CONFIG_BAD_LENGTH,
+    CONFIG_BAD_CRC,
+    CONFIG_BAD_VALUE     // Out of range value or pin clash
+};
+
+inline const char* KalimbaConfigStatusName(KalimbaConfigStatus status) {
+    static const char* const names[] = {"ok", "empty", "bad magic", "bad version",
+                                        "bad length", "bad crc", "bad value"};
+    return names[status];
+}
+
+// Decoded settings (always complete: defaults where nothing was written)
+struct KalimbaConfig {
+    uint8_t pots_fitted;
+    float   pot_values[KALIMBA_CONFIG_NUM_POTS];
+    uint8_t button_pins[NUM_STRINGS];  // Resolved D numbers
+    int     custom_scale_slot;         // -1 = none
+    char    custom_scale_name[16];
+    char    custom_note_names[NUM_STRINGS][4];
+    float   custom_freqs[NUM_STRINGS];
+    uint8_t sample_rate_khz;           // 32 / 48 / 96
+
+    void Defaults(const uint8_t default_pins[NUM_STRINGS]) {
+        pots_fitted = (1 << KALIMBA_CONFIG_NUM_POTS) - 1;
+        for (int p = 0; p < KALIMBA_CONFIG_NUM_POTS; p++) pot_values[p] = 0.5f;
+        memcpy(button_pins, default_pins, NUM_STRINGS);
+        custom_scale_slot = -1;
+        memset(custom_scale_name, 0, sizeof(custom_scale_name));
+        memset(custom_note_names, 0, sizeof(custom_note_names));
+        memset(custom_freqs, 0, sizeof(custom_freqs));
+        sample_rate_khz = KALIMBA_CONFIG_DEFAULT_KHZ;
+    }
+
+    bool PotFitted(int p) const { return pots_fitted & (1 << p); }
+};
+
+// CRC-32 (IEEE 802.3, reflected, as zlib / JS implementations)
+inline uint32_t KalimbaCrc32(const uint8_t* data, size_t size) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < size; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0u - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+// ============================================
+// Parsing
+// ============================================
+
+// Byte-wise reads: the block has no alignment guarantees
+class KalimbaConfigReader {
+  public:
+    explicit KalimbaConfigReader(const uint8_t* p) : p_(p) {}
+
+    uint8_t  U8() { return *p_++; }
+    uint16_t U16() { uint16_t v = p_[0] | (p_[1] << 8); p_ += 2; return v; }
+    uint32_t U32() {
+        uint32_t v = p_[0] | (p_[1] << 8) | (p_[2] << 16) | ((uint32_t)p_[3] << 24);
+        p_ += 4;
+        return v;
+    }
+    float F32() {
+        uint32_t bits = U32();
+        float    v;
+        memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+    void Chars(char* dst, size_t size) {
+        memcpy(dst, p_, size);
+        dst[size - 1] = '\0';  // Always terminated, whatever was written
+        p_ += size;
+    }
+
+  private:
+    const uint8_t* p_;
+};
+
+inline bool KalimbaConfigInRange(float v, float lo, float hi) {
+    return isfinite(v) && v >= lo && v <= hi;
+}
+
+// `data` is the raw block (at least KALIMBA_CONFIG_HEADER_SIZE bytes
+// readable). `reserved_pins` has bit n set for every D pin used by
+// something else. On any error *config holds the defaults.
+inline KalimbaConfigStatus KalimbaConfigParse(const uint8_t* data, size_t size, uint64_t reserved_pins,
+                                              const uint8_t default_pins[NUM_STRINGS],
+                                              KalimbaConfig* config) {
+    config->Defaults(default_pins);
+
+    KalimbaConfigReader header(data);
+    uint32_t magic   = header.U32();
+    uint16_t version = header.U16();
+    uint16_t length  = header.U16();
+    uint32_t crc     = header.U32();
+
+    if (magic == 0xFFFFFFFF) return CONFIG_EMPTY;
+    if (magic != KALIMBA_CONFIG_MAGIC) return CONFIG_BAD_MAGIC;
+    if (version == 0 || version > KALIMBA_CONFIG_VERSION) return CONFIG_BAD_VERSION;
+    size_t expected = version == 1 ? KALIMBA_CONFIG_V1_SIZE : KALIMBA_CONFIG_V2_SIZE;
+    if (length != expected || KALIMBA_CONFIG_HEADER_SIZE + length > size) {
+        return CONFIG_BAD_LENGTH;
+    }
+    const uint8_t* payload = data + KALIMBA_CONFIG_HEADER_SIZE;
+    if (KalimbaCrc32(payload, length) != crc) return CONFIG_BAD_CRC;
+
+    // Decode into a scratch copy: *config only changes if all of it is valid
+    KalimbaConfig       cfg = *config;
+    KalimbaConfigReader in(payload);
+
+    cfg.pots_fitted = in.U8() & ((1 << KALIMBA_CONFIG_NUM_POTS) - 1);
+    for (int p = 0; p < KALIMBA_CONFIG_NUM_POTS; p++) {
+        cfg.pot_values[p] = in.F32();
+        if (!KalimbaConfigInRange(cfg.pot_values[p], 0.0f, 1.0f)) return CONFIG_BAD_VALUE;
+    }
+
+    uint64_t used = 0;
+    for (int s = 0; s < NUM_STRINGS; s++) {
+        uint8_t pin = in.U8();
+        if (pin != KALIMBA_CONFIG_PIN_DEFAULT) {
+            if (pin > KALIMBA_CONFIG_MAX_PIN || (reserved_pins >> pin) & 1) return CONFIG_BAD_VALUE;
+            cfg.button_pins[s] = pin;
+        }
+    }
+    for (int s = 0; s < NUM_STRINGS; s++) {
+        uint64_t bit = 1ull << cfg.button_pins[s];
+        if (used & bit) return CONFIG_BAD_VALUE;  // Two buttons on one pin
+        used |= bit;
+    }
+
+    uint8_t slot = in.U8();
+    if (slot != KALIMBA_CONFIG_NO_SCALE && slot >= NUM_SCALES) return CONFIG_BAD_VALUE;
+    cfg.custom_scale_slot = slot == KALIMBA_CONFIG_NO_SCALE ? -1 : slot;
+    in.Chars(cfg.custom_scale_name, sizeof(cfg.custom_scale_name));
+    for (int s = 0; s < NUM_STRINGS; s++) {
+        in.Chars(cfg.custom_note_names[s], sizeof(cfg.custom_note_names[s]));
+    }
+    for (int s = 0; s < NUM_STRINGS; s++) {
+        cfg.custom_freqs[s] = in.F32();
+        if (cfg.custom_scale_slot >= 0
+            && !KalimbaConfigInRange(cfg.custom_freqs[s], KALIMBA_CONFIG_MIN_FREQ, KALIMBA_CONFIG_MAX_FREQ)) {
+            return CONFIG_BAD_VALUE;
+        }
+    }
+
+    if (version >= 2) {
+        cfg.sample_rate_khz = in.U8();
+        bool known = false;
+        for (uint8_t khz : KALIMBA_CONFIG_RATES_KHZ) known = known || cfg.sample_rate_khz == khz;
+        if (!known) return CONFIG_BAD_VALUE;
+    }
+
+    *config = cfg;
+    return CONFIG_OK;
+}
@@ -0,0 +1,664 @@
+/*
+ * KALIMBA ENGINE - The Digital Kalimba synthesis chain, without hardware
+ *
+ * SIGNAL PATH (per block):
+ *   LFOs → N tine waveguides (TineString.h: stretched partials, vibrato
+ *   + tremolo) → per-voice filters (optional) → mix / DC block
+ *   → ReverbSc (mono blend) or a reverb hook → soft saturation
+ *
+ * Only depends on DaisySP, TineString.h and VoiceFilter.h, so the exact
+ * same code runs in the firmware, the Cortex-M7 emulator benchmark
+ * (bench/) and any host build.
+ *
+ * BLOCK PROCESSING:
+ *   Each stage runs over the whole block before the next one starts (LFO
+ *   values are computed once into small arrays, every string then loops
+ *   over the block). Triggers always land on the first sample of a
+ *   Process() call - callers split blocks at event times for
+ *   sample-accurate timing.
+ *
+ * MULTI-RATE VOICES:
+ *   Each pluck picks its string's internal rate - 48, 24 or 12 kHz at a
+ *   48kHz engine - from pitch, brightness and decay: the cutoff of the
+ *   string's damping filter (TineString.h, Rings' law) has to stay under
+ *   MULTIRATE_BANDWIDTH x the rate. Dark, low
+ *   strings run at a half or a quarter of the samples and touch that
+ *   much less of their delay line; strings too low for the full-rate
+ *   delay line (< ~47Hz) get a reduced rate so they keep their pitch.
+ *   Reduced-rate strings are summed on a bus per rate and brought up by
+ *   one polyphase interpolator per rate, shared by all its voices (12
+ *   taps per phase, ~0.25 / 0.5ms of delay). Plucks land on the
+ *   string's next sample at its own rate. A string only changes rate
+ *   once it has gone quiet (a move re-Inits it), unless its old rate
+ *   can't hold the new pitch; sample exciters and SetMultiRate(false)
+ *   keep every string at full rate.
+ *
+ * VOICE FILTERS:
+ *   With SetFilter() on, each string goes through its own SVF before the
+ *   mix, cutoff = note x tracking, opened further by the pluck's velocity
+ *   (x0.5 at 0 .. x1.5 at full). The strings then write into a frame
+ *   buffer (lane = voice) and one SvfBank pass filters every voice, each
+ *   at its own rate; off, the stage costs nothing.
+ *
+ * METERING:
+ *   Each voice's peak (after tremolo) is tracked while it renders and
+ *   held until TakeVoicePeak() - the UI's level meters need no extra pass
+ *   over the audio.
+ *
+ * STATE SNAPSHOTS:
+ *   SaveState() / LoadState() write and read everything the future output
+ *   depends on, field by field behind a header (magic, version, size,
+ *   voices, rate): string delay lines, write positions and filter states,
+ *   voice pitches, levels, pending plucks and rates, interpolator
+ *   histories, SVF integrators, LFO phases, DC blocker, reverb buffers and
+ *   control values. Coefficients derived from those and per-chunk scratch
+ *   are not saved, nor are the exciter / reverb hooks (they stay as set on
+ *   the loading engine). DaisySP keeps its objects' state private, so the
+ *   LFOs, DC blocker and ReverbSc go in whole; ReverbSc's delay lines
+ *   point into its own buffer and are moved over on load. The engine has
+ *   no PRNG and DaisySP keeps no state outside its objects, so a render
+ *   resumed from a snapshot - in any engine of the same build Init()ed at
+ *   the same rate, a fresh one included - is bit-exact.
+ *
+ * PROFILING:
+ *   The Profiler template parameter gets Begin()/End() around every stage.
+ *   NoProfiler compiles to nothing; the benchmarks plug in a cycle or
+ *   instruction counter.
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "daisysp.h"
+#include "TineString.h"
+#include "VoiceFilter.h"
+
+// Default profiler: no cost at all
+struct NoProfiler {
+    static inline void Begin(int stage) {}
+    static inline void End(int stage) {}
+};
+
+template <int NUM_VOICES, typename Profiler = NoProfiler>
+class KalimbaEngine {
+  public:
+    enum Stage {
+        STAGE_LFO,
+        STAGE_STRINGS,
+        STAGE_FILTER,
+        STAGE_MIX,
+        STAGE_REVERB,
+        STAGE_SATURATOR,
+        NUM_STAGES
+    };
+
+    // Longest run processed in one go (longer calls are chunked)
+    static const size_t MAX_BLOCK = 48;
+
+    // Voice rates: sample rate divided by 1 << rate
+    enum VoiceRate {
+        RATE_FULL,
+        RATE_HALF,
+        RATE_QUARTER,
+        NUM_RATES
+    };
+
+    // Optional excitation source (e.g. streamed samples), replaces the
+    // impulse. `trigger` is true on the first sample after Trigger().
+    typedef float (*ExciteFn)(int voice, bool trigger, void* context);
+
+    // Optional reverb in place of ReverbSc (e.g. a convolution reverb):
+    // wet signal of `in` into `wet`, mixed in at the SetReverb() mix ahead
+    // of the saturator. Called once per chunk of up to MAX_BLOCK samples.
+    typedef void (*ReverbFn)(const float* in, float* wet, size_t size, void* context);
+
+    KalimbaEngine() {}
+    ~KalimbaEngine() {}
+
+    void Init(float sample_rate) {
+        for (int v = 0; v < NUM_VOICES; v++) {
+            strings_[v].Init(sample_rate);
+            freq_[v]      = 220.0f;
+            level_[v]     = 1.0f;
+            triggered_[v] = false;
+            peak_[v]      = 0.0f;
+            ring_[v]      = 0.0f;
+            ring_now_[v]  = 0.0f;
+            rate_[v]      = RATE_FULL;
+        }
+        sample_rate_ = sample_rate;
+        ring_count_  = 0;
+        InitInterpolators();
+        filters_.Init();
+        for (int l = 0; l < FILTER_STRIDE; l++) filter_frames_[l] = 0;
+
+        // Vibrato (sine) + tremolo (triangle, slightly slower)
+        lfo_vibrato_.Init(sample_rate);
+        lfo_vibrato_.SetWaveform(daisysp::Oscillator::WAVE_SIN);
+        lfo_vibrato_.SetAmp(1.0f);
+        lfo_vibrato_.SetFreq(LFO_RATE);
+
+        lfo_tremolo_.Init(sample_rate);
+        lfo_tremolo_.SetWaveform(daisysp::Oscillator::WAVE_TRI);
+        lfo_tremolo_.SetAmp(1.0f);
+        lfo_tremolo_.SetFreq(LFO_RATE * 0.7f);
+
+        reverb_.Init(sample_rate);
+        reverb_.SetFeedback(reverb_feedback_);
+        reverb_.SetLpFreq(reverb_lpfreq_);
+
+        dc_blocker_.Init(sample_rate);
+    }
+
+    // ============================================
+    // Control rate (once per block is plenty)
+    // ============================================
+
+    void SetBrightness(float brightness) { brightness_ = brightness; }
+    void SetDecay(float decay) { decay_ = decay; }
+    void SetLfoDepth(float depth) { lfo_depth_ = depth; }
+
+    // Partial stretch of the tines, 0 (harmonic) .. 1 (TineString.h)
+    void SetStiffness(float stiffness) { stiffness_ = stiffness; }
+
+    // Per-voice rates on (default) or every string at full rate; takes
+    // effect at each string's next pluck
+    void SetMultiRate(bool enabled) { multi_rate_ = enabled; }
+
+    // Per-voice filter: cutoff = note x tracking (x velocity, see above),
+    // resonance 0..1, morph 0 (lowpass) .. 1 (bandpass)
+    void SetFilter(bool enabled, float tracking, float resonance, float morph) {
+        if (enabled && !filter_on_) filters_.Init();  // No stale state
+        filter_on_        = enabled;
+        filter_tracking_  = tracking;
+        filter_resonance_ = resonance;
+        filter_morph_     = morph;
+    }
+
+    void SetReverb(float mix, float feedback, float lp_freq) {
+        reverb_mix_      = mix;
+        reverb_feedback_ = feedback;
+        reverb_lpfreq_   = lp_freq;
+        reverb_.SetFeedback(feedback);
+        reverb_.SetLpFreq(lp_freq);
+    }
+
+    // Reverb hook instead of ReverbSc (nullptr: ReverbSc, the default)
+    void SetReverbHook(ReverbFn fn, void* context) {
+        reverb_hook_ = fn;
+        reverb_ctx_  = context;
+    }
+
+    // Base pitch of one string (scale note x octave ratio)
+    void SetVoiceFreq(int v, float freq) { freq_[v] = freq; }
+
+    void SetExciter(ExciteFn fn, void* context) {
+        exciter_     = fn;
+        exciter_ctx_ = context;
+    }
+
+    // Pluck on the first sample of the next Process() call
+    void Trigger(int v, float level) {
+        level_[v]     = level;
+        triggered_[v] = true;
+    }
+
+    // ============================================
+    // Audio
+    // ============================================
+
+    void Process(float* out, size_t size) {
+        while (size > 0) {
+            size_t n = size < MAX_BLOCK ? size : MAX_BLOCK;
+            ProcessChunk(out, n);
+            out += n;
+            size -= n;
+        }
+    }
+
+    // Rate voice v runs at since its last pluck
+    VoiceRate GetVoiceRate(int v) const { return (VoiceRate)rate_[v]; }
+
+    // Peak of voice v since the last call (same thread as Process())
+    float TakeVoicePeak(int v) {
+        float peak = peak_[v];
+        peak_[v]   = 0.0f;
+        return peak;
+    }
+
+    // ============================================
+    // State snapshots (host renderers: checkpoint / resume)
+    // ============================================
+
+    static const uint32_t STATE_MAGIC   = 0x4B53544Eu;  // "KSTN"
+    static const uint32_t STATE_VERSION = 1;
+
+    // Bytes SaveState() writes (header included)
+    size_t StateSize() const {
+        StateCounter counter;
+        Transfer(counter, *this);
+        return sizeof(StateHeader) + counter.size + sizeof(reverb_);
+    }
+
+    void SaveState(void* dst) const {
+        StateHeader header = {STATE_MAGIC,  STATE_VERSION,    (uint32_t)StateSize(), NUM_VOICES,
+                              sample_rate_, sizeof(reverb_), (uint64_t)(uintptr_t)&reverb_};
+        memcpy(dst, &header, sizeof(header));
+        StateWriter writer = {static_cast<uint8_t*>(dst) + sizeof(header)};
+        Transfer(writer, *this);
+        writer(&reverb_, sizeof(reverb_));
+    }
+
+    // Into an engine Init()ed at the snapshot's rate. False (engine left
+    // as it was) if the snapshot is from another version, voice count,
+    // rate or DaisySP build, or shorter than its header says.
+    bool LoadState(const void* src, size_t size) {
+        StateHeader header;
+        if (size < sizeof(header)) return false;
+        memcpy(&header, src, sizeof(header));
+        if (header.magic != STATE_MAGIC || header.version != STATE_VERSION || header.size != StateSize()
+            || header.size > size || header.voices != NUM_VOICES || header.sample_rate != sample_rate_
+            || header.reverb_size != sizeof(reverb_)) {
+            return false;
+        }
+        StateReader reader = {static_cast<const uint8_t*>(src) + sizeof(header)};
+        Transfer(reader, *this);
+        LoadReverb(reader.p, (uintptr_t)header.reverb_address);
+        return true;
+    }
+
+  private:
+    static constexpr float LFO_RATE = 2.0f;  // Hz
+
+    // Snapshot header (32 bytes, no padding)
+    struct StateHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t size;  // Header included
+        uint32_t voices;
+        float    sample_rate;
+        uint32_t reverb_size;     // sizeof(ReverbSc): same DaisySP build
+        uint64_t reverb_address;  // The saving engine's ReverbSc
+    };
+
+    // Transfer() visitors: io(field, bytes) per field, io.Object(x) for
+    // members with their own SaveState() / LoadState()
+    struct StateCounter {
+        size_t size = 0;
+        void   operator()(const void* field, size_t bytes) { size += bytes; }
+        template <typename T>
+        void Object(const T& object) {
+            object.SaveState(*this);
+        }
+    };
+    struct StateWriter {
+        uint8_t* p;
+        void     operator()(const void* field, size_t bytes) {
+            memcpy(p, field, bytes);
+            p += bytes;
+        }
+        template <typename T>
+        void Object(const T& object) {
+            object.SaveState(*this);
+        }
+    };
+    struct StateReader {
+        const uint8_t* p;
+        void           operator()(void* field, size_t bytes) {
+            memcpy(field, p, bytes);
+            p += bytes;
+        }
+        template <typename T>
+        void Object(T& object) {
+            object.LoadState(*this);
+        }
+    };
+
+    // Every saved field but ReverbSc, in snapshot order (Engine: const for
+    // saving and sizing)
+    template <typename Io, typename Engine>
+    static void Transfer(Io& io, Engine& e) {
+        for (int v = 0; v < NUM_VOICES; v++) io.Object(e.strings_[v]);
+        io(&e.lfo_vibrato_, sizeof(e.lfo_vibrato_));
+        io(&e.lfo_tremolo_, sizeof(e.lfo_tremolo_));
+        io(&e.dc_blocker_, sizeof(e.dc_blocker_));
+
+        io(e.freq_, sizeof(e.freq_));
+        io(e.level_, sizeof(e.level_));
+        io(e.triggered_, sizeof(e.triggered_));
+        io(e.peak_, sizeof(e.peak_));
+        io(e.ring_, sizeof(e.ring_));
+        io(e.ring_now_, sizeof(e.ring_now_));
+        io(&e.ring_count_, sizeof(e.ring_count_));
+        io(e.rate_, sizeof(e.rate_));
+
+        io(e.interp_history_, sizeof(e.interp_history_));
+        io(e.interp_pos_, sizeof(e.interp_pos_));
+        io(e.interp_tail_, sizeof(e.interp_tail_));
+        io(e.rate_phase_, sizeof(e.rate_phase_));
+        io.Object(e.filters_);
+
+        io(&e.brightness_, sizeof(e.brightness_));
+        io(&e.decay_, sizeof(e.decay_));
+        io(&e.lfo_depth_, sizeof(e.lfo_depth_));
+        io(&e.stiffness_, sizeof(e.stiffness_));
+        io(&e.reverb_mix_, sizeof(e.reverb_mix_));
+        io(&e.reverb_feedback_, sizeof(e.reverb_feedback_));
+        io(&e.reverb_lpfreq_, sizeof(e.reverb_lpfreq_));
+        io(&e.multi_rate_, sizeof(e.multi_rate_));
+        io(&e.filter_on_, sizeof(e.filter_on_));
+        io(&e.filter_tracking_, sizeof(e.filter_tracking_));
+        io(&e.filter_resonance_, sizeof(e.filter_resonance_));
+        io(&e.filter_morph_, sizeof(e.filter_morph_));
+    }
+
+    // ReverbSc's delay lines point into its own buffer. Init() left this
+    // engine's pointers in place: words that point into the reverb here
+    // take the saved pointer moved over to this engine, the rest the
+    // saved bytes (after Init() nothing else in it holds such a value).
+    void LoadReverb(const uint8_t* src, uintptr_t saved_address) {
+        static_assert(sizeof(reverb_) % sizeof(uintptr_t) == 0, "ReverbSc is whole pointer words");
+        uintptr_t address = (uintptr_t)&reverb_;
+        uint8_t*  dst     = reinterpret_cast<uint8_t*>(&reverb_);
+        for (size_t i = 0; i < sizeof(reverb_); i += sizeof(uintptr_t)) {
+            uintptr_t here, saved;
+            memcpy(&here, dst + i, sizeof(here));
+            memcpy(&saved, src + i, sizeof(saved));
+            if (here >= address && here < address + sizeof(reverb_)) saved = saved - saved_address + address;
+            memcpy(dst + i, &saved, sizeof(saved));
+        }
+    }
+
+    // Multi-rate voices
+    static const int       FILTER_STRIDE       = SvfBank<NUM_VOICES>::STRIDE;
+    static const int       INTERP_TAPS         = 12;      // Per phase
+    static constexpr float MULTIRATE_BANDWIDTH = 0.3f;    // Damping cutoff / rate
+    static constexpr float QUIET               = 0.001f;  // -60 dB: safe to change rate
+    // Quiet = a whole window under QUIET: a low, dark string's output is
+    // one pulse per period, near zero in between, and the longest period
+    // is a full delay line at the lowest rate
+    static const size_t    RING_WINDOW         = (size_t)TINE_LINE_SIZE << RATE_QUARTER;
+
+    // Highest rate whose delay line still holds one period of voice v
+    int FitRate(int v) const {
+        int rate = RATE_FULL;
+        while (rate < RATE_QUARTER && sample_rate_ / (1 << rate) / freq_[v] > TINE_MAX_DELAY) rate++;
+        return rate;
+    }
+
+    // Lowest rate the string's damping filter allows at the current
+    // settings, but no higher than its pitch fits
+    int ChooseRate(int v, float brightness) const {
+        int fit = FitRate(v);
+        if (!multi_rate_ || exciter_ || decay_ > 0.95f) return fit;  // > 0.95: String opens up
+
+        float semitones = fminf(24.0f + decay_ * decay_ * 48.0f + brightness * brightness * 24.0f, 84.0f);
+        float cutoff    = freq_[v] * exp2f(semitones * (1.0f / 12.0f));
+        int   rate      = RATE_FULL;
+        while (rate < RATE_QUARTER && cutoff < MULTIRATE_BANDWIDTH * sample_rate_ / (2 << rate)) rate++;
+        return rate > fit ? rate : fit;
+    }
+
+    // On a pluck: new rate when the settings call for one. The re-Init
+    // cuts the old note off (a click), so up or down the move waits until
+    // it has died away - until then the string plays on at its old rate,
+    // duller than asked for when a move up is waiting. Only a pitch the
+    // old rate can't hold moves at once.
+    void UpdateRate(int v, float brightness) {
+        int rate = ChooseRate(v, brightness);
+        if (rate == rate_[v]) return;
+        if (rate_[v] >= FitRate(v) && fmaxf(ring_[v], ring_now_[v]) > QUIET) return;
+
+        strings_[v].Init(sample_rate_ / (1 << rate));
+        rate_[v] = rate;
+    }
+
+    // Windowed-sinc lowpass at the reduced rate's Nyquist, split into
+    // polyphase branches (each with unity gain at DC)
+    void InitInterpolators() {
+        for (int r = RATE_HALF; r < NUM_RATES; r++) {
+            int   phases = 1 << r;
+            int   length = phases * INTERP_TAPS;
+            float center = (length - 1) * 0.5f;
+            for (int i = 0; i < length; i++) {
+                float t    = (i - center) / phases;
+                float sinc = t == 0.0f ? 1.0f : sinf(PI_F * t) / (PI_F * t);
+                float w    = 0.42f - 0.5f * cosf(2.0f * PI_F * i / (length - 1))
+                          + 0.08f * cosf(4.0f * PI_F * i / (length - 1));  // Blackman
+                interp_coefs_[r - 1][i % phases][i / phases] = sinc * w;
+            }
+            for (int j = 0; j < INTERP_TAPS * 2; j++) interp_history_[r - 1][j] = 0.0f;
+            interp_pos_[r - 1]  = 0;
+            interp_tail_[r - 1] = 0;
+            rate_phase_[r - 1]  = 0;
+        }
+    }
+
+    // Adds the reduced-rate bus (ticks samples) into out, n output samples
+    void Interpolate(int r, float* out, size_t n) {
+        int          phases  = 1 << r;
+        int          phase   = rate_phase_[r - 1];
+        float*       history = interp_history_[r - 1];
+        const float* bus     = bus_[r - 1];
+        int          pos     = interp_pos_[r - 1];
+        for (size_t k = 0; k < n; k++) {
+            if (phase == 0) {
+                // Ring written twice, so the newest INTERP_TAPS are contiguous
+                pos                        = pos == 0 ? INTERP_TAPS - 1 : pos - 1;
+                history[pos]               = *bus;
+                history[pos + INTERP_TAPS] = *bus++;
+            }
+            const float* h   = interp_coefs_[r - 1][phase];
+            const float* x   = history + pos;
+            float        acc = 0.0f;
+            for (int j = 0; j < INTERP_TAPS; j++) acc += h[j] * x[j];
+            out[k] += acc;
+            phase = (phase + 1) & (phases - 1);
+        }
+        interp_pos_[r - 1] = pos;
+    }
+
+    void ProcessChunk(float* out, size_t n) {
+        // LFOs for vibrato + tremolo modulation
+        Profiler::Begin(STAGE_LFO);
+        for (size_t k = 0; k < n; k++) {
+            float vibrato_sig = lfo_vibrato_.Process();  // Sine wave for pitch
+            float tremolo_sig = lfo_tremolo_.Process();  // Triangle wave for amplitude
+            period_mod_[k] = 1.0f / (1.0f + vibrato_sig * 0.02f * lfo_depth_);  // ±2% vibrato
+            amp_mod_[k] = 1.0f - (fabsf(tremolo_sig) * 0.3f * lfo_depth_);  // Up to 30% tremolo
+            out[k] = 0.0f;
+        }
+        Profiler::End(STAGE_LFO);
+
+        // All strings (full polyphony)
+        Profiler::Begin(STAGE_STRINGS);
+        float brightness = daisysp::fclamp(brightness_, 0.5f, 1.0f);
+
+        // Reduced rates: first sample of this chunk on each rate's grid
+        // and how many of their samples fall into it
+        size_t first[NUM_RATES], ticks[NUM_RATES];
+        int    voices_at[NUM_RATES] = {};
+        first[RATE_FULL] = 0;
+        ticks[RATE_FULL] = n;
+        for (int r = RATE_HALF; r < NUM_RATES; r++) {
+            int phases = 1 << r;
+            first[r]   = (phases - rate_phase_[r - 1]) & (phases - 1);
+            ticks[r]   = first[r] < n ? (n - 1 - first[r]) / phases + 1 : 0;
+            for (size_t m = 0; m < ticks[r]; m++) bus_[r - 1][m] = 0.0f;
+        }
+        bool filter_on = filter_on_;
+        if (filter_on) {
+            for (size_t i = 0; i < n * FILTER_STRIDE; i++) filter_buffer_[i] = 0.0f;
+        }
+
+        for (int v = 0; v < NUM_VOICES; v++) {
+            if (triggered_[v]) UpdateRate(v, brightness);
+
+            // Cheap unless something changed (TineString recomputes then)
+            TineString& str = strings_[v];
+            str.SetDamping(decay_);
+            str.SetBrightness(brightness);
+            str.SetStiffness(stiffness_);
+            str.SetFreq(freq_[v]);
+
+            int    rate    = rate_[v];
+            size_t step    = (size_t)1 << rate;
+            float* dst     = rate == RATE_FULL ? out : bus_[rate - 1];
+            size_t stride  = 1;
+            bool   trigger = triggered_[v];
+            float  level   = level_[v];
+            float  impulse = level / step;  // Same impulse area as at full rate
+            float  peak    = 0.0f;
+            voices_at[rate]++;
+            if (ticks[rate] > 0) triggered_[v] = false;  // Else: next chunk
+            if (filter_on) {
+                // Filter lane v instead, mixed into dst after the bank
+                float cutoff = freq_[v] * filter_tracking_ * (0.5f + level);
+                filters_.SetLane(v, cutoff, sample_rate_ / step, filter_resonance_, filter_morph_);
+                filter_frames_[v] = (int)ticks[rate];
+                dst               = filter_buffer_ + v;
+                stride            = FILTER_STRIDE;
+            }
+
+            for (size_t m = 0, k = first[rate]; m < ticks[rate]; m++, k += step) {
+                bool  first_sample = trigger && m == 0;
+                float excitation   = first_sample ? impulse : 0.0f;
+                if (exciter_) {
+                    excitation = exciter_(v, first_sample, exciter_ctx_) * level;
+                }
+
+                float string_output = str.Process(excitation, period_mod_[k]);  // Clamps below Nyquist
+                string_output *= amp_mod_[k];
+                dst[m * stride] += string_output;
+                peak = fmaxf(peak, fabsf(string_output));
+            }
+            if (ticks[rate] > 0) {
+                peak_[v]     = fmaxf(peak_[v], peak);
+                ring_now_[v] = fmaxf(ring_now_[v], peak);
+            }
+        }
+        ring_count_ += n;
+        if (ring_count_ >= RING_WINDOW) {
+            for (int v = 0; v < NUM_VOICES; v++) {
+                ring_[v]     = ring_now_[v];
+                ring_now_[v] = 0.0f;
+            }
+            ring_count_ -= RING_WINDOW;
+        }
+        Profiler::End(STAGE_STRINGS);
+
+        // Every voice's filter in one pass, then into its rate's bus
+        if (filter_on) {
+            Profiler::Begin(STAGE_FILTER);
+            filters_.Process(filter_buffer_, n, filter_frames_);
+            for (int v = 0; v < NUM_VOICES; v++) {
+                int          rate = rate_[v];
+                float*       dst  = rate == RATE_FULL ? out : bus_[rate - 1];
+                const float* lane = filter_buffer_ + v;
+                for (size_t m = 0; m < ticks[rate]; m++) dst[m] += lane[m * FILTER_STRIDE];
+            }
+            Profiler::End(STAGE_FILTER);
+        }
+        Profiler::Begin(STAGE_STRINGS);
+
+        // Reduced-rate buses back up to the full rate (kept running until
+        // the last voice's samples have left the filter)
+        for (int r = RATE_HALF; r < NUM_RATES; r++) {
+            if (voices_at[r] > 0) interp_tail_[r - 1] = INTERP_TAPS;
+            if (interp_tail_[r - 1] > 0) {
+                Interpolate(r, out, n);
+                if (voices_at[r] == 0) {
+                    int left            = interp_tail_[r - 1] - (int)ticks[r];
+                    interp_tail_[r - 1] = left > 0 ? left : 0;
+                }
+            }
+            rate_phase_[r - 1] = (rate_phase_[r - 1] + n) & ((1 << r) - 1);
+        }
+        Profiler::End(STAGE_STRINGS);
+
+        // Scale down polyphonic output + remove DC (critical for Karplus-Strong)
+        Profiler::Begin(STAGE_MIX);
+        for (size_t k = 0; k < n; k++) {
+            float output = out[k] * (1.0f / NUM_VOICES);
+            out[k] = dc_blocker_.Process(output);
+        }
+        Profiler::End(STAGE_MIX);
+
+        // Reverb, stereo output blended to mono (or the hook's wet signal)
+        Profiler::Begin(STAGE_REVERB);
+        if (reverb_hook_) {
+            reverb_hook_(out, reverb_wet_, n, reverb_ctx_);
+            for (size_t k = 0; k < n; k++) out[k] += reverb_wet_[k] * reverb_mix_;
+        } else {
+            for (size_t k = 0; k < n; k++) {
+                float wet_l, wet_r;
+                reverb_.Process(out[k], out[k], &wet_l, &wet_r);
+                float reverb_mono = (wet_l + wet_r) * 0.5f;
+                out[k] = out[k] + (reverb_mono * reverb_mix_);
+            }
+        }
+        Profiler::End(STAGE_REVERB);
+
+        // Soft saturation for warmth
+        Profiler::Begin(STAGE_SATURATOR);
+        for (size_t k = 0; k < n; k++) {
+            out[k] = tanhf(out[k] * 1.2f) * 0.8f;
+        }
+        Profiler::End(STAGE_SATURATOR);
+    }
+
+    TineString          strings_[NUM_VOICES];
+    daisysp::Oscillator lfo_vibrato_;
+    daisysp::Oscillator lfo_tremolo_;
+    daisysp::ReverbSc   reverb_;
+    daisysp::DcBlock    dc_blocker_;
+
+    float   freq_[NUM_VOICES];
+    float   level_[NUM_VOICES];
+    bool    triggered_[NUM_VOICES];
+    float   peak_[NUM_VOICES];
+    float   ring_[NUM_VOICES];      // Peak of the last RING_WINDOW
+    float   ring_now_[NUM_VOICES];  // ... and of the one filling up
+    size_t  ring_count_;            // Samples into the window
+    uint8_t rate_[NUM_VOICES];
+
+    // Reduced-rate buses and their interpolators ([rate - 1])
+    float interp_coefs_[NUM_RATES - 1][1 << (NUM_RATES - 1)][INTERP_TAPS];
+    float interp_history_[NUM_RATES - 1][INTERP_TAPS * 2];
+    int   interp_pos_[NUM_RATES - 1];
+    int   interp_tail_[NUM_RATES - 1];
+    int   rate_phase_[NUM_RATES - 1];  // Output samples into the rate's period
+    float bus_[NUM_RATES - 1][MAX_BLOCK / 2];
+
+    // Per-voice filters: frames of FILTER_STRIDE samples, lane = voice
+    SvfBank<NUM_VOICES> filters_;
+    float               filter_buffer_[MAX_BLOCK * FILTER_STRIDE];
+    int                 filter_frames_[FILTER_STRIDE];  // Samples per lane this chunk
+
+    float period_mod_[MAX_BLOCK];  // 1 / vibrato pitch ratio
+    float amp_mod_[MAX_BLOCK];
+
+    // Defaults match the firmware's power-on values
+    float brightness_       = 0.75f;
+    float decay_            = 0.95f;
+    float lfo_depth_        = 0.1f;
+    float stiffness_        = TINE_DEFAULT_STIFFNESS;
+    float reverb_mix_       = 0.3f;
+    float reverb_feedback_  = 0.85f;
+    float reverb_lpfreq_    = 10000.0f;
+    float sample_rate_      = 48000.0f;
+    bool  multi_rate_       = true;
+    bool  filter_on_        = false;
+    float filter_tracking_  = 4.0f;
+    float filter_resonance_ = 0.0f;
+    float filter_morph_     = 0.0f;
+
+    ExciteFn exciter_     = nullptr;
+    void*    exciter_ctx_ = nullptr;
+    ReverbFn reverb_hook_ = nullptr;
+    void*    reverb_ctx_  = nullptr;
+    float    reverb_wet_[MAX_BLOCK];
+};
@@ -0,0 +1,106 @@
+/*
+ * KALIMBA SCALES - Scale tables and pot → parameter mappings
+ *
+ * Shared by the firmware (DigitalKalimba.cpp) and the in-browser preview
+ * (web-flasher/preview/), so a scale or setting sounds the same in both.
+ * Plain C++, no libDaisy / DaisySP.
+ *
+ * POTS (0.0 - 1.0 in):
+ *   A0 Brightness   0.5 - 1.0
+ *   A1 Decay        0.5 - 1.0 damping coefficient
+ *   A2 Octave       -2 .. +2
+ *   A3 Scale        0 .. NUM_SCALES-1
+ *   A4 Reverb mix   0.0 - 1.0 dry/wet
+ *   A5 Reverb time  0.6 - 0.999 feedback (safe range, no infinite feedback)
+ */
+
+#pragma once
+
+const int NUM_STRINGS = 7;
+
+// ============================================
+// OPTIMIZATION: Octave Ratio Lookup Table
+// ============================================
+// Pre-calculated 2^octave ratios (-2 to +2 octaves)
+const float OCTAVE_RATIOS[5] = {
+    0.25f,  // -2 octaves (2^-2)
+    0.5f,   // -1 octave  (2^-1)
+    1.0f,   // 0 octaves  (2^0)
+    2.0f,   // +1 octave  (2^1)
+    4.0f    // +2 octaves (2^2)
+};
+
+// ============================================
+// MULTI-SCALE SYSTEM - 5 Scales Available
+// ============================================
+
+#define NUM_SCALES 5
+
+// Scale names for display
+const char* const scale_names[NUM_SCALES] = {
+    "Pentatonic Maj",  // G Major Pentatonic
+    "Dorian Mode",     // D Dorian
+    "Chromatic",       // Chromatic from C3
+    "Kalimba Trad",    // Traditional kalimba voicing
+    "Just/LaMonte"     // La Monte Young just intonation
+};
+
+// Note names for each scale
+const char* const scale_note_names[NUM_SCALES][NUM_STRINGS] = {
+    // Pentatonic Major (G Major)
+    {"G3", "A3", "B3", "D4", "E4", "G4", "A4"},
+    // Dorian Mode (D Dorian)
+    {"D3", "E3", "F3", "G3", "A3", "B3", "C4"},
+    // Chromatic
+    {"C3", "C#3", "D3", "D#3", "E3", "F3", "F#3"},
+    // Kalimba Traditional
+    {"G3", "A3", "D4", "E4", "G4", "B4", "A4"},
+    // Just Intonation / La Monte Young
+    {"C3", "E3", "G3", "Bb3", "C4", "D4", "F4"}
+};
+
+// Base frequencies for each scale (in Hz)
+const float scale_frequencies[NUM_SCALES][NUM_STRINGS] = {
+    // Pentatonic Major (G Major): G3, A3, B3, D4, E4, G4, A4
+    {196.00f, 220.00f, 246.94f, 293.66f, 329.63f, 392.00f, 440.00f},
+
+    // Dorian Mode (D Dorian): D3, E3, F3, G3, A3, B3, C4
+    {146.83f, 164.81f, 174.61f, 196.00f, 220.00f, 246.94f, 261.63f},
+
+    // Chromatic: C3, C#3, D3, D#3, E3, F3, F#3
+    {130.81f, 138.59f, 146.83f, 155.56f, 164.81f, 174.61f, 185.00f},
+
+    // Kalimba Traditional (alternate G Major voicing): G3, A3, D4, E4, G4, B4, A4
+    {196.00f, 220.00f, 293.66f, 329.63f, 392.00f, 493.88f, 440.00f},
+
+    // Just Intonation / La Monte Young (based on C harmonic series)
+    // C3(1:1), E3(5:4), G3(3:2), Bb3(7:4), C4(2:1), D4(9:8), F4(11:8)
+    {130.81f, 163.51f, 196.22f, 229.28f, 261.63f, 293.66f, 323.08f}
+};
+
+// ============================================
+// Pot mappings
+// ============================================
+
+inline float PotToBrightness(float pot) { return 0.5f + (pot * 0.5f); }
+inline float PotToDecay(float pot) { return 0.5f + (pot * 0.5f); }
+inline float PotToReverbMix(float pot) { return pot; }
+inline float PotToReverbFeedback(float pot) { return 0.6f + (pot * 0.399f); }
+
+// 5 scales, pot range divided into zones
+inline int PotToScale(float pot) {
+    int scale = (int)(pot * 4.99f);  // Maps 0.0-1.0 to 0-4
+    return scale < 0 ? 0 : (scale > NUM_SCALES - 1 ? NUM_SCALES - 1 : scale);
+}
+
+// -2 to +2 octaves, 5 octave range
+inline int PotToOctave(float pot) {
+    int octave = (int)(pot * 4.99f) - 2;  // Maps 0.0-1.0 to -2..+2
+    return octave < -2 ? -2 : (octave > 2 ? 2 : octave);
+}
+
+// 2^octave, clamped to -2..+2
+inline float OctaveRatio(int octave) {
+    octave = octave < -2 ? -2 : (octave > 2 ? 2 : octave);
+    return OCTAVE_RATIOS[octave + 2];  // +2 to map -2..+2 to 0..4
+}
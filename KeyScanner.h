@@ -0,0 +1,164 @@
+/*
+ * KEY SCANNER - Up to 32 keys from a 74HC165 chain or a diode matrix
+ *
+ * DATA FLOW:
+ *   74HC165 chain: latch, then one SPI DMA read of all chips → completion
+ *   interrupt → ShiftRegisterKeys() → OnScan()
+ *   Diode matrix: timer interrupt drives one row, reads the columns →
+ *   KeyMatrix::Row() → OnScan() once every row is in
+ *   OnScan() debounces all keys at once and queues a NOTE_ON / NOTE_OFF
+ *   per debounced change (EventQueue, like MIDI input), stamped with the
+ *   sample it is due on.
+ *
+ * DEBOUNCE (bitwise, all keys in parallel):
+ *   A 2-bit counter per key, held as two 32-bit bit planes (vertical
+ *   counter). A key toggles after KEY_DEBOUNCE_SCANS scans in a row that
+ *   disagree with its debounced state; any agreeing scan resets it. The
+ *   whole chain costs a handful of logic operations per scan regardless
+ *   of the key count, plus one loop pass per key that actually changed.
+ *
+ * TIMESTAMPS:
+ *   The caller stamps each scan with the sample clock at the moment the
+ *   keys were sampled (the latch, not the DMA completion), plus a fixed
+ *   latency, so notes keep the timing of the scans.
+ *
+ * Portable (no libDaisy dependency).
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "EngineEvents.h"
+
+const int     KEY_SCAN_MAX_KEYS  = 32;   // One bit per key
+const int     KEY_DEBOUNCE_SCANS = 4;    // Vertical counter period
+const uint8_t KEY_VELOCITY       = 127;  // Keys are on / off
+
+// ============================================
+// Vertical-counter debounce
+// ============================================
+class KeyDebouncer {
+  public:
+    void Init() {
+        state_ = 0;
+        cnt0_  = 0;
+        cnt1_  = 0;
+    }
+
+    // One scan of raw pressed bits → bits whose debounced state toggled
+    uint32_t Update(uint32_t raw) {
+        uint32_t delta  = raw ^ state_;
+        cnt1_           = (cnt1_ ^ cnt0_) & delta;
+        cnt0_           = ~cnt0_ & delta;
+        uint32_t toggle = delta & ~(cnt0_ | cnt1_);
+        state_ ^= toggle;
+        return toggle;
+    }
+
+    uint32_t State() const { return state_; }
+
+  private:
+    uint32_t state_ = 0;  // Debounced: 1 = pressed
+    uint32_t cnt0_  = 0;  // Counter bit planes
+    uint32_t cnt1_  = 0;
+};
+
+// ============================================
+// Sources of raw key bits
+// ============================================
+
+// 74HC165 chain read MSB first over SPI: byte c = chip c counted from the
+// MCU, input A = bit 0 .. H = bit 7 (H shifts out first). Inputs pulled
+// up, a key closes to GND.
+inline uint32_t ShiftRegisterKeys(const uint8_t* bytes, int chips) {
+    uint32_t bits = 0;
+    for (int c = 0; c < chips; c++) bits |= (uint32_t)bytes[c] << (8 * c);
+    uint32_t used = chips >= 4 ? 0xFFFFFFFFu : (1u << (8 * chips)) - 1;
+    return ~bits & used;
+}
+
+// Diode matrix (one diode per key, no ghosting): rows driven one at a
+// time, key = row x COLS + column
+template <int ROWS, int COLS>
+class KeyMatrix {
+  public:
+    static_assert(ROWS * COLS <= KEY_SCAN_MAX_KEYS, "one bit per key");
+
+    void Init() {
+        row_   = 0;
+        frame_ = 0;
+        keys_  = 0;
+    }
+
+    // Row to drive next
+    int NextRow() const { return row_; }
+
+    // Pressed columns of the row just driven; true when a whole frame is
+    // in (then Keys() holds it)
+    bool Row(uint32_t columns) {
+        frame_ |= (columns & ((1u << COLS) - 1)) << (row_ * COLS);
+        if (++row_ < ROWS) return false;
+        keys_  = frame_;
+        frame_ = 0;
+        row_   = 0;
+        return true;
+    }
+
+    uint32_t Keys() const { return keys_; }
+
+  private:
+    int      row_   = 0;
+    uint32_t frame_ = 0;  // Rows so far
+    uint32_t keys_  = 0;  // Last complete frame
+};
+
+// ============================================
+// Debounced keys → EngineEvents
+// ============================================
+template <uint32_t QUEUE_SIZE>
+class KeyScanner {
+  public:
+    // Key k plays note base_note + k
+    void Init(int num_keys, uint8_t base_note) {
+        mask_      = num_keys >= KEY_SCAN_MAX_KEYS ? 0xFFFFFFFFu : (1u << num_keys) - 1;
+        base_note_ = base_note;
+        scans_     = 0;
+        dropped_   = 0;
+        debouncer_.Init();
+    }
+
+    // Scan completion (interrupt context): raw pressed bits, sample the
+    // resulting events are due on
+    void OnScan(uint32_t pressed, uint32_t due) {
+        uint32_t toggle = debouncer_.Update(pressed & mask_);
+        uint32_t down   = debouncer_.State();
+        while (toggle) {
+            int key = __builtin_ctz(toggle);
+            toggle &= toggle - 1;
+
+            EngineEvent e;
+            e.time   = due;
+            e.type   = (down >> key) & 1 ? EngineEvent::NOTE_ON : EngineEvent::NOTE_OFF;
+            e.data1  = (uint8_t)(base_note_ + key);
+            e.data2  = e.type == EngineEvent::NOTE_ON ? KEY_VELOCITY : 0;
+            e.octave = 0;
+            if (!queue_.Push(e)) dropped_++;
+        }
+        scans_++;
+    }
+
+    EventQueue<QUEUE_SIZE>& Queue() { return queue_; }
+    uint32_t                Pressed() const { return debouncer_.State(); }
+    uint32_t                Scans() const { return scans_; }
+    uint32_t                Dropped() const { return dropped_; }
+
+  private:
+    KeyDebouncer           debouncer_;
+    EventQueue<QUEUE_SIZE> queue_;
+    uint32_t               mask_      = 0;
+    uint8_t                base_note_ = 0;
+    volatile uint32_t      scans_     = 0;
+    volatile uint32_t      dropped_   = 0;
+};
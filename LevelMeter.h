@@ -0,0 +1,60 @@
+/*
+ * LEVEL METER - Per-string level bars for the OLED
+ *
+ * DATA FLOW:
+ *   KalimbaEngine tracks each voice's peak while it renders (one max per
+ *   sample, no extra pass) → audio callback hands the block peaks over
+ *   with Capture() → main loop calls Update() at display rate: peak since
+ *   the last update, falling back METER_FALL per update so the bar
+ *   follows the tine as it rings out.
+ *
+ * SCALE:
+ *   Bars are in dB, METER_FLOOR_DB .. 0 dBFS (single string, before the
+ *   mix), so quiet tails still show. Ringing() = above the floor.
+ *
+ * Portable (no libDaisy dependency).
+ */
+
+#pragma once
+
+#include <math.h>
+#include <atomic>
+
+const float METER_FLOOR_DB = -48.0f;
+const float METER_FALL     = 0.7f;  // Per Update() (~-30 dB/s at 100ms)
+
+template <int NUM_METERS>
+class LevelMeters {
+  public:
+    // Audio thread, once per block: peak of meter m in this block
+    void Capture(int m, float peak) {
+        if (peak > held_[m].load(std::memory_order_relaxed)) {
+            held_[m].store(peak, std::memory_order_relaxed);
+        }
+    }
+
+    // Main loop, once per display refresh
+    void Update() {
+        for (int m = 0; m < NUM_METERS; m++) {
+            float peak = held_[m].exchange(0.0f, std::memory_order_relaxed);
+            float fall = level_[m] * METER_FALL;
+            level_[m]  = peak > fall ? peak : fall;
+        }
+    }
+
+    // Bar length 0..size for meter m (dB scale)
+    int Bar(int m, int size) const {
+        if (!Ringing(m)) return 0;
+        float db  = 20.0f * log10f(level_[m]);
+        int   bar = (int)((db - METER_FLOOR_DB) * (size / -METER_FLOOR_DB) + 0.5f);
+        return bar < 1 ? 1 : (bar > size ? size : bar);
+    }
+
+    bool Ringing(int m) const { return level_[m] > METER_FLOOR_LINEAR; }
+
+  private:
+    static constexpr float METER_FLOOR_LINEAR = 0.00398f;  // -48 dB
+
+    std::atomic<float> held_[NUM_METERS] = {};
+    float              level_[NUM_METERS] = {};
+};
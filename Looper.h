@@ -0,0 +1,259 @@
+/*
+ * LOOPER - Record / overdub / undo into SDRAM
+ * For the Digital Kalimba (runs after the soft saturator)
+ *
+ * STATES:
+ *   EMPTY       → nothing recorded, input passes through
+ *   RECORDING   → input is written to the loop buffer, length grows
+ *   PLAYING     → loop is added to the input, length is fixed
+ *   OVERDUBBING → input is summed into the loop while it plays
+ *
+ * MEMORY:
+ *   The loop and undo layers live in SDRAM (DSY_SDRAM_BSS, owned by the
+ *   caller). The audio thread only ever touches them through the D-cache;
+ *   the one DMA user (undo restore via MemOps) does its own cache upkeep.
+ *
+ * COST:
+ *   Every state costs a fixed number of loads/stores per sample. Blocks are
+ *   split at the loop boundary, so wrap-around is sample-accurate and there
+ *   is no per-sample modulo/branch.
+ *
+ * UNDO:
+ *   While overdubbing, the previous contents of every touched sample are
+ *   saved to the undo layer - on the pass's first lap only, so undo after
+ *   several laps returns the loop as it was before the pass. Undo() hands that range to the main loop,
+ *   which copies it back via Service() so the audio callback never pays
+ *   for a multi-second memcpy. With SetMemOps() the copy runs on the MDMA
+ *   (one transfer per contiguous range); otherwise the CPU copies it in
+ *   UNDO_CHUNK pieces.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "MemOps.h"
+
+class Looper {
+  public:
+    enum class State { EMPTY, RECORDING, PLAYING, OVERDUBBING };
+
+    // Samples restored per Service() call (~85ms of audio at 48kHz)
+    static const size_t UNDO_CHUNK = 4096;
+
+    Looper() {}
+    ~Looper() {}
+
+    // loop_buf / undo_buf must each hold max_len samples
+    void Init(float* loop_buf, float* undo_buf, size_t max_len) {
+        loop_           = loop_buf;
+        undo_           = undo_buf;
+        max_len_        = max_len;
+        state_          = State::EMPTY;
+        length_         = 0;
+        pos_            = 0;
+        dub_start_      = 0;
+        dub_len_        = 0;
+        restore_pos_    = 0;
+        restore_remain_ = 0;
+        restore_inflight_ = 0;
+    }
+
+    // Optional: restore undo through the MDMA instead of CPU chunks
+    void SetMemOps(MemOps* mem_ops) { mem_ops_ = mem_ops; }
+
+    // ============================================
+    // Gestures (audio thread, at block boundaries)
+    // ============================================
+
+    // EMPTY → RECORDING → PLAYING → OVERDUBBING → PLAYING → ...
+    void RecordPress() {
+        if (UndoPending()) return;
+
+        switch (state_) {
+            case State::EMPTY:
+                pos_    = 0;
+                length_ = 0;
+                state_  = State::RECORDING;
+                break;
+
+            case State::RECORDING:
+                // Loop length = exactly what was recorded
+                if (pos_ == 0) {
+                    state_ = State::EMPTY;
+                    break;
+                }
+                length_ = pos_;
+                pos_    = 0;
+                state_  = State::PLAYING;
+                break;
+
+            case State::PLAYING:
+                dub_start_ = pos_;
+                dub_len_   = 0;
+                state_     = State::OVERDUBBING;
+                break;
+
+            case State::OVERDUBBING:
+                state_ = State::PLAYING;
+                break;
+        }
+    }
+
+    // Revert the last overdub pass (no-op if there is nothing to undo)
+    void Undo() {
+        if (UndoPending()) return;
+        if (state_ == State::OVERDUBBING) state_ = State::PLAYING;
+        if (state_ != State::PLAYING || dub_len_ == 0) return;
+
+        restore_pos_    = dub_start_;
+        restore_remain_ = dub_len_;
+        dub_len_        = 0;
+    }
+
+    // Stop and forget the loop
+    void Clear() {
+        if (UndoPending()) return;
+        state_   = State::EMPTY;
+        length_  = 0;
+        pos_     = 0;
+        dub_len_ = 0;
+    }
+
+    // ============================================
+    // Audio (in place, once per block)
+    // ============================================
+
+    // Records `io` and adds loop playback to it
+    void Process(float* io, size_t size) {
+        size_t done = 0;
+        while (done < size) {
+            float* blk = io + done;
+            size_t n   = size - done;
+
+            switch (state_) {
+                case State::EMPTY: return;
+
+                case State::RECORDING: {
+                    size_t room = max_len_ - pos_;
+                    if (n > room) n = room;
+                    memcpy(loop_ + pos_, blk, n * sizeof(float));
+                    pos_ += n;
+                    // Buffer full: close the loop at max length
+                    if (pos_ >= max_len_) {
+                        length_ = max_len_;
+                        pos_    = 0;
+                        state_  = State::PLAYING;
+                    }
+                    break;
+                }
+
+                case State::PLAYING: {
+                    if (n > length_ - pos_) n = length_ - pos_;
+                    const float* src = loop_ + pos_;
+                    for (size_t k = 0; k < n; k++) {
+                        blk[k] += src[k];
+                    }
+                    pos_ += n;
+                    if (pos_ >= length_) pos_ = 0;
+                    break;
+                }
+
+                case State::OVERDUBBING: {
+                    if (n > length_ - pos_) n = length_ - pos_;
+                    float* dst = loop_ + pos_;
+                    float* sav = undo_ + pos_;
+                    // Only the first lap of a pass saves: later laps would
+                    // save audio that already holds this pass's dub
+                    size_t save = length_ - dub_len_;
+                    if (save > n) save = n;
+                    for (size_t k = 0; k < save; k++) {
+                        float old = dst[k];
+                        sav[k]    = old;
+                        dst[k]    = old + blk[k];
+                        blk[k]   += old;
+                    }
+                    for (size_t k = save; k < n; k++) {
+                        float old = dst[k];
+                        dst[k]    = old + blk[k];
+                        blk[k]   += old;
+                    }
+                    pos_ += n;
+                    if (pos_ >= length_) pos_ = 0;
+                    // Once a full lap is dubbed the whole loop is undoable
+                    dub_len_ += save;
+                    break;
+                }
+            }
+            done += n;
+        }
+    }
+
+    // ============================================
+    // Main loop
+    // ============================================
+
+    // Copies (or queues) the next piece of a pending undo back into the
+    // loop layer
+    void Service() {
+        // MDMA copy still running, or just finished
+        if (restore_inflight_) {
+            if (!restore_op_.Done()) return;
+            Advance(restore_inflight_);
+            restore_inflight_ = 0;
+        }
+
+        size_t remain = restore_remain_;
+        if (remain == 0) return;
+
+        size_t n = length_ - restore_pos_;  // Contiguous up to the loop end
+        if (n > remain) n = remain;
+
+        if (mem_ops_) {
+            mem_ops_->Copy(&restore_op_, loop_ + restore_pos_, undo_ + restore_pos_,
+                           n * sizeof(float));
+            restore_inflight_ = n;
+            return;
+        }
+
+        if (n > UNDO_CHUNK) n = UNDO_CHUNK;
+        memcpy(loop_ + restore_pos_, undo_ + restore_pos_, n * sizeof(float));
+        Advance(n);
+    }
+
+    bool UndoPending() const { return restore_remain_ != 0; }
+
+    State  GetState() const { return state_; }
+    size_t GetLength() const { return length_; }
+    size_t GetPosition() const { return pos_; }
+
+  private:
+    // Restore progress: n more samples are back in the loop layer
+    void Advance(size_t n) {
+        size_t next = restore_pos_ + n;
+        restore_pos_    = next >= length_ ? 0 : next;
+        restore_remain_ = restore_remain_ - n;
+    }
+
+    float* loop_    = nullptr;
+    float* undo_    = nullptr;
+    size_t max_len_ = 0;
+
+    volatile State state_ = State::EMPTY;
+    size_t         length_ = 0;  // Loop length in samples (0 while recording)
+    size_t         pos_    = 0;  // Record/playback head
+
+    // Range touched by the current/last overdub pass
+    size_t dub_start_ = 0;
+    size_t dub_len_   = 0;
+
+    // Undo restore in progress (written by audio, drained by main loop)
+    volatile size_t restore_pos_    = 0;
+    volatile size_t restore_remain_ = 0;
+
+    MemOps*    mem_ops_          = nullptr;
+    MemOps::Op restore_op_;
+    size_t     restore_inflight_ = 0;  // Samples the MDMA is copying now
+};
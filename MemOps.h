@@ -0,0 +1,333 @@
+/*
+ * MEM OPS - Asynchronous bulk copy / fill on the STM32H750's MDMA
+ * For the Digital Kalimba
+ *
+ * Multi-megabyte memory moves (looper undo restore, clearing the
+ * convolution reverb's input spectra at boot) are handed to the MDMA, so
+ * neither the audio callback nor the main loop spends cycles on them.
+ *
+ * USAGE:
+ *   MemOps::Op op;
+ *   mem_ops.Copy(&op, dst, src, bytes);   // Returns immediately
+ *   mem_ops.Fill(&op, dst, 0, bytes);     // Same, pattern word into dst
+ *   ... later: if (op.Done()) ...         // Set from the MDMA interrupt
+ *
+ * CACHE MAINTENANCE (done here, not by the caller):
+ *   Source and destination are cleaned before the transfer, the
+ *   destination is invalidated when it completes. Only whole 32-byte cache
+ *   lines go to the MDMA - unaligned head/tail bytes are done by the CPU
+ *   on the spot, so a partial line can never be lost. Ranges bigger than
+ *   the D-cache get one whole-cache clean/invalidate instead of a
+ *   line-by-line walk.
+ *   Rule: don't write `dst` (or `src`) until Done().
+ *
+ * THREADING:
+ *   Submit from one context (the main loop). Operations run in order;
+ *   completion is signalled from MDMA_IRQHandler → IrqHandler().
+ *
+ * FALLBACK:
+ *   Without the MDMA (host builds) every operation is a plain
+ *   memcpy/memset and is Done() on return.
+ *
+ * STATS (per operation type):
+ *   bytes moved, CPU cycles actually spent (submit + interrupt), and what
+ *   the CPU would have spent doing it itself (measured by Calibrate()) -
+ *   the difference is the CPU time saved. Cycle counts need the DWT cycle
+ *   counter running (DwtClock::Enable()).
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+class MemOps {
+  public:
+    enum Kind { COPY, FILL, NUM_KINDS };
+
+    static const size_t   LINE          = 32;     // Cortex-M7 D-cache line
+    static const size_t   DCACHE_SIZE   = 16384;  // STM32H750 D-cache
+    static const uint32_t BLOCK_BYTES   = 32768;  // MDMA block (BNDT max 64KB)
+    static const uint32_t MAX_BLOCKS    = 4095;   // MDMA block repeat count (HAL_MDMA_Start_IT limit)
+    static const int      QUEUE_SIZE    = 8;
+
+    // One operation; owned by the caller, must outlive the transfer
+    class Op {
+      public:
+        bool Done() const { return done_.load(std::memory_order_acquire); }
+
+      private:
+        friend class MemOps;
+        std::atomic<bool> done_{true};
+        Kind              kind_   = COPY;
+        uint8_t*          dst_    = nullptr;  // Aligned middle part only
+        const uint8_t*    src_    = nullptr;
+        size_t            bytes_  = 0;
+        size_t            moved_  = 0;
+        uint32_t          value_  = 0;
+    };
+
+    struct Stats {
+        uint32_t ops;
+        uint64_t bytes;
+        uint64_t cpu_cycles;         // Spent submitting + in the interrupt
+        uint32_t cpu_cycles_per_kb;  // CPU doing the same itself (Calibrate)
+
+        uint64_t CpuOnlyCycles() const { return bytes * cpu_cycles_per_kb / 1024; }
+        uint64_t SavedCycles() const {
+            uint64_t cpu_only = CpuOnlyCycles();
+            return cpu_only > cpu_cycles ? cpu_only - cpu_cycles : 0;
+        }
+    };
+
+    MemOps() {}
+    ~MemOps() {}
+
+    void Init() {
+        head_  = 0;
+        count_ = 0;
+        busy_  = false;
+        memset(stats_, 0, sizeof(stats_));
+        memset((void*)irq_cycles_, 0, sizeof(irq_cycles_));
+#ifdef MDMA
+        Instance() = this;
+        __HAL_RCC_MDMA_CLK_ENABLE();
+        hmdma_.Instance = MDMA_Channel0;
+        Configure(COPY);
+        // Lowest priority: never delays the audio DMA interrupt
+        HAL_NVIC_SetPriority(MDMA_IRQn, 15, 0);
+        HAL_NVIC_EnableIRQ(MDMA_IRQn);
+#endif
+    }
+
+    // Measures what `bytes` of copy / fill cost the CPU on the given
+    // buffers (use the memory the real operations will touch)
+    void Calibrate(void* a, void* b, size_t bytes) {
+        uint32_t t0 = Cycles();
+        memcpy(a, b, bytes);
+        uint32_t t1 = Cycles();
+        memset(a, 0, bytes);
+        uint32_t t2 = Cycles();
+        stats_[COPY].cpu_cycles_per_kb = (uint32_t)((uint64_t)(t1 - t0) * 1024 / bytes);
+        stats_[FILL].cpu_cycles_per_kb = (uint32_t)((uint64_t)(t2 - t1) * 1024 / bytes);
+    }
+
+    // ============================================
+    // Operations (main loop)
+    // ============================================
+
+    void Copy(Op* op, void* dst, const void* src, size_t bytes) {
+        Submit(op, COPY, (uint8_t*)dst, (const uint8_t*)src, bytes, 0);
+    }
+
+    // `value` is a 32-bit pattern (0 = zeroed floats); dst and bytes must
+    // be multiples of 4
+    void Fill(Op* op, void* dst, uint32_t value, size_t bytes) {
+        Submit(op, FILL, (uint8_t*)dst, nullptr, bytes, value);
+    }
+
+    bool Busy() const { return busy_; }
+
+    Stats GetStats(Kind k) const {
+        Stats s = stats_[k];
+        s.cpu_cycles += irq_cycles_[k];
+        return s;
+    }
+
+    // ============================================
+    // MDMA interrupt
+    // ============================================
+    void IrqHandler() {
+#ifdef MDMA
+        HAL_MDMA_IRQHandler(&hmdma_);
+#endif
+    }
+
+  private:
+    void Submit(Op* op, Kind kind, uint8_t* dst, const uint8_t* src, size_t bytes, uint32_t value) {
+        uint32_t t0 = Cycles();
+        op->done_.store(false, std::memory_order_relaxed);
+        op->kind_  = kind;
+        op->value_ = value;
+        op->moved_ = 0;
+
+        // Head up to the first cache line boundary, tail after the last:
+        // CPU now. The MDMA gets whole lines (and word-aligned source).
+        size_t head = (LINE - ((uintptr_t)dst & (LINE - 1))) & (LINE - 1);
+        if (head > bytes) head = bytes;
+        size_t mid  = (bytes - head) & ~(LINE - 1);
+        size_t tail = bytes - head - mid;
+        if (kind == COPY && ((uintptr_t)(src + head) & 3)) {
+            head = bytes;  // Source can't be read in words: all CPU
+            mid  = 0;
+            tail = 0;
+        }
+        if (!HAS_MDMA || count_ == QUEUE_SIZE) {
+            head = bytes;  // No MDMA / queue full: all CPU, synchronously
+            mid  = 0;
+            tail = 0;
+        }
+        CpuOp(kind, dst, src, head, value);
+        CpuOp(kind, dst + head + mid, src ? src + head + mid : nullptr, tail, value);
+
+        stats_[kind].ops++;
+        stats_[kind].bytes += bytes;
+
+        if (mid == 0) {
+            stats_[kind].cpu_cycles += Cycles() - t0;
+            op->done_.store(true, std::memory_order_release);
+            return;
+        }
+
+        op->dst_   = dst + head;
+        op->src_   = src ? src + head : nullptr;
+        op->bytes_ = mid;
+
+        // Nothing dirty may be written back over the transfer later
+        if (kind == COPY) CleanCache(op->src_, mid);
+        if (kind == FILL) CleanCache((const uint8_t*)&op->value_, sizeof(op->value_));
+        CleanCache(op->dst_, mid);
+
+        EnterCritical();
+        queue_[(head_ + count_) % QUEUE_SIZE] = op;
+        count_++;
+        if (!busy_) {
+            busy_ = true;
+            StartNext();
+        }
+        ExitCritical();
+        stats_[kind].cpu_cycles += Cycles() - t0;
+    }
+
+    static void CpuOp(Kind kind, uint8_t* dst, const uint8_t* src, size_t bytes, uint32_t value) {
+        if (bytes == 0) return;
+        if (kind == COPY) {
+            memcpy(dst, src, bytes);
+        } else {
+            uint32_t* d = (uint32_t*)dst;
+            for (size_t i = 0; i < bytes / 4; i++) d[i] = value;
+        }
+    }
+
+#ifdef MDMA
+    static const bool HAS_MDMA = true;
+
+    static MemOps*& Instance() {
+        static MemOps* instance = nullptr;
+        return instance;
+    }
+
+    static uint32_t Cycles() { return DWT->CYCCNT; }
+
+    void EnterCritical() { NVIC_DisableIRQ(MDMA_IRQn); }
+    void ExitCritical() { NVIC_EnableIRQ(MDMA_IRQn); }
+
+    static void CleanCache(const uint8_t* p, size_t bytes) {
+        if (bytes > DCACHE_SIZE) {
+            SCB_CleanDCache();
+        } else {
+            SCB_CleanDCache_by_Addr((uint32_t*)p, bytes);
+        }
+    }
+
+    static void InvalidateCache(uint8_t* p, size_t bytes) {
+        if (bytes > DCACHE_SIZE) {
+            // Nothing in the range is dirty (cleaned at submit), so the
+            // whole-cache clean only writes back unrelated data
+            SCB_CleanInvalidateDCache();
+        } else {
+            SCB_InvalidateDCache_by_Addr((uint32_t*)p, bytes);
+        }
+    }
+
+    // Copy: word increments; fill: source pinned on the pattern word
+    void Configure(Kind kind) {
+        hmdma_.Init.Request                  = MDMA_REQUEST_SW;
+        hmdma_.Init.TransferTriggerMode      = MDMA_FULL_TRANSFER;
+        hmdma_.Init.Priority                 = MDMA_PRIORITY_LOW;
+        hmdma_.Init.Endianness               = MDMA_LITTLE_ENDIANNESS_PRESERVE;
+        hmdma_.Init.SourceInc                = kind == COPY ? MDMA_SRC_INC_WORD : MDMA_SRC_INC_DISABLE;
+        hmdma_.Init.DestinationInc           = MDMA_DEST_INC_WORD;
+        hmdma_.Init.SourceDataSize           = MDMA_SRC_DATASIZE_WORD;
+        hmdma_.Init.DestDataSize             = MDMA_DEST_DATASIZE_WORD;
+        hmdma_.Init.DataAlignment            = MDMA_DATAALIGN_PACKENABLE;
+        hmdma_.Init.BufferTransferLength     = 128;
+        hmdma_.Init.SourceBurst              = kind == COPY ? MDMA_SOURCE_BURST_32BEATS : MDMA_SOURCE_BURST_SINGLE;
+        hmdma_.Init.DestBurst                = MDMA_DEST_BURST_32BEATS;
+        hmdma_.Init.SourceBlockAddressOffset = 0;
+        hmdma_.Init.DestBlockAddressOffset   = 0;
+        HAL_MDMA_Init(&hmdma_);
+        hmdma_.XferCpltCallback = TransferComplete;
+        configured_ = kind;
+    }
+
+    // Next segment of the op at the queue head: as many whole blocks as
+    // fit in one transfer, then the remainder
+    void StartSegment() {
+        Op*    op     = queue_[head_];
+        size_t remain = op->bytes_ - op->moved_;
+        uint32_t len, blocks;
+        if (remain >= BLOCK_BYTES) {
+            len    = BLOCK_BYTES;
+            blocks = remain / BLOCK_BYTES < MAX_BLOCKS ? remain / BLOCK_BYTES : MAX_BLOCKS;
+        } else {
+            len    = remain;
+            blocks = 1;
+        }
+        segment_ = (size_t)len * blocks;
+
+        uintptr_t src = op->kind_ == COPY ? (uintptr_t)(op->src_ + op->moved_) : (uintptr_t)&op->value_;
+        HAL_MDMA_Start_IT(&hmdma_, src, (uintptr_t)(op->dst_ + op->moved_), len, blocks);
+    }
+
+    void StartNext() {
+        Op* op = queue_[head_];
+        if (configured_ != op->kind_) Configure(op->kind_);
+        StartSegment();
+    }
+
+    static void TransferComplete(MDMA_HandleTypeDef* hmdma) { Instance()->OnComplete(); }
+
+    void OnComplete() {
+        uint32_t t0 = Cycles();
+        Op*      op = queue_[head_];
+        op->moved_ += segment_;
+        if (op->moved_ < op->bytes_) {
+            StartSegment();
+        } else {
+            InvalidateCache(op->dst_, op->bytes_);
+            Kind kind = op->kind_;
+            op->done_.store(true, std::memory_order_release);
+            head_ = (head_ + 1) % QUEUE_SIZE;
+            count_--;
+            if (count_ > 0) {
+                StartNext();
+            } else {
+                busy_ = false;
+            }
+            irq_cycles_[kind] += Cycles() - t0;
+        }
+    }
+
+    MDMA_HandleTypeDef hmdma_;
+    Kind               configured_ = COPY;
+    size_t             segment_    = 0;
+#else
+    static const bool HAS_MDMA = false;
+
+    static uint32_t Cycles() { return 0; }
+    void            EnterCritical() {}
+    void            ExitCritical() {}
+    static void     CleanCache(const uint8_t* p, size_t bytes) {}
+    void            StartNext() {}
+#endif  // MDMA
+
+    Op*           queue_[QUEUE_SIZE];
+    volatile int  head_  = 0;
+    volatile int  count_ = 0;
+    volatile bool busy_  = false;
+    Stats         stats_[NUM_KINDS];       // Main loop side
+    volatile uint64_t irq_cycles_[NUM_KINDS];  // Interrupt side
+};
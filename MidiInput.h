@@ -0,0 +1,175 @@
+/*
+ * MIDI INPUT - Timestamped note/CC events for the Digital Kalimba
+ *
+ * DATA FLOW:
+ *   UART / USB receive interrupt → RxCallback() → running-status parser
+ *   → stamp with the audio sample clock → EventQueue (lock-free SPSC)
+ *   → audio callback pops each event on the exact sample it is due
+ *
+ * TIMING:
+ *   SampleClock maps "now" (a free-running tick counter) onto the sample
+ *   index the DAC is currently playing. Events are scheduled LATENCY
+ *   samples after arrival, which is always in a block that has not been
+ *   rendered yet - so every event gets the same, fixed delay instead of
+ *   being quantised to whichever block happens to be running.
+ *
+ * SYSEX TEXT:
+ *   F0 7D <7-bit ASCII> F7 (7D = non-commercial ID) is passed on as one
+ *   text line through TextQueue() - tuning commands, see TuningTable.h.
+ *   Other SysEx is ignored.
+ *
+ * ONE QUEUE PER TRANSPORT:
+ *   UART and USB interrupts can preempt each other, so each gets its own
+ *   single-producer queue. The audio thread is the only consumer.
+ *
+ * Portable (no libDaisy dependency) so the parser and scheduling can be
+ * driven from a host build as well.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#include "EngineEvents.h"
+
+// ============================================
+// Audio sample clock, readable from any interrupt
+// ============================================
+class SampleClock {
+  public:
+    void Init(float sample_rate, uint32_t tick_freq) {
+        samples_per_tick_ = sample_rate / (float)tick_freq;
+        seq_.store(0);
+        block_sample_ = 0;
+        block_tick_   = 0;
+    }
+
+    // Audio callback, first thing: block [sample, sample + size) starts now
+    void OnBlock(uint32_t tick, uint32_t sample) {
+        seq_.fetch_add(1, std::memory_order_relaxed);  // Odd = update in progress
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        block_tick_   = tick;
+        block_sample_ = sample;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        seq_.fetch_add(1, std::memory_order_release);
+    }
+
+    // Sample index corresponding to `tick` (seqlock: retries if the audio
+    // callback updated the reference in between)
+    uint32_t Now(uint32_t tick) const {
+        uint32_t s0, sample, ref;
+        do {
+            s0     = seq_.load(std::memory_order_acquire);
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+            sample = block_sample_;
+            ref    = block_tick_;
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+        } while ((s0 & 1) || s0 != seq_.load(std::memory_order_acquire));
+        return sample + (uint32_t)((float)(tick - ref) * samples_per_tick_);
+    }
+
+  private:
+    std::atomic<uint32_t> seq_{0};
+    volatile uint32_t     block_sample_ = 0;
+    volatile uint32_t     block_tick_   = 0;
+    float                 samples_per_tick_ = 0.0f;
+};
+
+const uint8_t  MIDI_SYSEX_TEXT_ID   = 0x7D;
+const uint32_t MIDI_TEXT_QUEUE_SIZE = 512;  // A few SysEx text lines
+
+// ============================================
+// MIDI byte stream → EngineEvents
+// ============================================
+template <uint32_t QUEUE_SIZE>
+class MidiInput {
+  public:
+    void Init(SampleClock* clock, uint32_t (*get_tick)(), uint32_t latency) {
+        clock_    = clock;
+        get_tick_ = get_tick;
+        latency_  = latency;
+        status_   = 0;
+        count_    = 0;
+        dropped_  = 0;
+        sysex_    = SYSEX_NONE;
+    }
+
+    // Transport callback (interrupt context): parse, stamp, queue
+    static void RxCallback(uint8_t* data, size_t size, void* context) {
+        MidiInput* self = static_cast<MidiInput*>(context);
+        uint32_t   due  = self->clock_->Now(self->get_tick_()) + self->latency_;
+        for (size_t i = 0; i < size; i++) {
+            self->Parse(data[i], due);
+        }
+    }
+
+    // Running-status parser: Note On/Off, CC and text SysEx, everything
+    // else skipped
+    void Parse(uint8_t byte, uint32_t due) {
+        if (byte >= 0xF8) return;  // Real-time (clock, active sensing...)
+        if (byte & 0x80) {
+            // End of a text SysEx = end of line; any other status byte
+            // aborts it (the partial line is dropped)
+            if (sysex_ == SYSEX_TEXT) text_.Push(byte == 0xF7 ? '\n' : BYTE_QUEUE_CANCEL);
+            sysex_ = byte == 0xF0 ? SYSEX_ID : SYSEX_NONE;
+
+            // Channel voice status starts a message; system common/SysEx
+            // cancels running status until the next channel status
+            status_ = byte < 0xF0 ? byte : 0;
+            count_  = 0;
+            return;
+        }
+        if (sysex_ == SYSEX_ID) {
+            sysex_ = byte == MIDI_SYSEX_TEXT_ID ? SYSEX_TEXT : SYSEX_OTHER;
+            return;
+        }
+        if (sysex_ == SYSEX_TEXT) {
+            if (!text_.Push(byte)) dropped_++;
+            return;
+        }
+        if (status_ == 0) return;
+
+        data_[count_++] = byte;
+        uint8_t kind   = status_ & 0xF0;
+        uint8_t needed = (kind == 0xC0 || kind == 0xD0) ? 1 : 2;
+        if (count_ < needed) return;
+        count_ = 0;  // Running status: next data byte starts a new message
+
+        EngineEvent e;
+        e.time  = due;
+        e.data1 = data_[0];
+        e.data2 = data_[1];
+        e.octave = 0;
+        if (kind == 0x90 && data_[1] > 0) {
+            e.type = EngineEvent::NOTE_ON;
+        } else if (kind == 0x80 || kind == 0x90) {
+            e.type = EngineEvent::NOTE_OFF;  // Note On with velocity 0 too
+        } else if (kind == 0xB0) {
+            e.type = EngineEvent::CONTROL_CHANGE;
+        } else {
+            return;
+        }
+        if (!queue_.Push(e)) dropped_++;
+    }
+
+    EventQueue<QUEUE_SIZE>&          Queue() { return queue_; }
+    ByteQueue<MIDI_TEXT_QUEUE_SIZE>& TextQueue() { return text_; }
+    uint32_t                         Dropped() const { return dropped_; }
+
+  private:
+    enum SysExState : uint8_t { SYSEX_NONE, SYSEX_ID, SYSEX_TEXT, SYSEX_OTHER };
+
+    EventQueue<QUEUE_SIZE>          queue_;
+    ByteQueue<MIDI_TEXT_QUEUE_SIZE> text_;
+    SampleClock*                    clock_    = nullptr;
+    uint32_t (*get_tick_)()                   = nullptr;
+    uint32_t                        latency_  = 0;
+
+    uint8_t           status_ = 0;
+    uint8_t           data_[2];
+    uint8_t           count_  = 0;
+    SysExState        sysex_  = SYSEX_NONE;
+    volatile uint32_t dropped_ = 0;
+};
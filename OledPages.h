@@ -0,0 +1,134 @@
+/*
+ * OLED PAGES - SSD1306 frames over any transport, changed pages only
+ *
+ * PAGES:
+ *   The panel's memory is HEIGHT/8 pages of WIDTH bytes, one byte = 8
+ *   pixel rows of a column. Update() compares the frame with a copy of
+ *   what the panel shows and sends only the pages that changed: every run
+ *   of changed pages gets an address window (columns 0..WIDTH-1, pages
+ *   first..last: 6 command bytes) and its bytes in one transfer. The
+ *   status screen mostly changes its level bars - 2 of 8 pages.
+ *
+ * TRANSPORT:
+ *   A class with
+ *     Config, Init(const Config&)
+ *     Commands(bytes, n)    command bytes, sent before returning
+ *     Data(bytes, n)        display bytes; may return while they go out
+ *     static bool Busy()    Data() still going out
+ *     ONE_WINDOW            one Data() per frame: runs of changed pages
+ *                           merge into one window first..last (DMA, where
+ *                           a transfer costs setup and the bytes are free)
+ *   The firmware has I2C (blocking) and SPI + DMA (DigitalKalimba.cpp);
+ *   oled/ counts bytes and bus time through a fake.
+ *
+ * DRIVER:
+ *   PagedOledDriver has what libDaisy's OledDisplay expects of a driver
+ *   (Config, Init, Width, Height, DrawPixel, Fill, Update), so the
+ *   drawing code - text, lines, scope - stays as it is. Update() first
+ *   waits for the last frame's Data(): the frame buffer can be drawn into
+ *   while DMA sends its own copy.
+ *
+ * Portable (no libDaisy dependency).
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// ============================================
+// SSD1306 driver, changed pages only
+// ============================================
+template <size_t WIDTH, size_t HEIGHT, typename Transport>
+class PagedOledDriver {
+  public:
+    static const size_t PAGES = HEIGHT / 8;
+
+    struct Config {
+        typename Transport::Config transport_config;
+    };
+
+    void Init(Config config) {
+        transport_.Init(config.transport_config);
+        const uint8_t init[] = {
+            0xAE,                               // Display off
+            0xD5, 0x80,                         // Clock divide / oscillator
+            0xA8, (uint8_t)(HEIGHT - 1),        // Multiplex
+            0xD3, 0x00,                         // Display offset
+            0x40,                               // Start line 0
+            0x8D, 0x14,                         // Charge pump on
+            0x20, 0x00,                         // Horizontal addressing: a window fills page by page
+            0xA1, 0xC8,                         // Column / row remap (as libDaisy)
+            0xDA, (uint8_t)(HEIGHT == 32 ? 0x02 : 0x12),  // COM pins
+            0x81, 0x8F,                         // Contrast
+            0xD9, 0xF1,                         // Precharge
+            0xDB, 0x40,                         // VCOMH
+            0xA4, 0xA6,                         // Show RAM, not inverted
+            0xAF,                               // Display on
+        };
+        transport_.Commands(init, sizeof(init));
+        memset(buffer_, 0, sizeof(buffer_));
+        shown_valid_ = false;  // First Update() sends every page
+    }
+
+    size_t Width() const { return WIDTH; }
+    size_t Height() const { return HEIGHT; }
+
+    void DrawPixel(uint_fast8_t x, uint_fast8_t y, bool on) {
+        if (x >= WIDTH || y >= HEIGHT) return;
+        uint8_t& byte = buffer_[x + (y / 8) * WIDTH];
+        if (on) byte |= (uint8_t)(1u << (y % 8));
+        else byte &= (uint8_t)~(1u << (y % 8));
+    }
+
+    void Fill(bool on) { memset(buffer_, on ? 0xFF : 0x00, sizeof(buffer_)); }
+
+    void Update() {
+        while (Transport::Busy()) {}
+
+        uint32_t changed = 0;
+        for (size_t p = 0; p < PAGES; p++) {
+            uint8_t* page = buffer_ + p * WIDTH;
+            uint8_t* shown = shown_ + p * WIDTH;
+            if (shown_valid_ && memcmp(page, shown, WIDTH) == 0) continue;
+            memcpy(shown, page, WIDTH);
+            changed |= 1u << p;
+        }
+        shown_valid_ = true;
+        last_pages_  = 0;
+        if (changed == 0) return;
+
+        if (Transport::ONE_WINDOW) {
+            size_t first = 0, last = PAGES - 1;
+            while (!(changed >> first & 1)) first++;
+            while (!(changed >> last & 1)) last--;
+            Send(first, last);
+            return;
+        }
+        for (size_t p = 0; p < PAGES; p++) {
+            if (!(changed >> p & 1)) continue;
+            size_t last = p;
+            while (last + 1 < PAGES && (changed >> (last + 1) & 1)) last++;
+            Send(p, last);
+            p = last;
+        }
+    }
+
+    // Pages sent by the last Update()
+    size_t LastPages() const { return last_pages_; }
+
+  private:
+    void Send(size_t first, size_t last) {
+        const uint8_t window[] = {0x21, 0x00, (uint8_t)(WIDTH - 1), 0x22, (uint8_t)first, (uint8_t)last};
+        transport_.Commands(window, sizeof(window));
+        transport_.Data(shown_ + first * WIDTH, (last - first + 1) * WIDTH);
+        last_pages_ += last - first + 1;
+    }
+
+    Transport transport_;
+    uint8_t   buffer_[WIDTH * PAGES];  // Drawn into
+    uint8_t   shown_[WIDTH * PAGES];   // On the panel (or going out)
+    bool      shown_valid_ = false;
+    size_t    last_pages_  = 0;
+};
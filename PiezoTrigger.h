@@ -0,0 +1,265 @@
+/*
+ * PIEZO TRIGGER - Velocity-tagged hits from piezo pickups, block-wise
+ *
+ * INPUT:
+ *   Interleaved ADC frames [frame][channel], 16-bit, as the ADC's DMA
+ *   leaves them. Piezos through the usual clamp (series resistor,
+ *   Schottky diodes to the rails, 1M to GND): only the positive half
+ *   waves arrive, silence reads ~0.
+ *
+ * BLOCK-WISE DETECTION:
+ *   Process() takes a whole buffer (a DMA half-buffer, or any block of
+ *   frames). First one pass computes every channel's block maximum - two
+ *   channels per instruction on the Cortex-M7's DSP extension (UQSUB16 /
+ *   UADD16), a vectorizable loop elsewhere. A quiet channel stops there:
+ *   one compare per block. Only a channel over its trigger level is
+ *   scanned sample by sample, for the onset and for the peak.
+ *
+ * HIT:
+ *   Onset = first frame above max(threshold, PIEZO_RISE x envelope), peak
+ *   = maximum over the PIEZO_PEAK_MS after it, velocity = peak on a log
+ *   scale from the threshold (0) to full scale (1).
+ *
+ * RETRIGGER GUARD:
+ *   Nothing for PIEZO_RETRIGGER_MS after an onset. After that a new hit
+ *   has to rise above PIEZO_RISE x the channel's envelope (block peaks,
+ *   PIEZO_RELEASE_MS release; the lower of this and the last block's, so
+ *   an attack split over two blocks still counts), so a still ringing
+ *   tine doesn't retrigger but a fresh, harder hit on it does.
+ *
+ * CROSSTALK:
+ *   A hit that rises less than PIEZO_CROSSTALK x an attack on another
+ *   channel at the same time (or a hit there within PIEZO_CROSSTALK_MS)
+ *   is that channel coming through the frame: dropped - also when the
+ *   other channel's own hit went unnoticed on its ringing tine. Ringing
+ *   on the other channels doesn't count.
+ *
+ * TIMING:
+ *   Hits carry their onset frame. A hit is reported at most
+ *   LatencyFrames() after its onset (peak window + one block), so adding
+ *   that as a fixed latency plays every hit with the same delay.
+ *
+ * Portable (no libDaisy dependency).
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#if defined(__ARM_FEATURE_SIMD32)
+#include <arm_acle.h>
+#endif
+
+const float PIEZO_THRESHOLD    = 0.02f;  // Full scale; above the noise of a clamped piezo
+const float PIEZO_PEAK_MS      = 1.0f;
+const float PIEZO_RETRIGGER_MS = 15.0f;
+const float PIEZO_RELEASE_MS   = 30.0f;  // Envelope time constant
+const float PIEZO_RISE         = 2.0f;
+const float PIEZO_CROSSTALK    = 0.4f;
+const float PIEZO_ATTACK       = 1.25f;  // Block peak over the envelope that is a new attack, not ringing
+const float PIEZO_CROSSTALK_MS = 3.0f;
+
+struct PiezoHit {
+    int      channel;
+    uint32_t frame;     // Onset, frames since Init()
+    float    velocity;  // 0..1
+};
+
+// Per-halfword maximum of two packed pairs of uint16
+inline uint32_t PiezoMax16x2(uint32_t a, uint32_t b) {
+#if defined(__ARM_FEATURE_SIMD32)
+    return __uadd16(b, __uqsub16(a, b));  // b + max(a - b, 0), per halfword
+#else
+    uint32_t lo = (a & 0xFFFF) > (b & 0xFFFF) ? a & 0xFFFF : b & 0xFFFF;
+    uint32_t hi = (a >> 16) > (b >> 16) ? a >> 16 : b >> 16;
+    return lo | hi << 16;
+#endif
+}
+
+template <int CHANNELS>
+class PiezoDetector {
+  public:
+    // frame_rate: ADC frames per second (per channel)
+    void Init(float frame_rate, float threshold = PIEZO_THRESHOLD) {
+        frame_        = 0;
+        threshold_    = threshold * 65535.0f;
+        log_range_    = logf(65535.0f / threshold_);
+        peak_frames_  = Frames(PIEZO_PEAK_MS, frame_rate);
+        guard_frames_ = Frames(PIEZO_RETRIGGER_MS, frame_rate);
+        talk_frames_  = Frames(PIEZO_CROSSTALK_MS, frame_rate);
+        release_      = 1000.0f / (PIEZO_RELEASE_MS * frame_rate);  // Per frame
+        release_count_ = 0;
+        release_block_ = 1.0f;
+        memset(ch_, 0, sizeof(ch_));
+        for (int c = 0; c < CHANNELS; c++) ch_[c].last_onset = 0u - 4 * talk_frames_;  // Long ago
+    }
+
+    // Hits are reported this long after their onset at most, for blocks
+    // of up to `block` frames
+    uint32_t LatencyFrames(size_t block) const { return peak_frames_ + (uint32_t)block; }
+
+    // One buffer of `count` frames (count <= the retrigger guard, so at
+    // most one hit per channel): hits in onset order per channel into
+    // `hits` (room for CHANNELS), returns how many
+    size_t Process(const uint16_t* frames, size_t count, PiezoHit* hits) {
+        uint16_t block_max[CHANNELS];
+        BlockMax(frames, count, block_max);
+
+        // Peak windows ending in this block
+        int      ended[CHANNELS];
+        size_t   pending = 0;
+        uint32_t first   = frame_;
+        uint32_t last    = first + (uint32_t)count;
+        for (int c = 0; c < CHANNELS; c++) {
+            Channel& ch  = ch_[c];
+            size_t   pos = 0;
+            while (pos < count) {
+                if (ch.state == GUARD) {
+                    if ((int32_t)(ch.until - last) >= 0) break;
+                    pos      = ch.until - first > pos ? ch.until - first : pos;
+                    ch.state = IDLE;
+                } else if (ch.state == IDLE) {
+                    float    env   = ch.env < ch.env_before ? ch.env : ch.env_before;  // Attack across blocks
+                    float    level = env * PIEZO_RISE > threshold_ ? env * PIEZO_RISE : threshold_;
+                    uint16_t limit = level < 65535.0f ? (uint16_t)level : 65535;
+                    uint16_t high  = pos == 0 ? block_max[c] : ChannelMax(frames, c, pos, count);
+                    if (high <= limit) break;  // Quiet: the common case
+                    while (frames[pos * CHANNELS + c] <= limit) pos++;
+                    ch.state      = PEAK;
+                    ch.background = env;
+                    ch.onset      = first + (uint32_t)pos;
+                    ch.until = ch.onset + peak_frames_;
+                    ch.peak  = 0;
+                } else {  // PEAK
+                    size_t   end  = (int32_t)(ch.until - last) >= 0 ? count : ch.until - first;
+                    uint16_t high = ChannelMax(frames, c, pos, end);
+                    ch.peak       = high > ch.peak ? high : ch.peak;
+                    pos           = end;
+                    if (first + (uint32_t)pos == ch.until) {
+                        ended[pending++] = c;
+                        ch.state         = GUARD;
+                        ch.until         = ch.onset + guard_frames_;
+                    }
+                }
+            }
+        }
+
+        // Block peaks of channels that are rising (not just ringing)
+        uint16_t attack[CHANNELS];
+        for (int c = 0; c < CHANNELS; c++) attack[c] = block_max[c] > PIEZO_ATTACK * ch_[c].env ? block_max[c] : 0;
+
+        // Crosstalk: the hit's rise over its background against attacks on
+        // the other channels over the peak window (this block and the one
+        // before) and hits they reported just before
+        size_t kept = 0;
+        for (size_t h = 0; h < pending; h++) {
+            const Channel& ch   = ch_[ended[h]];
+            uint16_t       loud = 0;
+            for (int d = 0; d < CHANNELS; d++) {
+                const Channel& other = ch_[d];
+                if (d == ended[h]) continue;
+                loud = attack[d] > loud ? attack[d] : loud;
+                loud = other.attack_before > loud ? other.attack_before : loud;
+                if (Near(other.last_onset, ch.onset)) loud = other.last_peak > loud ? other.last_peak : loud;
+            }
+            if (ch.peak - ch.background < PIEZO_CROSSTALK * loud) continue;
+            hits[kept].channel  = ended[h];
+            hits[kept].frame    = ch.onset;
+            hits[kept].velocity = Velocity(ch.peak);
+            kept++;
+        }
+        for (size_t h = 0; h < pending; h++) {
+            Channel& ch   = ch_[ended[h]];
+            ch.last_onset = ch.onset;  // Dropped ones too: real energy on the frame
+            ch.last_peak  = ch.peak;
+        }
+
+        // Envelope: block peaks with release
+        if (count != release_count_) {
+            release_count_ = count;
+            release_block_ = expf(-release_ * count);
+        }
+        for (int c = 0; c < CHANNELS; c++) {
+            float decayed         = ch_[c].env * release_block_;
+            ch_[c].env_before     = ch_[c].env;
+            ch_[c].env            = block_max[c] > decayed ? block_max[c] : decayed;
+            ch_[c].attack_before  = attack[c];
+        }
+
+        frame_ += (uint32_t)count;
+        return kept;
+    }
+
+    uint32_t Frame() const { return frame_; }
+
+  private:
+    enum State { IDLE, PEAK, GUARD };
+
+    struct Channel {
+        State    state;
+        uint32_t onset;       // Current / last hit
+        uint32_t until;       // End of the peak window / the guard
+        uint16_t peak;
+        float    env;         // Block peaks with release
+        float    env_before;  // As of the block before
+        float    background;  // Envelope the current hit rose from
+        uint16_t attack_before;
+        uint32_t last_onset;  // Last hit reported or dropped (crosstalk)
+        uint16_t last_peak;
+    };
+
+    static uint32_t Frames(float ms, float frame_rate) { return (uint32_t)(ms * 0.001f * frame_rate + 0.5f); }
+
+    bool Near(uint32_t a, uint32_t b) const {
+        uint32_t d = a - b;
+        return d <= talk_frames_ || -d <= talk_frames_;
+    }
+
+    float Velocity(float peak) const {
+        float v = logf(peak / threshold_) / log_range_;
+        return v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+    }
+
+    // Every channel's maximum over the block: channel pairs packed in one
+    // word, an odd last channel on its own
+    static void BlockMax(const uint16_t* frames, size_t count, uint16_t* out) {
+        const int PAIRS = CHANNELS / 2;
+        uint32_t  pair_max[PAIRS > 0 ? PAIRS : 1] = {};
+        uint16_t  odd_max = 0;
+        for (size_t f = 0; f < count; f++) {
+            const uint16_t* x = frames + f * CHANNELS;
+            for (int p = 0; p < PAIRS; p++) {
+                uint32_t word;
+                memcpy(&word, x + 2 * p, sizeof(word));
+                pair_max[p] = PiezoMax16x2(pair_max[p], word);
+            }
+            if (CHANNELS & 1) odd_max = x[CHANNELS - 1] > odd_max ? x[CHANNELS - 1] : odd_max;
+        }
+        for (int p = 0; p < PAIRS; p++) {
+            uint16_t halves[2];
+            memcpy(halves, &pair_max[p], sizeof(halves));  // Memory order = channel order
+            out[2 * p]     = halves[0];
+            out[2 * p + 1] = halves[1];
+        }
+        if (CHANNELS & 1) out[CHANNELS - 1] = odd_max;
+    }
+
+    static uint16_t ChannelMax(const uint16_t* frames, int c, size_t from, size_t to) {
+        uint16_t high = 0;
+        for (size_t f = from; f < to; f++) high = frames[f * CHANNELS + c] > high ? frames[f * CHANNELS + c] : high;
+        return high;
+    }
+
+    Channel  ch_[CHANNELS];
+    uint32_t frame_        = 0;
+    float    threshold_    = 0.0f;  // ADC counts
+    float    log_range_    = 1.0f;
+    uint32_t peak_frames_  = 0;
+    uint32_t guard_frames_ = 0;
+    uint32_t talk_frames_  = 0;
+    float    release_      = 0.0f;
+    size_t   release_count_ = 0;
+    float    release_block_ = 1.0f;
+};
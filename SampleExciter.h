@@ -0,0 +1,313 @@
+/*
+ * SAMPLE EXCITER - Pluck strings with recorded sounds streamed from SD
+ * For the Digital Kalimba
+ *
+ * Instead of the single-sample impulse, String::Process() is fed a WAV
+ * (mallet hit, fingernail click, found sound...). Files are EXC_0.WAV,
+ * EXC_1.WAV, ... on the card: 16-bit PCM mono, played 1:1 (use 48kHz).
+ *
+ * MEMORY:
+ *   Only a small window of each file is in RAM:
+ *   - HEAD samples stay resident, so a trigger starts on the exact sample
+ *     with no SD access at all
+ *   - every string then streams the rest through its own double buffer
+ *     (2 x WINDOW), refilled by the main loop one half ahead of playback
+ *
+ * REAL-TIME RULES:
+ *   - The audio thread never touches the card. If a half is not ready in
+ *     time (card too slow) the excitation ends early and Underruns() counts
+ *     it - the string still rings, nothing stalls.
+ *   - Each half carries a tag = generation * 2 + ready. A retrigger bumps
+ *     the generation, so a read that was in flight for the previous note
+ *     fails its compare-exchange and is discarded.
+ *
+ * SOURCES:
+ *   Any class with Open(name) / ReadAt(offset, buf, bytes) / Close().
+ *   FatFsSampleSource is used on the Daisy; StdioSampleSource reads a host
+ *   file and can simulate slow reads (exciter/ streams through it).
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+
+// ============================================
+// WAV header (16-bit PCM mono only)
+// ============================================
+// Walks the RIFF chunks of the open file: byte offset and length in
+// samples of "data", false if it is not 16-bit PCM mono
+template <typename Source>
+bool FindWavData(Source* source, size_t* data_offset, uint32_t* samples) {
+    auto get16 = [](const uint8_t* p) -> uint16_t { return p[0] | (p[1] << 8); };
+    auto get32 = [](const uint8_t* p) -> uint32_t {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+    };
+
+    uint8_t h[12];
+    if (source->ReadAt(0, h, 12) != 12) return false;
+    if (memcmp(h, "RIFF", 4) != 0 || memcmp(h + 8, "WAVE", 4) != 0) return false;
+
+    // 64-bit offsets: a malformed chunk size can't wrap back to an earlier
+    // chunk (endless loop at boot), it runs past the RIFF end and stops
+    uint64_t riff_end = 8 + (uint64_t)get32(h + 4);
+    bool     fmt_ok   = false;
+    uint64_t off      = 12;
+    while (off + 8 <= riff_end && source->ReadAt((size_t)off, h, 8) == 8) {
+        uint32_t size = get32(h + 4);
+        if (memcmp(h, "fmt ", 4) == 0) {
+            uint8_t f[16];
+            if (size < 16 || source->ReadAt((size_t)off + 8, f, 16) != 16) return false;
+            fmt_ok = get16(f) == 1 && get16(f + 2) == 1 && get16(f + 14) == 16;
+        } else if (memcmp(h, "data", 4) == 0) {
+            *data_offset = (size_t)off + 8;
+            *samples     = size / 2;
+            return fmt_ok;
+        }
+        off += 8 + (uint64_t)size + (size & 1);  // Chunks are word aligned
+    }
+    return false;
+}
+
+template <typename Source, int NUM_VOICES>
+class SampleExciter {
+  public:
+    static const uint32_t HEAD   = 4096;  // Resident samples (~85ms at 48kHz)
+    static const uint32_t WINDOW = 2048;  // Samples per streamed half (~43ms)
+    static const int      MAX_FILES = 8;  // EXC_0.WAV ... EXC_7.WAV
+
+    SampleExciter() {}
+    ~SampleExciter() {}
+
+    void Init(Source* source, float gain) {
+        source_ = source;
+        gain_   = gain / 32768.0f;
+        file_index_ = -1;
+        select_req_.store(false);
+        loaded_.store(false);
+        underruns_.store(0);
+        for (int v = 0; v < NUM_VOICES; v++) {
+            voices_[v].active.store(false);
+            voices_[v].tag[0].store(0);
+            voices_[v].tag[1].store(0);
+        }
+    }
+
+    // ============================================
+    // Audio thread
+    // ============================================
+
+    // Cycle Impulse → EXC_0 → EXC_1 → ... → Impulse (button chord)
+    void SelectNext() { select_req_.store(true, std::memory_order_release); }
+
+    // True when a sample is loaded (otherwise use the impulse)
+    bool Loaded() const { return loaded_.load(std::memory_order_relaxed); }
+
+    // Restart the sample on a string, from its first sample
+    void Start(int v) {
+        if (!Loaded()) return;
+        Voice&   vc  = voices_[v];
+        uint32_t gen = vc.gen + 1;
+        vc.gen       = gen;
+        vc.pos       = 0;
+        vc.fill_pos[0] = HEAD;
+        vc.fill_pos[1] = HEAD + WINDOW;
+        vc.tag[0].store(gen * 2, std::memory_order_release);
+        vc.tag[1].store(gen * 2, std::memory_order_release);
+        vc.active.store(length_ > 0, std::memory_order_release);
+    }
+
+    // Next excitation sample for a string (0 when idle)
+    float Process(int v) {
+        Voice& vc = voices_[v];
+        if (!vc.active.load(std::memory_order_relaxed)) return 0.0f;
+
+        uint32_t pos = vc.pos;
+        if (pos >= length_) {
+            vc.active.store(false, std::memory_order_relaxed);
+            return 0.0f;
+        }
+
+        int16_t x;
+        if (pos < HEAD) {
+            x = head_[pos];
+        } else {
+            uint32_t off = pos - HEAD;
+            uint32_t h   = (off / WINDOW) & 1;
+            uint32_t i   = off % WINDOW;
+            if (!(vc.tag[h].load(std::memory_order_acquire) & 1)) {
+                underruns_.fetch_add(1, std::memory_order_relaxed);
+                vc.active.store(false, std::memory_order_relaxed);
+                return 0.0f;
+            }
+            x = vc.buf[h][i];
+            // Half consumed: queue the window after the other half
+            if (i == WINDOW - 1) {
+                vc.fill_pos[h] += 2 * WINDOW;
+                vc.tag[h].store(vc.gen * 2, std::memory_order_release);
+            }
+        }
+
+        vc.pos = pos + 1;
+        return (float)x * gain_;
+    }
+
+    // ============================================
+    // Main loop
+    // ============================================
+
+    // Handles sample selection and refills every empty half
+    void Service() {
+        if (select_req_.exchange(false, std::memory_order_acquire)) {
+            LoadNext();
+        }
+        if (!Loaded()) return;
+
+        for (int v = 0; v < NUM_VOICES; v++) {
+            Voice& vc = voices_[v];
+            for (int h = 0; h < 2; h++) {
+                uint32_t tag = vc.tag[h].load(std::memory_order_acquire);
+                if ((tag & 1) || !vc.active.load(std::memory_order_acquire)) continue;
+
+                uint32_t from = vc.fill_pos[h];
+                if (from >= length_) continue;
+                uint32_t n = length_ - from < WINDOW ? length_ - from : WINDOW;
+
+                size_t got = source_->ReadAt(data_offset_ + from * 2, vc.buf[h], n * 2);
+                if (got < n * 2) memset((uint8_t*)vc.buf[h] + got, 0, WINDOW * 2 - got);
+                else if (n < WINDOW) memset(vc.buf[h] + n, 0, (WINDOW - n) * 2);
+
+                // Publish unless the note was retriggered meanwhile
+                vc.tag[h].compare_exchange_strong(tag, tag | 1, std::memory_order_release);
+            }
+        }
+    }
+
+    int      FileIndex() const { return Loaded() ? file_index_ : -1; }
+    uint32_t Underruns() const { return underruns_.load(std::memory_order_relaxed); }
+
+  private:
+    struct Voice {
+        alignas(32) int16_t buf[2][WINDOW];
+        std::atomic<uint32_t> tag[2];        // gen * 2 + ready
+        std::atomic<bool>     active{false};
+        uint32_t              fill_pos[2];   // First sample each half will hold
+        uint32_t              gen = 0;
+        uint32_t              pos = 0;
+    };
+
+    // Opens the next EXC_n.WAV (or falls back to the impulse)
+    void LoadNext() {
+        // Audio stops reading immediately (main loop can't preempt it)
+        loaded_.store(false, std::memory_order_release);
+        for (int v = 0; v < NUM_VOICES; v++) {
+            voices_[v].active.store(false, std::memory_order_relaxed);
+        }
+        if (file_index_ >= 0) source_->Close();
+
+        int next = file_index_ + 1;
+        file_index_ = -1;
+        if (next >= MAX_FILES) return;
+
+        char name[24];
+        snprintf(name, sizeof(name), "EXC_%d.WAV", next);
+        if (!source_->Open(name)) return;
+        file_index_ = next;
+
+        if (!FindWavData(source_, &data_offset_, &length_)) {
+            source_->Close();
+            file_index_ = -1;
+            return;
+        }
+
+        uint32_t n = length_ < HEAD ? length_ : HEAD;
+        memset(head_, 0, sizeof(head_));
+        if (source_->ReadAt(data_offset_, head_, n * 2) != n * 2) {
+            source_->Close();
+            file_index_ = -1;
+            return;
+        }
+        loaded_.store(true, std::memory_order_release);
+    }
+
+    Source* source_      = nullptr;
+    float   gain_        = 0.0f;
+    int     file_index_  = -1;
+    size_t  data_offset_ = 0;
+    uint32_t length_     = 0;  // Samples in the loaded file
+
+    std::atomic<bool>     select_req_{false};
+    std::atomic<bool>     loaded_{false};
+    std::atomic<uint32_t> underruns_{0};
+
+    alignas(32) int16_t head_[HEAD];
+    Voice voices_[NUM_VOICES];
+};
+
+// ============================================
+// FatFS source (Daisy: SDMMC1 + FatFS from libDaisy)
+// ============================================
+#ifdef FF_DEFINED
+
+class FatFsSampleSource {
+  public:
+    bool Open(const char* name) { return f_open(&file_, name, FA_READ) == FR_OK; }
+
+    // libDaisy's SD driver invalidates the D-cache after each DMA read
+    size_t ReadAt(size_t offset, void* buf, size_t bytes) {
+        UINT got = 0;
+        if (f_lseek(&file_, offset) != FR_OK) return 0;
+        if (f_read(&file_, buf, bytes, &got) != FR_OK) return 0;
+        return got;
+    }
+
+    void Close() { f_close(&file_); }
+
+  private:
+    FIL file_;
+};
+
+#endif  // FF_DEFINED
+
+// ============================================
+// Stdio source (host builds: SD card = plain file)
+// ============================================
+#if !defined(__arm__)
+
+#include <unistd.h>
+
+class StdioSampleSource {
+  public:
+    explicit StdioSampleSource(const char* dir) : dir_(dir) {}
+
+    // Simulated card latency per ReadAt() call (microseconds)
+    void SetReadLatency(uint32_t us) { latency_us_ = us; }
+
+    bool Open(const char* name) {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/%s", dir_, name);
+        file_ = fopen(path, "rb");
+        return file_ != nullptr;
+    }
+
+    size_t ReadAt(size_t offset, void* buf, size_t bytes) {
+        if (latency_us_) usleep(latency_us_);
+        if (fseek(file_, (long)offset, SEEK_SET) != 0) return 0;
+        return fread(buf, 1, bytes, file_);
+    }
+
+    void Close() {
+        if (file_) fclose(file_);
+        file_ = nullptr;
+    }
+
+  private:
+    const char* dir_;
+    FILE*       file_       = nullptr;
+    uint32_t    latency_us_ = 0;
+};
+
+#endif  // !__arm__
@@ -0,0 +1,348 @@
+/*
+ * SCOPE VIEW - Oscilloscope and 64-band spectrum screens for the OLED
+ *
+ * DATA FLOW:
+ *   audio callback → SnapshotRing::Push (decimated final mix, lock-free
+ *   triple buffer) → main loop: SnapshotRing::Acquire → SlicedFft::Run
+ *   (a few hundred microseconds per pass) → DrawScope / DrawSpectrum at
+ *   the refresh interval ScopePacer picks
+ *
+ * SNAPSHOTS:
+ *   SCOPE_FRAME samples at 48kHz / SCOPE_DECIMATION (24kHz: ~10.7ms, FFT
+ *   bins of 93.75Hz up to 12kHz); ScopeDecimation() keeps other sample
+ *   rates near 24kHz (32kHz: 1, 96kHz: 4). Three frames: the audio
+ *   thread fills one, one is ready, the main loop holds one - neither
+ *   side ever waits, the main loop always gets the newest complete frame.
+ *
+ * TIME BUDGET:
+ *   The FFT (256-point, radix-2, float) is a state machine - window,
+ *   butterflies, band magnitudes - advanced in steps of a few dozen
+ *   operations. Run() stops stepping once its budget is used up, so no
+ *   main loop pass is held up for a whole transform.
+ *
+ * REFRESH:
+ *   ScopePacer stretches the refresh interval when drawing a frame (FFT +
+ *   drawing + the I2C transfer) costs more than SCOPE_CPU_SHARE of the
+ *   CPU the audio callback leaves over.
+ *
+ * Portable (no libDaisy dependency): drawing goes through any display
+ * with libDaisy's OledDisplay Fill / DrawPixel / DrawLine / DrawRect, so a
+ * host framebuffer renders the same screens. Clocks as in SelfBench.h
+ * (static Now() / Elapsed(start)).
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+const size_t SCOPE_FRAME       = 256;  // Samples per snapshot = FFT size
+const int    SCOPE_FFT_LOG2    = 8;
+const int    SCOPE_DECIMATION  = 2;    // 48kHz → 24kHz
+const float  SCOPE_RATE        = 24000.0f;  // Snapshot rate aimed for
+const int    SCOPE_BANDS       = 64;   // 2 pixels each on the 128px OLED
+const float  SCOPE_FLOOR_DB    = -72.0f;
+const int    SCOPE_STEP_OPS    = 32;   // Butterflies / samples / bands per step
+const float  SCOPE_CPU_SHARE   = 0.25f;
+const float  SCOPE_MIN_REFRESH = 0.033f;  // Seconds (~30 fps)
+const float  SCOPE_MAX_REFRESH = 0.25f;
+
+// ============================================
+// Audio thread → main loop snapshots (triple buffer)
+// ============================================
+// Decimation that brings `sample_rate` nearest SCOPE_RATE
+inline int ScopeDecimation(float sample_rate) {
+    int decimation = (int)(sample_rate / SCOPE_RATE + 0.5f);
+    return decimation < 1 ? 1 : decimation;
+}
+
+class SnapshotRing {
+  public:
+    // Before the first Push()
+    void SetDecimation(int decimation) {
+        decimation_ = decimation;
+        gain_       = 1.0f / decimation;
+    }
+    int  Decimation() const { return decimation_; }
+
+    // Audio thread: append a block of the final mix
+    void Push(const float* in, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            acc_ += in[i];
+            if (++phase_ < decimation_) continue;
+            frames_[write_][fill_++] = acc_ * gain_;  // Box filter
+            acc_   = 0.0f;
+            phase_ = 0;
+            if (fill_ == SCOPE_FRAME) {
+                // Publish: swap the full frame with the ready slot
+                write_ = ready_.exchange(write_ | NEW_FRAME, std::memory_order_acq_rel) & INDEX_MASK;
+                fill_  = 0;
+            }
+        }
+    }
+
+    // Main loop: newest complete frame, or nullptr if none arrived since
+    // the last call. Stays valid until the next successful Acquire().
+    const float* Acquire() {
+        if (!(ready_.load(std::memory_order_relaxed) & NEW_FRAME)) return nullptr;
+        read_ = ready_.exchange(read_, std::memory_order_acq_rel) & INDEX_MASK;
+        return frames_[read_];
+    }
+
+  private:
+    static const uint8_t NEW_FRAME  = 0x80;
+    static const uint8_t INDEX_MASK = 0x03;
+
+    float                frames_[3][SCOPE_FRAME];
+    std::atomic<uint8_t> ready_{1};
+    uint8_t              write_ = 0;  // Audio thread
+    uint8_t              read_  = 2;  // Main loop
+    size_t               fill_  = 0;
+    int                  phase_ = 0;
+    float                acc_   = 0.0f;
+    int                  decimation_ = SCOPE_DECIMATION;
+    float                gain_       = 1.0f / SCOPE_DECIMATION;
+};
+
+// ============================================
+// FFT in budgeted slices (main loop only)
+// ============================================
+class SlicedFft {
+  public:
+    void Init() {
+        const float two_pi = 6.28318530718f;
+        for (size_t i = 0; i < SCOPE_FRAME / 2; i++) {
+            cos_[i] = cosf(two_pi * i / SCOPE_FRAME);
+            sin_[i] = sinf(two_pi * i / SCOPE_FRAME);
+        }
+        for (size_t i = 0; i < SCOPE_FRAME; i++) {
+            window_[i]  = 0.5f - 0.5f * cosf(two_pi * i / SCOPE_FRAME);  // Hann
+            reverse_[i] = Reverse(i);
+        }
+
+        // Log-spaced bands over bins 1 .. N/2 - 1, at least one bin each
+        // (so one bin per band up to ~6kHz, log above)
+        int   lo    = 1;
+        float ratio = powf((float)(SCOPE_FRAME / 2) / lo, 1.0f / SCOPE_BANDS);
+        float edge  = lo;
+        for (int b = 0; b < SCOPE_BANDS; b++) {
+            edge *= ratio;
+            int hi   = (int)(edge + 0.5f);
+            int left = SCOPE_BANDS - 1 - b;  // Bands still to place after this one
+            if (hi <= lo) hi = lo + 1;
+            if (hi > (int)(SCOPE_FRAME / 2) - left) hi = SCOPE_FRAME / 2 - left;
+            band_lo_[b] = lo;
+            band_hi_[b] = hi;
+            lo = hi;
+            bands_[b] = 0.0f;
+        }
+        state_ = IDLE;
+    }
+
+    bool Busy() const { return state_ != IDLE; }
+
+    // Start a transform of `frame` (SCOPE_FRAME samples, must stay valid
+    // until Busy() turns false)
+    void Start(const float* frame) {
+        input_ = frame;
+        state_ = LOAD;
+        pos_   = 0;
+    }
+
+    // Advance until done or `budget` Clock ticks have passed; true when a
+    // new set of bands is ready
+    template <typename Clock>
+    bool Run(uint32_t budget) {
+        uint32_t start = Clock::Now();
+        while (state_ != IDLE) {
+            if (Step()) return true;
+            if (Clock::Elapsed(start) >= budget) break;
+        }
+        return false;
+    }
+
+    // One slice of work; true when the bands were just completed
+    bool Step() {
+        switch (state_) {
+            case IDLE: return false;
+            case LOAD: {
+                // Window, in bit-reversed order for the in-place butterflies
+                size_t end = pos_ + SCOPE_STEP_OPS;
+                for (; pos_ < end; pos_++) {
+                    size_t j = reverse_[pos_];
+                    re_[j]   = input_[pos_] * window_[pos_];
+                    im_[j]   = 0.0f;
+                }
+                if (pos_ == SCOPE_FRAME) Next(BUTTERFLY);
+                return false;
+            }
+            case BUTTERFLY: {
+                // Stage `stage_` (span 2^stage_), butterflies pos_..
+                size_t half   = (size_t)1 << stage_;
+                size_t stride = SCOPE_FRAME / (half * 2);
+                for (int n = 0; n < SCOPE_STEP_OPS && pos_ < SCOPE_FRAME / 2; n++, pos_++) {
+                    size_t group = pos_ / half;
+                    size_t k     = pos_ % half;
+                    size_t a     = group * half * 2 + k;
+                    size_t b     = a + half;
+                    float  wr    = cos_[k * stride];
+                    float  wi    = -sin_[k * stride];
+                    float  tr    = re_[b] * wr - im_[b] * wi;
+                    float  ti    = re_[b] * wi + im_[b] * wr;
+                    re_[b] = re_[a] - tr;
+                    im_[b] = im_[a] - ti;
+                    re_[a] += tr;
+                    im_[a] += ti;
+                }
+                if (pos_ == SCOPE_FRAME / 2) {
+                    pos_ = 0;
+                    if (++stage_ == SCOPE_FFT_LOG2) Next(BANDS);
+                }
+                return false;
+            }
+            case BANDS: {
+                // Loudest bin per band, dB → 0..1 above the floor. A full
+                // scale sine peaks at N/4 with the Hann window.
+                const float norm = 4.0f / SCOPE_FRAME;
+                int         end  = (int)pos_ + SCOPE_STEP_OPS / 4;
+                for (; (int)pos_ < end && pos_ < (size_t)SCOPE_BANDS; pos_++) {
+                    float peak = 0.0f;
+                    for (int k = band_lo_[pos_]; k < band_hi_[pos_]; k++) {
+                        float p = re_[k] * re_[k] + im_[k] * im_[k];
+                        if (p > peak) peak = p;
+                    }
+                    float db = 10.0f * log10f(peak * norm * norm + 1e-12f);
+                    float v  = (db - SCOPE_FLOOR_DB) / -SCOPE_FLOOR_DB;
+                    bands_[pos_] = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+                }
+                if (pos_ == (size_t)SCOPE_BANDS) {
+                    state_ = IDLE;
+                    return true;
+                }
+                return false;
+            }
+        }
+        return false;
+    }
+
+    // Last completed spectrum, 0..1 per band (low → high)
+    const float* Bands() const { return bands_; }
+
+    // Centre frequency of band b, for labels
+    float BandHz(int b, float sample_rate) const {
+        return 0.5f * (band_lo_[b] + band_hi_[b] - 1) * sample_rate / SCOPE_FRAME;
+    }
+
+    // Band showing frequency `hz` (-1 below the first / above the last)
+    int Band(float hz, float sample_rate) const {
+        int bin = (int)(hz * SCOPE_FRAME / sample_rate + 0.5f);
+        for (int b = 0; b < SCOPE_BANDS; b++) {
+            if (bin >= band_lo_[b] && bin < band_hi_[b]) return b;
+        }
+        return -1;
+    }
+
+  private:
+    enum State { IDLE, LOAD, BUTTERFLY, BANDS };
+
+    void Next(State state) {
+        state_ = state;
+        pos_   = 0;
+        stage_ = 0;
+    }
+
+    static uint16_t Reverse(size_t i) {
+        uint16_t r = 0;
+        for (int b = 0; b < SCOPE_FFT_LOG2; b++) r = (r << 1) | ((i >> b) & 1);
+        return r;
+    }
+
+    float        re_[SCOPE_FRAME];
+    float        im_[SCOPE_FRAME];
+    float        window_[SCOPE_FRAME];
+    float        cos_[SCOPE_FRAME / 2];
+    float        sin_[SCOPE_FRAME / 2];
+    uint16_t     reverse_[SCOPE_FRAME];
+    uint8_t      band_lo_[SCOPE_BANDS];
+    uint8_t      band_hi_[SCOPE_BANDS];
+    float        bands_[SCOPE_BANDS];
+    const float* input_ = nullptr;
+    State        state_ = IDLE;
+    size_t       pos_   = 0;
+    int          stage_ = 0;
+};
+
+// ============================================
+// Refresh pacing
+// ============================================
+class ScopePacer {
+  public:
+    // Seconds until the next frame, given what the last one cost (main
+    // loop time) and the audio callback's load (0..1)
+    float Interval(float frame_cost, float audio_load) {
+        float spare = 1.0f - audio_load;
+        if (spare < 0.05f) spare = 0.05f;
+        float interval = frame_cost / (SCOPE_CPU_SHARE * spare);
+        interval_      = interval < SCOPE_MIN_REFRESH ? SCOPE_MIN_REFRESH
+                                                      : (interval > SCOPE_MAX_REFRESH ? SCOPE_MAX_REFRESH : interval);
+        return interval_;
+    }
+
+    float Last() const { return interval_; }
+
+  private:
+    float interval_ = SCOPE_MIN_REFRESH;
+};
+
+// ============================================
+// Drawing (128x64, row 0-7 left free for a title)
+// ============================================
+const int SCOPE_TOP    = 10;
+const int SCOPE_BOTTOM = 63;
+
+// Waveform: triggered on the first rising zero crossing, auto-ranged to
+// the frame's peak. Returns the gain used.
+template <typename Display>
+float DrawScope(Display& display, const float* frame) {
+    const int width = 128;
+    size_t    start = 0;
+    for (size_t i = 1; i + width < SCOPE_FRAME; i++) {
+        if (frame[i - 1] < 0.0f && frame[i] >= 0.0f) {
+            start = i;
+            break;
+        }
+    }
+
+    float peak = 0.0f;
+    for (int x = 0; x < width; x++) peak = fmaxf(peak, fabsf(frame[start + x]));
+    float gain = 1.0f / fmaxf(peak, 0.01f);  // Silence stays a flat line
+
+    const float mid  = 0.5f * (SCOPE_TOP + SCOPE_BOTTOM);
+    const float half = 0.5f * (SCOPE_BOTTOM - SCOPE_TOP);
+    int         prev = 0;
+    for (int x = 0; x < width; x++) {
+        int y = (int)(mid - frame[start + x] * gain * half + 0.5f);
+        y     = y < SCOPE_TOP ? SCOPE_TOP : (y > SCOPE_BOTTOM ? SCOPE_BOTTOM : y);
+        if (x > 0) {
+            display.DrawLine(x - 1, prev, x, y, true);
+        } else {
+            display.DrawPixel(x, y, true);
+        }
+        prev = y;
+    }
+    return gain;
+}
+
+// One 2px bar per band, low frequencies left
+template <typename Display>
+void DrawSpectrum(Display& display, const float* bands) {
+    const int height = SCOPE_BOTTOM - SCOPE_TOP + 1;
+    for (int b = 0; b < SCOPE_BANDS; b++) {
+        int bar = (int)(bands[b] * height + 0.5f);
+        if (bar > 0) {
+            display.DrawRect(b * 2, SCOPE_BOTTOM - bar + 1, b * 2 + 1, SCOPE_BOTTOM, true, true);
+        }
+    }
+}
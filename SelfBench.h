@@ -0,0 +1,158 @@
+/*
+ * SELF BENCH - Fixed render of the Kalimba engine, for timing and
+ * golden-output checks
+ *
+ * The same pluck sequence is rendered by the QEMU benchmark (bench/) and
+ * by the firmware at boot (hold Button 1 at power-on), so:
+ *   - cycles / instructions per stage compare across units and builds
+ *   - the output checksum of a unit must match the golden one printed by
+ *     the emulator for the same build flags (7 voices, block 4)
+ *
+ * SEQUENCE:
+ *   48kHz, engine defaults, Pentatonic Major (an octave up for every
+ *   extra 7 voices). All voices plucked on the first block, then one
+ *   pluck every SELF_BENCH_PLUCK_INTERVAL samples, round robin. Other
+ *   sample rates (bench/'s rate sweep) keep the plucks as far apart in
+ *   time; the golden checksum is the 48kHz one.
+ *
+ * CLOCKS:
+ *   Any struct with static Now() and Elapsed(start). DwtClock counts CPU
+ *   cycles on the Daisy; the emulator benchmark brings its own.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "KalimbaEngine.h"
+
+const float SELF_BENCH_SAMPLE_RATE    = 48000.0f;
+const int   SELF_BENCH_BLOCKS         = 4000;   // ~0.33s of audio at block 4
+const int   SELF_BENCH_PLUCK_INTERVAL = 2400;   // Samples between plucks (at 48kHz)
+const int   SELF_BENCH_MAX_STAGES     = 8;
+
+const char* const SELF_BENCH_STAGE_NAMES[] = {"lfo", "strings", "filter", "mix", "reverb", "saturator"};
+
+// ============================================
+// Per-stage timing for KalimbaEngine's Profiler hook
+// ============================================
+// Off by default: a disabled profiler costs one load + branch per stage
+template <typename Clock>
+struct StageProfiler {
+    static bool     enabled;
+    static uint32_t start[SELF_BENCH_MAX_STAGES];
+    static uint64_t total[SELF_BENCH_MAX_STAGES];
+
+    static inline void Begin(int stage) {
+        if (enabled) start[stage] = Clock::Now();
+    }
+    static inline void End(int stage) {
+        if (enabled) total[stage] += Clock::Elapsed(start[stage]);
+    }
+
+    static void Reset() { memset(total, 0, sizeof(total)); }
+};
+
+template <typename Clock> bool     StageProfiler<Clock>::enabled = false;
+template <typename Clock> uint32_t StageProfiler<Clock>::start[SELF_BENCH_MAX_STAGES];
+template <typename Clock> uint64_t StageProfiler<Clock>::total[SELF_BENCH_MAX_STAGES];
+
+// ============================================
+// Cortex-M7 cycle counter (only when CMSIS is included)
+// ============================================
+#ifdef DWT
+
+struct DwtClock {
+    static void Enable() {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->LAR = 0xC5ACCE55;  // M7: unlock the DWT registers
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+    static inline uint32_t Now() { return DWT->CYCCNT; }
+    static inline uint32_t Elapsed(uint32_t start) { return DWT->CYCCNT - start; }
+};
+
+#endif  // DWT
+
+// ============================================
+// Benchmark run
+// ============================================
+struct SelfBenchReport {
+    int      voices;
+    uint32_t block_size;
+    uint32_t blocks;
+    uint64_t total;                          // Clock units, whole run
+    uint32_t max_block;                      // Slowest single block
+    uint64_t stage[SELF_BENCH_MAX_STAGES];   // Clock units per stage, whole run
+    uint32_t checksum;                       // FNV-1a over the output floats
+
+    uint32_t MeanBlock() const { return (uint32_t)(total / blocks); }
+    uint32_t MeanStage(int s) const { return (uint32_t)(stage[s] / blocks); }
+};
+
+inline uint32_t SelfBenchChecksum(uint32_t h, const float* buf, size_t size) {
+    const uint8_t* p = (const uint8_t*)buf;
+    for (size_t i = 0; i < size * sizeof(float); i++) {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+// Re-initialises the engine and renders the sequence (callers Init() it
+// again afterwards for normal use)
+template <int NUM_VOICES, typename Clock>
+void RunSelfBench(KalimbaEngine<NUM_VOICES, StageProfiler<Clock>>& engine,
+                  size_t block, SelfBenchReport* report, float sample_rate = SELF_BENCH_SAMPLE_RATE) {
+    typedef KalimbaEngine<NUM_VOICES, StageProfiler<Clock>> Engine;
+    static const float scale[7] = {196.00f, 220.00f, 246.94f, 293.66f, 329.63f, 392.00f, 440.00f};
+    static float buf[Engine::MAX_BLOCK];
+    if (block > Engine::MAX_BLOCK) block = Engine::MAX_BLOCK;
+
+    uint32_t interval = (uint32_t)(SELF_BENCH_PLUCK_INTERVAL * sample_rate / SELF_BENCH_SAMPLE_RATE + 0.5f);
+    engine.Init(sample_rate);
+    engine.SetBrightness(0.75f);
+    engine.SetDecay(0.95f);
+    engine.SetLfoDepth(0.1f);
+    engine.SetReverb(0.3f, 0.85f, 10000.0f);
+    engine.SetExciter(nullptr, nullptr);
+    for (int v = 0; v < NUM_VOICES; v++) {
+        engine.SetVoiceFreq(v, scale[v % 7] * (float)(1 << ((v / 7) % 3)));
+    }
+
+    memset(report, 0, sizeof(*report));
+    report->voices     = NUM_VOICES;
+    report->block_size = block;
+    report->blocks     = SELF_BENCH_BLOCKS;
+    report->checksum   = 2166136261u;
+
+    StageProfiler<Clock>::Reset();
+    StageProfiler<Clock>::enabled = true;
+
+    uint32_t sample     = 0;
+    int      next_voice = 0;
+    for (int b = 0; b < SELF_BENCH_BLOCKS; b++) {
+        if (b == 0) {
+            for (int v = 0; v < NUM_VOICES; v++) engine.Trigger(v, 1.0f);
+        } else if (sample / interval != (sample + block) / interval) {
+            engine.Trigger(next_voice, 0.8f);
+            next_voice = (next_voice + 1) % NUM_VOICES;
+        }
+
+        uint32_t t0 = Clock::Now();
+        engine.Process(buf, block);
+        uint32_t t = Clock::Elapsed(t0);
+
+        report->total += t;
+        if (t > report->max_block) report->max_block = t;
+        report->checksum = SelfBenchChecksum(report->checksum, buf, block);
+        sample += block;
+    }
+
+    StageProfiler<Clock>::enabled = false;
+    for (int s = 0; s < Engine::NUM_STAGES; s++) {
+        report->stage[s] = StageProfiler<Clock>::total[s];
+    }
+}
@@ -0,0 +1,83 @@
+/*
+ * STRUMMER - Chords strummed into the audio thread's own future
+ *
+ * CHORD:
+ *   Strum() schedules STRUM_NOTES plucks rooted on one string, every
+ *   other string (1-3-5-7, 2-4-6-1'...; wrapping past the last string
+ *   goes up an octave), one every Spacing() samples, up or down. Each
+ *   pluck is an EngineEvent in an EventScheduler, so it lands on its own
+ *   sample like MIDI notes do.
+ *
+ * SPACING:
+ *   Set at run time in ms (MIDI CC, serial command) and held in samples,
+ *   rounded to the nearest one. A chord keeps the spacing it was struck
+ *   with; only later chords pick up a change.
+ *
+ * FULL SCHEDULER:
+ *   A chord goes in whole or not at all: with fewer than STRUM_NOTES free
+ *   slots (long spacing, fast repeated strums) it is dropped and counted
+ *   in Dropped(), never cut down to its first few notes.
+ *
+ * Audio thread only, except SetSpacing() (one 32-bit store, any thread).
+ * Portable (no libDaisy dependency).
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "EngineEvents.h"
+
+const int   STRUM_NOTES          = 4;       // Root + every other string
+const float STRUM_SPACING_MS     = 30.0f;   // Power-on spacing
+const float STRUM_SPACING_MAX_MS = 250.0f;
+
+template <int STRINGS, size_t SIZE>
+class Strummer {
+  public:
+    void Init(float sample_rate) {
+        scheduler_.Clear();
+        dropped_ = 0;
+        SetSpacing(STRUM_SPACING_MS, sample_rate);
+    }
+
+    // Spacing in ms, clamped to 0..STRUM_SPACING_MAX_MS
+    void SetSpacing(float ms, float sample_rate) {
+        if (!(ms > 0.0f)) ms = 0.0f;
+        if (ms > STRUM_SPACING_MAX_MS) ms = STRUM_SPACING_MAX_MS;
+        spacing_ = (uint32_t)(ms * 0.001f * sample_rate + 0.5f);
+    }
+
+    // Chord rooted on string `root` (`octave` up/down), first note on
+    // sample `start`; false (and counted) if it doesn't fit
+    bool Strum(int root, uint32_t start, int octave, bool down) {
+        if (scheduler_.Count() + STRUM_NOTES > SIZE) {
+            dropped_++;
+            return false;
+        }
+        uint32_t spacing = spacing_;
+        for (int n = 0; n < STRUM_NOTES; n++) {
+            int degree = root + 2 * n;
+            int order  = down ? (STRUM_NOTES - 1 - n) : n;
+
+            EngineEvent e;
+            e.time   = start + order * spacing;
+            e.type   = EngineEvent::PLUCK;
+            e.data1  = degree % STRINGS;
+            e.data2  = 127;
+            e.octave = octave + degree / STRINGS;
+            scheduler_.Schedule(e);
+        }
+        return true;
+    }
+
+    EventScheduler<SIZE>& Scheduler() { return scheduler_; }
+    uint32_t              Spacing() const { return spacing_; }
+    uint32_t              Dropped() const { return dropped_; }
+
+  private:
+    EventScheduler<SIZE> scheduler_;
+    volatile uint32_t    spacing_ = 0;
+    uint32_t             dropped_ = 0;
+};
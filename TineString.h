@@ -0,0 +1,308 @@
+/*
+ * TINE STRING - Waveguide string with stretched (stiff) partials
+ *
+ * LOOP (per sample):
+ *   delay line (linear interpolation) → damping lowpass → loop gain
+ *   → dispersion cascade (TINE_STAGES first-order allpasses) → + pluck
+ *
+ * DAMPING:
+ *   Same law as Rings' / DaisySP's String: decay sets the RT60 and,
+ *   with brightness, the lowpass cutoff as an interval above the pitch;
+ *   above 0.95 both fade towards infinite sustain. KalimbaEngine's
+ *   multi-rate voices rely on that cutoff law.
+ *
+ * DISPERSION:
+ *   A steel tine's partials run sharp of the harmonic series like a stiff
+ *   string's: f_n = n f_1 sqrt((1 + B n^2) / (1 + B)). The allpasses
+ *   (coefficient a < 0) delay low frequencies more than high ones, so the
+ *   upper partials come round the loop early. The coefficient that puts
+ *   partials 2..TINE_FIT_PARTIALS closest to the target (least squares,
+ *   in cents) is fitted once per (pitch, stiffness) into a table shared by
+ *   every string - in normalized frequency, so it serves every sample
+ *   rate - and looked up (bilinear) only when the pitch or a parameter
+ *   changes. The cascade's and the lowpass's delay at the fundamental
+ *   come off the delay line, so the fundamental stays in tune.
+ *
+ * VIBRATO:
+ *   Process() takes a period scale (1 / pitch modulation): it only moves
+ *   the read point, nothing is recomputed per sample.
+ *
+ * Portable (no libDaisy / DaisySP dependency).
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+const float TINE_PI                = 3.14159265f;
+const float TINE_TWO_PI            = 6.28318531f;
+const int   TINE_LINE_SIZE         = 1024;
+const float TINE_MAX_DELAY         = TINE_LINE_SIZE - 8.0f;  // Loop length limit (samples)
+const float TINE_MIN_DELAY         = 2.0f;                   // Line part of the loop
+const int   TINE_STAGES            = 4;                      // Dispersion allpasses
+const int   TINE_FIT_PARTIALS      = 6;                      // Partials 2..6 fitted
+const float TINE_MAX_B             = 0.01f;                  // Inharmonicity at stiffness 1
+const float TINE_DEFAULT_STIFFNESS = 0.4f;                   // B = 0.0016
+
+// Table axes: log2(pitch / sample rate) and stiffness
+const int   TINE_PITCH_BINS  = 37;
+const float TINE_PITCH_LOW   = -12.0f;  // 11.7Hz at 48kHz
+const float TINE_PITCH_STEP  = 0.25f;   // Octaves, up to 0.125 x rate
+const int   TINE_STIFF_BINS  = 9;
+const float TINE_MIN_ALLPASS = -0.995f;
+
+// ============================================
+// Dispersion coefficient table (fitted once, shared)
+// ============================================
+class TineDispersion {
+  public:
+    // Inharmonicity coefficient B for a stiffness 0..1
+    static float Inharmonicity(float stiffness) { return TINE_MAX_B * stiffness * stiffness; }
+
+    // Phase delay (samples) of one allpass stage at w (rad/sample)
+    static float AllpassDelay(float a, float w) {
+        return 1.0f - 2.0f / w * atanf(a * sinf(w) / (1.0f + a * cosf(w)));
+    }
+
+    // Fits the table on the first call (tens of ms on the M7, call it
+    // before audio starts)
+    static void Prepare() {
+        if (ready()) return;
+        for (int p = 0; p < TINE_PITCH_BINS; p++) {
+            float w0 = TINE_TWO_PI * exp2f(TINE_PITCH_LOW + p * TINE_PITCH_STEP);
+            for (int s = 0; s < TINE_STIFF_BINS; s++) {
+                table()[p][s] = Fit(w0, Inharmonicity((float)s / (TINE_STIFF_BINS - 1)));
+            }
+        }
+        ready() = true;
+    }
+
+    // Allpass coefficient for pitch w0 (rad/sample) and stiffness 0..1
+    static float Coefficient(float w0, float stiffness) {
+        float p = (log2f(w0 * (1.0f / TINE_TWO_PI)) - TINE_PITCH_LOW) / TINE_PITCH_STEP;
+        float s = stiffness * (TINE_STIFF_BINS - 1);
+        p       = p < 0.0f ? 0.0f : (p > TINE_PITCH_BINS - 1.001f ? TINE_PITCH_BINS - 1.001f : p);
+        s       = s < 0.0f ? 0.0f : (s > TINE_STIFF_BINS - 1.001f ? TINE_STIFF_BINS - 1.001f : s);
+        int   pi = (int)p, si = (int)s;
+        float pf = p - pi, sf = s - si;
+        const Table& t  = table();
+        float        lo = t[pi][si] + (t[pi + 1][si] - t[pi][si]) * pf;
+        float        hi = t[pi][si + 1] + (t[pi + 1][si + 1] - t[pi][si + 1]) * pf;
+        return lo + (hi - lo) * sf;
+    }
+
+  private:
+    // Frequency (rad/sample) of partial n of a loop tuned to w0: where
+    // the loop phase w x (line + cascade delay) reaches 2 pi n (secant
+    // steps from the harmonic and the target; the phase is monotonic)
+    static float Partial(float a, float w0, float line, int n, float guess) {
+        float target = TINE_TWO_PI * n;
+        float w1 = n * w0, w2 = guess;
+        float g1 = w1 * (line + TINE_STAGES * AllpassDelay(a, w1)) - target;
+        for (int i = 0; i < 6 && w2 != w1; i++) {
+            float g2 = w2 * (line + TINE_STAGES * AllpassDelay(a, w2)) - target;
+            if (g2 == g1) break;
+            float w3 = w2 - g2 * (w2 - w1) / (g2 - g1);
+            w1       = w2;
+            g1       = g2;
+            w2       = w3 < 0.01f * w0 ? 0.01f * w0 : (w3 > TINE_PI ? TINE_PI : w3);
+        }
+        return w2;
+    }
+
+    // Squared error (cents) of partials 2..last against the stiff string
+    static float Error(float a, float w0, float b, int last) {
+        float line  = TINE_TWO_PI / w0 - TINE_STAGES * AllpassDelay(a, w0);
+        float error = 0.0f;
+        for (int n = 2; n <= last; n++) {
+            float target = n * sqrtf((1.0f + b * n * n) / (1.0f + b));
+            float ratio  = Partial(a, w0, line, n, target * w0) / w0;
+            float cents  = 1200.0f * log2f(ratio / target);
+            error += cents * cents;
+        }
+        return error;
+    }
+
+    static float Fit(float w0, float b) {
+        int last = TINE_FIT_PARTIALS;
+        while (last > 1 && last * w0 > 0.8f * TINE_PI) last--;
+        if (b <= 0.0f || last < 2) return 0.0f;
+
+        // Most negative coefficient that still leaves TINE_MIN_DELAY of line
+        float lo = TINE_MIN_ALLPASS, hi = 0.0f;
+        float period = TINE_TWO_PI / w0;
+        if (period - TINE_STAGES * AllpassDelay(lo, w0) < TINE_MIN_DELAY) {
+            float ok = 0.0f, bad = lo;
+            for (int i = 0; i < 24; i++) {
+                float a = 0.5f * (ok + bad);
+                if (period - TINE_STAGES * AllpassDelay(a, w0) < TINE_MIN_DELAY) {
+                    bad = a;
+                } else {
+                    ok = a;
+                }
+            }
+            lo = ok;
+        }
+
+        // Golden-section search over [lo, 0]
+        const float golden = 0.618034f;
+        float       x1 = hi - golden * (hi - lo), x2 = lo + golden * (hi - lo);
+        float       e1 = Error(x1, w0, b, last), e2 = Error(x2, w0, b, last);
+        for (int i = 0; i < 20; i++) {
+            if (e1 < e2) {
+                hi = x2;
+                x2 = x1;
+                e2 = e1;
+                x1 = hi - golden * (hi - lo);
+                e1 = Error(x1, w0, b, last);
+            } else {
+                lo = x1;
+                x1 = x2;
+                e1 = e2;
+                x2 = lo + golden * (hi - lo);
+                e2 = Error(x2, w0, b, last);
+            }
+        }
+        return 0.5f * (lo + hi);
+    }
+
+    typedef float Table[TINE_PITCH_BINS][TINE_STIFF_BINS];
+
+    // Function statics: one table however many files include this
+    static Table& table() {
+        static Table t;
+        return t;
+    }
+    static bool& ready() {
+        static bool r = false;
+        return r;
+    }
+};
+
+// ============================================
+// One string
+// ============================================
+class TineString {
+  public:
+    void Init(float sample_rate) {
+        TineDispersion::Prepare();
+        sample_rate_ = sample_rate;
+        memset(line_, 0, sizeof(line_));
+        write_ = 0;
+        lp_    = 0.0f;
+        for (int i = 0; i < TINE_STAGES; i++) ap_state_[i] = 0.0f;
+        dirty_ = true;
+    }
+
+    // Note pitch; vibrato goes through Process()
+    void SetFreq(float freq) { Set(&freq_, freq); }
+    void SetDamping(float damping) { Set(&damping_, damping); }
+    void SetBrightness(float brightness) { Set(&brightness_, brightness); }
+    void SetStiffness(float stiffness) { Set(&stiffness_, stiffness); }
+
+    // `period_scale` = 1 / pitch modulation
+    float Process(float in, float period_scale = 1.0f) {
+        if (dirty_) Update();
+
+        float delay = period_ * period_scale - compensation_;
+        delay       = delay < TINE_MIN_DELAY ? TINE_MIN_DELAY : (delay > TINE_MAX_DELAY ? TINE_MAX_DELAY : delay);
+        int   whole = (int)delay;
+        float frac  = delay - whole;
+        float a     = line_[(write_ - whole) & (TINE_LINE_SIZE - 1)];
+        float b     = line_[(write_ - whole - 1) & (TINE_LINE_SIZE - 1)];
+        float out   = a + (b - a) * frac;
+
+        lp_ += lp_coef_ * (out - lp_);
+        float x = lp_ * gain_;
+        for (int i = 0; i < TINE_STAGES; i++) {
+            float y      = allpass_ * x + ap_state_[i];
+            ap_state_[i] = x - allpass_ * y;
+            x            = y;
+        }
+        line_[write_] = x + in;
+        write_        = (write_ + 1) & (TINE_LINE_SIZE - 1);
+        return out;
+    }
+
+    // State snapshots (KalimbaEngine::SaveState): io(field, bytes) for the
+    // line, the filter states and the parameters. The coefficients are
+    // recomputed from the parameters after a load.
+    template <typename Io>
+    void SaveState(Io& io) const {
+        Transfer(io, *this);
+    }
+    template <typename Io>
+    void LoadState(Io& io) {
+        Transfer(io, *this);
+        dirty_ = true;
+    }
+
+  private:
+    template <typename Io, typename String>
+    static void Transfer(Io& io, String& s) {
+        io(s.line_, sizeof(s.line_));
+        io(&s.write_, sizeof(s.write_));
+        io(&s.lp_, sizeof(s.lp_));
+        io(s.ap_state_, sizeof(s.ap_state_));
+        io(&s.sample_rate_, sizeof(s.sample_rate_));
+        io(&s.freq_, sizeof(s.freq_));
+        io(&s.damping_, sizeof(s.damping_));
+        io(&s.brightness_, sizeof(s.brightness_));
+        io(&s.stiffness_, sizeof(s.stiffness_));
+    }
+
+    void Set(float* param, float value) {
+        if (*param != value) {
+            *param = value;
+            dirty_ = true;
+        }
+    }
+
+    // Pitch or a parameter changed: damping, dispersion, tuning
+    void Update() {
+        float nyquist = 0.45f * sample_rate_;
+        float freq    = freq_ < nyquist ? freq_ : nyquist;
+        float w0      = TINE_TWO_PI * freq / sample_rate_;
+        period_       = sample_rate_ / freq;
+
+        // Rings' damping law: RT60 from decay, cutoff an interval above the
+        // pitch from decay and brightness
+        float lf_damping = damping_ * (2.0f - damping_);
+        float rt60       = 0.07f * exp2f(lf_damping * 8.0f) * sample_rate_;
+        float semitones  = fminf(24.0f + damping_ * damping_ * 48.0f + brightness_ * brightness_ * 24.0f, 84.0f);
+        float cutoff     = fminf(freq * exp2f(semitones * (1.0f / 12.0f)), 0.499f * sample_rate_);
+        gain_            = exp2f(fmaxf(-10.0f * period_ / rt60, -127.0f / 12.0f));
+        if (damping_ >= 0.95f) {
+            float to_infinite = 20.0f * (damping_ - 0.95f);
+            cutoff += to_infinite * (0.4999f * sample_rate_ - cutoff);
+            gain_ += to_infinite * (1.0f - gain_);
+        }
+        lp_coef_ = 1.0f - expf(-TINE_TWO_PI * cutoff / sample_rate_);
+
+        // One-pole lowpass + cascade delay at the fundamental, taken off the line
+        float pole   = 1.0f - lp_coef_;
+        allpass_     = TineDispersion::Coefficient(w0, stiffness_);
+        compensation_ = atanf(pole * sinf(w0) / (1.0f - pole * cosf(w0))) / w0
+                        + TINE_STAGES * TineDispersion::AllpassDelay(allpass_, w0);
+        dirty_ = false;
+    }
+
+    float line_[TINE_LINE_SIZE];
+    int   write_;
+    float lp_;
+    float ap_state_[TINE_STAGES];
+
+    float sample_rate_  = 48000.0f;
+    float freq_         = 220.0f;
+    float damping_      = 0.95f;
+    float brightness_   = 0.75f;
+    float stiffness_    = TINE_DEFAULT_STIFFNESS;
+    bool  dirty_        = true;
+    float period_       = 218.0f;
+    float compensation_ = 0.0f;
+    float gain_         = 1.0f;
+    float lp_coef_      = 1.0f;
+    float allpass_      = 0.0f;
+};
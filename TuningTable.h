@@ -0,0 +1,274 @@
+/*
+ * TUNING TABLE - Scales loadable at runtime, swapped into the audio
+ * thread with one pointer store
+ *
+ * DATA FLOW:
+ *   USB serial / SysEx text → ByteQueue (interrupt) → LineReader (main
+ *   loop) → TuningLoader: stages SCALE lines, COMMIT validates and
+ *   precomputes every pitch into the free half of TuningTables, then
+ *   publishes it → audio callback picks the new pointer up at its next
+ *   block start (Acquire)
+ *
+ * DOUBLE BUFFER:
+ *   Two tables in RAM. The main loop only writes the one the audio
+ *   thread is not using: after a publish, Back() stays unavailable until
+ *   the audio thread has acknowledged the swap, so the old table can't be
+ *   overwritten while a block is still reading it.
+ *
+ * PRECOMPUTED:
+ *   freq[scale][octave][string] = base x 2^octave for all 5 octaves. On a
+ *   swap the audio thread only loads 7 pitches (same as a scale change);
+ *   nothing is derived in the audio thread.
+ *
+ * COMMANDS (one per line, USB serial or SysEx F0 7D <text> F7, see
+ * MidiInput.h):
+ *   SCALE <1-5> <name> <note>=<hz> x7   stage a scale (_ in names = space)
+ *   COMMIT                              validate + install staged scales
+ *   RESET                               install the power-on scales
+ *   e.g. SCALE 3 Hijaz D3=146.83 Eb3=155.56 F#3=185 G3=196 A3=220 Bb3=233.08 C4=261.63
+ *
+ * Portable (no libDaisy dependency) so swaps can be driven from a host
+ * build as well.
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+
+#include "EngineEvents.h"
+#include "KalimbaScales.h"
+
+const int    TUNING_OCTAVES  = 5;        // -2 .. +2
+const float  TUNING_MIN_FREQ = 20.0f;
+const float  TUNING_MAX_FREQ = 4000.0f;  // x4 octave shift stays < Nyquist
+const size_t TUNING_LINE_MAX = 192;
+
+// ============================================
+// One complete set of scales
+// ============================================
+struct TuningTable {
+    char  scale_names[NUM_SCALES][16];
+    char  note_names[NUM_SCALES][NUM_STRINGS][4];
+    float base[NUM_SCALES][NUM_STRINGS];
+    float freq[NUM_SCALES][TUNING_OCTAVES][NUM_STRINGS];  // base x 2^octave
+
+    // Pitch of string s in `scale` shifted by `octave` (clamped to -2..+2)
+    float Freq(int scale, int octave, int s) const {
+        octave = octave < -2 ? -2 : (octave > 2 ? 2 : octave);
+        return freq[scale][octave + 2][s];
+    }
+
+    void SetScale(int scale, const char* name, const char* const notes[NUM_STRINGS],
+                  const float freqs[NUM_STRINGS]) {
+        CopyName(scale_names[scale], name, sizeof(scale_names[scale]));
+        for (int s = 0; s < NUM_STRINGS; s++) {
+            CopyName(note_names[scale][s], notes[s], sizeof(note_names[scale][s]));
+            base[scale][s] = freqs[s];
+        }
+    }
+
+    // Check every base pitch, then fill freq[][][]; false leaves the
+    // table unusable (never publish it)
+    bool Prepare() {
+        for (int i = 0; i < NUM_SCALES; i++) {
+            for (int s = 0; s < NUM_STRINGS; s++) {
+                float f = base[i][s];
+                if (!isfinite(f) || f < TUNING_MIN_FREQ || f > TUNING_MAX_FREQ) return false;
+                for (int o = 0; o < TUNING_OCTAVES; o++) {
+                    freq[i][o][s] = f * OCTAVE_RATIOS[o];
+                }
+            }
+        }
+        return true;
+    }
+
+    static void CopyName(char* dst, const char* src, size_t size) {
+        strncpy(dst, src, size - 1);
+        dst[size - 1] = '\0';
+    }
+};
+
+// ============================================
+// Double buffer: main loop writes, audio thread reads
+// ============================================
+class TuningTables {
+  public:
+    // Installs `initial` (already Prepare()d) as the active table
+    void Init(const TuningTable& initial) {
+        tables_[0] = initial;
+        published_.store(&tables_[0], std::memory_order_relaxed);
+        in_use_.store(&tables_[0], std::memory_order_release);
+    }
+
+    // Main loop: the table that is free to fill, or nullptr while the
+    // audio thread has not picked up the last publish yet
+    TuningTable* Back() {
+        TuningTable* pub = published_.load(std::memory_order_relaxed);
+        if (in_use_.load(std::memory_order_acquire) != pub) return nullptr;
+        return pub == &tables_[0] ? &tables_[1] : &tables_[0];
+    }
+
+    // Main loop: make a filled Back() table the active one
+    void Publish(TuningTable* table) { published_.store(table, std::memory_order_release); }
+
+    // Main loop: latest published table (never written while visible)
+    const TuningTable* Published() const { return published_.load(std::memory_order_relaxed); }
+
+    // Audio thread, once per block: table to use for the whole block
+    const TuningTable* Acquire() {
+        TuningTable* t = published_.load(std::memory_order_acquire);
+        in_use_.store(t, std::memory_order_release);
+        return t;
+    }
+
+  private:
+    TuningTable               tables_[2];
+    std::atomic<TuningTable*> published_{nullptr};
+    std::atomic<TuningTable*> in_use_{nullptr};
+};
+
+// ============================================
+// Byte stream → lines (one reader per source)
+// ============================================
+class LineReader {
+  public:
+    // Next complete line from `queue`, or nullptr. Over-long lines are
+    // dropped whole.
+    template <typename Queue>
+    const char* Read(Queue& queue) {
+        uint8_t b;
+        while (queue.Pop(&b)) {
+            if (b == '\n' || b == '\r') {
+                bool complete = len_ > 0 && !overflow_;
+                line_[len_] = '\0';
+                len_        = 0;
+                overflow_   = false;
+                if (complete) return line_;
+            } else if (b == BYTE_QUEUE_CANCEL) {
+                len_      = 0;
+                overflow_ = false;
+            } else if (len_ < TUNING_LINE_MAX - 1) {
+                line_[len_++] = (char)b;
+            } else {
+                overflow_ = true;
+            }
+        }
+        return nullptr;
+    }
+
+  private:
+    char   line_[TUNING_LINE_MAX];
+    size_t len_      = 0;
+    bool   overflow_ = false;
+};
+
+// ============================================
+// Commands → staged table → publish (main loop only)
+// ============================================
+class TuningLoader {
+  public:
+    enum Result {
+        NONE,       // Nothing happened (e.g. still waiting for the swap)
+        STAGED,     // SCALE accepted, COMMIT to install
+        INSTALLED,  // New table published
+        REJECTED    // Bad command or table, nothing changed
+    };
+
+    void Init(TuningTables* tables, const TuningTable& defaults) {
+        tables_   = tables;
+        defaults_ = defaults;
+        staged_   = defaults;
+        pending_  = false;
+    }
+
+    // One command line; Message() says what happened
+    Result Command(const char* line) {
+        char buf[TUNING_LINE_MAX];
+        TuningTable::CopyName(buf, line, sizeof(buf));
+
+        char* save = nullptr;
+        char* cmd  = strtok_r(buf, " \t", &save);
+        if (!cmd) return NONE;
+
+        if (strcmp(cmd, "SCALE") == 0) return Scale(save);
+        if (strcmp(cmd, "COMMIT") == 0) return Commit(staged_);
+        if (strcmp(cmd, "RESET") == 0) {
+            staged_ = defaults_;
+            return Commit(defaults_);
+        }
+        return Fail("unknown command");
+    }
+
+    // Main loop, every pass: finishes a COMMIT that had to wait for the
+    // audio thread to let go of the back buffer
+    Result Service() {
+        if (!pending_) return NONE;
+        TuningTable* back = tables_->Back();
+        if (!back) return NONE;
+        *back = pending_table_;
+        tables_->Publish(back);
+        pending_ = false;
+        snprintf(message_, sizeof(message_), "installed");
+        return INSTALLED;
+    }
+
+    const char* Message() const { return message_; }
+
+  private:
+    // SCALE <1-5> <name> <note>=<hz> x7
+    Result Scale(char* save) {
+        char* tok   = strtok_r(nullptr, " \t", &save);
+        int   scale = tok ? atoi(tok) - 1 : -1;
+        if (scale < 0 || scale >= NUM_SCALES) return Fail("scale must be 1-5");
+
+        char* name = strtok_r(nullptr, " \t", &save);
+        if (!name) return Fail("missing name");
+        for (char* c = name; *c; c++) {
+            if (*c == '_') *c = ' ';
+        }
+
+        const char* notes[NUM_STRINGS];
+        float       freqs[NUM_STRINGS];
+        for (int s = 0; s < NUM_STRINGS; s++) {
+            char* pair = strtok_r(nullptr, " \t", &save);
+            char* eq   = pair ? strchr(pair, '=') : nullptr;
+            if (!eq) return Fail("need 7 note=hz pairs");
+            *eq      = '\0';
+            notes[s] = pair;
+            freqs[s] = strtof(eq + 1, nullptr);
+            if (!isfinite(freqs[s]) || freqs[s] < TUNING_MIN_FREQ || freqs[s] > TUNING_MAX_FREQ) {
+                return Fail("frequency out of range (20-4000 Hz)");
+            }
+        }
+        staged_.SetScale(scale, name, notes, freqs);
+        snprintf(message_, sizeof(message_), "scale %d staged", scale + 1);
+        return STAGED;
+    }
+
+    Result Commit(const TuningTable& table) {
+        pending_table_ = table;
+        if (!pending_table_.Prepare()) return Fail("invalid table");
+        pending_ = true;
+        Result r = Service();
+        if (r == NONE) snprintf(message_, sizeof(message_), "waiting for swap");
+        return r;
+    }
+
+    Result Fail(const char* why) {
+        snprintf(message_, sizeof(message_), "error: %s", why);
+        return REJECTED;
+    }
+
+    TuningTables* tables_ = nullptr;
+    TuningTable   defaults_;
+    TuningTable   staged_;
+    TuningTable   pending_table_;
+    bool          pending_ = false;
+    char          message_[48] = "";
+};
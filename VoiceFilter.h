@@ -0,0 +1,179 @@
+/*
+ * VOICE FILTER - One state-variable filter per voice, run as a bank
+ *
+ * FILTER:
+ *   Trapezoidal (zero-delay feedback) SVF: stable at any cutoff below
+ *   Nyquist and under fast cutoff changes. Each lane blends its lowpass
+ *   and bandpass outputs (morph 0 .. 1); the bandpass is scaled to unity
+ *   gain at the cutoff.
+ *
+ * LAYOUT (structure of arrays):
+ *   State and coefficients are arrays indexed by lane (= voice), and the
+ *   audio comes in frames of STRIDE samples, lane fastest (LANES padded
+ *   to whole vectors). Process() takes SVF_VECTOR lanes at a time as one
+ *   GCC / Clang vector: their coefficients and state stay in registers
+ *   for the whole block and every frame is a few vector multiply-adds -
+ *   SSE / NEON / WebAssembly SIMD on hosts, one lane per voice. The
+ *   Cortex-M7 has no float SIMD: there the compiler lowers the vectors to
+ *   scalar code, which still keeps the state in registers and saves the
+ *   per-voice call and coefficient reloads.
+ *
+ * REDUCED-RATE LANES:
+ *   Lanes can stop early in a block (frames[]): frames every lane of a
+ *   vector runs take the plain path, the rest a masked one that holds
+ *   the stopped lanes' state and leaves their samples untouched.
+ *
+ * CONTROL RATE:
+ *   SetLane() once per block; the tanf() for the cutoff only runs when a
+ *   lane's cutoff, rate or resonance actually changed.
+ *
+ * Portable (no libDaisy / DaisySP dependency).
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+const float SVF_PI          = 3.14159265f;
+const int   SVF_VECTOR      = 4;      // Floats per SIMD register (SSE, NEON)
+const float SVF_MAX_CUTOFF  = 0.45f;  // x sample rate
+const float SVF_MIN_DAMPING = 0.05f;  // Resonance 1 (Q = 20)
+const float SVF_MAX_DAMPING = 2.0f;   // Resonance 0 (Q = 0.5)
+
+typedef float   SvfVector __attribute__((vector_size(SVF_VECTOR * sizeof(float))));
+typedef int32_t SvfMask __attribute__((vector_size(SVF_VECTOR * sizeof(int32_t))));
+
+template <int LANES>
+class SvfBank {
+  public:
+    // Frame stride: LANES rounded up to whole SIMD registers
+    static const int STRIDE = (LANES + SVF_VECTOR - 1) / SVF_VECTOR * SVF_VECTOR;
+
+    void Init() {
+        memset(ic1_, 0, sizeof(ic1_));
+        memset(ic2_, 0, sizeof(ic2_));
+        memset(a1_, 0, sizeof(a1_));
+        memset(a2_, 0, sizeof(a2_));
+        memset(a3_, 0, sizeof(a3_));
+        memset(lp_, 0, sizeof(lp_));
+        memset(bp_, 0, sizeof(bp_));
+        memset(k_, 0, sizeof(k_));
+        for (int l = 0; l < STRIDE; l++) omega_[l] = -1.0f;  // Forces the first SetLane()
+    }
+
+    // Control rate: cutoff in Hz at the lane's own sample rate,
+    // resonance 0..1, morph 0 (lowpass) .. 1 (bandpass)
+    void SetLane(int lane, float cutoff, float sample_rate, float resonance, float morph) {
+        float omega = cutoff / sample_rate;
+        if (omega > SVF_MAX_CUTOFF) omega = SVF_MAX_CUTOFF;
+        float k = SVF_MAX_DAMPING - (SVF_MAX_DAMPING - SVF_MIN_DAMPING) * resonance;
+
+        if (omega != omega_[lane] || k != k_[lane]) {
+            float g      = tanf(SVF_PI * omega);
+            a1_[lane]    = 1.0f / (1.0f + g * (g + k));
+            a2_[lane]    = g * a1_[lane];
+            a3_[lane]    = g * a2_[lane];
+            omega_[lane] = omega;
+            k_[lane]     = k;
+        }
+        lp_[lane] = 1.0f - morph;
+        bp_[lane] = morph * k;
+    }
+
+    // Filters `count` frames of STRIDE samples in place. Lane l only
+    // advances for its first frames[l] frames (reduced-rate voices have
+    // fewer samples per block), later frames of it are left as they are.
+    void Process(float* x, size_t count, const int* frames) {
+        for (int g = 0; g < STRIDE; g += SVF_VECTOR) {
+            // Frames every lane of this vector runs (padding lanes: all)
+            int    run[SVF_VECTOR];
+            size_t all = count, any = 0;
+            for (int j = 0; j < SVF_VECTOR; j++) {
+                run[j] = g + j < LANES ? frames[g + j] : (int)count;
+                all    = (size_t)run[j] < all ? run[j] : all;
+                any    = (size_t)run[j] > any ? run[j] : any;
+            }
+            any = any < count ? any : count;
+
+            SvfVector ic1 = Load(ic1_ + g), ic2 = Load(ic2_ + g);
+            SvfVector a1 = Load(a1_ + g), a2 = Load(a2_ + g), a3 = Load(a3_ + g);
+            SvfVector lp = Load(lp_ + g), bp = Load(bp_ + g);
+            SvfVector two = Splat(2.0f);
+            float*    io  = x + g;
+
+            size_t m = 0;
+            for (; m < all; m++, io += STRIDE) {
+                SvfVector v3 = Load(io) - ic2;
+                SvfVector v1 = a1 * ic1 + a2 * v3;
+                SvfVector v2 = ic2 + a2 * ic1 + a3 * v3;
+                ic1          = two * v1 - ic1;
+                ic2          = two * v2 - ic2;
+                Store(io, lp * v2 + bp * v1);
+            }
+            if (m < any) {
+                SvfMask limit;
+                memcpy(&limit, run, sizeof(limit));
+                for (; m < any; m++, io += STRIDE) {
+                    SvfMask   on = limit > (SvfMask){} + (int32_t)m;  // -1 where running
+                    SvfVector in = Load(io);
+                    SvfVector v3 = in - ic2;
+                    SvfVector v1 = a1 * ic1 + a2 * v3;
+                    SvfVector v2 = ic2 + a2 * ic1 + a3 * v3;
+                    ic1          = Select(on, two * v1 - ic1, ic1);
+                    ic2          = Select(on, two * v2 - ic2, ic2);
+                    Store(io, Select(on, lp * v2 + bp * v1, in));  // Stopped lanes: samples kept
+                }
+            }
+            Store(ic1_ + g, ic1);
+            Store(ic2_ + g, ic2);
+        }
+    }
+
+    // State snapshots (KalimbaEngine::SaveState): io(field, bytes) for the
+    // integrators and the lane coefficients
+    template <typename Io>
+    void SaveState(Io& io) const {
+        Transfer(io, *this);
+    }
+    template <typename Io>
+    void LoadState(Io& io) {
+        Transfer(io, *this);
+    }
+
+  private:
+    template <typename Io, typename Bank>
+    static void Transfer(Io& io, Bank& b) {
+        io(b.ic1_, sizeof(b.ic1_));
+        io(b.ic2_, sizeof(b.ic2_));
+        io(b.a1_, sizeof(b.a1_));
+        io(b.a2_, sizeof(b.a2_));
+        io(b.a3_, sizeof(b.a3_));
+        io(b.lp_, sizeof(b.lp_));
+        io(b.bp_, sizeof(b.bp_));
+        io(b.omega_, sizeof(b.omega_));
+        io(b.k_, sizeof(b.k_));
+    }
+
+    // Unaligned loads / stores (frames need no particular alignment)
+    static SvfVector Load(const float* p) {
+        SvfVector v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+    static void      Store(float* p, SvfVector v) { memcpy(p, &v, sizeof(v)); }
+    static SvfVector Splat(float value) { return (SvfVector){} + value; }
+
+    // Bitwise blend: a where mask is set, else b
+    static SvfVector Select(SvfMask mask, SvfVector a, SvfVector b) {
+        return (SvfVector)(((SvfMask)a & mask) | ((SvfMask)b & ~mask));
+    }
+
+    // Integrator states and per-lane coefficients
+    float ic1_[STRIDE], ic2_[STRIDE];
+    float a1_[STRIDE], a2_[STRIDE], a3_[STRIDE];
+    float lp_[STRIDE], bp_[STRIDE];
+    float omega_[STRIDE], k_[STRIDE];  // What a1..a3 were computed for
+};
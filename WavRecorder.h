@@ -0,0 +1,359 @@
+/*
+ * WAV RECORDER - Stream the instrument output to SD card
+ * For the Digital Kalimba
+ *
+ * DATA FLOW:
+ *   Audio callback → Push() → int16 ring in SDRAM (lock-free, single
+ *   producer / single consumer) → Service() in the main loop → Sink
+ *
+ * REAL-TIME RULES:
+ *   - Push() never blocks. If the ring is full (card too slow) the whole
+ *     block is dropped and counted in Overruns().
+ *   - The sink is only ever called from the main loop, in CHUNK-sized,
+ *     32-byte aligned pieces, so FatFS can hand them straight to SDMMC DMA
+ *     (whole sectors, no copy through its sector window).
+ *
+ * CARD ERRORS:
+ *   A write that fails (or comes up short) stops the recording and is
+ *   counted in WriteErrors(). The file is finalized with the data that
+ *   made it to the card, so its header never claims more than is there.
+ *
+ * FILE LAYOUT:
+ *   The header is padded to one 512-byte sector with a JUNK chunk, so
+ *   every audio chunk lands sector-aligned in the file. Sizes are patched
+ *   in when recording stops.
+ *
+ * SINKS:
+ *   Any class with Open() / Write(buf, bytes) returning the bytes written /
+ *   WriteAt(offset, buf, bytes) / Close(). FatFsWavSink is used on the Daisy; StdioWavSink
+ *   writes a plain file on a host build and can simulate a slow card
+ *   (wav/ records through it at real-time pace and checks the file).
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+
+// ============================================
+// Sector-padded WAV header (16-bit PCM)
+// ============================================
+struct WavHeader {
+    static const size_t SIZE = 512;
+
+    static void Build(uint8_t* h, uint32_t sample_rate, uint16_t channels, uint32_t data_bytes) {
+        const uint32_t fmt_size  = 16;
+        const uint32_t junk_size = SIZE - 12 - (8 + fmt_size) - 8 - 8;
+        const uint16_t bits      = 16;
+        const uint16_t align     = channels * bits / 8;
+
+        memset(h, 0, SIZE);
+        memcpy(h + 0, "RIFF", 4);
+        Put32(h + 4, (uint32_t)SIZE - 8 + data_bytes);
+        memcpy(h + 8, "WAVE", 4);
+
+        memcpy(h + 12, "fmt ", 4);
+        Put32(h + 16, fmt_size);
+        Put16(h + 20, 1);  // PCM
+        Put16(h + 22, channels);
+        Put32(h + 24, sample_rate);
+        Put32(h + 28, sample_rate * align);
+        Put16(h + 32, align);
+        Put16(h + 34, bits);
+
+        memcpy(h + 36, "JUNK", 4);
+        Put32(h + 40, junk_size);
+
+        memcpy(h + SIZE - 8, "data", 4);
+        Put32(h + SIZE - 4, data_bytes);
+    }
+
+    static void Put16(uint8_t* p, uint16_t v) {
+        p[0] = v & 0xFF;
+        p[1] = v >> 8;
+    }
+
+    static void Put32(uint8_t* p, uint32_t v) {
+        p[0] = v & 0xFF;
+        p[1] = (v >> 8) & 0xFF;
+        p[2] = (v >> 16) & 0xFF;
+        p[3] = v >> 24;
+    }
+};
+
+// ============================================
+// Recorder
+// ============================================
+template <typename Sink>
+class WavRecorder {
+  public:
+    // Samples per sink write (32KB of int16)
+    static const uint32_t CHUNK = 16384;
+
+    WavRecorder() {}
+    ~WavRecorder() {}
+
+    // ring must hold ring_len int16 samples, ring_len a power of two and a
+    // multiple of CHUNK (SDRAM on target, 32-byte aligned)
+    void Init(Sink* sink, int16_t* ring, uint32_t ring_len, float sample_rate) {
+        sink_        = sink;
+        ring_        = ring;
+        mask_        = ring_len - 1;
+        sample_rate_ = (uint32_t)sample_rate;
+        write_.store(0);
+        read_.store(0);
+        recording_.store(false);
+        start_req_.store(false);
+        stop_req_.store(false);
+        overruns_.store(0);
+        data_bytes_   = 0;
+        write_errors_ = 0;
+        file_open_  = false;
+    }
+
+    // ============================================
+    // Audio thread
+    // ============================================
+
+    // Start/stop toggle (button chord) - the main loop does the file work
+    void TogglePress() {
+        if (recording_.load(std::memory_order_relaxed)) {
+            stop_req_.store(true, std::memory_order_release);
+        } else {
+            start_req_.store(true, std::memory_order_release);
+        }
+    }
+
+    // Copies one output block into the ring, or drops it if full
+    void Push(const float* in, size_t size) {
+        if (!recording_.load(std::memory_order_relaxed)) return;
+
+        uint32_t w = write_.load(std::memory_order_relaxed);
+        uint32_t r = read_.load(std::memory_order_acquire);
+        if ((mask_ + 1) - (w - r) < size) {
+            overruns_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        for (size_t i = 0; i < size; i++) {
+            float s = in[i];
+            s = s > 1.0f ? 1.0f : (s < -1.0f ? -1.0f : s);
+            ring_[(w + i) & mask_] = (int16_t)(s * 32767.0f);
+        }
+        write_.store(w + (uint32_t)size, std::memory_order_release);
+    }
+
+    // ============================================
+    // Main loop
+    // ============================================
+
+    // Opens/closes files on request and writes at most one chunk per call
+    void Service() {
+        if (start_req_.exchange(false, std::memory_order_acquire) && !file_open_) {
+            Start();
+        }
+
+        if (!file_open_) return;
+
+        bool     stopping = stop_req_.exchange(false, std::memory_order_acquire);
+        uint32_t r        = read_.load(std::memory_order_relaxed);
+        uint32_t avail    = write_.load(std::memory_order_acquire) - r;
+
+        if (avail >= CHUNK && !WriteRing(r, CHUNK)) {
+            Fail();
+            return;
+        }
+
+        if (stopping) {
+            recording_.store(false, std::memory_order_relaxed);
+            // Drain the tail (may be several chunks plus a partial one)
+            r     = read_.load(std::memory_order_relaxed);
+            avail = write_.load(std::memory_order_acquire) - r;
+            while (avail > 0) {
+                uint32_t n = avail < CHUNK ? avail : CHUNK;
+                if (!WriteRing(r, n)) break;
+                r += n;
+                avail -= n;
+            }
+            write_errors_ += avail > 0;
+            Finish();
+        }
+    }
+
+    bool     IsRecording() const { return recording_.load(std::memory_order_relaxed); }
+    uint32_t Overruns() const { return overruns_.load(std::memory_order_relaxed); }
+    uint32_t BytesWritten() const { return data_bytes_; }
+    uint32_t WriteErrors() const { return write_errors_; }
+
+    // Fill level of the ring, 0-1 (for a slow-card warning on the display)
+    float Fill() const {
+        return (float)(write_.load() - read_.load()) / (float)(mask_ + 1);
+    }
+
+  private:
+    void Start() {
+        if (!sink_->Open()) return;
+
+        WavHeader::Build(header_, sample_rate_, 1, 0);
+        if (sink_->Write(header_, sizeof(header_)) != sizeof(header_)) {
+            sink_->Close();
+            return;
+        }
+
+        data_bytes_   = 0;
+        write_errors_ = 0;
+        file_open_    = true;
+        stop_req_.store(false, std::memory_order_relaxed);
+        overruns_.store(0, std::memory_order_relaxed);
+        // Audio is not pushing yet: restart the ring at a chunk boundary
+        write_.store(0, std::memory_order_relaxed);
+        read_.store(0, std::memory_order_relaxed);
+        recording_.store(true, std::memory_order_release);
+    }
+
+    // Ring never wraps inside a chunk: ring_len is a multiple of CHUNK and
+    // the read index only ever advances by CHUNK until the final tail.
+    // False if the card took less than all of it (data_bytes_ counts what
+    // it did take)
+    bool WriteRing(uint32_t r, uint32_t n) {
+        uint32_t start = r & mask_;
+        uint32_t first = (mask_ + 1) - start;
+        if (first > n) first = n;
+
+        size_t want    = first * sizeof(int16_t);
+        size_t written = sink_->Write(ring_ + start, want);
+        if (written == want && first < n) {
+            want += (n - first) * sizeof(int16_t);
+            written += sink_->Write(ring_, (n - first) * sizeof(int16_t));
+        }
+        data_bytes_ += (uint32_t)written;
+        read_.store(r + n, std::memory_order_release);
+        return written == want;
+    }
+
+    // Card error mid-recording: stop taking audio, keep what was written
+    void Fail() {
+        write_errors_++;
+        recording_.store(false, std::memory_order_relaxed);
+        Finish();
+    }
+
+    void Finish() {
+        data_bytes_ &= ~1u;  // Whole samples only
+        WavHeader::Build(header_, sample_rate_, 1, data_bytes_);
+        if (!sink_->WriteAt(0, header_, sizeof(header_))) write_errors_++;
+        sink_->Close();
+        file_open_ = false;
+    }
+
+    Sink*    sink_        = nullptr;
+    int16_t* ring_        = nullptr;
+    uint32_t mask_        = 0;
+    uint32_t sample_rate_ = 48000;
+
+    std::atomic<uint32_t> write_{0};  // Audio thread only
+    std::atomic<uint32_t> read_{0};   // Main loop only
+    std::atomic<bool>     recording_{false};
+    std::atomic<bool>     start_req_{false};
+    std::atomic<bool>     stop_req_{false};
+    std::atomic<uint32_t> overruns_{0};
+
+    uint32_t data_bytes_   = 0;  // Bytes the card took
+    uint32_t write_errors_ = 0;
+    bool     file_open_    = false;
+
+    // Not on the stack: DTCM is out of reach for SDMMC DMA
+    alignas(32) uint8_t header_[WavHeader::SIZE];
+};
+
+// ============================================
+// FatFS sink (Daisy: SDMMC1 + FatFS from libDaisy)
+// ============================================
+#ifdef FF_DEFINED
+
+class FatFsWavSink {
+  public:
+    // Picks the next free KAL_nnnn.WAV name
+    bool Open() {
+        char    name[16];
+        FILINFO info;
+        for (int i = 0; i < 10000; i++) {
+            snprintf(name, sizeof(name), "KAL_%04d.WAV", i);
+            if (f_stat(name, &info) == FR_NO_FILE) {
+                return f_open(&file_, name, FA_CREATE_ALWAYS | FA_WRITE) == FR_OK;
+            }
+        }
+        return false;
+    }
+
+    size_t Write(const void* buf, size_t bytes) {
+        // SDMMC IDMA reads memory directly: flush the cached copy first
+        dsy_dma_clear_cache_for_buffer((uint8_t*)buf, bytes);
+        UINT written = 0;
+        f_write(&file_, buf, bytes, &written);
+        return written;
+    }
+
+    bool WriteAt(size_t offset, const void* buf, size_t bytes) {
+        FSIZE_t end = f_tell(&file_);
+        if (f_lseek(&file_, offset) != FR_OK) return false;
+        bool ok = Write(buf, bytes) == bytes;
+        f_lseek(&file_, end);
+        return ok;
+    }
+
+    void Close() { f_close(&file_); }
+
+  private:
+    FIL file_;
+};
+
+#endif  // FF_DEFINED
+
+// ============================================
+// Stdio sink (host builds: SD card = plain file)
+// ============================================
+#if !defined(__arm__)
+
+#include <unistd.h>
+
+class StdioWavSink {
+  public:
+    explicit StdioWavSink(const char* path) : path_(path) {}
+
+    // Simulated card latency per Write() call (microseconds)
+    void SetWriteLatency(uint32_t us) { latency_us_ = us; }
+
+    bool Open() {
+        file_ = fopen(path_, "wb");
+        return file_ != nullptr;
+    }
+
+    size_t Write(const void* buf, size_t bytes) {
+        if (latency_us_) usleep(latency_us_);
+        return fwrite(buf, 1, bytes, file_);
+    }
+
+    bool WriteAt(size_t offset, const void* buf, size_t bytes) {
+        long end = ftell(file_);
+        if (fseek(file_, (long)offset, SEEK_SET) != 0) return false;
+        bool ok = fwrite(buf, 1, bytes, file_) == bytes;
+        fseek(file_, end, SEEK_SET);
+        return ok;
+    }
+
+    void Close() {
+        if (file_) fclose(file_);
+        file_ = nullptr;
+    }
+
+  private:
+    const char* path_;
+    FILE*       file_       = nullptr;
+    uint32_t    latency_us_ = 0;
+};
+
+#endif  // !__arm__
@@ -0,0 +1,278 @@
+/*
+ * CONFIG CHECK - KalimbaConfigParse() on good and broken settings blocks,
+ * on the host
+ *
+ * BLOCKS:
+ *   Built here byte by byte in the documented layout (KalimbaConfig.h),
+ *   version 2 and version 1, then broken one way each. With a file
+ *   argument, that block is parsed too and must be valid - `make run`
+ *   passes the sector web-flasher/dfu-check.mjs wrote through dfu.js into
+ *   a simulated DfuSe bootloader, so web-flasher/config.js's encoder is
+ *   checked against this parser end to end.
+ *
+ * WHAT IT CHECKS:
+ *   - a valid block round-trips every field (pots, pins, custom scale,
+ *     sample rate); a version 1 block loads at 48kHz
+ *   - erased flash, bad magic / version / length / CRC, out-of-range
+ *     values, reserved pins and pin clashes each give their status
+ *   - on any error the config is the defaults, field for field: never a
+ *     partial config
+ *
+ *   config_check [sector.bin]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "../KalimbaConfig.h"
+
+// Firmware's default button pins and reserved pins (plain build)
+const uint8_t  DEFAULT_PINS[NUM_STRINGS] = {1, 2, 3, 4, 5, 6, 7};
+const uint64_t RESERVED_PINS             = (1ull << 11) | (1ull << 12) | (1ull << 13) | (1ull << 14) | (0x3Full << 15);
+
+// ============================================
+// Block builder (the documented layout)
+// ============================================
+struct Settings {
+    uint8_t     pots_fitted = 0x3F;
+    float       pot_values[KALIMBA_CONFIG_NUM_POTS] = {0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f};
+    uint8_t     pins[NUM_STRINGS] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    uint8_t     slot = KALIMBA_CONFIG_NO_SCALE;
+    const char* name = "";
+    const char* notes[NUM_STRINGS] = {"", "", "", "", "", "", ""};
+    float       freqs[NUM_STRINGS] = {};
+    uint8_t     khz = 48;
+};
+
+struct Block {
+    std::vector<uint8_t> bytes;
+
+    void U8(uint8_t v) { bytes.push_back(v); }
+    void U16(uint16_t v) { U8((uint8_t)v), U8((uint8_t)(v >> 8)); }
+    void U32(uint32_t v) { U16((uint16_t)v), U16((uint16_t)(v >> 16)); }
+    void F32(float v) {
+        uint32_t bits;
+        memcpy(&bits, &v, 4);
+        U32(bits);
+    }
+    void Chars(const char* s, size_t size) {
+        for (size_t i = 0; i < size; i++) U8(i < strlen(s) ? (uint8_t)s[i] : 0);
+    }
+
+    // Header + payload; length and CRC as written unless overridden
+    static Block Make(const Settings& s, uint16_t version = KALIMBA_CONFIG_VERSION) {
+        Block payload;
+        payload.U8(s.pots_fitted);
+        for (float v : s.pot_values) payload.F32(v);
+        for (uint8_t p : s.pins) payload.U8(p);
+        payload.U8(s.slot);
+        payload.Chars(s.name, 16);
+        for (const char* n : s.notes) payload.Chars(n, 4);
+        for (float f : s.freqs) payload.F32(f);
+        if (version >= 2) payload.U8(s.khz);
+
+        Block b;
+        b.U32(KALIMBA_CONFIG_MAGIC);
+        b.U16(version);
+        b.U16((uint16_t)payload.bytes.size());
+        b.U32(KalimbaCrc32(payload.bytes.data(), payload.bytes.size()));
+        b.bytes.insert(b.bytes.end(), payload.bytes.begin(), payload.bytes.end());
+        return b;
+    }
+
+    // Payload changed after the CRC was taken
+    void Corrupt(size_t payload_offset) { bytes[KALIMBA_CONFIG_HEADER_SIZE + payload_offset] ^= 0x10; }
+    void SetLength(uint16_t length) {
+        bytes[6] = (uint8_t)length;
+        bytes[7] = (uint8_t)(length >> 8);
+    }
+    void Resign() {
+        uint32_t crc = KalimbaCrc32(&bytes[KALIMBA_CONFIG_HEADER_SIZE], bytes.size() - KALIMBA_CONFIG_HEADER_SIZE);
+        for (int i = 0; i < 4; i++) bytes[8 + i] = (uint8_t)(crc >> (8 * i));
+    }
+};
+
+// A custom scale that passes every range check
+Settings Custom() {
+    Settings s;
+    s.pots_fitted = 0x2B;  // A2, A4 not fitted
+    s.pot_values[2] = 0.25f;
+    s.pot_values[4] = 1.0f;
+    s.pins[0] = 22;
+    s.pins[6] = 0;
+    s.slot = 3;
+    s.name = "Hijaz long name!!";  // 17 chars: cut to 15 + terminator
+    const char* notes[NUM_STRINGS] = {"D3", "Eb3", "F#3", "G3", "A3", "Bb3", "C4"};
+    const float freqs[NUM_STRINGS] = {146.83f, 155.56f, 185.0f, 196.0f, 220.0f, 233.08f, 261.63f};
+    for (int i = 0; i < NUM_STRINGS; i++) {
+        s.notes[i] = notes[i];
+        s.freqs[i] = freqs[i];
+    }
+    s.khz = 96;
+    return s;
+}
+
+// ============================================
+// Checks
+// ============================================
+int failures = 0;
+
+// Field by field (the struct has padding)
+bool IsDefaults(const KalimbaConfig& c) {
+    KalimbaConfig d;
+    d.Defaults(DEFAULT_PINS);
+    return c.pots_fitted == d.pots_fitted && memcmp(c.pot_values, d.pot_values, sizeof(d.pot_values)) == 0
+        && memcmp(c.button_pins, d.button_pins, sizeof(d.button_pins)) == 0
+        && c.custom_scale_slot == d.custom_scale_slot
+        && memcmp(c.custom_scale_name, d.custom_scale_name, sizeof(d.custom_scale_name)) == 0
+        && memcmp(c.custom_note_names, d.custom_note_names, sizeof(d.custom_note_names)) == 0
+        && memcmp(c.custom_freqs, d.custom_freqs, sizeof(d.custom_freqs)) == 0
+        && c.sample_rate_khz == d.sample_rate_khz;
+}
+
+// Parse into a config full of junk: errors must leave exactly the defaults
+KalimbaConfigStatus Parse(const std::vector<uint8_t>& bytes, KalimbaConfig* c, size_t size = 0) {
+    memset(c, 0xA5, sizeof(*c));
+    std::vector<uint8_t> sector(bytes);
+    sector.resize(size ? size : KALIMBA_CONFIG_MAX_SIZE, 0xFF);  // Rest of the erased sector
+    return KalimbaConfigParse(sector.data(), size ? size : sector.size(), RESERVED_PINS, DEFAULT_PINS, c);
+}
+
+void Expect(const char* name, const std::vector<uint8_t>& bytes, KalimbaConfigStatus want, size_t size = 0) {
+    KalimbaConfig       c;
+    KalimbaConfigStatus got = Parse(bytes, &c, size);
+    bool ok = got == want && (want == CONFIG_OK || IsDefaults(c));
+    printf("%-36s %-11s %s\n", name, KalimbaConfigStatusName(got), ok ? "ok" : "WRONG");
+    if (!ok) {
+        if (got != want) printf("    expected %s\n", KalimbaConfigStatusName(want));
+        else printf("    config is not the defaults after the error\n");
+        failures++;
+    }
+}
+
+void RoundTrip() {
+    Settings      s = Custom();
+    KalimbaConfig c;
+    KalimbaConfigStatus status = Parse(Block::Make(s).bytes, &c);
+    bool ok = status == CONFIG_OK && c.pots_fitted == 0x2B && c.pot_values[2] == 0.25f && c.pot_values[4] == 1.0f
+           && c.button_pins[0] == 22 && c.button_pins[1] == 2 && c.button_pins[6] == 0 && c.custom_scale_slot == 3
+           && strcmp(c.custom_scale_name, "Hijaz long name") == 0 && strcmp(c.custom_note_names[2], "F#3") == 0
+           && c.custom_freqs[6] == 261.63f && c.sample_rate_khz == 96;
+    printf("%-36s %-11s %s\n", "v2 round trip (every field)", KalimbaConfigStatusName(status), ok ? "ok" : "WRONG");
+    failures += !ok;
+
+    status = Parse(Block::Make(s, 1).bytes, &c);
+    ok = status == CONFIG_OK && c.sample_rate_khz == 48 && c.custom_scale_slot == 3 && c.button_pins[0] == 22;
+    printf("%-36s %-11s %s\n", "v1 block (loads at 48kHz)", KalimbaConfigStatusName(status), ok ? "ok" : "WRONG");
+    failures += !ok;
+}
+
+void Broken() {
+    Settings s = Custom();
+    Block    b;
+
+    Expect("erased sector", std::vector<uint8_t>(KALIMBA_CONFIG_MAX_SIZE, 0xFF), CONFIG_EMPTY);
+    b = Block::Make(s);
+    b.bytes[0] = 'X';
+    Expect("bad magic", b.bytes, CONFIG_BAD_MAGIC);
+    Expect("version 3 (newer flasher)", Block::Make(s, 3).bytes, CONFIG_BAD_VERSION);
+    Expect("version 0", Block::Make(s, 0).bytes, CONFIG_BAD_VERSION);
+
+    b = Block::Make(s);
+    b.Corrupt(40);
+    Expect("bad crc (payload bit flipped)", b.bytes, CONFIG_BAD_CRC);
+    b = Block::Make(s);
+    b.bytes[8] ^= 1;
+    Expect("bad crc (crc bit flipped)", b.bytes, CONFIG_BAD_CRC);
+
+    b = Block::Make(s);
+    b.SetLength((uint16_t)(KALIMBA_CONFIG_V2_SIZE - 1));
+    Expect("bad length (v2, one short)", b.bytes, CONFIG_BAD_LENGTH);
+    b = Block::Make(s, 1);
+    b.SetLength((uint16_t)KALIMBA_CONFIG_V2_SIZE);
+    Expect("bad length (v1 with v2 length)", b.bytes, CONFIG_BAD_LENGTH);
+    b = Block::Make(s);
+    b.SetLength(0xFFFF);
+    Expect("bad length (0xFFFF)", b.bytes, CONFIG_BAD_LENGTH);
+    Expect("block past the readable size", Block::Make(s).bytes, CONFIG_BAD_LENGTH,
+           KALIMBA_CONFIG_HEADER_SIZE + KALIMBA_CONFIG_V2_SIZE - 1);
+
+    Settings r = s;
+    r.pins[3] = 13;  // MIDI RX
+    Expect("reserved pin (D13)", Block::Make(r).bytes, CONFIG_BAD_VALUE);
+    r = s;
+    r.pins[3] = 33;
+    Expect("pin past D32", Block::Make(r).bytes, CONFIG_BAD_VALUE);
+    r = s;
+    r.pins[1] = 22;  // Same as button 1
+    Expect("pin clash (two buttons on D22)", Block::Make(r).bytes, CONFIG_BAD_VALUE);
+    r = s;
+    r.pins[0] = 4;  // Button 4's default pin
+    Expect("pin clash (with a default pin)", Block::Make(r).bytes, CONFIG_BAD_VALUE);
+    r = s;
+    r.pins[0] = 2;
+    r.pins[1] = 1;  // Swapped with each other: fine
+    Expect("pins swapped (no clash)", Block::Make(r).bytes, CONFIG_OK);
+
+    r = s;
+    r.pot_values[1] = 1.5f;
+    Expect("pot value 1.5", Block::Make(r).bytes, CONFIG_BAD_VALUE);
+    r = s;
+    r.pot_values[0] = nanf("");
+    Expect("pot value NaN", Block::Make(r).bytes, CONFIG_BAD_VALUE);
+    r = s;
+    r.slot = 5;
+    Expect("scale slot 5", Block::Make(r).bytes, CONFIG_BAD_VALUE);
+    r = s;
+    r.freqs[4] = 5000.0f;
+    Expect("custom note 5kHz", Block::Make(r).bytes, CONFIG_BAD_VALUE);
+    r = s;
+    r.slot = KALIMBA_CONFIG_NO_SCALE;
+    r.freqs[4] = 5000.0f;  // Unused without a slot
+    Expect("5kHz note, no custom scale", Block::Make(r).bytes, CONFIG_OK);
+    r = s;
+    r.khz = 44;
+    Expect("sample rate 44kHz", Block::Make(r).bytes, CONFIG_BAD_VALUE);
+
+    // Name without a terminator: cut, not read past
+    b = Block::Make(s);
+    memset(&b.bytes[KALIMBA_CONFIG_HEADER_SIZE + 1 + 24 + 7 + 1], 'A', 16);
+    b.Resign();
+    KalimbaConfig       c;
+    KalimbaConfigStatus status = Parse(b.bytes, &c);
+    bool ok = status == CONFIG_OK && strlen(c.custom_scale_name) == 15;
+    printf("%-36s %-11s %s\n", "unterminated name (cut at 15)", KalimbaConfigStatusName(status), ok ? "ok" : "WRONG");
+    failures += !ok;
+}
+
+// A sector written by the web flasher
+void FromFile(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        printf("%s: can't read\n", path);
+        failures++;
+        return;
+    }
+    std::vector<uint8_t> sector(KALIMBA_CONFIG_MAX_SIZE, 0);
+    size_t               n = fread(sector.data(), 1, sector.size(), f);
+    fclose(f);
+
+    KalimbaConfig       c;
+    KalimbaConfigStatus status = Parse(sector, &c, n);
+    printf("%s (%zu bytes): %s, %ukHz, pots 0x%02X, pins %u %u %u %u %u %u %u, custom slot %d \"%s\"\n", path, n,
+           KalimbaConfigStatusName(status), c.sample_rate_khz, c.pots_fitted, c.button_pins[0], c.button_pins[1],
+           c.button_pins[2], c.button_pins[3], c.button_pins[4], c.button_pins[5], c.button_pins[6],
+           c.custom_scale_slot, status == CONFIG_OK ? c.custom_scale_name : "");
+    failures += status != CONFIG_OK;
+}
+
+int main(int argc, char** argv) {
+    RoundTrip();
+    Broken();
+    for (int i = 1; i < argc; i++) FromFile(argv[i]);
+    printf("%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
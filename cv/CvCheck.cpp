@@ -0,0 +1,258 @@
+/*
+ * CV CHECK - CvInput.h against synthetic Eurorack gates and pitch CV, on
+ * the host
+ *
+ * SIGNALS (sampled like the firmware's ADC: one frame per audio block,
+ * FRAME_RATE):
+ *   Gate 1 and its pitch CV come from a "sequencer": random notes of the
+ *   scale row (slightly detuned), the CV changing on the edge or up to
+ *   0.5ms before it; gates and triggers of random length. Gate 2 is an
+ *   independent trigger stream at 10V (clamped at the ADC's full scale).
+ *   Every input goes through the divider's RC low-pass, all carry noise.
+ *   Edges fall at any time, not on the frame grid.
+ *
+ * WHAT IT CHECKS:
+ *   - every rising edge reported once, none extra
+ *   - timing against the true edge, in audio samples: the latency is
+ *     fixed per gate (the RC), what varies is jitter, which must stay
+ *     under one ADC frame; also shown without the interpolation (frame
+ *     grid only) for comparison
+ *   - gate 1's note: the quantized CV is the pitch the sequencer sent
+ *   - quantizer hysteresis: a CV right between two notes doesn't flip
+ *   - cost of one Process() call
+ *   for blocks of 1, 4 and 12 frames (12 = the firmware's 1ms pass).
+ *
+ *   cv_check [seconds]
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+#include "../CvInput.h"
+#include "../TuningTable.h"
+
+const float  SAMPLE_RATE   = 48000.0f;
+const int    FRAME_SAMPLES = 4;  // Firmware: one frame per 4-sample audio block
+const float  FRAME_RATE    = SAMPLE_RATE / FRAME_SAMPLES;
+const int    OVERSAMPLE    = 40;        // Analog simulation steps per frame
+const float  RC_TAU        = 100e-6f;   // 10k || 20k divider + 15nF
+const float  NOISE_V       = 0.003f;    // At the jack
+const float  GATE_LEVELS[2] = {5.0f, 10.0f};
+const int    SCALE         = 0;
+const size_t BLOCKS[3]     = {1, 4, 12};
+
+typedef GateCvInput<2, 1> Inputs;
+
+// ============================================
+// Sequence
+// ============================================
+uint32_t rng = 4242;
+
+float Uniform(float lo, float hi) {
+    rng = rng * 1664525u + 1013904223u;
+    return lo + (hi - lo) * (rng >> 8) * (1.0f / 16777216.0f);
+}
+
+struct Edge {
+    int    gate;
+    double rise;    // Seconds
+    double fall;
+    int    note;    // Row index (gate 1)
+    double cv_at;   // When the CV moved to it
+    float  volts;
+};
+
+struct Row {
+    float pitch[TUNING_OCTAVES * NUM_STRINGS];
+    float volts[TUNING_OCTAVES * NUM_STRINGS];  // 1V/oct from pitch[0]
+};
+
+Row MakeRow() {
+    TuningTable table;
+    for (int i = 0; i < NUM_SCALES; i++) table.SetScale(i, scale_names[i], scale_note_names[i], scale_frequencies[i]);
+    table.Prepare();
+    Row row;
+    for (int i = 0; i < TUNING_OCTAVES * NUM_STRINGS; i++) {
+        row.pitch[i] = (&table.freq[SCALE][0][0])[i];
+        row.volts[i] = log2f(row.pitch[i] / row.pitch[0]);
+    }
+    return row;
+}
+
+std::vector<Edge> Sequence(const Row& row, float seconds) {
+    std::vector<Edge> edges;
+    for (int g = 0; g < 2; g++) {
+        double t = 0.05;
+        while (t < seconds - 0.5) {
+            Edge e;
+            e.gate   = g;
+            e.rise   = t;
+            double gap = Uniform(0.02f, 0.4f);
+            e.fall   = t + (Uniform(0.0f, 1.0f) < 0.5f ? Uniform(0.001f, 0.015f) : gap * Uniform(0.2f, 0.8f));
+            do {  // Within the CV range
+                e.note = (int)Uniform(0.0f, TUNING_OCTAVES * NUM_STRINGS - 0.01f);
+            } while (row.volts[e.note] > CV_FULL_SCALE_V - 0.05f);
+            e.cv_at  = t - (Uniform(0.0f, 1.0f) < 0.5f ? 0.0 : Uniform(0.0f, 0.0005f));
+            e.volts  = row.volts[e.note] + Uniform(-10.0f, 10.0f) / 1200.0f;  // Detuned up to 10 cents
+            edges.push_back(e);
+            t += gap;
+        }
+    }
+    return edges;
+}
+
+// ADC frames [gate 1, gate 2, pitch CV], through the RC, 16-bit
+std::vector<uint16_t> Render(const std::vector<Edge>& edges, float seconds) {
+    size_t frames = (size_t)(seconds * FRAME_RATE);
+    double dt     = 1.0 / (FRAME_RATE * OVERSAMPLE);
+    float  k      = 1.0f - expf(-(float)dt / RC_TAU);
+
+    // Edges of each gate, in time order
+    std::vector<const Edge*> by_gate[2];
+    for (const Edge& e : edges) by_gate[e.gate].push_back(&e);
+    size_t next[2] = {}, next_cv = 0;
+    float  held    = 0.0f;
+
+    // Jack voltages on a fine grid through the RC low-pass; the ADC
+    // samples at every frame instant
+    std::vector<uint16_t> adc(frames * 3);
+    float                 y[3] = {};
+    for (size_t f = 0; f < frames; f++) {
+        for (int c = 0; c < 3; c++) {
+            float v = (y[c] + Uniform(-NOISE_V, NOISE_V)) / CV_FULL_SCALE_V;
+            v       = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+            adc[f * 3 + c] = (uint16_t)(v * 65535.0f + 0.5f);
+        }
+        for (int s = 0; s < OVERSAMPLE; s++) {
+            double t = (f * OVERSAMPLE + s) * dt;
+            float  jack[3];
+            for (int g = 0; g < 2; g++) {
+                while (next[g] < by_gate[g].size() && by_gate[g][next[g]]->fall <= t) next[g]++;
+                bool high = next[g] < by_gate[g].size() && by_gate[g][next[g]]->rise <= t;
+                jack[g]   = high ? GATE_LEVELS[g] : 0.0f;
+            }
+            while (next_cv < by_gate[0].size() && by_gate[0][next_cv]->cv_at <= t) held = by_gate[0][next_cv++]->volts;
+            jack[2] = held;
+            for (int c = 0; c < 3; c++) y[c] += k * (jack[c] - y[c]);
+        }
+    }
+    return adc;
+}
+
+// ============================================
+// Detection run
+// ============================================
+struct Stats {
+    double min = 1e9, max = -1e9, sum = 0.0;
+    int    n   = 0;
+    void   Add(double x) {
+        min = x < min ? x : min;
+        max = x > max ? x : max;
+        sum += x;
+        n++;
+    }
+    double Spread() const { return n ? max - min : 0.0; }
+};
+
+bool Check(const Row& row, const std::vector<Edge>& edges, const std::vector<uint16_t>& adc, size_t block) {
+    Inputs input;
+    input.Init(FRAME_RATE);
+    CvQuantizer quantizer;
+    quantizer.SetRow(row.pitch, TUNING_OCTAVES * NUM_STRINGS, NUM_STRINGS);
+
+    struct Found {
+        Inputs::Edge edge;
+        int          note;
+        uint32_t     reported;
+    };
+    std::vector<Found> found;
+    size_t             frames = adc.size() / Inputs::CHANNELS;
+    double             cost   = 0.0;
+    for (size_t f = 0; f + block <= frames; f += block) {
+        Inputs::Edge out[2];
+        auto         start = std::chrono::steady_clock::now();
+        size_t       n     = input.Process(&adc[f * Inputs::CHANNELS], block, out);
+        cost += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        for (size_t i = 0; i < n; i++) {
+            int note = out[i].gate == 0 ? quantizer.Quantize(out[i].cv[0]).index : -1;
+            found.push_back({out[i], note, (uint32_t)(f + block)});
+        }
+    }
+
+    // Match every edge to a report on its gate, in order
+    std::vector<bool> used(found.size(), false);
+    int               missed = 0, wrong_notes = 0, late = 0;
+    Stats             timing[2], grid[2];
+    for (const Edge& e : edges) {
+        double true_sample = e.rise * SAMPLE_RATE;
+        int    match       = -1;
+        for (size_t i = 0; i < found.size() && match < 0; i++) {
+            double at = (found[i].edge.frame + found[i].edge.fraction) * FRAME_SAMPLES;
+            if (!used[i] && found[i].edge.gate == e.gate && fabs(at - true_sample) < 2.0 * FRAME_SAMPLES) {
+                match = (int)i;
+            }
+        }
+        if (match < 0) {
+            missed++;
+            continue;
+        }
+        used[match]     = true;
+        const Found& d  = found[match];
+        // Firmware: frame's sample + the fraction, rounded to a sample
+        double at       = d.edge.frame * FRAME_SAMPLES + floorf(d.edge.fraction * FRAME_SAMPLES + 0.5f);
+        double on_grid  = (d.edge.frame + 1) * FRAME_SAMPLES;
+        timing[e.gate].Add(at - true_sample);
+        grid[e.gate].Add(on_grid - true_sample);
+        if (e.gate == 0 && fabsf(row.volts[d.note] - row.volts[e.note]) > 0.001f) wrong_notes++;  // Pitch, not string: scales repeat notes
+        if (d.reported - d.edge.frame > input.LatencyFrames(block)) late++;
+    }
+    int extra = 0;
+    for (size_t i = 0; i < found.size(); i++) extra += !used[i];
+
+    double jitter = timing[0].Spread() > timing[1].Spread() ? timing[0].Spread() : timing[1].Spread();
+    printf("block %2zu frames: %zu edges, %d missed, %d extra, %d wrong notes, %d late, %.0fns per Process()\n",
+           block, edges.size(), missed, extra, wrong_notes, late, cost / (frames / block));
+    for (int g = 0; g < 2; g++) {
+        printf("    gate %d (%.0fV): latency %.2f samples, jitter %.2f samples (frame grid only: %.2f)\n", g + 1,
+               GATE_LEVELS[g], timing[g].n ? timing[g].sum / timing[g].n : 0.0, timing[g].Spread(),
+               grid[g].Spread());
+    }
+    return missed == 0 && extra == 0 && wrong_notes == 0 && late == 0 && jitter < FRAME_SAMPLES;
+}
+
+// A CV right between two notes, with noise: how often the note flips
+int HysteresisFlips(const Row& row) {
+    CvQuantizer quantizer;
+    quantizer.SetRow(row.pitch, TUNING_OCTAVES * NUM_STRINGS, NUM_STRINGS);
+    float lo = 1e9f, hi = 1e9f;
+    for (int i = 0; i < TUNING_OCTAVES * NUM_STRINGS; i++) {  // Two neighbours in pitch around 2V
+        if (row.volts[i] < 2.0f && (lo > 1e8f || row.volts[i] > lo)) lo = row.volts[i];
+        if (row.volts[i] >= 2.0f && row.volts[i] < hi) hi = row.volts[i];
+    }
+    int flips = 0, last = -1;
+    for (int i = 0; i < 10000; i++) {
+        int note = quantizer.Quantize(0.5f * (lo + hi) + Uniform(-NOISE_V, NOISE_V)).index;
+        flips += last >= 0 && note != last;
+        last = note;
+    }
+    return flips;
+}
+
+int main(int argc, char** argv) {
+    float                 seconds = argc > 1 ? (float)atof(argv[1]) : 60.0f;
+    Row                   row     = MakeRow();
+    std::vector<Edge>     edges   = Sequence(row, seconds);
+    std::vector<uint16_t> adc     = Render(edges, seconds);
+
+    bool ok = true;
+    for (size_t block : BLOCKS) ok = Check(row, edges, adc, block) && ok;
+    int flips = HysteresisFlips(row);
+    printf("CV between two notes, +-%.0fmV noise: %d flips in 10000 quantizations\n", NOISE_V * 1000.0f, flips);
+    ok = ok && flips == 0;
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,328 @@
+/*
+ * JITTER DIAGNOSTIC - Audio callback timing under peripheral load
+ * For Daisy Seed using libDaisy + DaisySP
+ *
+ * Where the other diagnostics only prove that audio runs, this one
+ * measures HOW it runs: every callback entry is timestamped with the DWT
+ * cycle counter, and two histograms are built per test phase:
+ *   - interval: entry to entry (should sit on one bin: 83.3us at 48kHz/4)
+ *   - duration: entry to exit (the Kalimba engine's real DSP load)
+ *
+ * PHASES (PHASE_MS each, then results are printed and the next starts):
+ *   every on/off combination of
+ *     USB  - serial log traffic from the main loop
+ *     I2C  - continuous SSD1306 frame updates (D11/D12, like the Kalimba)
+ *     ADC  - 6-channel ADC DMA running (A0-A5)
+ *   once with libDaisy's default interrupt priorities, once with the audio
+ *   DMA raised above everything else ("audio-first").
+ *   Histograms are frozen while results print, so reporting never shows
+ *   up in its own numbers.
+ *
+ * OUTPUT (USB serial, CSV lines, '#' = comment):
+ *   PHASE,<n>,<usb>,<i2c>,<adc>,<prio>,<callbacks>,<late>
+ *   STATS,<n>,<interval|duration>,<min_us>,<mean_us>,<max_us>
+ *   BIN,<n>,<interval|duration>,<us>,<count>   (non-empty 1us bins only;
+ *                                               the last bin = overflow)
+ *   e.g. grep '^BIN' log.txt > bins.csv, then plot count over us per phase
+ *
+ * Monitor: ./monitor.sh > log.txt
+ */
+
+#include "daisy_seed.h"
+#include "daisysp.h"
+#include "dev/oled_ssd130x.h"
+#include "../KalimbaEngine.h"
+#include "../SelfBench.h"
+
+using namespace daisy;
+using namespace daisysp;
+
+// Hardware
+DaisySeed hw;
+OledDisplay<SSD130xI2c128x64Driver> display;
+AdcChannelConfig adc_config[6];
+
+// Real DSP load: the Kalimba engine, auto-plucking
+const int NUM_STRINGS = 7;
+KalimbaEngine<NUM_STRINGS> engine;
+const size_t AUDIO_BLOCK_SIZE = 4;
+const uint32_t PLUCK_INTERVAL = 12000;  // Samples (250ms at 48kHz)
+const float string_freqs[NUM_STRINGS] = {196.00f, 220.00f, 246.94f, 293.66f,
+                                         329.63f, 392.00f, 440.00f};
+uint32_t pluck_timer = 0;
+int next_string = 0;
+
+// Test phases
+const uint32_t PHASE_MS = 5000;
+const uint32_t SETTLE_MS = 100;  // After switching peripherals, before measuring
+const int NUM_PHASES = 16;       // USB x I2C x ADC x priority scheme
+
+// ============================================
+// Histograms (written by the audio callback)
+// ============================================
+struct Histogram {
+    static const int BINS = 200;  // 1us bins, last one = overflow
+
+    uint32_t count[BINS];
+    uint32_t n;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+
+    void Reset() {
+        memset(count, 0, sizeof(count));
+        n   = 0;
+        min = 0xFFFFFFFF;
+        max = 0;
+        sum = 0;
+    }
+
+    void Add(uint32_t cycles, uint32_t cycles_per_us) {
+        uint32_t bin = cycles / cycles_per_us;
+        count[bin < BINS ? bin : BINS - 1]++;
+        n++;
+        sum += cycles;
+        if (cycles < min) min = cycles;
+        if (cycles > max) max = cycles;
+    }
+};
+
+Histogram interval_hist;
+Histogram duration_hist;
+volatile bool measuring = false;
+bool have_last_entry = false;
+uint32_t last_entry = 0;
+uint32_t cycles_per_us = 480;
+uint32_t expected_interval = 0;  // Cycles per callback at the nominal rate
+volatile uint32_t late_callbacks = 0;
+
+// ============================================
+// Interrupt priorities
+// ============================================
+struct IrqInfo {
+    IRQn_Type   irq;
+    const char* name;
+    uint32_t    default_priority;
+};
+
+// Audio DMA: SAI1 A/B streams as set up by libDaisy
+IrqInfo audio_irqs[] = {
+    {DMA1_Stream0_IRQn, "SAI1A DMA", 0},
+    {DMA1_Stream1_IRQn, "SAI1B DMA", 0},
+};
+
+// Everything the test switches on and off
+IrqInfo other_irqs[] = {
+    {OTG_HS_IRQn, "USB OTG HS", 0},
+    {OTG_FS_IRQn, "USB OTG FS", 0},
+    {I2C1_EV_IRQn, "I2C1 EV", 0},
+    {I2C1_ER_IRQn, "I2C1 ER", 0},
+    {DMA1_Stream2_IRQn, "ADC1 DMA", 0},
+};
+
+const int NUM_AUDIO_IRQS = sizeof(audio_irqs) / sizeof(audio_irqs[0]);
+const int NUM_OTHER_IRQS = sizeof(other_irqs) / sizeof(other_irqs[0]);
+
+void SaveDefaultPriorities() {
+    for (int i = 0; i < NUM_AUDIO_IRQS; i++) {
+        audio_irqs[i].default_priority = NVIC_GetPriority(audio_irqs[i].irq);
+    }
+    for (int i = 0; i < NUM_OTHER_IRQS; i++) {
+        other_irqs[i].default_priority = NVIC_GetPriority(other_irqs[i].irq);
+    }
+}
+
+// Audio-first: audio DMA at 0 (highest), everything else at 15 (lowest)
+void SetPriorities(bool audio_first) {
+    for (int i = 0; i < NUM_AUDIO_IRQS; i++) {
+        NVIC_SetPriority(audio_irqs[i].irq, audio_first ? 0 : audio_irqs[i].default_priority);
+    }
+    for (int i = 0; i < NUM_OTHER_IRQS; i++) {
+        NVIC_SetPriority(other_irqs[i].irq, audio_first ? 15 : other_irqs[i].default_priority);
+    }
+}
+
+void PrintPriorities() {
+    hw.PrintLine("# Default NVIC priorities (0 = highest):");
+    for (int i = 0; i < NUM_AUDIO_IRQS; i++) {
+        hw.PrintLine("#   %-12s %u", audio_irqs[i].name, (unsigned)audio_irqs[i].default_priority);
+    }
+    for (int i = 0; i < NUM_OTHER_IRQS; i++) {
+        hw.PrintLine("#   %-12s %u", other_irqs[i].name, (unsigned)other_irqs[i].default_priority);
+    }
+}
+
+// ============================================
+// Audio
+// ============================================
+void AudioCallback(AudioHandle::InputBuffer in,
+                   AudioHandle::OutputBuffer out,
+                   size_t size) {
+    uint32_t entry = DwtClock::Now();
+
+    if (measuring) {
+        if (have_last_entry) {
+            uint32_t interval = entry - last_entry;
+            interval_hist.Add(interval, cycles_per_us);
+            if (interval > expected_interval + expected_interval / 2) {
+                late_callbacks++;
+            }
+        }
+        have_last_entry = true;
+    } else {
+        have_last_entry = false;
+    }
+    last_entry = entry;
+
+    // Keep the strings ringing so the DSP load is realistic
+    pluck_timer += size;
+    if (pluck_timer >= PLUCK_INTERVAL) {
+        pluck_timer = 0;
+        engine.Trigger(next_string, 0.8f);
+        next_string = (next_string + 1) % NUM_STRINGS;
+    }
+
+    engine.Process(out[0], size);
+    for (size_t i = 0; i < size; i++) {
+        out[1][i] = out[0][i];
+    }
+
+    if (measuring) {
+        duration_hist.Add(DwtClock::Now() - entry, cycles_per_us);
+    }
+}
+
+// ============================================
+// Reporting (main loop, histograms frozen)
+// ============================================
+void PrintHistogram(int phase, const char* kind, const Histogram& h) {
+    if (h.n == 0) {
+        hw.PrintLine("STATS,%d,%s,0,0,0", phase, kind);
+        return;
+    }
+    // Microseconds with 2 decimals, integer math only
+    uint32_t mean = (uint32_t)(h.sum * 100 / h.n / cycles_per_us);
+    uint32_t mn   = (uint32_t)((uint64_t)h.min * 100 / cycles_per_us);
+    uint32_t mx   = (uint32_t)((uint64_t)h.max * 100 / cycles_per_us);
+    hw.PrintLine("STATS,%d,%s,%u.%02u,%u.%02u,%u.%02u", phase, kind,
+                 (unsigned)(mn / 100), (unsigned)(mn % 100),
+                 (unsigned)(mean / 100), (unsigned)(mean % 100),
+                 (unsigned)(mx / 100), (unsigned)(mx % 100));
+
+    for (int b = 0; b < Histogram::BINS; b++) {
+        if (h.count[b]) {
+            hw.PrintLine("BIN,%d,%s,%d,%u", phase, kind, b, (unsigned)h.count[b]);
+        }
+    }
+}
+
+void DisplayInit() {
+    OledDisplay<SSD130xI2c128x64Driver>::Config disp_cfg;
+    disp_cfg.driver_config.transport_config.i2c_address = 0x3C;
+    disp_cfg.driver_config.transport_config.i2c_config.periph = I2CHandle::Config::Peripheral::I2C_1;
+    disp_cfg.driver_config.transport_config.i2c_config.speed = I2CHandle::Config::Speed::I2C_400KHZ;
+    disp_cfg.driver_config.transport_config.i2c_config.pin_config.scl = seed::D11;
+    disp_cfg.driver_config.transport_config.i2c_config.pin_config.sda = seed::D12;
+    display.Init(disp_cfg);
+}
+
+int main(void) {
+    // Initialize hardware
+    hw.Init();
+    hw.SetAudioBlockSize(AUDIO_BLOCK_SIZE);
+    float sample_rate = hw.AudioSampleRate();
+
+    // Same codec stabilization delay as the Kalimba firmware
+    System::Delay(1000);
+
+    // Start USB serial logging (waits for the host: results are the point)
+    hw.StartLog(true);
+    System::Delay(500);
+
+    DwtClock::Enable();
+    cycles_per_us = System::GetSysClkFreq() / 1000000;
+    expected_interval = (uint32_t)((float)System::GetSysClkFreq() * AUDIO_BLOCK_SIZE / sample_rate);
+
+    hw.PrintLine("# =================================");
+    hw.PrintLine("# Daisy Seed Audio Jitter Diagnostic");
+    hw.PrintLine("# =================================");
+    hw.PrintLine("# sample_rate=%u block=%u expected_interval_us=%u.%02u bin_us=1",
+                 (unsigned)sample_rate, (unsigned)AUDIO_BLOCK_SIZE,
+                 (unsigned)(expected_interval / cycles_per_us),
+                 (unsigned)(expected_interval * 100 / cycles_per_us % 100));
+
+    // Peripherals under test
+    adc_config[0].InitSingle(seed::A0);
+    adc_config[1].InitSingle(seed::A1);
+    adc_config[2].InitSingle(seed::A2);
+    adc_config[3].InitSingle(seed::A3);
+    adc_config[4].InitSingle(seed::A4);
+    adc_config[5].InitSingle(seed::A5);
+    hw.adc.Init(adc_config, 6);
+    DisplayInit();
+
+    SaveDefaultPriorities();
+    PrintPriorities();
+
+    // DSP load
+    engine.Init(sample_rate);
+    for (int s = 0; s < NUM_STRINGS; s++) {
+        engine.SetVoiceFreq(s, string_freqs[s]);
+    }
+
+    hw.StartAudio(AudioCallback);
+    hw.PrintLine("# Audio started, %d phases of %u ms", NUM_PHASES, (unsigned)PHASE_MS);
+
+    // Main loop: one phase after the other, forever
+    int phase = 0;
+    while(1) {
+        bool usb_on      = phase & 1;
+        bool i2c_on      = phase & 2;
+        bool adc_on      = phase & 4;
+        bool audio_first = phase & 8;
+
+        // Switch peripherals, let them settle, then measure
+        SetPriorities(audio_first);
+        if (adc_on) {
+            hw.adc.Start();
+        } else {
+            hw.adc.Stop();
+        }
+        System::Delay(SETTLE_MS);
+
+        interval_hist.Reset();
+        duration_hist.Reset();
+        late_callbacks = 0;
+        measuring = true;
+
+        uint32_t start = System::GetNow();
+        uint32_t usb_lines = 0;
+        bool pixel = false;
+        while (System::GetNow() - start < PHASE_MS) {
+            hw.SetLed((System::GetNow() / 250) & 1);
+
+            if (usb_on) {
+                hw.PrintLine("# usb load %u", (unsigned)usb_lines++);
+            }
+            if (i2c_on) {
+                // Full frame (1KB) over I2C, blocking, as the Kalimba does
+                pixel = !pixel;
+                display.Fill(pixel);
+                display.Update();
+            }
+            if (!usb_on && !i2c_on) {
+                System::Delay(1);
+            }
+        }
+        measuring = false;
+
+        // Report (histograms are no longer written)
+        hw.PrintLine("PHASE,%d,%d,%d,%d,%s,%u,%u", phase, usb_on, i2c_on, adc_on,
+                     audio_first ? "audio-first" : "default",
+                     (unsigned)interval_hist.n, (unsigned)late_callbacks);
+        PrintHistogram(phase, "interval", interval_hist);
+        PrintHistogram(phase, "duration", duration_hist);
+
+        phase = (phase + 1) % NUM_PHASES;
+    }
+}
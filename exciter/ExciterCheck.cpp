@@ -0,0 +1,248 @@
+/*
+ * EXCITER CHECK - SampleExciter.h streaming from a slow file-backed card,
+ * on the host
+ *
+ * SIMULATION (time in samples, as on the Daisy):
+ *   The main loop calls Service(); every ReadAt() of the card takes a
+ *   simulated latency, and while it "runs" the audio callback keeps
+ *   interrupting it, 4 samples at a time - the same preemption as the
+ *   audio interrupt over a FatFS read. The card is StdioSampleSource on a
+ *   generated EXC_0.WAV (no zero samples, a LIST chunk before "data").
+ *   All 7 strings are retriggered at random, often while the main loop is
+ *   reading for them.
+ *
+ * CARDS:
+ *   fast    0.5ms per read: never underruns
+ *   slow    60ms per read (longer than a 43ms half): underruns
+ *   storm   5ms per read, retriggers every 2-40ms: most reads are
+ *           overtaken by a retrigger
+ *
+ * WHAT IT CHECKS:
+ *   - every trigger starts on its own sample with the file's first sample
+ *   - every sample a string plays is the file's sample at that position:
+ *     a read in flight for the previous note is never published (a stale
+ *     half would put the wrong part of the file in the new note)
+ *   - a half that isn't ready ends the excitation (silence, never a
+ *     stall) and Underruns() counts exactly those endings
+ *   - FindWavData() gives up on malformed chunk sizes instead of looping
+ *
+ *   exciter_check [seconds per card]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "../SampleExciter.h"
+
+const int      VOICES      = 7;
+const float    SAMPLE_RATE = 48000.0f;
+const size_t   BLOCK       = 4;       // Firmware AUDIO_BLOCK_SIZE
+const uint32_t FILE_LEN    = 24000;   // 0.5s: most notes are retriggered mid-stream
+const char*    DIR         = ".";
+
+// ============================================
+// Test files
+// ============================================
+uint32_t rng = 31337;
+
+uint32_t Next() {
+    rng = rng * 1664525u + 1013904223u;
+    return rng >> 8;
+}
+
+void Put32(FILE* f, uint32_t v) {
+    uint8_t b[4] = {(uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24)};
+    fwrite(b, 1, 4, f);
+}
+
+void Put16(FILE* f, uint16_t v) {
+    uint8_t b[2] = {(uint8_t)v, (uint8_t)(v >> 8)};
+    fwrite(b, 1, 2, f);
+}
+
+// 16-bit mono WAV with an odd-sized LIST chunk before "data"
+std::vector<int16_t> WriteExciter(const char* path) {
+    std::vector<int16_t> pcm(FILE_LEN);
+    for (int16_t& x : pcm) {
+        int v = (int)(Next() % 60001) - 30000;
+        x     = (int16_t)(v == 0 ? 1 : v);  // No zero: silence means the note ended
+    }
+    FILE* f = fopen(path, "wb");
+    fwrite("RIFF", 1, 4, f);
+    Put32(f, 4 + (8 + 16) + (8 + 5 + 1) + (8 + FILE_LEN * 2));
+    fwrite("WAVE", 1, 4, f);
+    fwrite("fmt ", 1, 4, f);
+    Put32(f, 16);
+    Put16(f, 1);
+    Put16(f, 1);
+    Put32(f, (uint32_t)SAMPLE_RATE);
+    Put32(f, (uint32_t)SAMPLE_RATE * 2);
+    Put16(f, 2);
+    Put16(f, 16);
+    fwrite("LIST", 1, 4, f);
+    Put32(f, 5);
+    fwrite("abcde\0", 1, 6, f);  // + pad byte
+    fwrite("data", 1, 4, f);
+    Put32(f, FILE_LEN * 2);
+    fwrite(pcm.data(), 2, FILE_LEN, f);
+    fclose(f);
+    return pcm;
+}
+
+// A chunk whose size wraps a 32-bit offset (used to hang the boot)
+bool MalformedGivesUp(uint32_t bad_size) {
+    FILE* f = fopen("EXC_BAD.WAV", "wb");
+    fwrite("RIFF", 1, 4, f);
+    Put32(f, 0xFFFFFFFF);
+    fwrite("WAVE", 1, 4, f);
+    fwrite("JUNK", 1, 4, f);
+    Put32(f, bad_size);
+    for (int i = 0; i < 64; i++) Put32(f, 0);
+    fclose(f);
+
+    StdioSampleSource source(DIR);
+    source.Open("EXC_BAD.WAV");
+    size_t   offset = 0;
+    uint32_t samples = 0;
+    bool     found  = FindWavData(&source, &offset, &samples);
+    source.Close();
+    remove("EXC_BAD.WAV");
+    return !found;
+}
+
+// ============================================
+// Simulation
+// ============================================
+struct Sim;
+
+// File-backed card whose reads take simulated time, audio running meanwhile
+class SlowSource : public StdioSampleSource {
+  public:
+    SlowSource() : StdioSampleSource(DIR) {}
+
+    size_t ReadAt(size_t offset, void* buf, size_t bytes);
+
+    Sim*     sim        = nullptr;
+    uint32_t latency    = 0;  // Samples
+    uint32_t reads      = 0;
+    uint32_t overtaken  = 0;  // Reads during which a string was retriggered
+};
+
+struct Sim {
+    SampleExciter<SlowSource, VOICES> exciter;
+    SlowSource                        card;
+    const std::vector<int16_t>&       pcm;
+    uint64_t                          now = 0;
+    uint64_t                          next_trigger[VOICES];
+    uint32_t                          min_gap, max_gap;  // Samples between retriggers
+
+    // Per string: where the note started, whether it ended early
+    int64_t  start[VOICES];
+    bool     ended[VOICES];
+    uint32_t triggers = 0, late_starts = 0, wrong = 0, early_ends = 0, bad_ends = 0;
+
+    Sim(const std::vector<int16_t>& file, uint32_t latency, uint32_t min_gap_, uint32_t max_gap_)
+        : pcm(file), min_gap(min_gap_), max_gap(max_gap_) {
+        card.sim     = this;
+        card.latency = latency;
+        exciter.Init(&card, 1.0f);
+        for (int v = 0; v < VOICES; v++) {
+            next_trigger[v] = Gap();
+            start[v]        = -1;
+            ended[v]        = false;
+        }
+    }
+
+    uint64_t Gap() { return min_gap + Next() % (max_gap - min_gap + 1); }
+
+    // One audio callback: triggers land on their exact sample
+    void AudioBlock() {
+        for (size_t i = 0; i < BLOCK; i++, now++) {
+            for (int v = 0; v < VOICES; v++) {
+                if (now == next_trigger[v]) {
+                    next_trigger[v] = now + Gap();
+                    if (exciter.Loaded()) {
+                        exciter.Start(v);
+                        start[v] = (int64_t)now;
+                        ended[v] = false;
+                        triggers++;
+                    }
+                }
+                Check(v, exciter.Process(v));
+            }
+        }
+    }
+
+    void Check(int v, float y) {
+        if (start[v] < 0) {
+            wrong += y != 0.0f;
+            return;
+        }
+        uint64_t pos      = now - (uint64_t)start[v];
+        float    expected = pos < FILE_LEN && !ended[v] ? pcm[pos] * (1.0f / 32768.0f) : 0.0f;
+        if (y == expected) return;
+        if (y == 0.0f && !ended[v]) {
+            // Ran out of streamed data: only possible past the resident head
+            ended[v] = true;
+            early_ends++;
+            bad_ends += pos < SampleExciter<SlowSource, VOICES>::HEAD;
+            return;
+        }
+        if (pos == 0) late_starts++;
+        wrong++;
+    }
+
+    // Main loop: Service() (its reads let audio run), or idle for a block
+    void Run(float seconds) {
+        exciter.SelectNext();  // EXC_0.WAV
+        uint64_t end = (uint64_t)(seconds * SAMPLE_RATE);
+        while (now < end) {
+            uint32_t reads = card.reads;
+            exciter.Service();
+            if (card.reads == reads) AudioBlock();
+        }
+    }
+};
+
+size_t SlowSource::ReadAt(size_t offset, void* buf, size_t bytes) {
+    reads++;
+    uint32_t triggers = sim->triggers;
+    for (uint32_t t = 0; t < latency; t += BLOCK) sim->AudioBlock();
+    overtaken += sim->triggers != triggers;
+    return StdioSampleSource::ReadAt(offset, buf, bytes);
+}
+
+bool RunCard(const char* name, const std::vector<int16_t>& pcm, float seconds, float latency_ms, float min_ms,
+             float max_ms, int expect_underruns) {
+    Sim sim(pcm, (uint32_t)(latency_ms * SAMPLE_RATE / 1000.0f), (uint32_t)(min_ms * SAMPLE_RATE / 1000.0f),
+            (uint32_t)(max_ms * SAMPLE_RATE / 1000.0f));
+    sim.Run(seconds);
+    uint32_t underruns = sim.exciter.Underruns();
+    printf("%-6s %5u triggers, %6u reads (%5u overtaken by a retrigger), %4u late starts, %u wrong samples, "
+           "%5u underruns / %5u early ends\n",
+           name, sim.triggers, sim.card.reads, sim.card.overtaken, sim.late_starts, sim.wrong, underruns,
+           sim.early_ends);
+    return sim.exciter.FileIndex() == 0 && sim.triggers > 0 && sim.late_starts == 0 && sim.wrong == 0
+        && sim.bad_ends == 0 && underruns == sim.early_ends
+        && (expect_underruns < 0 || (underruns > 0) == (expect_underruns > 0));
+}
+
+int main(int argc, char** argv) {
+    float                seconds = argc > 1 ? (float)atof(argv[1]) : 60.0f;
+    std::vector<int16_t> pcm     = WriteExciter("EXC_0.WAV");
+
+    // Underruns expected: 0 = never, 1 = yes, -1 = either (storm: load-dependent)
+    bool ok = RunCard("fast", pcm, seconds, 0.5f, 20.0f, 400.0f, 0);
+    ok      = RunCard("slow", pcm, seconds, 60.0f, 20.0f, 400.0f, 1) && ok;
+    ok      = RunCard("storm", pcm, seconds, 5.0f, 2.0f, 40.0f, -1) && ok;
+    remove("EXC_0.WAV");
+
+    bool gives_up = MalformedGivesUp(0xFFFFFFF8) && MalformedGivesUp(0xFFFFFFFF) && MalformedGivesUp(0x7FFFFFFF);
+    printf("FindWavData on chunk sizes 0xFFFFFFF8 / 0xFFFFFFFF / 0x7FFFFFFF: %s\n",
+           gives_up ? "rejected" : "ACCEPTED");
+    ok = ok && gives_up;
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,245 @@
+/*
+ * KEY SCAN CHECK - KeyScanner.h against a simulated 32-key instrument,
+ * on the host
+ *
+ * SIMULATION:
+ *   Contacts are modelled at the audio rate: random presses and holds,
+ *   KEY_BOUNCE_MS of contact bounce on make and on break, single-scan
+ *   glitches while keys are held, and chords (up to 8 keys in the same
+ *   millisecond). Every 1ms the keys are read the way the firmware does
+ *   it - through a 74HC165 chain (bytes, active low) - and, for the same
+ *   contacts, through a 4 x 8 diode matrix scanned row by row.
+ *
+ * WHAT IT CHECKS:
+ *   - one NOTE_ON per press and one NOTE_OFF per release, none from
+ *     bounce or glitches, none lost (queue never full)
+ *   - both sources give identical events
+ *   - latency from first contact to the event's due sample (debounce +
+ *     scan grid + the fixed event latency), and that every event is due
+ *     exactly KEY_LATENCY samples after a scan (no timing jitter)
+ *   - cost per scan: OnScan() for 32 keys against the firmware's old
+ *     per-button loop for 7
+ *
+ *   key_scan_check [seconds]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+#include "../KeyScanner.h"
+
+const uint32_t SAMPLE_RATE   = 48000;
+const uint32_t SCAN_SAMPLES  = 48;  // 1ms, as in the firmware
+const uint32_t KEY_LATENCY   = 8;   // Firmware MIDI_LATENCY
+const int      KEYS          = 32;
+const int      CHIPS         = 4;
+const int      ROWS          = 4;
+const int      COLS          = 8;
+const uint8_t  BASE_NOTE     = 53;
+const float    KEY_BOUNCE_MS = 2.5f;  // Longest bounce (must stay under 3 scans)
+const float    GLITCH_RATE   = 0.002f;  // Per held key per scan
+const int      COST_SCANS    = 2000000;
+
+// ============================================
+// Contacts
+// ============================================
+uint32_t rng = 12345;
+
+uint32_t Random(uint32_t n) {
+    rng = rng * 1664525u + 1013904223u;
+    return (rng >> 8) % n;
+}
+
+struct Press {
+    int      key;
+    uint32_t make;     // First contact (sample)
+    uint32_t release;  // First break (sample)
+};
+
+// Contact state of `p` at sample t: bouncing at either edge
+bool Closed(const Press& p, uint32_t t, uint32_t seed) {
+    uint32_t bounce = (uint32_t)(KEY_BOUNCE_MS * SAMPLE_RATE / 1000.0f);
+    if (t < p.make || t >= p.release + bounce) return false;
+    uint32_t edge   = t < p.release ? p.make : p.release;
+    bool     steady = t < p.release;
+    if (t - edge >= bounce) return steady;
+    // Deterministic chatter: 0.1ms cells, random open / closed
+    uint32_t cell = (t - edge) / 5 + seed * 7919u + edge;
+    cell          = cell * 2654435761u;
+    return (cell >> 29) & 1 ? steady : !steady;
+}
+
+std::vector<Press> MakePresses(uint32_t length) {
+    std::vector<Press> presses;
+    uint32_t           busy_until[KEYS] = {};
+    for (uint32_t t = SAMPLE_RATE / 10; t < length - SAMPLE_RATE; t += SAMPLE_RATE / 50 + Random(SAMPLE_RATE / 10)) {
+        int chord = Random(8) == 0 ? 2 + Random(7) : 1;
+        for (int c = 0; c < chord; c++) {
+            int key = Random(KEYS);
+            // 10ms clear of the key's last bounce
+            if (busy_until[key] > t) continue;
+            uint32_t hold = SAMPLE_RATE / 50 + Random(SAMPLE_RATE / 3);
+            presses.push_back({key, t + Random(SCAN_SAMPLES), t + hold});
+            busy_until[key] = t + hold + SAMPLE_RATE / 100 + (uint32_t)(KEY_BOUNCE_MS * SAMPLE_RATE / 1000.0f);
+        }
+    }
+    return presses;
+}
+
+// Raw key bits at sample t (glitches: one scan reads a held key open)
+uint32_t RawKeys(const std::vector<Press>& presses, uint32_t t, uint32_t* glitches) {
+    uint32_t bits = 0;
+    for (size_t i = 0; i < presses.size(); i++) {
+        const Press& p = presses[i];
+        if (!Closed(p, t, (uint32_t)i)) continue;
+        if (t >= p.make + SAMPLE_RATE / 100 && t + SAMPLE_RATE / 100 < p.release
+            && Random(1000000) < GLITCH_RATE * 1000000) {
+            (*glitches)++;
+            continue;
+        }
+        bits |= 1u << p.key;
+    }
+    return bits;
+}
+
+// ============================================
+// Readers: 74HC165 chain bytes, diode matrix rows
+// ============================================
+void ChainBytes(uint32_t keys, uint8_t* bytes) {
+    for (int c = 0; c < CHIPS; c++) bytes[c] = (uint8_t)~(keys >> (8 * c));  // Pulled up, key = low
+}
+
+uint32_t MatrixColumns(uint32_t keys, int row) {
+    return (keys >> (row * COLS)) & ((1u << COLS) - 1);
+}
+
+struct Heard {
+    uint32_t time;
+    bool     on;
+    int      key;
+};
+
+template <typename Scanner>
+void Drain(Scanner& scanner, std::vector<Heard>* heard) {
+    EngineEvent e;
+    while (scanner.Queue().Peek(&e)) {
+        scanner.Queue().Pop();
+        heard->push_back({e.time, e.type == EngineEvent::NOTE_ON, e.data1 - BASE_NOTE});
+    }
+}
+
+// ============================================
+// Cost per scan
+// ============================================
+volatile uint32_t sink;
+
+double ScannerCost() {
+    KeyScanner<64> scanner;
+    scanner.Init(KEYS, BASE_NOTE);
+    uint8_t bytes[CHIPS];
+    auto    start = std::chrono::steady_clock::now();
+    for (int s = 0; s < COST_SCANS; s++) {
+        ChainBytes(s & 0x40000 ? 0x00010000u : 0, bytes);  // A press every ~262k scans
+        scanner.OnScan(ShiftRegisterKeys(bytes, CHIPS), s);
+        EngineEvent e;
+        while (scanner.Queue().Peek(&e)) scanner.Queue().Pop();
+    }
+    std::chrono::duration<double, std::nano> t = std::chrono::steady_clock::now() - start;
+    return t.count() / COST_SCANS;
+}
+
+// The firmware's button loop for 7 GPIOs (reads stand in for GPIO::Read)
+double ButtonLoopCost() {
+    volatile bool pins[7] = {};
+    bool          state[7] = {};
+    auto          start    = std::chrono::steady_clock::now();
+    for (int s = 0; s < COST_SCANS; s++) {
+        pins[0] = (s & 0x40000) != 0;
+        for (int i = 0; i < 7; i++) {
+            bool current = pins[i];
+            if (current && !state[i]) sink = sink + i;
+            state[i] = current;
+        }
+    }
+    std::chrono::duration<double, std::nano> t = std::chrono::steady_clock::now() - start;
+    return t.count() / COST_SCANS;
+}
+
+int main(int argc, char** argv) {
+    float    seconds = argc > 1 ? (float)atof(argv[1]) : 120.0f;
+    uint32_t length  = (uint32_t)(seconds * SAMPLE_RATE);
+    std::vector<Press> presses = MakePresses(length);
+
+    KeyScanner<64>           chain, matrix;
+    KeyMatrix<ROWS, COLS>    rows;
+    std::vector<Heard>       chain_heard, matrix_heard;
+    uint32_t                 glitches = 0;
+    chain.Init(KEYS, BASE_NOTE);
+    matrix.Init(KEYS, BASE_NOTE);
+    rows.Init();
+
+    // Events are drained after every scan (the audio thread runs far
+    // more often than the scans)
+    for (uint32_t t = 0; t < length; t += SCAN_SAMPLES) {
+        uint32_t keys = RawKeys(presses, t, &glitches);
+        uint8_t  bytes[CHIPS];
+        ChainBytes(keys, bytes);
+        chain.OnScan(ShiftRegisterKeys(bytes, CHIPS), t + KEY_LATENCY);
+        Drain(chain, &chain_heard);
+
+        // Matrix: all rows within the same scan (rows ~1us apart)
+        bool complete = false;
+        while (!complete) complete = rows.Row(MatrixColumns(keys, rows.NextRow()));
+        matrix.OnScan(rows.Keys(), t + KEY_LATENCY);
+        Drain(matrix, &matrix_heard);
+    }
+
+    // Match presses to events: per key, in order
+    int      ons = 0, offs = 0, missing = 0, extra = 0, off_grid = 0;
+    double   latency_sum = 0.0, latency_max = 0.0, latency_min = 1e9;
+    size_t   next[KEYS] = {};
+    std::vector<std::vector<Heard>> per_key(KEYS);
+    for (const Heard& h : chain_heard) {
+        per_key[h.key].push_back(h);
+        if ((h.time - KEY_LATENCY) % SCAN_SAMPLES != 0) off_grid++;
+        (h.on ? ons : offs)++;
+    }
+    for (const Press& p : presses) {
+        std::vector<Heard>& events = per_key[p.key];
+        size_t&             i      = next[p.key];
+        if (i + 1 < events.size() && events[i].on && !events[i + 1].on) {
+            double ms   = (events[i].time - p.make) * 1000.0 / SAMPLE_RATE;
+            latency_sum += ms;
+            latency_max = ms > latency_max ? ms : latency_max;
+            latency_min = ms < latency_min ? ms : latency_min;
+            i += 2;
+        } else {
+            missing++;
+        }
+    }
+    for (int k = 0; k < KEYS; k++) extra += (int)(per_key[k].size() - next[k]);
+
+    bool same = chain_heard.size() == matrix_heard.size();
+    for (size_t i = 0; same && i < chain_heard.size(); i++) {
+        same = chain_heard[i].time == matrix_heard[i].time && chain_heard[i].on == matrix_heard[i].on
+               && chain_heard[i].key == matrix_heard[i].key;
+    }
+
+    printf("%.0fs, %zu presses on %d keys, %u glitches, %.1fms bounce\n", seconds, presses.size(), KEYS, glitches,
+           KEY_BOUNCE_MS);
+    printf("    events: %d on, %d off, %d presses missing, %d extra, %u dropped\n", ons, offs, missing, extra,
+           chain.Dropped());
+    printf("    latency (first contact to due sample): min %.2fms, mean %.2fms, max %.2fms\n", latency_min,
+           presses.empty() ? 0.0 : latency_sum / (presses.size() - missing), latency_max);
+    printf("    events off the scan grid: %d, chain vs matrix: %s\n", off_grid, same ? "identical" : "DIFFERENT");
+    printf("    cost per scan: %.1fns for %d keys (OnScan), %.1fns for 7 buttons (old loop)\n", ScannerCost(), KEYS,
+           ButtonLoopCost());
+
+    bool ok = missing == 0 && extra == 0 && off_grid == 0 && same && chain.Dropped() == 0
+              && latency_max < (KEY_DEBOUNCE_SCANS + 1) * SCAN_SAMPLES * 1000.0 / SAMPLE_RATE + KEY_BOUNCE_MS;
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
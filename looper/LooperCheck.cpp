@@ -0,0 +1,216 @@
+/*
+ * LOOPER CHECK - Looper.h against a sample-by-sample model, on the host
+ *
+ * MODEL:
+ *   The same looper written the slow way: one sample at a time, the
+ *   position wrapped with a modulo, the undo layer a copy of the loop
+ *   taken when the overdub starts. Looper.h splits blocks at the loop end
+ *   and saves undo samples as it goes; every output sample and the loop
+ *   layer must match the model bit for bit.
+ *
+ * WHAT IT CHECKS (random block sizes 1..MAX_BLOCK, odd ones included, so
+ * the loop end falls anywhere in a block):
+ *   - the loop closes on the block boundary where it was pressed and
+ *     wraps on the exact sample, lap after lap
+ *   - recording into the full buffer closes the loop at max length inside
+ *     the block, and the rest of that block already plays the loop
+ *   - overdub passes of under one lap, one lap and several laps: Undo()
+ *     returns the loop exactly as it was before the pass, restored by CPU
+ *     chunks and through MemOps (plain memcpy on the host)
+ *
+ *   looper_check [trials]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "../Looper.h"
+
+const size_t MAX_LEN   = 48000;  // 1s buffers: small enough to fill often
+const size_t MAX_BLOCK = 97;
+
+// ============================================
+// Input and block sizes
+// ============================================
+uint32_t rng = 7777;
+
+uint32_t Next() {
+    rng = rng * 1664525u + 1013904223u;
+    return rng >> 8;
+}
+
+float Noise() { return (Next() & 0xFFFF) * (1.0f / 65536.0f) - 0.5f; }
+
+size_t Block() { return 1 + Next() % MAX_BLOCK; }
+
+// ============================================
+// Sample-by-sample model
+// ============================================
+struct Model {
+    std::vector<float> loop, undo;
+    size_t             length = 0, pos = 0;
+    Looper::State      state  = Looper::State::EMPTY;
+
+    Model() : loop(MAX_LEN, 0.0f), undo(MAX_LEN, 0.0f) {}
+
+    void Press() {
+        switch (state) {
+            case Looper::State::EMPTY: pos = 0; state = Looper::State::RECORDING; break;
+            case Looper::State::RECORDING: length = pos; pos = 0; state = Looper::State::PLAYING; break;
+            case Looper::State::PLAYING:
+                undo  = loop;  // Everything the pass may touch
+                state = Looper::State::OVERDUBBING;
+                break;
+            case Looper::State::OVERDUBBING: state = Looper::State::PLAYING; break;
+        }
+    }
+
+    void Undo() {
+        state = Looper::State::PLAYING;
+        loop  = undo;
+    }
+
+    float Sample(float in) {
+        switch (state) {
+            case Looper::State::EMPTY: return in;
+            case Looper::State::RECORDING:
+                loop[pos++] = in;
+                if (pos == MAX_LEN) {
+                    length = MAX_LEN;
+                    pos    = 0;
+                    state  = Looper::State::PLAYING;
+                }
+                return in;
+            case Looper::State::PLAYING: {
+                float old = loop[pos];
+                pos       = (pos + 1) % length;
+                return in + old;
+            }
+            case Looper::State::OVERDUBBING: {
+                float old = loop[pos];
+                loop[pos] = old + in;
+                pos       = (pos + 1) % length;
+                return in + old;
+            }
+        }
+        return in;
+    }
+};
+
+// ============================================
+// Run both side by side
+// ============================================
+struct Pair {
+    std::vector<float> loop_buf, undo_buf;
+    Looper             looper;
+    Model              model;
+    MemOps             mem_ops;
+    size_t             mismatches = 0;
+
+    explicit Pair(bool use_mem_ops) : loop_buf(MAX_LEN), undo_buf(MAX_LEN) {
+        looper.Init(loop_buf.data(), undo_buf.data(), MAX_LEN);
+        mem_ops.Init();
+        if (use_mem_ops) looper.SetMemOps(&mem_ops);
+    }
+
+    void Press() {
+        looper.RecordPress();
+        model.Press();
+    }
+
+    // `samples` of noise in random blocks
+    void Run(size_t samples) {
+        float io[MAX_BLOCK], expected[MAX_BLOCK];
+        while (samples > 0) {
+            size_t n = Block();
+            if (n > samples) n = samples;
+            for (size_t k = 0; k < n; k++) {
+                io[k]       = Noise();
+                expected[k] = model.Sample(io[k]);
+            }
+            looper.Process(io, n);
+            for (size_t k = 0; k < n; k++) mismatches += io[k] != expected[k];
+            samples -= n;
+        }
+    }
+
+    void Undo() {
+        looper.Undo();
+        model.Undo();
+        while (looper.UndoPending()) looper.Service();
+    }
+
+    bool LoopMatches() const {
+        return memcmp(loop_buf.data(), model.loop.data(), model.length * sizeof(float)) == 0;
+    }
+
+    bool StateMatches() const {
+        return looper.GetState() == model.state && looper.GetLength() == model.length
+            && looper.GetPosition() == model.pos;
+    }
+};
+
+// Record a loop of about `samples`, play it, then overdub `laps` and undo
+bool Trial(size_t samples, float laps, bool use_mem_ops) {
+    Pair pair(use_mem_ops);
+    pair.Press();
+    pair.Run(samples);  // Random blocks: the loop closes wherever they end
+    pair.Press();
+    pair.Run(3 * pair.model.length + Block());  // Plays through the loop end
+    bool ok = pair.StateMatches();
+
+    std::vector<float> before = pair.model.loop;
+    pair.Press();
+    pair.Run((size_t)(laps * pair.model.length));
+    pair.Press();
+    pair.Run(Block());
+    ok = ok && pair.StateMatches() && pair.LoopMatches();
+
+    pair.Undo();
+    ok = ok && pair.LoopMatches() && pair.model.loop == before;
+    pair.Run(2 * pair.model.length);
+    ok = ok && pair.StateMatches() && pair.mismatches == 0;
+    if (!ok) {
+        printf("    FAIL: %zu samples, %.2f laps%s: %zu output mismatches\n", samples, laps,
+               use_mem_ops ? " (MemOps)" : "", pair.mismatches);
+    }
+    return ok;
+}
+
+// Record into the full buffer: it closes itself inside a block
+bool MaxLength() {
+    Pair pair(false);
+    pair.Press();
+    pair.Run(MAX_LEN + 5 * MAX_BLOCK);
+    pair.Run(2 * MAX_LEN);
+    bool ok = pair.StateMatches() && pair.looper.GetLength() == MAX_LEN && pair.mismatches == 0;
+    printf("max length: loop closed at %zu samples, %zu output mismatches\n", pair.looper.GetLength(),
+           pair.mismatches);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    int  trials = argc > 1 ? atoi(argv[1]) : 200;
+    bool ok     = MaxLength();
+
+    const float laps[] = {0.3f, 1.0f, 2.0f, 3.7f};
+    int         failed = 0, runs = 0;
+    for (int t = 0; t < trials; t++) {
+        size_t samples = 1 + Next() % (MAX_LEN - 1);
+        for (float l : laps) {
+            for (int m = 0; m < 2; m++) {
+                failed += !Trial(samples, l, m == 1);
+                runs++;
+            }
+        }
+    }
+    printf("%d loops of 1..%zu samples in blocks of 1..%zu, overdubs of 0.3 / 1 / 2 / 3.7 laps + undo"
+           " (CPU / MemOps): %d of %d failed\n",
+           trials, MAX_LEN, MAX_BLOCK, failed, runs);
+    ok = ok && failed == 0;
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,401 @@
+/*
+ * MIDI CHECK - a Standard MIDI File replayed through MidiInput.h, on the
+ * host
+ *
+ * SIMULATION (as on the Daisy):
+ *   The file's messages go out over a 31250 baud wire (320us per byte,
+ *   running status on the wire too, so chords spread out), and every
+ *   byte reaches MidiInput::RxCallback() at the time its stop bit ends,
+ *   with the 200MHz tick counter as System::GetTick(). The audio callback
+ *   runs every 4 samples: SampleClock::OnBlock(), then the firmware's
+ *   segment loop - events applied when due, SamplesUntilNextEvent() to
+ *   find where the next segment ends. The codec clock runs 50ppm fast of
+ *   nominal, and the tick counter and the sample count both wrap during
+ *   the replay.
+ *
+ * WHAT IT CHECKS:
+ *   - every note on/off and CC in the file comes out, in order, nothing
+ *     dropped (program changes, pitch bend and SysEx are not events)
+ *   - every event is applied on exactly the sample it was stamped for
+ *   - trigger sample minus the file's timestamp is the fixed latency plus
+ *     the wire time, within a sample: no block quantisation, no drift
+ *
+ *   midi_check [file.mid]     (default: a generated two-track file with
+ *                              tempo changes, chords and CC sweeps)
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "../MidiInput.h"
+
+const float    SAMPLE_RATE  = 48000.0f;
+const double   CODEC_PPM    = 50.0;                // Real audio clock vs nominal
+const uint32_t TICK_FREQ    = 200000000;           // System::GetTickFreq()
+const size_t   BLOCK        = 4;                   // Firmware AUDIO_BLOCK_SIZE
+const uint32_t LATENCY      = 2 * BLOCK;           // Firmware MIDI_LATENCY
+const double   BYTE_SECONDS = 10.0 / 31250.0;      // Start + 8 data + stop bits
+const uint32_t SAMPLE_START = 0xFFF00000;          // Wraps after ~22s
+const uint32_t TICK_START   = 0xFFFFFFFF - 400000000;  // Wraps after 2s
+const char*    GENERATED    = "midi_check.mid";
+
+typedef MidiInput<64> Midi;  // Firmware MIDI_QUEUE_SIZE
+
+// ============================================
+// Generated test file
+// ============================================
+uint32_t rng = 4242;
+
+uint32_t Next() {
+    rng = rng * 1664525u + 1013904223u;
+    return rng >> 8;
+}
+
+void PutVarLen(std::vector<uint8_t>& t, uint32_t v) {
+    uint8_t b[5];
+    int     n = 0;
+    do {
+        b[n++] = v & 0x7F;
+        v >>= 7;
+    } while (v);
+    while (n > 1) t.push_back(b[--n] | 0x80);
+    t.push_back(b[0]);
+}
+
+void PutChunk(FILE* f, const char* id, const std::vector<uint8_t>& data) {
+    uint32_t n    = (uint32_t)data.size();
+    uint8_t  h[8] = {(uint8_t)id[0], (uint8_t)id[1], (uint8_t)id[2], (uint8_t)id[3],
+                    (uint8_t)(n >> 24), (uint8_t)(n >> 16), (uint8_t)(n >> 8), (uint8_t)n};
+    fwrite(h, 1, 8, f);
+    fwrite(data.data(), 1, n, f);
+}
+
+// Format 1: track 0 the tempo map, track 1 the playing (running status,
+// Note On velocity 0 as note off, chords, CC sweeps, things to skip)
+void WriteTestFile(const char* path) {
+    const uint32_t PPQ = 480;
+    std::vector<uint8_t> tempo, play;
+
+    const uint32_t tempos[] = {500000, 400000, 666667, 300000};  // 120, 150, 90, 200 bpm
+    for (int i = 0; i < 4; i++) {
+        PutVarLen(tempo, i == 0 ? 0 : 16 * PPQ);
+        uint8_t meta[] = {0xFF, 0x51, 0x03, (uint8_t)(tempos[i] >> 16), (uint8_t)(tempos[i] >> 8),
+                          (uint8_t)tempos[i]};
+        tempo.insert(tempo.end(), meta, meta + 6);
+    }
+    PutVarLen(tempo, 0);
+    tempo.insert(tempo.end(), {0xFF, 0x2F, 0x00});
+
+    uint8_t  status = 0;
+    uint32_t delta  = 0;
+    auto     msg    = [&](uint8_t s, uint8_t d1, int d2) {
+        PutVarLen(play, delta);
+        delta = 0;
+        if (s != status) play.push_back(s);
+        status = s;
+        play.push_back(d1);
+        if (d2 >= 0) play.push_back((uint8_t)d2);
+    };
+
+    const uint32_t gaps[] = {1, 15, 30, 60, 120, 240, 480};
+    uint32_t       ticks  = 0;
+    while (ticks < 64 * PPQ) {
+        uint32_t r = Next() % 16;
+        if (r < 9) {
+            // Chord of 1-5 notes on one tick, released together later
+            int     n = 1 + Next() % 5;
+            uint8_t notes[5];
+            for (int k = 0; k < n; k++) {
+                notes[k] = (uint8_t)(48 + Next() % 36);
+                msg(0x90, notes[k], 1 + Next() % 127);
+            }
+            delta = gaps[Next() % 7];
+            ticks += delta;
+            for (int k = 0; k < n; k++) {
+                if (k == 1) msg(0x80, notes[k], 64);  // Mixed: real note offs too
+                else msg(0x90, notes[k], 0);
+            }
+        } else if (r < 13) {
+            // CC sweep, one value every tick or two
+            uint8_t cc = (uint8_t)(70 + Next() % 23);
+            for (int v = 0; v < 128; v += 8) {
+                msg(0xB0, cc, v);
+                delta = 1 + Next() % 2;
+                ticks += delta;
+            }
+        } else if (r == 13) {
+            msg(0xC0, (uint8_t)(Next() % 128), -1);  // Program change
+        } else if (r == 14) {
+            msg(0xE0, 0, (uint8_t)(Next() % 128));   // Pitch bend
+        } else {
+            // SysEx event in the file (not sent: the firmware only takes
+            // text SysEx, and a file's SysEx is not a note)
+            PutVarLen(play, delta);
+            delta  = 0;
+            status = 0;  // SysEx cancels running status
+            play.insert(play.end(), {0xF0, 0x03, 0x7E, 0x00, 0xF7});
+        }
+        uint32_t gap = gaps[Next() % 7];
+        delta += gap;
+        ticks += gap;
+    }
+    PutVarLen(play, delta);
+    play.insert(play.end(), {0xFF, 0x2F, 0x00});
+
+    FILE* f = fopen(path, "wb");
+    PutChunk(f, "MThd", {0, 1, 0, 2, (uint8_t)(PPQ >> 8), (uint8_t)PPQ});
+    PutChunk(f, "MTrk", tempo);
+    PutChunk(f, "MTrk", play);
+    fclose(f);
+}
+
+// ============================================
+// Standard MIDI File reader
+// ============================================
+struct FileEvent {
+    uint64_t             tick;
+    int                  track;
+    bool                 tempo;  // Else a channel message
+    uint32_t             usec_per_quarter;
+    std::vector<uint8_t> bytes;  // Full status + data
+    double               seconds;
+};
+
+uint32_t Get32(const uint8_t* p) { return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3]; }
+
+bool ReadVarLen(const std::vector<uint8_t>& d, size_t end, size_t* i, uint32_t* v) {
+    *v = 0;
+    for (int n = 0; n < 4; n++) {
+        if (*i >= end) return false;
+        uint8_t b = d[(*i)++];
+        *v        = *v << 7 | (b & 0x7F);
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+bool ReadFile(const char* path, std::vector<FileEvent>* events) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    std::vector<uint8_t> d;
+    uint8_t              buf[4096];
+    size_t               n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) d.insert(d.end(), buf, buf + n);
+    fclose(f);
+
+    if (d.size() < 14 || memcmp(&d[0], "MThd", 4) != 0) return false;
+    uint32_t division = d[12] << 8 | d[13];
+    if (division & 0x8000) return false;  // SMPTE time: not supported
+    size_t pos   = 8 + Get32(&d[4]);
+    int    track = 0;
+    while (pos + 8 <= d.size()) {
+        size_t end = pos + 8 + Get32(&d[pos + 4]);
+        if (end > d.size()) return false;
+        if (memcmp(&d[pos], "MTrk", 4) != 0) {
+            pos = end;
+            continue;
+        }
+        size_t   i      = pos + 8;
+        uint64_t tick   = 0;
+        uint8_t  status = 0;
+        while (i < end) {
+            uint32_t delta;
+            if (!ReadVarLen(d, end, &i, &delta)) return false;
+            tick += delta;
+            uint8_t b = d[i];
+            if (b == 0xFF) {
+                if (i + 2 > end) return false;
+                uint8_t  type = d[i + 1];
+                uint32_t len;
+                i += 2;
+                if (!ReadVarLen(d, end, &i, &len) || i + len > end) return false;
+                if (type == 0x51 && len == 3) {
+                    FileEvent e = {tick, track, true, (uint32_t)(d[i] << 16 | d[i + 1] << 8 | d[i + 2]), {}, 0.0};
+                    events->push_back(e);
+                }
+                i += len;
+                if (type == 0x2F) break;
+                continue;
+            }
+            if (b == 0xF0 || b == 0xF7) {
+                uint32_t len;
+                i++;
+                if (!ReadVarLen(d, end, &i, &len) || i + len > end) return false;
+                i += len;
+                status = 0;
+                continue;
+            }
+            if (b & 0x80) {
+                status = b;
+                i++;
+            }
+            if (status == 0) return false;
+            uint8_t kind = status & 0xF0;
+            size_t  len  = (kind == 0xC0 || kind == 0xD0) ? 1 : 2;
+            if (i + len > end) return false;
+            FileEvent e = {tick, track, false, 0, {status}, 0.0};
+            e.bytes.insert(e.bytes.end(), &d[i], &d[i] + len);
+            events->push_back(e);
+            i += len;
+        }
+        pos = end;
+        track++;
+    }
+
+    // Merge the tracks, then the tempo map turns ticks into seconds
+    std::stable_sort(events->begin(), events->end(), [](const FileEvent& a, const FileEvent& b) {
+        return a.tick != b.tick ? a.tick < b.tick : a.tempo > b.tempo;
+    });
+    double   seconds = 0.0, per_tick = 500000e-6 / division;
+    uint64_t last    = 0;
+    for (FileEvent& e : *events) {
+        seconds += (e.tick - last) * per_tick;
+        last      = e.tick;
+        e.seconds = seconds;
+        if (e.tempo) per_tick = e.usec_per_quarter * 1e-6 / division;
+    }
+    events->erase(std::remove_if(events->begin(), events->end(), [](const FileEvent& e) { return e.tempo; }),
+                  events->end());
+    return true;
+}
+
+// ============================================
+// Replay
+// ============================================
+struct Byte {
+    double  seconds;  // Stop bit ends
+    uint8_t value;
+    int     message;  // Index of the message this byte completes, else -1
+};
+
+struct Expected {
+    EngineEvent::Type type;
+    uint8_t           data1, data2;
+    double            file_seconds;
+    double            arrival_seconds;
+};
+
+Midi        midi;
+SampleClock sample_clock;
+uint32_t    tick_now = 0;
+
+uint32_t GetTick() { return tick_now; }
+
+int main(int argc, char** argv) {
+    const char* path = argc > 1 ? argv[1] : GENERATED;
+    if (argc <= 1) WriteTestFile(GENERATED);
+    std::vector<FileEvent> file;
+    if (!ReadFile(path, &file)) {
+        printf("%s: not a readable Standard MIDI File\n", path);
+        printf("FAIL\n");
+        return 1;
+    }
+
+    // The wire: messages go out back to back at 31250 baud
+    std::vector<Byte>     wire;
+    std::vector<Expected> expected;
+    double                free_at = 0.0, max_wire = 0.0;
+    uint8_t               running = 0;
+    for (const FileEvent& e : file) {
+        double t    = std::max(e.seconds, free_at);
+        bool   skip = e.bytes[0] == running;
+        running     = e.bytes[0];
+        for (size_t k = skip ? 1 : 0; k < e.bytes.size(); k++) {
+            t += BYTE_SECONDS;
+            wire.push_back({t, e.bytes[k], -1});
+        }
+        free_at  = t;
+        max_wire = std::max(max_wire, t - e.seconds);
+
+        uint8_t kind = e.bytes[0] & 0xF0;
+        if (kind != 0x80 && kind != 0x90 && kind != 0xB0) continue;
+        Expected x;
+        x.type = kind == 0xB0                     ? EngineEvent::CONTROL_CHANGE
+               : kind == 0x90 && e.bytes[2] > 0 ? EngineEvent::NOTE_ON
+                                                : EngineEvent::NOTE_OFF;
+        x.data1           = e.bytes[1];
+        x.data2           = e.bytes[2];
+        x.file_seconds    = e.seconds;
+        x.arrival_seconds = t;
+        wire.back().message = (int)expected.size();
+        expected.push_back(x);
+    }
+
+    sample_clock.Init(SAMPLE_RATE, TICK_FREQ);
+    midi.Init(&sample_clock, GetTick, LATENCY);
+
+    const double real_rate = SAMPLE_RATE * (1.0 + CODEC_PPM * 1e-6);
+    double       end       = (wire.empty() ? 0.0 : wire.back().seconds) + 0.1;
+    size_t       next_byte = 0, got = 0, out_of_order = 0, off_sample = 0, segments = 0;
+    double       err_min = 1e9, err_max = -1e9, jit_min = 1e9, jit_max = -1e9, err_sum = 0.0;
+    uint32_t     sample  = SAMPLE_START;
+
+    for (uint64_t b = 0;; b++) {
+        double block_seconds = b * BLOCK / real_rate;
+        if (block_seconds > end) break;
+
+        // Bytes that arrived since the last callback, each its own interrupt
+        while (next_byte < wire.size() && wire[next_byte].seconds < block_seconds) {
+            tick_now = TICK_START + (uint32_t)(uint64_t)(wire[next_byte].seconds * TICK_FREQ);
+            Midi::RxCallback(&wire[next_byte].value, 1, &midi);
+            next_byte++;
+        }
+
+        // Audio callback
+        tick_now = TICK_START + (uint32_t)(uint64_t)(block_seconds * TICK_FREQ);
+        sample_clock.OnBlock(tick_now, sample);
+        size_t done = 0;
+        while (done < BLOCK) {
+            uint32_t    now = sample + (uint32_t)done;
+            EngineEvent e;
+            while (midi.Queue().Peek(&e) && EventDue(e.time, now)) {
+                midi.Queue().Pop();
+                off_sample += e.time != now;
+                if (got >= expected.size() || e.type != expected[got].type || e.data1 != expected[got].data1
+                    || (e.type != EngineEvent::NOTE_OFF && e.data2 != expected[got].data2)) {
+                    out_of_order++;
+                    got++;
+                    continue;
+                }
+                // Trigger sample against the file's timestamp (and against
+                // the arrival of its last byte on the wire)
+                double at  = (double)(int32_t)(now - SAMPLE_START);
+                double err = at - expected[got].file_seconds * real_rate;
+                double jit = at - (expected[got].arrival_seconds * real_rate + LATENCY);
+                err_min    = std::min(err_min, err);
+                err_max    = std::max(err_max, err);
+                err_sum += err;
+                jit_min = std::min(jit_min, jit);
+                jit_max = std::max(jit_max, jit);
+                got++;
+            }
+            size_t n = SamplesUntilNextEvent(midi.Queue(), now, BLOCK - done);
+            done += n;
+            segments++;
+        }
+        sample += BLOCK;
+    }
+
+    double ms = 1000.0 / real_rate;
+    printf("%s: %zu messages, %zu events over %.1fs (wire up to %.2fms behind the file)\n", path, file.size(),
+           expected.size(), file.empty() ? 0.0 : file.back().seconds, max_wire * 1000.0);
+    printf("applied %zu of %zu events, %zu out of order, %zu off their stamped sample, %u dropped, "
+           "%.3f segments per block\n",
+           got, expected.size(), out_of_order, off_sample, midi.Dropped(),
+           segments / (double)((uint64_t)(end * real_rate) / BLOCK));
+    if (got > 0) {
+        printf("trigger - file time: %.2f .. %.2f samples (mean %.2f, = %.3f .. %.3fms)\n", err_min, err_max,
+               err_sum / got, err_min * ms, err_max * ms);
+        printf("trigger - (last byte + %u samples latency): %.2f .. %.2f samples\n", LATENCY, jit_min, jit_max);
+    }
+    if (argc <= 1) remove(GENERATED);
+
+    bool ok = got == expected.size() && out_of_order == 0 && off_sample == 0 && midi.Dropped() == 0
+           && (got == 0 || (jit_min > -1.001 && jit_max <= 1.0));
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
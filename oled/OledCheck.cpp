@@ -0,0 +1,345 @@
+/*
+ * OLED CHECK - OledPages.h over modelled I2C and SPI + DMA buses, on the
+ * host
+ *
+ * FRAMES:
+ *   "status" is the firmware's status screen at its 10 frames/s: the
+ *   same text lines (a stand-in 6x8 font), level bars that jump on
+ *   plucks and decay, a parameter line that changes while a pot turns.
+ *   "scope" redraws a moving waveform over the whole screen, 30 frames/s.
+ *
+ * BUSES (fake transports: bytes and modelled time per transfer):
+ *   I2C   400kHz, blocking: start + address + control byte + 9 bits per
+ *         byte + stop per transaction
+ *   SPI   SPI_HZ, commands blocking, display data by DMA: the CPU pays
+ *         the setup and the copy into the DMA buffer, not the bus time
+ *   "stock" is libDaisy's SSD130x driver on I2C: every page on every
+ *   Update(), 3 one-byte command transactions per page.
+ *
+ * WHAT IT CHECKS:
+ *   - what the panel shows after every frame (a GDDRAM model fed by the
+ *     command / data stream) is the frame drawn
+ *   - bytes, bus time and CPU time per frame for each bus and screen
+ *
+ *   oled_check [seconds]
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../OledPages.h"
+
+const double I2C_HZ        = 400e3;
+const double SPI_HZ        = 6.25e6;  // Firmware: PS_32, under the SSD1306's 10MHz
+const double SPI_SELECT_S  = 1e-6;    // CS / DC GPIO writes around a transfer
+const double DMA_SETUP_S   = 2e-6;    // Start a DMA transfer (HAL)
+const double COPY_S_PER_B  = 1e-9;    // Copy into the DMA buffer (M7 memcpy)
+const int    WIDTH         = 128;
+const int    HEIGHT        = 64;
+const float  STATUS_FPS    = 10.0f;   // DISPLAY_UPDATE_INTERVAL
+const float  SCOPE_FPS     = 30.0f;
+
+// ============================================
+// Panel model: GDDRAM written by commands + data
+// ============================================
+struct Panel {
+    uint8_t ram[WIDTH * HEIGHT / 8];
+    int     col_start = 0, col_end = WIDTH - 1, page_start = 0, page_end = HEIGHT / 8 - 1;
+    int     col = 0, page = 0;
+    uint8_t pending = 0;  // Command waiting for arguments
+    int     args = 0, arg[2];
+
+    void Command(uint8_t b) {
+        if (args > 0) {
+            arg[2 - args] = b;
+            if (--args == 0) Apply();
+            return;
+        }
+        pending = b;
+        switch (b) {
+            case 0x21: case 0x22: args = 2; break;  // Column / page window
+            case 0x20: case 0xD5: case 0xA8: case 0xD3: case 0x8D:
+            case 0xDA: case 0x81: case 0xD9: case 0xDB: args = 1; break;
+            default: break;  // No arguments
+        }
+        if (args == 2) arg[0] = arg[1] = 0;
+    }
+
+    void Apply() {
+        if (pending == 0x21) {
+            col_start = col = arg[0];
+            col_end   = arg[1];
+        } else if (pending == 0x22) {
+            page_start = page = arg[0];
+            page_end   = arg[1];
+        }
+    }
+
+    // Horizontal addressing
+    void Data(uint8_t b) {
+        ram[page * WIDTH + col] = b;
+        if (++col > col_end) {
+            col = col_start;
+            if (++page > page_end) page = page_start;
+        }
+    }
+};
+
+// ============================================
+// Fake transports
+// ============================================
+struct BusStats {
+    double bytes = 0, transfers = 0, bus_s = 0, cpu_s = 0;
+    void   Reset() { *this = BusStats(); }
+};
+
+BusStats i2c_stats, spi_stats;
+Panel    i2c_panel, spi_panel;
+
+struct FakeI2c {
+    struct Config {};
+    static const bool ONE_WINDOW = false;
+    static bool Busy() { return false; }
+    void Init(const Config&) {}
+    void Commands(const uint8_t* bytes, size_t n) {
+        for (size_t i = 0; i < n; i++) i2c_panel.Command(bytes[i]);
+        Transaction(n);
+    }
+    void Data(const uint8_t* bytes, size_t n) {
+        for (size_t i = 0; i < n; i++) i2c_panel.Data(bytes[i]);
+        Transaction(n);
+    }
+    static void Transaction(size_t n) {
+        double s = (1 + 9 + 9 + 9.0 * n + 1) / I2C_HZ;
+        i2c_stats.bytes += n + 2;  // Address, control byte
+        i2c_stats.transfers++;
+        i2c_stats.bus_s += s;
+        i2c_stats.cpu_s += s;  // Blocking
+    }
+};
+
+struct FakeSpiDma {
+    struct Config {};
+    static const bool ONE_WINDOW = true;
+    static bool Busy() { return false; }  // Bus time is counted, not waited for
+    void Init(const Config&) {}
+    void Commands(const uint8_t* bytes, size_t n) {
+        for (size_t i = 0; i < n; i++) spi_panel.Command(bytes[i]);
+        double s = 8.0 * n / SPI_HZ + SPI_SELECT_S;
+        spi_stats.bytes += n;
+        spi_stats.transfers++;
+        spi_stats.bus_s += s;
+        spi_stats.cpu_s += s;  // Blocking
+    }
+    void Data(const uint8_t* bytes, size_t n) {
+        for (size_t i = 0; i < n; i++) spi_panel.Data(bytes[i]);
+        spi_stats.bytes += n;
+        spi_stats.transfers++;
+        spi_stats.bus_s += 8.0 * n / SPI_HZ + SPI_SELECT_S;
+        spi_stats.cpu_s += SPI_SELECT_S + DMA_SETUP_S + n * COPY_S_PER_B;
+    }
+};
+
+// ============================================
+// Drawing (the firmware uses libDaisy's OledDisplay on top)
+// ============================================
+uint32_t rng = 99;
+
+float Uniform(float lo, float hi) {
+    rng = rng * 1664525u + 1013904223u;
+    return lo + (hi - lo) * (rng >> 8) * (1.0f / 16777216.0f);
+}
+
+// Any glyph that differs per character will do: 5 columns of 7 rows
+template <typename Driver>
+void Text(Driver& d, int x, int y, const char* s) {
+    for (; *s; s++, x += 6) {
+        if (*s == ' ') continue;
+        for (int c = 0; c < 5; c++) {
+            uint32_t h    = (uint32_t)(*s * 7 + c) * 2654435761u;
+            uint8_t  bits = (uint8_t)(h >> 24) & 0x7F;
+            for (int r = 0; r < 7; r++) d.DrawPixel(x + c, y + r, bits >> r & 1);
+        }
+    }
+}
+
+template <typename Driver>
+void Rect(Driver& d, int x0, int y0, int x1, int y1) {
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) d.DrawPixel(x, y, true);
+    }
+}
+
+template <typename Driver>
+void Line(Driver& d, int x0, int y0, int x1, int y1) {
+    int steps = abs(x1 - x0) > abs(y1 - y0) ? abs(x1 - x0) : abs(y1 - y0);
+    for (int i = 0; i <= steps; i++) {
+        float t = steps ? (float)i / steps : 0.0f;
+        d.DrawPixel((int)(x0 + t * (x1 - x0) + 0.5f), (int)(y0 + t * (y1 - y0) + 0.5f), true);
+    }
+}
+
+// Status screen state, stepped once per frame
+struct Status {
+    float level[7] = {};
+    float decay    = 0.8f;
+    float mix      = 30.0f;
+    int   turning  = 0;  // Frames a pot keeps moving
+
+    void Step() {
+        for (float& l : level) l *= 0.85f;
+        if (Uniform(0.0f, 1.0f) < 0.3f) level[(int)Uniform(0.0f, 6.99f)] = Uniform(0.5f, 1.0f);
+        if (turning == 0 && Uniform(0.0f, 1.0f) < 0.02f) turning = (int)Uniform(5.0f, 20.0f);
+        if (turning > 0) {
+            turning--;
+            decay += Uniform(-0.02f, 0.02f);
+            mix += Uniform(-2.0f, 2.0f);
+        }
+    }
+
+    template <typename Driver>
+    void Draw(Driver& d) const {
+        char line[32];
+        d.Fill(false);
+        Text(d, 0, 0, "SCALE:Pentatonic");
+        Text(d, 0, 10, "Octave: +0");
+        Text(d, 0, 22, "Btns:");
+        for (int i = 0; i < 7; i++) {
+            int x = 36 + i * 7, bar = (int)(level[i] * 8.0f);
+            if (bar > 0) Rect(d, x, 29 - bar + 1, x + 4, 29);
+            else d.DrawPixel(x + 2, 29, true);
+        }
+        Text(d, 0, 32, "C4 D4 E4 G4");
+        Text(d, 0, 40, "A4 C5 D5");
+        snprintf(line, sizeof(line), "Dcy:%.2f RvbMix:%.0f%%", decay, mix);
+        Text(d, 0, 50, line);
+        Text(d, 0, 58, "RvbTime:0.85 Brt:0.80");
+    }
+};
+
+template <typename Driver>
+void DrawScope(Driver& d, int frame) {
+    d.Fill(false);
+    Text(d, 0, 0, "SCOPE x1.0");
+    int prev = 0;
+    for (int x = 0; x < WIDTH; x++) {
+        float v = sinf(x * 0.15f + frame * 0.7f) * expf(-0.01f * (frame % 40)) + 0.1f * sinf(x * 0.9f);
+        int   y = 38 - (int)(v * 24.0f);
+        if (x > 0) Line(d, x - 1, prev, x, y);
+        prev = y;
+    }
+}
+
+// ============================================
+// Runs
+// ============================================
+struct Result {
+    double pages = 0, bytes = 0, bus_s = 0, cpu_s = 0;
+    int    frames = 0, mismatches = 0;
+};
+
+template <typename Driver>
+bool Shown(const Driver& d, const Panel& panel) {
+    // The driver's frame, drawn again from the pixels
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < WIDTH; x++) {
+            bool on = panel.ram[(y / 8) * WIDTH + x] >> (y % 8) & 1;
+            if (on != d.Pixel(x, y)) return false;
+        }
+    }
+    return true;
+}
+
+// Driver + a pixel readback for the comparison
+template <typename Transport>
+struct Checked : PagedOledDriver<WIDTH, HEIGHT, Transport> {
+    uint8_t pixels[WIDTH * HEIGHT];
+    void    DrawPixel(int x, int y, bool on) {
+        if (x < 0 || y < 0 || x >= WIDTH || y >= HEIGHT) return;
+        pixels[y * WIDTH + x] = on;
+        PagedOledDriver<WIDTH, HEIGHT, Transport>::DrawPixel(x, y, on);
+    }
+    void Fill(bool on) {
+        memset(pixels, on, sizeof(pixels));
+        PagedOledDriver<WIDTH, HEIGHT, Transport>::Fill(on);
+    }
+    bool Pixel(int x, int y) const { return pixels[y * WIDTH + x]; }
+};
+
+template <typename Transport>
+Result Run(bool scope, int frames, BusStats& stats, Panel& panel) {
+    Checked<Transport> d;
+    d.Init({});
+    stats.Reset();
+    Status status;
+    rng = 99;  // Same frames for every bus
+    Result r;
+    for (int f = 0; f < frames; f++) {
+        if (scope) DrawScope(d, f);
+        else {
+            status.Step();
+            status.Draw(d);
+        }
+        d.Update();
+        r.pages += d.LastPages();
+        r.mismatches += !Shown(d, panel);
+        r.frames++;
+    }
+    r.bytes = stats.bytes;
+    r.bus_s = stats.bus_s;
+    r.cpu_s = stats.cpu_s;
+    return r;
+}
+
+// libDaisy's SSD130x driver: per page 0xB0+p, 0x00, 0x10 one by one, then its 128 bytes
+Result Stock(int frames) {
+    i2c_stats.Reset();
+    for (int f = 0; f < frames; f++) {
+        for (int p = 0; p < HEIGHT / 8; p++) {
+            for (int c = 0; c < 3; c++) FakeI2c::Transaction(1);
+            FakeI2c::Transaction(WIDTH);
+        }
+    }
+    Result r;
+    r.frames = frames;
+    r.pages  = frames * (HEIGHT / 8);
+    r.bytes  = i2c_stats.bytes;
+    r.bus_s  = i2c_stats.bus_s;
+    r.cpu_s  = i2c_stats.cpu_s;
+    return r;
+}
+
+void Print(const char* bus, const char* screen, const Result& r) {
+    printf("  %-10s %-7s %5.2f %7.0f %10.3f %10.3f %9d\n", bus, screen, r.pages / r.frames, r.bytes / r.frames,
+           r.bus_s * 1e3 / r.frames, r.cpu_s * 1e3 / r.frames, r.mismatches);
+}
+
+int main(int argc, char** argv) {
+    float seconds = argc > 1 ? (float)atof(argv[1]) : 60.0f;
+    int   status_frames = (int)(seconds * STATUS_FPS);
+    int   scope_frames  = (int)(seconds * SCOPE_FPS);
+
+    printf("%d status frames, %d scope frames; I2C %.0fkHz, SPI %.2fMHz\n", status_frames, scope_frames,
+           I2C_HZ * 1e-3, SPI_HZ * 1e-6);
+    printf("  %-10s %-7s %5s %7s %10s %10s %9s\n", "bus", "screen", "pages", "bytes", "bus ms", "CPU ms",
+           "mismatch");
+    Result stock       = Stock(status_frames);
+    Result i2c_status  = Run<FakeI2c>(false, status_frames, i2c_stats, i2c_panel);
+    Result i2c_scope   = Run<FakeI2c>(true, scope_frames, i2c_stats, i2c_panel);
+    Result spi_status  = Run<FakeSpiDma>(false, status_frames, spi_stats, spi_panel);
+    Result spi_scope   = Run<FakeSpiDma>(true, scope_frames, spi_stats, spi_panel);
+    Print("I2C stock", "any", stock);
+    Print("I2C paged", "status", i2c_status);
+    Print("I2C paged", "scope", i2c_scope);
+    Print("SPI DMA", "status", spi_status);
+    Print("SPI DMA", "scope", spi_scope);
+    printf("  (per frame; CPU = main loop blocked)\n");
+
+    bool ok = i2c_status.mismatches + i2c_scope.mismatches + spi_status.mismatches + spi_scope.mismatches == 0;
+    ok      = ok && i2c_status.bus_s < stock.bus_s && spi_scope.bus_s / spi_scope.frames < 2e-3;
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
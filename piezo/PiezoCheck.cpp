@@ -0,0 +1,262 @@
+/*
+ * PIEZO CHECK - PiezoTrigger.h against synthetic piezo waveforms, on the
+ * host
+ *
+ * SIGNALS (3 channels, sampled like the firmware's ADC, FRAME_RATE):
+ *   Each hit is a short impact transient (0.8-3kHz, a few ms) plus the
+ *   tine ringing on at a quarter of its level for a few hundred ms, half-
+ *   wave rectified by the input clamp. Every hit leaks 5-20% of its
+ *   transient into the neighbouring channels (crosstalk), all channels
+ *   carry noise. The performance mixes single hits from pp to ff, rolls
+ *   (60ms apart, on the ringing tine) and two-channel chords.
+ *
+ * WHAT IT CHECKS:
+ *   - every hit detected once, on its own channel; no hits from ringing,
+ *     crosstalk or noise. Hits that don't clear the ringing they land on
+ *     (and their crosstalk) are counted apart: nothing can tell those from
+ *     the ringing
+ *   - onset error against the true start of the hit
+ *   - velocity against the one the true peak of the hit would give, in
+ *     MIDI steps (the ADC only samples at FRAME_RATE and misses the
+ *     exact crest)
+ *   - latency: hits reported within LatencyFrames() of their onset
+ *   - cost of one Process() call
+ *   for 1ms blocks (the firmware) and 5ms DMA half-buffers.
+ *
+ *   piezo_check [seconds]
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+#include "../PiezoTrigger.h"
+
+const float  FRAME_RATE  = 12000.0f;  // Firmware: PIEZO_FRAME_RATE (timer interrupt)
+const int    CHANNELS    = 3;
+const float  NOISE       = 0.004f;
+const float  MATCH_EARLY = 0.5f;  // ms a detection may lead the true onset
+const float  MATCH_LATE  = 2.0f;  // ms it may trail it
+const int    MAX_STEPS   = 14;    // Velocity error allowed (of 127): crest missed by up to 45 degrees at
+                                  // 3kHz (11 steps), plus noise on pp hits
+const float  MAX_ERRORS  = 0.001f;  // Missed + false per clear hit (pp hits right at the threshold)
+const size_t BLOCKS[2]   = {12, 60};
+
+// ============================================
+// Performance
+// ============================================
+uint32_t rng = 777;
+
+float Uniform(float lo, float hi) {
+    rng = rng * 1664525u + 1013904223u;
+    return lo + (hi - lo) * (rng >> 8) * (1.0f / 16777216.0f);
+}
+
+struct Hit {
+    int   channel;
+    float onset;      // Seconds
+    float amplitude;  // Transient, full scale = 1
+    float f_hit, tau_hit, f_ring, tau_ring, talk[CHANNELS];
+    float true_peak;  // Of its own (rectified) waveform
+    float ring_end;   // Next hit on the channel restarts the tine
+    bool  masked;     // Under PIEZO_RISE x the ringing it lands on
+};
+
+// Own waveform of a hit on its channel (unrectified), t since onset
+float Transient(const Hit& h, float t) {
+    return h.amplitude * expf(-t / h.tau_hit) * sinf(6.2831853f * h.f_hit * t);
+}
+
+float Ring(const Hit& h, float t) {
+    float attack = t < 0.002f ? t / 0.002f : 1.0f;
+    return 0.25f * h.amplitude * attack * expf(-t / h.tau_ring) * sinf(6.2831853f * h.f_ring * t);
+}
+
+Hit MakeHit(int channel, float onset, float amplitude) {
+    Hit h;
+    h.channel   = channel;
+    h.onset     = onset;
+    h.amplitude = amplitude;
+    h.f_hit     = Uniform(800.0f, 3000.0f);
+    h.tau_hit   = Uniform(0.0015f, 0.004f);
+    h.f_ring    = Uniform(150.0f, 900.0f);
+    h.tau_ring  = Uniform(0.1f, 0.4f);
+    for (int c = 0; c < CHANNELS; c++) {
+        h.talk[c] = abs(c - channel) == 1 ? Uniform(0.05f, 0.2f) : (c == channel ? 0.0f : Uniform(0.0f, 0.05f));
+    }
+    h.true_peak = 0.0f;
+    for (float t = 0.0f; t < 0.003f; t += 1e-6f) {
+        float x     = Transient(h, t) + Ring(h, t);
+        h.true_peak = x > h.true_peak ? x : h.true_peak;
+    }
+    if (h.true_peak > 1.0f) h.true_peak = 1.0f;
+    h.ring_end = 1e9f;
+    h.masked   = false;
+    return h;
+}
+
+float LogUniform(float lo, float hi) {
+    return expf(Uniform(logf(lo), logf(hi)));
+}
+
+std::vector<Hit> Perform(float seconds) {
+    std::vector<Hit> hits;
+    float            busy[CHANNELS] = {};  // Channel free from (s)
+    float            t              = 0.2f;
+    while (t < seconds - 1.0f) {
+        float kind = Uniform(0.0f, 1.0f);
+        if (kind < 0.08f) {
+            // Roll: 6 hits 60ms apart on a ringing tine
+            int   c = (int)Uniform(0.0f, CHANNELS - 0.01f);
+            float a = LogUniform(0.1f, 1.0f);
+            for (int i = 0; i < 6; i++) hits.push_back(MakeHit(c, t + 0.06f * i, a * Uniform(0.6f, 1.0f)));
+            busy[c] = t + 0.06f * 6;
+            t += 0.06f * 6 + 0.1f;
+        } else if (kind < 0.2f) {
+            // Chord: two channels within 0.5ms, similar strength, both over
+            // twice the threshold
+            int   c = (int)Uniform(0.0f, CHANNELS - 0.01f);
+            int   d = (c + 1 + (int)Uniform(0.0f, CHANNELS - 1.01f)) % CHANNELS;
+            float a = LogUniform(0.07f, 1.0f);
+            hits.push_back(MakeHit(c, t, a));
+            hits.push_back(MakeHit(d, t + Uniform(0.0f, 0.0005f), a * Uniform(0.6f, 1.0f)));
+            t += Uniform(0.15f, 0.4f);
+        } else {
+            int c = (int)Uniform(0.0f, CHANNELS - 0.01f);
+            if (busy[c] > t) c = (c + 1) % CHANNELS;
+            hits.push_back(MakeHit(c, t, LogUniform(0.03f, 1.0f)));
+            t += Uniform(0.1f, 0.35f);
+        }
+    }
+
+    // A hit stops the ringing of the previous one on its channel; a hit
+    // that doesn't clear the ringing it lands on by PIEZO_RISE (plus
+    // margin) can't be told apart from it
+    for (size_t i = 0; i < hits.size(); i++) {
+        for (size_t j = i + 1; j < hits.size(); j++) {
+            if (hits[j].channel != hits[i].channel) continue;
+            float t          = hits[j].onset - hits[i].onset;
+            hits[i].ring_end = hits[j].onset;
+            float ring       = 0.25f * hits[i].amplitude * expf(-t / hits[i].tau_ring);
+            hits[j].masked   = hits[j].true_peak < 1.5f * PIEZO_RISE * ring;
+            break;
+        }
+    }
+    return hits;
+}
+
+// ADC frames [frame][channel], rectified by the clamp, 16-bit
+std::vector<uint16_t> Render(const std::vector<Hit>& hits, float seconds) {
+    size_t             frames = (size_t)(seconds * FRAME_RATE);
+    std::vector<float> x(frames * CHANNELS, 0.0f);
+    for (const Hit& h : hits) {
+        size_t start = (size_t)ceilf(h.onset * FRAME_RATE);
+        size_t end   = start + (size_t)(5.0f * h.tau_ring * FRAME_RATE);
+        for (size_t f = start; f < end && f < frames; f++) {
+            float t = f / FRAME_RATE - h.onset;
+            float a = Transient(h, t);
+            x[f * CHANNELS + h.channel] += a + (f / FRAME_RATE < h.ring_end ? Ring(h, t) : 0.0f);
+            for (int c = 0; c < CHANNELS; c++) x[f * CHANNELS + c] += h.talk[c] * a;
+        }
+    }
+    std::vector<uint16_t> adc(x.size());
+    for (size_t i = 0; i < x.size(); i++) {
+        float v = x[i] + Uniform(-NOISE, NOISE);
+        v       = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+        adc[i]  = (uint16_t)(v * 65535.0f + 0.5f);
+    }
+    return adc;
+}
+
+// ============================================
+// Detection run
+// ============================================
+struct Found {
+    PiezoHit hit;
+    uint32_t reported;  // Frame count when Process() returned it
+};
+
+bool Check(const std::vector<Hit>& hits, const std::vector<uint16_t>& adc, size_t block) {
+    PiezoDetector<CHANNELS> detector;
+    detector.Init(FRAME_RATE);
+    std::vector<Found> found;
+    size_t             frames = adc.size() / CHANNELS;
+    double             cost   = 0.0;
+    for (size_t f = 0; f + block <= frames; f += block) {
+        PiezoHit out[CHANNELS];
+        auto     start = std::chrono::steady_clock::now();
+        size_t   n     = detector.Process(&adc[f * CHANNELS], block, out);
+        cost += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        for (size_t i = 0; i < n; i++) found.push_back({out[i], (uint32_t)(f + block)});
+    }
+
+    // Match each true hit to a detection on its channel
+    std::vector<bool> used(found.size(), false);
+    int    missed = 0, masked = 0, late = 0;
+    double onset_sum = 0.0, onset_max = 0.0, vel_sum = 0.0, vel_max = 0.0, report_max = 0.0;
+    for (const Hit& h : hits) {
+        int match = -1;
+        for (size_t i = 0; i < found.size() && match < 0; i++) {
+            float dt = found[i].hit.frame / FRAME_RATE - h.onset;
+            if (!used[i] && found[i].hit.channel == h.channel && dt >= -MATCH_EARLY * 0.001f
+                && dt <= MATCH_LATE * 0.001f) {
+                match = (int)i;
+            }
+        }
+        if (match < 0) {
+            masked += h.masked;
+            missed += !h.masked;
+            continue;
+        }
+        used[match] = true;
+        const Found& d      = found[match];
+        double       dt_ms  = (d.hit.frame / FRAME_RATE - h.onset) * 1000.0;
+        double       want   = logf(h.true_peak / PIEZO_THRESHOLD) / logf(1.0f / PIEZO_THRESHOLD);
+        want                = want < 0.0 ? 0.0 : (want > 1.0 ? 1.0 : want);
+        double       steps  = fabs(d.hit.velocity - want) * 126.0;
+        double       report = (d.reported - d.hit.frame) * 1000.0 / FRAME_RATE;
+        onset_sum += fabs(dt_ms);
+        onset_max  = fabs(dt_ms) > onset_max ? fabs(dt_ms) : onset_max;
+        vel_sum   += steps * steps;
+        vel_max    = steps > vel_max ? steps : vel_max;
+        report_max = report > report_max ? report : report_max;
+        if (d.reported - d.hit.frame > detector.LatencyFrames(block)) late++;
+    }
+    // Unmatched detections; crosstalk of a hit under the ringing can't be
+    // told from a soft hit and is counted apart
+    int extra = 0, masked_talk = 0;
+    for (size_t i = 0; i < found.size(); i++) {
+        if (used[i]) continue;
+        bool talk = false;
+        for (const Hit& h : hits) {
+            float dt = found[i].hit.frame / FRAME_RATE - h.onset;
+            talk     = talk || (h.masked && dt >= -MATCH_EARLY * 0.001f && dt <= MATCH_LATE * 0.001f);
+        }
+        masked_talk += talk;
+        extra += !talk;
+    }
+    int matched = (int)hits.size() - missed - masked;
+
+    printf("block %3zu frames (%.1fms): %zu hits, %d detected, %d missed, %d under the ringing, %d false "
+           "(+%d crosstalk of those)\n",
+           block, block * 1000.0f / FRAME_RATE, hits.size(), matched, missed, masked, extra, masked_talk);
+    printf("    onset error mean %.3fms max %.3fms, velocity error rms %.1f max %.1f steps\n",
+           matched ? onset_sum / matched : 0.0, onset_max, matched ? sqrt(vel_sum / matched) : 0.0, vel_max);
+    printf("    reported within %.2fms of the onset (fixed latency %.2fms, %d late), %.0fns per Process()\n",
+           report_max, detector.LatencyFrames(block) * 1000.0f / FRAME_RATE, late, cost / (frames / block));
+    return missed + extra <= MAX_ERRORS * (matched + missed) && late == 0 && vel_max <= MAX_STEPS;
+}
+
+int main(int argc, char** argv) {
+    float                 seconds = argc > 1 ? (float)atof(argv[1]) : 60.0f;
+    std::vector<Hit>      hits    = Perform(seconds);
+    std::vector<uint16_t> adc     = Render(hits, seconds);
+
+    bool ok = true;
+    for (size_t block : BLOCKS) ok = Check(hits, adc, block) && ok;
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,427 @@
+/*
+ * KALIMBA REPLAY - Re-render a captured performance on the host
+ *
+ * Reads a capture log (ControlCapture.h) out of a saved serial log - the
+ * CAPTURE BEGIN / CAPTURE <hex> / CAPTURE END lines the firmware prints
+ * for `CAPTURE DUMP` - and plays it through KalimbaEngine block by block:
+ * same control values, same pot mappings (KalimbaScales.h), every pluck
+ * and pitch change on its original sample. Field reports ("it glitched
+ * when I turned the reverb up") become a render you can listen to, step
+ * through and profile.
+ *
+ * OUTPUT:
+ *   - the engine output as raw float32 mono (optional)
+ *   - time per block and per stage, and the slowest blocks with their
+ *     time stamp and what happened in them
+ *   - with --events: every logged event, decoded
+ *
+ * CHECKPOINTS:
+ *   Every CHECKPOINT_SECONDS of the render the engine state is saved
+ *   (KalimbaEngine::SaveState, runs of zero words packed - silent strings
+ *   and unused reverb space cost next to nothing). --edit <seconds>
+ *   changes the first pluck from that time on (level halved), loads the
+ *   nearest checkpoint before it into a freshly constructed engine,
+ *   re-renders from there and checks the result bit for bit against a
+ *   full render of the edited log on another fresh engine, with the time
+ *   saved.
+ *
+ * LIMITS:
+ *   The replay is the engine only (no looper, no SD exciter samples).
+ *   Logs started with CAPTURE START instead of at power-on miss whatever
+ *   was still ringing. Host and Cortex-M7 libm differ in the last bits,
+ *   so the audio matches the device's closely, not bit for bit; replays
+ *   of one log on one machine are identical.
+ *
+ *   kalimba_replay <serial.log> [out.f32] [--events] [--edit <seconds>]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "../ControlCapture.h"
+#include "../KalimbaConfig.h"  // KalimbaCrc32
+#include "../KalimbaEngine.h"
+#include "../KalimbaScales.h"
+#include "../SelfBench.h"      // StageProfiler, stage names
+
+const float LP_FREQ            = 10000.0f;  // Firmware: reverb LP fixed at 10kHz
+const int   SLOWEST            = 10;        // Blocks listed in the report
+const float CHECKPOINT_SECONDS = 1.0f;
+
+// ============================================
+// Host clock for the stage profiler (nanoseconds)
+// ============================================
+struct HostClock {
+    static inline uint32_t Now() {
+        return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+    static inline uint32_t Elapsed(uint32_t start) { return Now() - start; }
+};
+
+static double Seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+typedef StageProfiler<HostClock>                   ReplayProfiler;
+typedef KalimbaEngine<NUM_STRINGS, ReplayProfiler> ReplayEngine;
+
+ReplayEngine engine;
+ReplayEngine reference;  // --edit: fresh engine for the full re-render
+ReplayEngine resumed;    // --edit: fresh engine the checkpoint loads into
+
+// ============================================
+// Serial log → capture bytes
+// ============================================
+static int HexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Last complete dump in the file (earlier ones are older captures)
+static bool ReadDump(const char* path, std::vector<uint8_t>* out) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+
+    char                 line[512];
+    std::vector<uint8_t> data;
+    bool                 in_dump = false, found = false;
+    unsigned             size = 0, crc = 0;
+    while (fgets(line, sizeof(line), f)) {
+        const char* p = strstr(line, "CAPTURE ");
+        if (!p) continue;
+        p += 8;
+        if (sscanf(p, "BEGIN size=%u crc=%x", &size, &crc) == 2) {
+            data.clear();
+            in_dump = true;
+        } else if (strncmp(p, "END", 3) == 0 && in_dump) {
+            in_dump = false;
+            if (data.size() != size || KalimbaCrc32(data.data(), data.size()) != crc) {
+                fprintf(stderr, "%s: dump damaged (%u of %u bytes, crc mismatch), skipped\n", path,
+                        (unsigned)data.size(), size);
+                continue;
+            }
+            *out  = data;
+            found = true;
+        } else if (in_dump) {
+            for (; HexDigit(p[0]) >= 0 && HexDigit(p[1]) >= 0; p += 2) {
+                data.push_back((uint8_t)(HexDigit(p[0]) << 4 | HexDigit(p[1])));
+            }
+        }
+    }
+    fclose(f);
+    if (!found) fprintf(stderr, "%s: no complete CAPTURE dump found\n", path);
+    return found;
+}
+
+// ============================================
+// Checkpoints
+// ============================================
+
+// Where a render stands between two blocks (besides the engine itself)
+struct Cursor {
+    uint32_t block;
+    size_t   next;  // First event not applied yet
+    float    pots[CAPTURE_NUM_POTS];
+};
+
+// Before the first block: pots at the firmware's power-on values
+const Cursor START = {0, 0, {0.5f, 0.5f, 0.5f, 0.0f, 0.5f, 0.5f}};
+
+struct Checkpoint {
+    Cursor                cursor;
+    std::vector<uint32_t> state;  // PackState()
+};
+
+// Engine state as 32-bit words: (zero run, literal run, literals...)*
+static void PackState(const ReplayEngine& e, std::vector<uint32_t>* out) {
+    static std::vector<uint32_t> words;
+    words.assign((e.StateSize() + 3) / 4, 0);
+    e.SaveState(words.data());
+
+    out->clear();
+    size_t i = 0;
+    while (i < words.size()) {
+        size_t zeros = i;
+        while (i < words.size() && words[i] == 0) i++;
+        size_t literal = i;
+        while (i < words.size() && !(words[i] == 0 && i + 1 < words.size() && words[i + 1] == 0)) i++;
+        out->push_back((uint32_t)(literal - zeros));
+        out->push_back((uint32_t)(i - literal));
+        out->insert(out->end(), words.begin() + literal, words.begin() + i);
+    }
+}
+
+static bool UnpackState(const std::vector<uint32_t>& in, ReplayEngine* e) {
+    static std::vector<uint32_t> words;
+    words.assign((e->StateSize() + 3) / 4, 0);
+    size_t w = 0;
+    for (size_t i = 0; i < in.size();) {
+        w += in[i];
+        uint32_t literals = in[i + 1];
+        i += 2;
+        memcpy(&words[w], &in[i], literals * sizeof(uint32_t));
+        w += literals;
+        i += literals;
+    }
+    return e->LoadState(words.data(), words.size() * sizeof(uint32_t));
+}
+
+// ============================================
+// Replay
+// ============================================
+struct BlockTime {
+    uint32_t block;
+    uint32_t ns;
+    int      plucks;
+    int      pot_moves;
+};
+
+static void PrintEvent(const CaptureEvent& e, float block_seconds) {
+    printf("%10.4fs  block %-8u ", e.block * block_seconds, (unsigned)e.block);
+    switch (e.tag) {
+        case CAPTURE_POT: printf("pot A%d = %d/4095\n", e.index, (int)e.value); break;
+        case CAPTURE_BUTTONS: printf("buttons %02x\n", (unsigned)e.value); break;
+        case CAPTURE_PLUCK:
+            printf("+%u pluck string %d octave %+d level %.2f\n", (unsigned)e.offset, e.index + 1,
+                   (int)e.value, e.level);
+            break;
+        case CAPTURE_PITCH: printf("+%u pitch string %d = %.2f Hz\n", (unsigned)e.offset, e.index + 1, e.freq); break;
+    }
+}
+
+// Blocks c->block .. end-1 into out (whole-log buffer). Optionally times
+// every block and saves a checkpoint every `interval` blocks.
+static void Render(ReplayEngine& e, const std::vector<CaptureEvent>& events, uint32_t block_size, Cursor* c,
+                   uint32_t end, float* out, std::vector<BlockTime>* times = nullptr,
+                   std::vector<Checkpoint>* checkpoints = nullptr, uint32_t interval = 0) {
+    for (; c->block < end; c->block++) {
+        uint32_t block = c->block;
+        if (checkpoints && block % interval == 0) {
+            checkpoints->push_back(Checkpoint{*c, {}});
+            PackState(e, &checkpoints->back().state);
+        }
+        BlockTime t = {block, 0, 0, 0};
+
+        // Same order as the firmware callback: controls, then segments
+        // that end on each logged pluck / pitch offset
+        while (c->next < events.size() && events[c->next].block == block && events[c->next].offset == 0) {
+            const CaptureEvent& ev = events[c->next++];
+            if (ev.tag == CAPTURE_POT) {
+                c->pots[ev.index] = ev.value * (1.0f / CAPTURE_POT_STEPS);
+                t.pot_moves++;
+            } else if (ev.tag == CAPTURE_PITCH) {
+                e.SetVoiceFreq(ev.index, ev.freq);
+            } else if (ev.tag == CAPTURE_PLUCK) {
+                e.Trigger(ev.index, ev.level);
+                t.plucks++;
+            }
+        }
+        e.SetBrightness(PotToBrightness(c->pots[0]));
+        e.SetDecay(PotToDecay(c->pots[1]));
+        e.SetReverb(PotToReverbMix(c->pots[4]), PotToReverbFeedback(c->pots[5]), LP_FREQ);
+
+        float*   buffer = out + (size_t)block * block_size;
+        uint32_t start  = HostClock::Now();
+        uint32_t done   = 0;
+        while (done < block_size) {
+            uint32_t stop = block_size;
+            if (c->next < events.size() && events[c->next].block == block) stop = events[c->next].offset;
+            if (stop > done) {
+                e.Process(buffer + done, stop - done);
+                done = stop;
+            }
+            while (c->next < events.size() && events[c->next].block == block && events[c->next].offset == done) {
+                const CaptureEvent& ev = events[c->next++];
+                if (ev.tag == CAPTURE_PITCH) {
+                    e.SetVoiceFreq(ev.index, ev.freq);
+                } else if (ev.tag == CAPTURE_PLUCK) {
+                    e.Trigger(ev.index, ev.level);
+                    t.plucks++;
+                }
+            }
+        }
+        t.ns = HostClock::Elapsed(start);
+        if (times) times->push_back(t);
+    }
+}
+
+// --edit: change one pluck, resume from the nearest checkpoint, compare
+// with a full render of the edited log. False if they differ.
+static bool EditAndVerify(std::vector<CaptureEvent> events, const std::vector<Checkpoint>& checkpoints,
+                          const std::vector<float>& original, uint32_t block_size, float sample_rate,
+                          uint32_t num_blocks, float edit_seconds) {
+    float    block_seconds = block_size / sample_rate;
+    uint32_t edit_block    = (uint32_t)(edit_seconds / block_seconds);
+    auto     edited        = std::find_if(events.begin(), events.end(), [&](const CaptureEvent& ev) {
+        return ev.block >= edit_block && ev.tag == CAPTURE_PLUCK;
+    });
+    if (edited == events.end()) {
+        fprintf(stderr, "--edit: no pluck at or after %.3fs\n", edit_seconds);
+        return false;
+    }
+    edited->level *= 0.5f;
+
+    // Latest checkpoint before the edit (its block has not been rendered)
+    const Checkpoint* from = &checkpoints.front();
+    for (const Checkpoint& cp : checkpoints) {
+        if (cp.cursor.block <= edited->block) from = &cp;
+    }
+
+    // Resumed on an engine that never rendered: the checkpoint has to
+    // carry everything
+    std::vector<float> output  = original;
+    double             start   = Seconds();
+    Cursor             c       = from->cursor;
+    resumed.Init(sample_rate);
+    if (!UnpackState(from->state, &resumed)) {
+        printf("Edit: checkpoint at %.4fs does not load into a fresh engine\n", from->cursor.block * block_seconds);
+        return false;
+    }
+    Render(resumed, events, block_size, &c, num_blocks, output.data());
+    double resumed_seconds = Seconds() - start;
+
+    std::vector<float> full(original.size());
+    start = Seconds();
+    reference.Init(sample_rate);
+    Cursor r = START;
+    Render(reference, events, block_size, &r, num_blocks, full.data());
+    double reference_seconds = Seconds() - start;
+
+    printf("Edit: pluck at %.4fs (string %d) level halved, resumed from the checkpoint at %.4fs on a fresh engine\n",
+           edited->block * block_seconds, edited->index + 1, from->cursor.block * block_seconds);
+    printf("    resumed render %.3fs, full render %.3fs: %.3fs saved (%.0f%%)\n", resumed_seconds,
+           reference_seconds, reference_seconds - resumed_seconds,
+           100.0 * (reference_seconds - resumed_seconds) / reference_seconds);
+
+    size_t first_diff = output.size();
+    for (size_t i = 0; i < output.size() && first_diff == output.size(); i++) {
+        if (memcmp(&output[i], &full[i], sizeof(float)) != 0) first_diff = i;
+    }
+    if (first_diff != output.size()) {
+        printf("    MISMATCH from sample %u (%.4fs)\n", (unsigned)first_diff, first_diff / sample_rate);
+        return false;
+    }
+    printf("    bit-exact against the full render (%u samples)\n", (unsigned)output.size());
+    return true;
+}
+
+int main(int argc, char** argv) {
+    const char* log_path    = nullptr;
+    const char* out_path    = nullptr;
+    bool        list_events = false;
+    float       edit_at     = -1.0f;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--events") == 0) {
+            list_events = true;
+        } else if (strcmp(argv[i], "--edit") == 0 && i + 1 < argc) {
+            edit_at = strtof(argv[++i], nullptr);
+        } else if (!log_path) {
+            log_path = argv[i];
+        } else {
+            out_path = argv[i];
+        }
+    }
+    if (!log_path) {
+        fprintf(stderr, "usage: %s serial.log [out.f32] [--events] [--edit <seconds>]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<uint8_t> data;
+    if (!ReadDump(log_path, &data)) return 1;
+
+    ControlCaptureReader log;
+    if (!log.Open(data.data(), data.size())) {
+        fprintf(stderr, "%s: not a capture log this tool understands\n", log_path);
+        return 1;
+    }
+    if (log.Voices() != NUM_STRINGS) {
+        fprintf(stderr, "%s: captured with %d voices, replay has %d\n", log_path, log.Voices(), NUM_STRINGS);
+        return 1;
+    }
+
+    // Whole log decoded up front, so rendering is timed on its own
+    std::vector<CaptureEvent> events;
+    CaptureEvent              e;
+    while (log.Next(&e)) events.push_back(e);
+    if (log.Truncated()) fprintf(stderr, "warning: log truncated, replaying what is there\n");
+
+    uint32_t block_size    = log.BlockSize();
+    float    sample_rate   = (float)log.SampleRate();
+    float    block_seconds = block_size / sample_rate;
+    uint32_t num_blocks    = log.Ended() ? log.Blocks() : (events.empty() ? 0 : events.back().block + 1);
+    printf("Capture: %u bytes, %u events, %u blocks of %u (%.2fs at %.0fHz), %s start\n",
+           (unsigned)data.size(), (unsigned)events.size(), (unsigned)num_blocks, (unsigned)block_size,
+           num_blocks * block_seconds, sample_rate, log.Cold() ? "power-on" : "mid-performance");
+    if (list_events) {
+        for (const CaptureEvent& ev : events) PrintEvent(ev, block_seconds);
+    }
+
+    engine.Init(sample_rate);
+    ReplayProfiler::enabled = true;
+    ReplayProfiler::Reset();
+
+    std::vector<float>      output((size_t)num_blocks * block_size);
+    std::vector<BlockTime>  times;
+    std::vector<Checkpoint> checkpoints;
+    uint32_t                interval = (uint32_t)(CHECKPOINT_SECONDS / block_seconds);
+    times.reserve(num_blocks);
+    Cursor c     = START;
+    double start = Seconds();
+    Render(engine, events, block_size, &c, num_blocks, output.data(), &times, &checkpoints, interval);
+    double render_seconds   = Seconds() - start;
+    ReplayProfiler::enabled = false;
+
+    if (out_path) {
+        FILE* out = fopen(out_path, "wb");
+        if (!out) {
+            perror(out_path);
+            return 1;
+        }
+        fwrite(output.data(), sizeof(float), output.size(), out);
+        fclose(out);
+    }
+    if (times.empty()) return 0;
+
+    // Report
+    size_t packed = 0;
+    for (const Checkpoint& cp : checkpoints) packed += cp.state.size() * sizeof(uint32_t);
+    uint64_t total = 0;
+    for (const BlockTime& bt : times) total += bt.ns;
+    double budget_ns = 1e9 * block_seconds;
+    printf("Rendered in %.3fs; %u checkpoints, %u KB (engine state %u KB unpacked)\n", render_seconds,
+           (unsigned)checkpoints.size(), (unsigned)(packed / 1024), (unsigned)(engine.StateSize() / 1024));
+    printf("Host time per block: mean %.0f ns (%.1f%% of the %.0f ns real-time budget)\n",
+           (double)total / times.size(), 100.0 * total / times.size() / budget_ns, budget_ns);
+    for (int s = 0; s < engine.NUM_STAGES; s++) {
+        printf("    %-10s %8.0f ns/block\n", SELF_BENCH_STAGE_NAMES[s],
+               (double)ReplayProfiler::total[s] / times.size());
+    }
+
+    std::vector<BlockTime> slowest = times;
+    int                    n       = (int)slowest.size() < SLOWEST ? (int)slowest.size() : SLOWEST;
+    std::partial_sort(slowest.begin(), slowest.begin() + n, slowest.end(),
+                      [](const BlockTime& a, const BlockTime& b) { return a.ns > b.ns; });
+    printf("Slowest blocks:\n");
+    for (int i = 0; i < n; i++) {
+        const BlockTime& bt = slowest[i];
+        printf("    %10.4fs  block %-8u %7u ns  plucks %d  pot moves %d\n", bt.block * block_seconds,
+               (unsigned)bt.block, (unsigned)bt.ns, bt.plucks, bt.pot_moves);
+    }
+
+    if (edit_at >= 0.0f) {
+        if (!EditAndVerify(events, checkpoints, output, block_size, sample_rate, num_blocks, edit_at)) return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,300 @@
+/*
+ * CONVOLUTION CHECK - ConvolutionReverb.h against direct convolution, on
+ * the host
+ *
+ * WHAT IT CHECKS:
+ *   - latency: an impulse in comes out as the impulse response from its
+ *     first tap on, no delay on top of the audio block
+ *   - correctness: the output against a direct convolution (double) at
+ *     every sample of the first CHECK_DENSE (all partition seams) and
+ *     every CHECK_STRIDE-th sample after; error in dB below the peak
+ *   - deadlines: late partitions and the tightest slack of the main loop
+ *     level, in the schedules below
+ *
+ * SCHEDULES:
+ *   Audio runs in blocks of 4 samples. The main loop is simulated on the
+ *   audio clock: per pass a Service() slice (WORKER_SLICE_US, one step of
+ *   work taken as STEP_US on the M7), the firmware's 1ms delay, and every
+ *   DISPLAY_INTERVAL_MS a display update that blocks it for the stall
+ *   given. "display" is the firmware (a blocking OLED transfer); "stalled"
+ *   blocks it for longer than the tail deadline (43ms) on purpose, so
+ *   the late count must go up and only those partitions go missing.
+ *   "threads" runs the worker on a real thread against audio paced in
+ *   real time (takes as long as the input), exercising the handoff itself.
+ *
+ * INPUT:
+ *   An impulse, then noise bursts and decaying tones, INPUT_SECONDS long.
+ *   Impulse response: IR.WAV-style 16-bit mono file if given, else a
+ *   synthetic room (early reflections + exponentially decaying noise,
+ *   IR_SECONDS).
+ *
+ *   convolution_check [ir.wav] [--threads]
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../ConvolutionReverb.h"
+#include "../SampleExciter.h"  // FindWavData, StdioSampleSource
+
+const float  SAMPLE_RATE         = 48000.0f;
+const size_t BLOCK               = 4;
+const float  INPUT_SECONDS       = 6.0f;
+const float  IR_SECONDS          = 3.0f;
+const size_t CHECK_DENSE         = 8192;
+const size_t CHECK_STRIDE        = 61;
+const float  STEP_US             = 3.0f;     // One worker step on the M7 (estimate)
+const float  WORKER_SLICE_US     = 2000.0f;  // Firmware CONV_SLICE_US
+const float  LOOP_DELAY_US       = 1000.0f;  // Firmware main loop System::Delay(1)
+const float  DISPLAY_INTERVAL_MS = 100.0f;
+const float  PASS_THRESHOLD_DB   = -90.0f;
+
+// ============================================
+// Signals
+// ============================================
+uint32_t noise_state = 1;
+
+float Noise() {
+    noise_state = noise_state * 1664525u + 1013904223u;
+    return (int32_t)noise_state * (1.0f / 2147483648.0f);
+}
+
+std::vector<float> SyntheticRoom() {
+    std::vector<float> ir((size_t)(IR_SECONDS * SAMPLE_RATE), 0.0f);
+    ir[0] = 0.8f;
+    static const float reflections[6][2] = {
+        {0.0031f, 0.5f}, {0.0047f, -0.42f}, {0.0113f, 0.35f}, {0.0170f, -0.3f}, {0.0290f, 0.22f}, {0.0410f, 0.18f},
+    };
+    for (int r = 0; r < 6; r++) ir[(size_t)(reflections[r][0] * SAMPLE_RATE)] += reflections[r][1];
+    float rt60 = IR_SECONDS * 0.8f;
+    for (size_t i = (size_t)(0.02f * SAMPLE_RATE); i < ir.size(); i++) {
+        ir[i] += 0.25f * Noise() * powf(10.0f, -3.0f * i / (rt60 * SAMPLE_RATE));
+    }
+    return ir;
+}
+
+bool LoadWav(const char* path, std::vector<float>* ir) {
+    std::string       dir(path);
+    size_t            slash = dir.rfind('/');
+    std::string       name  = slash == std::string::npos ? dir : dir.substr(slash + 1);
+    dir                     = slash == std::string::npos ? "." : dir.substr(0, slash);
+    StdioSampleSource source(dir.c_str());
+    if (!source.Open(name.c_str())) return false;
+    size_t   offset  = 0;
+    uint32_t samples = 0;
+    if (!FindWavData(&source, &offset, &samples)) {
+        source.Close();
+        return false;
+    }
+    std::vector<int16_t> pcm(samples);
+    size_t               got = source.ReadAt(offset, pcm.data(), samples * 2) / 2;
+    source.Close();
+    ir->resize(got);
+    for (size_t i = 0; i < got; i++) (*ir)[i] = pcm[i] / 32768.0f;
+    return got > 0;
+}
+
+std::vector<float> TestInput() {
+    std::vector<float> x((size_t)(INPUT_SECONDS * SAMPLE_RATE), 0.0f);
+    x[0] = 1.0f;  // Latency check
+    for (size_t start = 12000; start + 4800 < x.size(); start += 31000) {
+        for (size_t i = 0; i < 4800; i++) x[start + i] += 0.3f * Noise();
+    }
+    for (size_t start = 30000; start + 24000 < x.size(); start += 53000) {
+        for (size_t i = 0; i < 24000; i++) {
+            x[start + i] += 0.4f * sinf(6.2831853f * 440.0f * i / SAMPLE_RATE) * expf(-4.0f * i / 24000.0f);
+        }
+    }
+    return x;
+}
+
+double Direct(const std::vector<float>& x, const std::vector<float>& ir, size_t n) {
+    double acc = 0.0;
+    size_t taps = n + 1 < ir.size() ? n + 1 : ir.size();
+    for (size_t k = 0; k < taps; k++) acc += (double)ir[k] * x[n - k];
+    return acc;
+}
+
+// ============================================
+// Schedules
+// ============================================
+// Simulated time in microseconds: the worker only steps when it "has"
+// the CPU in the main loop model
+struct SimClock {
+    static uint32_t ticks;
+    static inline uint32_t Now() { return ticks; }
+    static inline uint32_t Elapsed(uint32_t start) { return ticks - start; }
+};
+uint32_t SimClock::ticks = 0;
+
+struct HostClock {
+    static inline uint32_t Now() {
+        return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+    static inline uint32_t Elapsed(uint32_t start) { return Now() - start; }
+};
+
+// One worker step per STEP_US of simulated CPU
+struct StepClock {
+    static uint32_t steps;
+    static inline uint32_t Now() { return (uint32_t)(steps++ * STEP_US); }
+    static inline uint32_t Elapsed(uint32_t start) { return (uint32_t)(steps * STEP_US) - start; }
+};
+uint32_t StepClock::steps = 0;
+
+ConvolutionReverb reverb;
+std::vector<float> arena;
+MemOps             mem_ops;
+
+// The arena starts out as garbage (SDRAM at power-on): Init() must clear
+// what it reads, the input spectra through MemOps::Fill as on the Daisy
+void Prepare(const std::vector<float>& ir) {
+    arena.assign(ConvolutionReverb::ArenaFloats(ir.size()), 1e30f);
+    mem_ops.Init();
+    reverb.Init(arena.data(), arena.size(), ir.data(), ir.size(), BLOCK, &mem_ops);
+}
+
+// Main loop model: slice → delay → (every DISPLAY_INTERVAL_MS) stall.
+// The audio clock advances BLOCK samples at a time; the worker gets the
+// slices that fall between.
+void RenderSimulated(const std::vector<float>& x, std::vector<float>* y, float stall_ms) {
+    y->assign(x.size(), 0.0f);
+    double block_us   = BLOCK * 1e6 / SAMPLE_RATE;
+    double loop_at    = 0.0;  // When the main loop next gets to run
+    double display_at = DISPLAY_INTERVAL_MS * 1000.0;
+    for (size_t i = 0; i + BLOCK <= x.size(); i += BLOCK) {
+        double now = (i / BLOCK) * block_us;
+        while (loop_at <= now) {
+            reverb.Service<StepClock>((uint32_t)WORKER_SLICE_US);
+            loop_at += WORKER_SLICE_US + LOOP_DELAY_US;
+            if (loop_at >= display_at) {
+                loop_at += stall_ms * 1000.0;
+                display_at += DISPLAY_INTERVAL_MS * 1000.0;
+            }
+        }
+        reverb.Process(&x[i], &(*y)[i], BLOCK);
+    }
+}
+
+// Real threads: audio paced in real time, worker spinning on Service()
+void RenderThreaded(const std::vector<float>& x, std::vector<float>* y) {
+    y->assign(x.size(), 0.0f);
+    std::atomic<bool> running{true};
+    std::thread       worker([&] {
+        while (running.load()) {
+            reverb.Service<HostClock>((uint32_t)WORKER_SLICE_US);
+            std::this_thread::sleep_for(std::chrono::microseconds((int)LOOP_DELAY_US));
+        }
+    });
+    auto   start    = std::chrono::steady_clock::now();
+    double block_us = BLOCK * 1e6 / SAMPLE_RATE;
+    for (size_t i = 0; i + BLOCK <= x.size(); i += BLOCK) {
+        // Audio "interrupt": sleep in chunks of 16 blocks (~1.3ms)
+        if ((i / BLOCK) % 16 == 0) {
+            std::this_thread::sleep_until(start + std::chrono::microseconds((long)((i / BLOCK) * block_us)));
+        }
+        reverb.Process(&x[i], &(*y)[i], BLOCK);
+    }
+    running.store(false);
+    worker.join();
+}
+
+// ============================================
+// Report
+// ============================================
+void Report(const char* name, const std::vector<float>& x, const std::vector<float>& ir,
+            const std::vector<float>& y) {
+    // Latency: first output sample above the noise vs the IR's first tap
+    size_t ir_first = 0, y_first = 0;
+    while (ir_first < ir.size() && fabsf(ir[ir_first]) < 1e-6f) ir_first++;
+    while (y_first < y.size() && fabsf(y[y_first]) < 1e-6f) y_first++;
+
+    double peak = 0.0, error = 0.0;
+    size_t checked = 0;
+    for (size_t n = 0; n < y.size(); n += n < CHECK_DENSE ? 1 : CHECK_STRIDE, checked++) {
+        double ref = Direct(x, ir, n);
+        peak       = fmax(peak, fabs(ref));
+        error      = fmax(error, fabs(ref - y[n]));
+    }
+    double error_db = 20.0 * log10(error / peak + 1e-30);
+
+    const ConvLevel& tail = reverb.Level(CONV_LEVELS - 1);
+    printf("%-8s latency %d samples  error %6.1f dB (%zu samples)  late partitions %u", name,
+           (int)y_first - (int)ir_first, error_db, checked, reverb.Late());
+    if (tail.Active()) printf("  tail min slack %.1f ms", tail.MinSlack() * 1000.0f / SAMPLE_RATE);
+    printf("\n");
+}
+
+bool Passed(const std::vector<float>& x, const std::vector<float>& ir, const std::vector<float>& y) {
+    double peak = 0.0, error = 0.0;
+    for (size_t n = 0; n < y.size(); n += n < CHECK_DENSE ? 1 : CHECK_STRIDE) {
+        double ref = Direct(x, ir, n);
+        peak       = fmax(peak, fabs(ref));
+        error      = fmax(error, fabs(ref - y[n]));
+    }
+    return 20.0 * log10(error / peak + 1e-30) < PASS_THRESHOLD_DB && y[0] != 0.0f;
+}
+
+int main(int argc, char** argv) {
+    const char* ir_path = nullptr;
+    bool        threads = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0) {
+            threads = true;
+        } else {
+            ir_path = argv[i];
+        }
+    }
+
+    std::vector<float> ir;
+    if (ir_path) {
+        if (!LoadWav(ir_path, &ir)) {
+            fprintf(stderr, "%s: not a 16-bit mono WAV\n", ir_path);
+            return 1;
+        }
+    } else {
+        ir = SyntheticRoom();
+    }
+    if (ir.size() > CONV_MAX_TAPS) ir.resize(CONV_MAX_TAPS);
+    std::vector<float> x = TestInput();
+    std::vector<float> y;
+
+    printf("Impulse response %zu taps (%.2fs), arena %zu floats\n", ir.size(), ir.size() / SAMPLE_RATE,
+           ConvolutionReverb::ArenaFloats(ir.size()));
+    for (int l = 0; l < CONV_LEVELS; l++) {
+        const ConvLevelSpec& spec = CONV_LEVEL_SPECS[l];
+        static const char* const runner[] = {"audio, on the spot", "audio, sliced", "main loop"};
+        printf("    level %d: partitions of %4zu from tap %4zu x %3zu  (%s)\n", l, spec.size, spec.start,
+               ConvLevel::Parts(spec, ir.size()), runner[spec.runner]);
+    }
+
+    Prepare(ir);
+    RenderSimulated(x, &y, 25.0f);
+    Report("display", x, ir, y);
+    bool ok = Passed(x, ir, y) && reverb.Late() == 0;
+
+    Prepare(ir);
+    RenderSimulated(x, &y, 60.0f);
+    Report("stalled", x, ir, y);
+    ok = ok && reverb.Late() > 0;
+
+    if (threads) {
+        Prepare(ir);
+        RenderThreaded(x, &y);
+        Report("threads", x, ir, y);
+        ok = ok && (reverb.Late() > 0 || Passed(x, ir, y));
+    }
+
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
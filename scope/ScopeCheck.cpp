@@ -0,0 +1,279 @@
+/*
+ * SCOPE CHECK - ScopeView.h's scope and spectrum screens drawn into a
+ * host framebuffer
+ *
+ * SETUP:
+ *   Test tones at 32/48/96kHz go through SnapshotRing (decimated as the
+ *   firmware does), SlicedFft stepped to completion, then DrawScope /
+ *   DrawSpectrum into a 128x64 framebuffer with libDaisy's OledDisplay
+ *   drawing calls (Bresenham lines, filled rects). Everything below is
+ *   read back from the pixels.
+ *
+ * WHAT IT CHECKS:
+ *   - spectrum: the band holding the tone is the peak, its bar height
+ *     is the tone's level (box decimation and Hann scalloping allowed
+ *     for), bands 4 or more away are at least 24dB lower; two tones give
+ *     two peaks
+ *   - scope: the trace starts on a rising zero crossing (free-running
+ *     when there is none with a screen's width of frame after it), spans
+ *     the rows the auto-range gain puts the samples on - the top or
+ *     bottom of the screen for 0.01 or more - and crosses the centre line
+ *     upwards as often as the drawn samples do (~f x 128 / rate);
+ *     silence is a flat line
+ *
+ *   scope_check
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "../ScopeView.h"
+
+const size_t BLOCK  = 4;  // Firmware AUDIO_BLOCK_SIZE
+const int    WIDTH  = 128;
+const int    HEIGHT = 64;
+const int    MID    = 37;  // Row DrawScope puts 0.0 on
+const float  TWO_PI = 6.28318530718f;
+
+// ============================================
+// Framebuffer with OledDisplay's drawing calls
+// ============================================
+struct Framebuffer {
+    bool pixels[HEIGHT][WIDTH];
+
+    void Fill(bool on) { memset(pixels, on, sizeof(pixels)); }
+
+    void DrawPixel(int x, int y, bool on) {
+        if (x >= 0 && x < WIDTH && y >= 0 && y < HEIGHT) pixels[y][x] = on;
+    }
+
+    void DrawLine(int x1, int y1, int x2, int y2, bool on) {
+        int dx = abs(x2 - x1), sx = x1 < x2 ? 1 : -1;
+        int dy = -abs(y2 - y1), sy = y1 < y2 ? 1 : -1;
+        int err = dx + dy;
+        for (;;) {
+            DrawPixel(x1, y1, on);
+            if (x1 == x2 && y1 == y2) break;
+            int e2 = 2 * err;
+            if (e2 >= dy) err += dy, x1 += sx;
+            if (e2 <= dx) err += dx, y1 += sy;
+        }
+    }
+
+    void DrawRect(int x1, int y1, int x2, int y2, bool on, bool fill = false) {
+        for (int y = y1; y <= y2; y++) {
+            for (int x = x1; x <= x2; x++) {
+                if (fill || y == y1 || y == y2 || x == x1 || x == x2) DrawPixel(x, y, on);
+            }
+        }
+    }
+
+    // Lit rows in column x: count, first, last
+    int Column(int x, int* top, int* bottom) const {
+        int n = 0;
+        *top = HEIGHT, *bottom = -1;
+        for (int y = 0; y < HEIGHT; y++) {
+            if (!pixels[y][x]) continue;
+            n++;
+            if (y < *top) *top = y;
+            *bottom = y;
+        }
+        return n;
+    }
+};
+
+// ============================================
+// Tones → snapshot
+// ============================================
+struct Tone {
+    float hz, amp;
+};
+
+// Newest frame after a second of `tones` at `rate`
+const float* Snapshot(SnapshotRing* ring, float rate, const std::vector<Tone>& tones) {
+    ring->SetDecimation(ScopeDecimation(rate));
+    float        block[BLOCK];
+    const float* frame = nullptr;
+    for (uint32_t n = 0; n < (uint32_t)rate; n += BLOCK) {
+        for (size_t i = 0; i < BLOCK; i++) {
+            block[i] = 0.0f;
+            for (const Tone& t : tones) block[i] += t.amp * sinf(TWO_PI * fmodf(t.hz * (n + i) / rate, 1.0f));
+        }
+        ring->Push(block, BLOCK);
+        const float* f = ring->Acquire();
+        if (f) frame = f;
+    }
+    return frame;
+}
+
+// dB a tone should show at: box decimation, Hann scalloping (worst case
+// between bins) as the allowance below
+float BoxDb(float hz, float rate, int decimation) {
+    float g = decimation == 1 ? 1.0f : fabsf(sinf(TWO_PI * 0.5f * hz * decimation / rate) / (decimation * sinf(TWO_PI * 0.5f * hz / rate)));
+    return 20.0f * log10f(g);
+}
+
+int BarPx(float db) {
+    float v = (db - SCOPE_FLOOR_DB) / -SCOPE_FLOOR_DB;
+    v       = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+    return (int)(v * (SCOPE_BOTTOM - SCOPE_TOP + 1) + 0.5f);
+}
+
+// ============================================
+// Spectrum
+// ============================================
+bool Spectrum(float rate, const std::vector<Tone>& tones) {
+    static SnapshotRing ring;
+    static SlicedFft    fft;
+    static Framebuffer  fb;
+    fft.Init();
+    const float* frame = Snapshot(&ring, rate, tones);
+    int          dec   = ring.Decimation();
+    float        fs    = rate / dec;  // Snapshot rate
+
+    fft.Start(frame);
+    int steps = 1;
+    while (!fft.Step()) steps++;
+    fb.Fill(false);
+    DrawSpectrum(fb, fft.Bands());
+
+    int bars[SCOPE_BANDS];
+    for (int b = 0; b < SCOPE_BANDS; b++) {
+        int top, bottom;
+        bars[b] = fb.Column(2 * b, &top, &bottom);
+    }
+
+    const float scallop_px = 1.42f / -SCOPE_FLOOR_DB * (SCOPE_BOTTOM - SCOPE_TOP + 1);
+    bool        ok         = true;
+    char        what[64]   = "";
+    for (size_t i = 0; i < tones.size(); i++) {
+        const Tone& t      = tones[i];
+        int         band   = fft.Band(t.hz, fs);
+        int         expect = BarPx(20.0f * log10f(t.amp) + BoxDb(t.hz, rate, dec));
+
+        // Local peak: taller than every band 2+ away, as tall as its neighbours
+        bool peak = band >= 0;
+        for (int b = 0; peak && b < SCOPE_BANDS; b++) {
+            if (abs(b - band) >= 2 && abs(b - band) < 4 && bars[b] > bars[band]) peak = false;
+        }
+        // Far bands ≥24dB down (other tones' own peaks aside)
+        int leak = 0;
+        for (int b = 0; b < SCOPE_BANDS; b++) {
+            bool near_tone = false;
+            for (const Tone& o : tones) near_tone = near_tone || abs(b - fft.Band(o.hz, fs)) < 4;
+            if (!near_tone && bars[b] > leak) leak = bars[b];
+        }
+        bool height = bars[band] <= expect + 1 && bars[band] >= expect - scallop_px - 1;
+        bool quiet  = leak <= bars[band] - BarPx(SCOPE_FLOOR_DB + 24.0f);
+        snprintf(what + strlen(what), sizeof(what) - strlen(what), "%s%.0fHz", i ? "+" : "", t.hz);
+        printf("  %5.0fHz %4.0fdB: band %2d (%5.0fHz), bar %2dpx (expected %d), far bands <= %2dpx  %s\n", t.hz,
+               20.0f * log10f(t.amp), band, band >= 0 ? fft.BandHz(band, fs) : 0.0f, bars[band], expect, leak,
+               peak && height && quiet ? "ok" : "WRONG");
+        ok = ok && peak && height && quiet;
+    }
+    printf("spectrum %2.0fkHz %-14s %d FFT steps  %s\n", rate / 1000.0f, what, steps, ok ? "ok" : "WRONG");
+    return ok;
+}
+
+// ============================================
+// Scope
+// ============================================
+bool Scope(float rate, const std::vector<Tone>& tones) {
+    static SnapshotRing ring;
+    static Framebuffer  fb;
+    const float*        frame = Snapshot(&ring, rate, tones);
+    float               fs    = rate / ring.Decimation();
+
+    fb.Fill(false);
+    DrawScope(fb, frame);
+
+    // Trace back from the pixels: above / below the centre row per column
+    int rising = 0, state = 0, top_row = HEIGHT, bottom_row = -1, first_bottom = -1, lit = 0;
+    for (int x = 0; x < WIDTH; x++) {
+        int top, bottom;
+        lit += fb.Column(x, &top, &bottom);
+        if (x == 0) first_bottom = bottom;
+        if (top < top_row) top_row = top;
+        if (bottom > bottom_row) bottom_row = bottom;
+        int now = bottom < MID ? 1 : (top > MID ? -1 : 0);
+        if (now == 1 && state == -1) rising++;
+        if (now) state = now;
+    }
+
+    // The same from the samples: trigger, crossings over the drawn window
+    size_t start = 0;
+    for (size_t i = 1; i + WIDTH < SCOPE_FRAME; i++) {
+        if (frame[i - 1] < 0.0f && frame[i] >= 0.0f) {
+            start = i;
+            break;
+        }
+    }
+    int   expect = 0;
+    float peak = 0.0f, high = -1.0f, low = 1.0f;
+    for (int x = 0; x < WIDTH; x++) {
+        float v = frame[start + x];
+        peak    = fmaxf(peak, fabsf(v));
+        high    = fmaxf(high, v);
+        low     = fminf(low, v);
+        if (x > 0 && frame[start + x - 1] < 0.0f && v >= 0.0f) expect++;
+    }
+
+    bool  ok;
+    float cycles = tones.empty() ? 0.0f : tones[0].hz * WIDTH / fs;
+    if (tones.empty()) {
+        ok = top_row == MID && bottom_row == MID && lit == WIDTH;
+        printf("scope    %2.0fkHz silence         flat line on row %d-%d, %d pixels  %s\n", rate / 1000.0f, top_row,
+               bottom_row, lit, ok ? "ok" : "WRONG");
+        return ok;
+    }
+
+    // Rows the samples land on at the auto-range gain (1 / peak, at most
+    // 100): the highest and lowest sample set the trace's extent, and a
+    // tone of 0.01 or more reaches the top or bottom of the screen
+    const float half  = 0.5f * (SCOPE_BOTTOM - SCOPE_TOP);
+    float       gain  = 1.0f / fmaxf(peak, 0.01f);
+    int         upper = (int)(MID - 0.5f - high * gain * half + 0.5f);
+    int         lower = (int)(MID - 0.5f - low * gain * half + 0.5f);
+    bool        edge  = peak < 0.01f || upper == SCOPE_TOP || lower == SCOPE_BOTTOM;
+
+    // Column 0 is the first sample at or above zero: the rising trace
+    // leaves it from its lowest pixel, on the centre row or one step above
+    // (a tone too low to cross upwards with a screen's width of frame
+    // after it is drawn from the frame's start)
+    float step      = start > 0 ? (frame[start] - frame[start - 1]) * gain * half : 0.0f;
+    bool  triggered = start == 0 || (first_bottom <= MID && first_bottom >= MID - 1 - (int)step);
+    bool  ranged    = top_row == upper && bottom_row == lower && edge;
+    bool  crossings = rising == expect && fabsf(rising - cycles) <= 1.0f;
+    ok              = triggered && ranged && crossings;
+    printf("scope    %2.0fkHz %6.0fHz x%.3f  %s row %2d, rows %d-%d (samples %d-%d), %2d rising crossings "
+           "(samples %2d, f x 128 / rate %5.2f)  %s\n",
+           rate / 1000.0f, tones[0].hz, tones[0].amp, start ? "starts" : "free  ", first_bottom, top_row, bottom_row, upper, lower, rising, expect,
+           cycles,
+           ok ? "ok" : "WRONG");
+    return ok;
+}
+
+int main() {
+    bool        ok      = true;
+    const float rates[] = {48000.0f, 32000.0f, 96000.0f};
+    for (float rate : rates) {
+        for (float hz : {187.5f, 440.0f, 1000.0f, 2812.5f, 5000.0f, 9000.0f}) {
+            ok = Spectrum(rate, {{hz, 0.25f}}) && ok;
+        }
+        ok = Spectrum(rate, {{440.0f, 0.5f}, {3000.0f, 0.0625f}}) && ok;
+        ok = Spectrum(rate, {{1000.0f, 1.0f}}) && ok;  // Clipped at the top
+    }
+    for (float rate : rates) {
+        for (float hz : {100.0f, 440.0f, 1000.0f, 3000.0f}) {
+            ok = Scope(rate, {{hz, 0.8f}}) && ok;
+        }
+        ok = Scope(rate, {{440.0f, 0.004f}}) && ok;  // Under the auto-range limit
+        ok = Scope(rate, {}) && ok;
+    }
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,199 @@
+/*
+ * STRUM CHECK - Strummer.h through the firmware's event loop, on the host
+ *
+ * RENDER:
+ *   Strums go into Strummer's EventScheduler and come out of the same
+ *   segment loop as in the audio callback (4-sample blocks, events applied
+ *   when due, SamplesUntilNextEvent() to the next one), with the sample
+ *   count about to wrap. Every pluck is logged with the sample it landed
+ *   on.
+ *
+ * WHAT IT CHECKS:
+ *   - spacing: at 32/48/96kHz and 0..250ms (and out-of-range values,
+ *     clamped), the notes of a chord are Spacing() apart, within half a
+ *     sample of the ms asked for, strings in order up and down
+ *   - a spacing change during a chord leaves that chord alone
+ *   - full scheduler: strums every ~20ms with a long spacing overlap far
+ *     more chords than fit; Strum() refuses exactly when fewer than 4
+ *     slots are free, Dropped() counts the refusals, and every accepted
+ *     chord plays all 4 notes on time - never a partial chord
+ *
+ *   strum_check [seconds of hammering]
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
+#include "../Strummer.h"
+
+const int      STRINGS = 7;
+const size_t   SLOTS   = 32;  // Firmware scheduler size
+const size_t   BLOCK   = 4;   // Firmware AUDIO_BLOCK_SIZE
+const uint32_t START   = 0xFFFFF000;
+
+typedef Strummer<STRINGS, SLOTS> KalimbaStrummer;
+
+// ============================================
+// Random numbers
+// ============================================
+uint32_t rng = 2024;
+
+uint32_t Next() {
+    rng = rng * 1664525u + 1013904223u;
+    return rng >> 8;
+}
+
+// ============================================
+// Plucks: expected and played
+// ============================================
+struct Pluck {
+    uint32_t time;
+    int      string, octave;
+
+    bool operator<(const Pluck& o) const {
+        if (time != o.time) return (int32_t)(time - o.time) < 0;
+        if (string != o.string) return string < o.string;
+        return octave < o.octave;
+    }
+    bool operator==(const Pluck& o) const { return time == o.time && string == o.string && octave == o.octave; }
+};
+
+// The chord as it should sound
+void ExpectChord(std::vector<Pluck>* out, int root, uint32_t start, int octave, bool down, uint32_t spacing) {
+    for (int n = 0; n < STRUM_NOTES; n++) {
+        int degree = root + 2 * n;
+        int order  = down ? STRUM_NOTES - 1 - n : n;
+        out->push_back({start + order * spacing, degree % STRINGS, octave + degree / STRINGS});
+    }
+}
+
+// One audio block of the firmware's segment loop
+struct Render {
+    KalimbaStrummer    strummer;
+    uint32_t           sample = START;
+    std::vector<Pluck> played;
+    size_t             late = 0;
+
+    void Block() {
+        size_t done = 0;
+        while (done < BLOCK) {
+            uint32_t    now = sample + (uint32_t)done;
+            EngineEvent e;
+            while (strummer.Scheduler().Peek(&e) && EventDue(e.time, now)) {
+                strummer.Scheduler().Pop();
+                late += e.time != now;
+                played.push_back({now, e.data1, e.octave});
+            }
+            done += SamplesUntilNextEvent(strummer.Scheduler(), now, BLOCK - done);
+        }
+        sample += BLOCK;
+    }
+
+    void Run(uint32_t samples) {
+        for (uint32_t s = 0; s < samples; s += BLOCK) Block();
+    }
+};
+
+bool Same(std::vector<Pluck> a, std::vector<Pluck> b) {
+    std::sort(a.begin(), a.end());
+    std::sort(b.begin(), b.end());
+    return a == b;
+}
+
+// ============================================
+// Spacing accuracy
+// ============================================
+bool Spacing() {
+    const float rates[] = {32000.0f, 48000.0f, 96000.0f};
+    const float ms[]    = {0.0f, 1.0f, 7.5f, 13.3f, 30.0f, 60.0f, 127.0f, 250.0f, 400.0f, -5.0f};
+    bool        ok      = true;
+    for (float rate : rates) {
+        double worst = 0.0;
+        size_t wrong = 0;
+        for (float m : ms) {
+            for (int down = 0; down < 2; down++) {
+                Render r;
+                r.strummer.Init(rate);
+                r.strummer.SetSpacing(m, rate);
+                r.Run(Next() % 64);  // Chords start anywhere in a block
+                int      root = (int)(Next() % STRINGS), octave = (int)(Next() % 3) - 1;
+                uint32_t start = r.sample + 2 * BLOCK + Next() % BLOCK;
+                r.strummer.Strum(root, start, octave, down);
+
+                // A change during the chord is for the next chord only
+                uint32_t spacing = r.strummer.Spacing();
+                r.Run(BLOCK * 3);
+                r.strummer.SetSpacing(m + 11.0f, rate);
+                r.Run(4 * spacing + 16 * BLOCK);
+
+                std::vector<Pluck> expected;
+                ExpectChord(&expected, root, start, octave, down, spacing);
+                wrong += !Same(r.played, expected) || r.late;
+
+                // Spacing against the ms asked for (clamped)
+                float  clamped = m < 0.0f ? 0.0f : (m > STRUM_SPACING_MAX_MS ? STRUM_SPACING_MAX_MS : m);
+                double ideal   = clamped * 0.001 * rate;
+                worst          = std::max(worst, fabs((double)spacing - ideal));
+            }
+        }
+        printf("%2.0fkHz  0..250ms up/down: spacing off by at most %.2f samples (%.1fus), %zu chords wrong\n",
+               rate / 1000.0f, worst, worst * 1e6 / rate, wrong);
+        ok = ok && worst <= 0.5 && wrong == 0;
+    }
+    return ok;
+}
+
+// ============================================
+// Full scheduler
+// ============================================
+bool Hammer(float seconds) {
+    const float rate = 48000.0f;
+    Render      r;
+    r.strummer.Init(rate);
+
+    std::vector<Pluck> expected;
+    uint32_t           accepted = 0, refused = 0, refused_wrongly = 0, accepted_wrongly = 0;
+    uint32_t           end      = (uint32_t)(seconds * rate);
+    for (uint32_t t = 0; t < end; t += BLOCK) {
+        // A strum every ~20ms on average, spacing changed now and then (up
+        // to 250ms: a chord then spans 750ms, far more than 8 overlap)
+        if (Next() % 256 == 0) {
+            if (Next() % 8 == 0) r.strummer.SetSpacing((float)(Next() % 251), rate);
+            size_t   free    = SLOTS - r.strummer.Scheduler().Count();
+            int      root    = (int)(Next() % STRINGS);
+            bool     down    = Next() & 1;
+            uint32_t start   = r.sample;  // Like a button: first note on this block
+            uint32_t spacing = r.strummer.Spacing();
+            if (r.strummer.Strum(root, start, 0, down)) {
+                accepted++;
+                accepted_wrongly += free < (size_t)STRUM_NOTES;
+                ExpectChord(&expected, root, start, 0, down, spacing);
+            } else {
+                refused++;
+                refused_wrongly += free >= (size_t)STRUM_NOTES;
+            }
+        }
+        r.Block();
+    }
+    r.Run((uint32_t)(3 * STRUM_SPACING_MAX_MS * 0.001f * rate) + BLOCK);  // Let the last chords finish
+
+    bool same = Same(r.played, expected);
+    printf("full scheduler: %u strums, %u accepted, %u refused (Dropped() %u), %u refused with room, "
+           "%u accepted without; %zu plucks played of %zu expected, %zu late%s\n",
+           accepted + refused, accepted, refused, r.strummer.Dropped(), refused_wrongly, accepted_wrongly,
+           r.played.size(), expected.size(), r.late, same ? "" : " - PARTIAL OR MOVED CHORDS");
+    return refused > 0 && refused == r.strummer.Dropped() && refused_wrongly == 0 && accepted_wrongly == 0
+        && same && r.late == 0;
+}
+
+int main(int argc, char** argv) {
+    float seconds = argc > 1 ? (float)atof(argv[1]) : 120.0f;
+    bool  ok      = Spacing();
+    ok            = Hammer(seconds) && ok;
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
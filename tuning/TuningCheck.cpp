@@ -0,0 +1,242 @@
+/*
+ * TUNING CHECK - TuningTable.h swapped under a running audio thread, on
+ * the host
+ *
+ * SETUP:
+ *   A main loop thread sends TuningLoader commands as fast as it can:
+ *   every generation is 5 SCALE lines and a COMMIT, with Service() until
+ *   it is installed (or, now and then, the next generation committed on
+ *   top of one still waiting), plus RESETs and rejected lines. Every
+ *   pitch and name of a generation carries its number, so any table can
+ *   be checked on its own. An audio thread calls Acquire() once per block
+ *   as the firmware does, checks the whole table, yields mid-block (so on
+ *   any core count the main loop runs while the block holds the table),
+ *   then checks it again.
+ *
+ * WHAT IT CHECKS:
+ *   - every table a block sees is one complete generation (or the
+ *     power-on scales): names, base pitches and all 5 octaves of
+ *     precomputed pitches agree, at the start and at the end of the block
+ *   - generations only move forward; the last one committed is the one
+ *     the audio thread ends up with
+ *   - control: a main loop that writes the published table in place
+ *     (no double buffer) is caught tearing blocks - the check can fail
+ *
+ *   tuning_check [seconds]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "../TuningTable.h"
+
+typedef std::chrono::steady_clock Clock;
+
+// ============================================
+// Generations: every field derived from the number
+// ============================================
+float GenFreq(uint32_t gen, int scale, int s) {
+    return 100.0f + 37.0f * scale + 11.0f * s + (float)(gen % 3000);
+}
+
+const char* ScaleLine(char* line, size_t size, uint32_t gen, int scale, float first_freq) {
+    int n = snprintf(line, size, "SCALE %d g%us%d", scale + 1, (unsigned)gen, scale);
+    for (int s = 0; s < NUM_STRINGS; s++) {
+        float f = s == 0 ? first_freq : GenFreq(gen, scale, s);
+        n += snprintf(line + n, size - n, " N%d=%.1f", s, f);
+    }
+    return line;
+}
+
+TuningTable defaults;
+
+// Generation of a complete table; -1 if it is torn or wrong, 0 for the
+// power-on scales
+int64_t Generation(const TuningTable& t) {
+    if (memcmp(&t, &defaults, sizeof(t)) == 0) return 0;
+    unsigned gen = 0;
+    if (sscanf(t.scale_names[0], "g%us0", &gen) != 1) return -1;
+    for (int i = 0; i < NUM_SCALES; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "g%us%d", gen, i);
+        if (strcmp(t.scale_names[i], name) != 0) return -1;
+        for (int s = 0; s < NUM_STRINGS; s++) {
+            char note[4];
+            snprintf(note, sizeof(note), "N%d", s);
+            if (strcmp(t.note_names[i][s], note) != 0 || t.base[i][s] != GenFreq(gen, i, s)) return -1;
+            for (int o = 0; o < TUNING_OCTAVES; o++) {
+                if (t.freq[i][o][s] != t.base[i][s] * OCTAVE_RATIOS[o]) return -1;
+            }
+        }
+    }
+    return gen;
+}
+
+// ============================================
+// Audio thread
+// ============================================
+struct Audio {
+    TuningTables*     tables;
+    std::atomic<bool> stop{false};
+    uint64_t          blocks = 0, swaps = 0, torn = 0, backwards = 0;
+    int64_t           last   = 0;
+    float             sink   = 0.0f;
+
+    void Run() {
+        const TuningTable* active = nullptr;
+        while (!stop.load(std::memory_order_relaxed)) Block(&active);
+        Block(&active);  // Pick up the final publish
+    }
+
+    void Block(const TuningTable** active) {
+        const TuningTable* t = tables->Acquire();
+        swaps += t != *active;
+        *active = t;
+        blocks++;
+
+        int64_t gen = Generation(*t);
+        for (int s = 0; s < NUM_STRINGS; s++) sink += t->Freq(blocks % NUM_SCALES, (int)(blocks % 5) - 2, s);
+        std::this_thread::yield();  // The main loop runs while this block holds the table
+        if (gen < 0 || Generation(*t) != gen) {
+            torn++;
+            return;
+        }
+        if (gen > 0) {
+            backwards += gen < last;
+            last = gen;
+        }
+    }
+};
+
+// ============================================
+// Main loop thread
+// ============================================
+struct MainLoop {
+    TuningLoader loader;
+    uint32_t     gen       = 0;  // Last generation committed
+    uint64_t     installed = 0, waits = 0, replaced = 0, resets = 0, rejected = 0, unexpected = 0;
+    int64_t      final_gen = 0;
+
+    void Send(uint32_t g, float first_freq = 0.0f) {
+        char line[TUNING_LINE_MAX];
+        for (int i = 0; i < NUM_SCALES; i++) {
+            TuningLoader::Result r = loader.Command(ScaleLine(line, sizeof(line), g, i, first_freq > 0.0f ? first_freq : GenFreq(g, i, 0)));
+            if (first_freq > 0.0f) {
+                rejected += r == TuningLoader::REJECTED;
+                unexpected += r != TuningLoader::REJECTED;
+                return;
+            }
+            unexpected += r != TuningLoader::STAGED;
+        }
+    }
+
+    void Finish(TuningLoader::Result r) {
+        while (r == TuningLoader::NONE) {
+            waits++;
+            std::this_thread::yield();
+            r = loader.Service();
+        }
+        installed += r == TuningLoader::INSTALLED;
+        unexpected += r != TuningLoader::INSTALLED;
+    }
+
+    void Run(TuningTables* tables, float seconds, uint32_t* rng) {
+        loader.Init(tables, defaults);
+        Clock::time_point end = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(seconds));
+        while (Clock::now() < end) {
+            *rng     = *rng * 1664525u + 1013904223u;
+            uint32_t dice = *rng >> 24;
+            if (dice < 3) {
+                resets++;
+                Finish(loader.Command("RESET"));
+                final_gen = 0;
+                continue;
+            }
+            if (dice < 16) Send(gen + 1, 5000.0f);  // Out of range: rejected, staged scales kept
+            Send(++gen);
+            TuningLoader::Result r = loader.Command("COMMIT");
+            if (r == TuningLoader::NONE && dice < 64) {
+                replaced++;  // Next generation over the one still waiting
+                Send(++gen);
+                r = loader.Command("COMMIT");
+            }
+            Finish(r);
+            final_gen = gen;
+        }
+    }
+};
+
+// ============================================
+// Control: no double buffer
+// ============================================
+uint64_t Unguarded(TuningTables* tables, float seconds) {
+    Audio audio;
+    audio.tables = tables;
+    std::thread thread([&] { audio.Run(); });
+
+    Clock::time_point end = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(seconds));
+    for (uint32_t gen = 1; Clock::now() < end; gen++) {
+        TuningTable* t = const_cast<TuningTable*>(tables->Published());  // The table in use
+        for (int i = 0; i < NUM_SCALES; i++) {
+            char        name[16];
+            const char* notes[NUM_STRINGS] = {"N0", "N1", "N2", "N3", "N4", "N5", "N6"};
+            float       freqs[NUM_STRINGS];
+            snprintf(name, sizeof(name), "g%us%d", gen, i);
+            for (int s = 0; s < NUM_STRINGS; s++) freqs[s] = GenFreq(gen, i, s);
+            t->SetScale(i, name, notes, freqs);
+            std::this_thread::yield();
+        }
+        t->Prepare();
+    }
+    audio.stop = true;
+    thread.join();
+    return audio.torn;
+}
+
+int main(int argc, char** argv) {
+    float seconds = argc > 1 ? (float)atof(argv[1]) : 10.0f;
+    for (int i = 0; i < NUM_SCALES; i++) {
+        defaults.SetScale(i, scale_names[i], scale_note_names[i], scale_frequencies[i]);
+    }
+    defaults.Prepare();
+
+    static TuningTables tables;
+    tables.Init(defaults);
+    Audio audio;
+    audio.tables = &tables;
+    MainLoop main_loop;
+    uint32_t rng = 2024;
+
+    std::thread thread([&] { audio.Run(); });
+    main_loop.Run(&tables, seconds, &rng);
+    audio.stop = true;
+    thread.join();
+
+    int64_t ended = Generation(*tables.Acquire());
+    printf("main loop: %llu tables installed (%llu committed over one waiting), %llu resets, "
+           "%llu lines rejected, %llu Service() waits for the swap, %llu unexpected results\n",
+           (unsigned long long)main_loop.installed, (unsigned long long)main_loop.replaced,
+           (unsigned long long)main_loop.resets, (unsigned long long)main_loop.rejected,
+           (unsigned long long)main_loop.waits, (unsigned long long)main_loop.unexpected);
+    printf("audio:     %llu blocks, %llu swaps seen, %llu torn tables, %llu generations backwards, "
+           "ended on generation %lld of %lld\n",
+           (unsigned long long)audio.blocks, (unsigned long long)audio.swaps, (unsigned long long)audio.torn,
+           (unsigned long long)audio.backwards, (long long)ended, (long long)main_loop.final_gen);
+    bool ok = audio.torn == 0 && audio.backwards == 0 && main_loop.unexpected == 0 && main_loop.installed > 0
+           && main_loop.waits > 0 && ended == main_loop.final_gen;
+
+    static TuningTables control;
+    control.Init(defaults);
+    uint64_t torn = Unguarded(&control, seconds < 1.0f ? seconds : 1.0f);
+    printf("control:   writing the table in use tore %llu blocks%s\n", (unsigned long long)torn,
+           torn ? "" : " - THE CHECK CANNOT SEE TEARING");
+    ok = ok && torn > 0;
+
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,224 @@
+/*
+ * WAV CHECK - WavRecorder.h streaming to a file through a slow "card",
+ * on the host
+ *
+ * SETUP:
+ *   An audio thread pushes 4-sample blocks at the real 48kHz pace; a main
+ *   loop thread calls Service() as fast as it can. StdioWavSink writes a
+ *   plain file with a simulated latency per write, and StallSink adds a
+ *   long stall every few writes. The ring is 64K samples (1.4s) instead of
+ *   the firmware's 1M (22s), so stalls overflow it in seconds.
+ *
+ * CARDS:
+ *   steady   10ms per 32KB write (~3MB/s): must never overrun
+ *   stalls   10ms per write + 2.5s every 6th: drops blocks only while
+ *            stalled, catches up after
+ *   slow     700ms per write (~47KB/s, half the 96KB/s needed): drops
+ *            blocks all the time
+ *   failing  10ms per write; the 9th write takes half its data and
+ *            every later one fails (card pulled / full)
+ *
+ * WHAT IT CHECKS:
+ *   - the file is a valid WAV whose header sizes match its data
+ *   - the data is the pushed signal in order, whole blocks missing only
+ *     where blocks were dropped, and dropped blocks == Overruns()
+ *   - steady: nothing dropped, every pushed sample in the file
+ *   - stalls / slow: overruns counted, never a stall of the audio thread
+ *     (longest Push() shown)
+ *   - failing: the recording stops at the error, which is counted once,
+ *     and the header's sizes match the data the card took
+ *
+ *   wav_check [seconds per card]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "../WavRecorder.h"
+
+const float    SAMPLE_RATE = 48000.0f;
+const size_t   BLOCK       = 4;        // Firmware AUDIO_BLOCK_SIZE
+const uint32_t RING        = 1 << 16;  // Power of two, multiple of CHUNK
+const char*    PATH        = "wav_check.wav";
+
+typedef std::chrono::steady_clock Clock;
+
+// ============================================
+// Signal: a hash of the sample index, so blocks can be found in the file
+// ============================================
+int Code(uint32_t n) {
+    uint32_t h = n * 2654435761u;
+    h ^= h >> 15;
+    return (int)(h & 0x7FFF) - 0x4000;
+}
+
+float Signal(uint32_t n) { return Code(n) / 32768.0f; }
+
+// ============================================
+// Card with periodic stalls, or one that fails
+// ============================================
+class StallSink : public StdioWavSink {
+  public:
+    StallSink(const char* path, uint32_t latency_us, int stall_every, uint32_t stall_us, int fail_at)
+        : StdioWavSink(path), stall_every_(stall_every), stall_us_(stall_us), fail_at_(fail_at) {
+        SetWriteLatency(latency_us);
+    }
+
+    // From write fail_at on: half the data, then nothing
+    size_t Write(const void* buf, size_t bytes) {
+        writes_++;
+        if (stall_every_ && writes_ % stall_every_ == 0) usleep(stall_us_);
+        if (fail_at_ && writes_ > fail_at_) return 0;
+        if (fail_at_ && writes_ == fail_at_) return StdioWavSink::Write(buf, bytes / 2);
+        return StdioWavSink::Write(buf, bytes);
+    }
+
+  private:
+    int      stall_every_;
+    uint32_t stall_us_;
+    int      fail_at_;
+    int      writes_ = 0;
+};
+
+// ============================================
+// One recording
+// ============================================
+struct Result {
+    uint32_t pushed, overruns, write_errors, bytes_written, max_push_ns;
+    float    max_fill;
+};
+
+Result Record(StallSink* sink, float seconds) {
+    static int16_t          ring[RING];
+    WavRecorder<StallSink>  recorder;
+    recorder.Init(sink, ring, RING, SAMPLE_RATE);
+    recorder.TogglePress();
+    recorder.Service();  // Opens the file
+
+    Result            result = {};
+    std::atomic<bool> done{false};
+    std::thread       audio([&] {
+        uint32_t blocks = (uint32_t)(seconds * SAMPLE_RATE / BLOCK);
+        auto     start  = Clock::now();
+        float    buf[BLOCK];
+        for (uint32_t b = 0; b < blocks; b++) {
+            std::this_thread::sleep_until(start + std::chrono::nanoseconds((uint64_t)(b * BLOCK * 1e9 / SAMPLE_RATE)));
+            for (size_t i = 0; i < BLOCK; i++) buf[i] = Signal(b * BLOCK + (uint32_t)i);
+            auto t0 = Clock::now();
+            recorder.Push(buf, BLOCK);
+            uint32_t ns = (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+            result.max_push_ns = ns > result.max_push_ns ? ns : result.max_push_ns;
+            float fill = recorder.Fill();
+            result.max_fill = fill > result.max_fill ? fill : result.max_fill;
+        }
+        result.pushed = blocks * BLOCK;
+        recorder.TogglePress();
+        done = true;
+    });
+
+    while (!done || recorder.IsRecording()) {
+        recorder.Service();
+        std::this_thread::sleep_for(std::chrono::microseconds(200));  // Rest of the main loop
+    }
+    audio.join();
+    result.overruns      = recorder.Overruns();
+    result.write_errors  = recorder.WriteErrors();
+    result.bytes_written = recorder.BytesWritten();
+    return result;
+}
+
+// ============================================
+// Read the file back
+// ============================================
+uint32_t Get32(const uint8_t* p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24; }
+
+// stopped: the recording ended early (card error), so the blocks after
+// the end of the file are not dropped ones
+bool Verify(const char* name, const Result& r, bool stopped) {
+    FILE* f = fopen(PATH, "rb");
+    if (!f) return false;
+    std::vector<uint8_t> file;
+    uint8_t              buf[65536];
+    size_t               n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) file.insert(file.end(), buf, buf + n);
+    fclose(f);
+
+    bool     header_ok = file.size() >= WavHeader::SIZE && memcmp(&file[0], "RIFF", 4) == 0
+                  && memcmp(&file[WavHeader::SIZE - 8], "data", 4) == 0;
+    uint32_t data      = header_ok ? Get32(&file[WavHeader::SIZE - 4]) : 0;
+    header_ok          = header_ok && data == file.size() - WavHeader::SIZE
+                && Get32(&file[4]) == file.size() - 8 && Get32(&file[24]) == (uint32_t)SAMPLE_RATE
+                && data == r.bytes_written;
+
+    // Walk the pushed blocks: each block in the file is the next one, or a
+    // later one after dropped blocks
+    const int16_t* pcm     = (const int16_t*)&file[WavHeader::SIZE];
+    size_t         samples = data / 2;
+    uint32_t       next = 0, dropped = 0;
+    bool           order_ok = samples % BLOCK == 0;
+    for (size_t i = 0; order_ok && i < samples; i += BLOCK) {
+        for (;; next += BLOCK, dropped++) {
+            if (next >= r.pushed) {
+                order_ok = false;
+                break;
+            }
+            bool match = true;
+            for (size_t k = 0; k < BLOCK && match; k++) match = abs(pcm[i + k] - Code(next + (uint32_t)k)) <= 1;
+            if (match) break;
+        }
+        next += BLOCK;
+    }
+    if (!stopped) dropped += (r.pushed - next) / BLOCK;  // Dropped at the very end
+
+    printf("%-8s %6.2fs pushed, %6.2fs in the file, %5u blocks dropped, %5u overruns, %u write errors, "
+           "ring max %3.0f%%, longest Push() %uus\n",
+           name, r.pushed / SAMPLE_RATE, samples / SAMPLE_RATE, dropped, r.overruns, r.write_errors,
+           r.max_fill * 100.0f, r.max_push_ns / 1000);
+    if (!header_ok) printf("    bad header\n");
+    if (!order_ok) printf("    data out of order / not the pushed signal\n");
+    return header_ok && order_ok && dropped == r.overruns;
+}
+
+int main(int argc, char** argv) {
+    float seconds = argc > 1 ? (float)atof(argv[1]) : 6.0f;
+
+    struct Card {
+        const char* name;
+        uint32_t    latency_us;
+        int         stall_every;
+        uint32_t    stall_us;
+        int         fail_at;
+    };
+    const Card cards[] = {
+        {"steady", 10000, 0, 0, 0},
+        {"stalls", 10000, 6, 2500000, 0},
+        {"slow", 700000, 0, 0, 0},
+        {"failing", 10000, 0, 0, 9},
+    };
+
+    bool ok = true;
+    for (const Card& c : cards) {
+        StallSink sink(PATH, c.latency_us, c.stall_every, c.stall_us, c.fail_at);
+        Result    r    = Record(&sink, seconds);
+        bool      good = Verify(c.name, r, c.fail_at != 0);
+        if (c.fail_at) {
+            // Stopped at the error: the chunks written before it (write 1 is
+            // the header) and half of the one that failed
+            uint32_t expect = (c.fail_at - 2) * WavRecorder<StallSink>::CHUNK * 2 + WavRecorder<StallSink>::CHUNK;
+            good = good && r.write_errors == 1 && r.bytes_written == expect;
+        } else {
+            // The steady card keeps up; the others must drop (and count) blocks
+            good = good && r.write_errors == 0
+                && (c.stall_every == 0 && c.latency_us < 100000 ? r.overruns == 0 : r.overruns > 0);
+        }
+        ok   = ok && good;
+    }
+    remove(PATH);
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
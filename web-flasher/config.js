@@ -0,0 +1,89 @@
+/**
+ * Digital Kalimba settings block (same layout as KalimbaConfig.h)
+ *
+ * Encoded here, written by DFU to its own QSPI sector, parsed by the
+ * firmware at boot.
+ */
+
+export const CONFIG_ADDRESS = 0x90000000 + 0x7F0000;  // KALIMBA_CONFIG_QSPI_OFFSET
+export const CONFIG_MAGIC = 0x4746434B;                // "KCFG"
+export const CONFIG_VERSION = 2;
+export const CONFIG_HEADER_SIZE = 12;
+export const NUM_STRINGS = 7;
+export const NUM_POTS = 6;
+export const NUM_SCALES = 5;
+export const PIN_DEFAULT = 0xFF;
+export const NO_SCALE = 0xFF;
+export const CONFIG_V1_SIZE = 1 + NUM_POTS * 4 + NUM_STRINGS + 1 + 16 + NUM_STRINGS * 4 + NUM_STRINGS * 4;
+export const CONFIG_V2_SIZE = CONFIG_V1_SIZE + 1;
+
+// Same values the firmware uses when nothing is written
+export function defaultSettings() {
+    return {
+        potsFitted: 0x3F,
+        potValues: new Array(NUM_POTS).fill(0.5),
+        buttonPins: new Array(NUM_STRINGS).fill(null),  // null = firmware default
+        customScaleSlot: null,                           // 0-4 or null
+        customScaleName: '',
+        customNoteNames: new Array(NUM_STRINGS).fill(''),
+        customFreqs: new Array(NUM_STRINGS).fill(0),
+        sampleRateKhz: 48
+    };
+}
+
+/**
+ * CRC-32 (IEEE, reflected) - matches KalimbaCrc32()
+ */
+export function crc32(bytes) {
+    let crc = 0xFFFFFFFF;
+    for (const byte of bytes) {
+        crc ^= byte;
+        for (let b = 0; b < 8; b++) {
+            crc = (crc >>> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return (crc ^ 0xFFFFFFFF) >>> 0;
+}
+
+function writeChars(view, offset, text, size) {
+    for (let i = 0; i < size - 1 && i < text.length; i++) {
+        view.setUint8(offset + i, text.charCodeAt(i) & 0x7F);  // ASCII only (OLED font)
+    }
+    return offset + size;  // Rest stays zero = terminated
+}
+
+/**
+ * Settings → header + payload, ready to write at CONFIG_ADDRESS
+ */
+export function encodeConfig(settings) {
+    const payload = new Uint8Array(CONFIG_V2_SIZE);
+    const view = new DataView(payload.buffer);
+    let o = 0;
+
+    view.setUint8(o++, settings.potsFitted & 0x3F);
+    for (let p = 0; p < NUM_POTS; p++, o += 4) {
+        view.setFloat32(o, settings.potValues[p], true);
+    }
+    for (let s = 0; s < NUM_STRINGS; s++) {
+        const pin = settings.buttonPins[s];
+        view.setUint8(o++, pin === null ? PIN_DEFAULT : pin);
+    }
+    view.setUint8(o++, settings.customScaleSlot === null ? NO_SCALE : settings.customScaleSlot);
+    o = writeChars(view, o, settings.customScaleName, 16);
+    for (let s = 0; s < NUM_STRINGS; s++) {
+        o = writeChars(view, o, settings.customNoteNames[s], 4);
+    }
+    for (let s = 0; s < NUM_STRINGS; s++, o += 4) {
+        view.setFloat32(o, settings.customFreqs[s], true);
+    }
+    view.setUint8(o++, settings.sampleRateKhz);
+
+    const block = new Uint8Array(CONFIG_HEADER_SIZE + CONFIG_V2_SIZE);
+    const header = new DataView(block.buffer);
+    header.setUint32(0, CONFIG_MAGIC, true);
+    header.setUint16(4, CONFIG_VERSION, true);
+    header.setUint16(6, CONFIG_V2_SIZE, true);
+    header.setUint32(8, crc32(payload), true);
+    block.set(payload, CONFIG_HEADER_SIZE);
+    return block;
+}
@@ -0,0 +1,395 @@
+/**
+ * DFU check: dfu.js against a simulated DfuSe bootloader (node 18+)
+ *
+ *   node dfu-check.mjs [sector.bin]
+ *
+ * The mock is a WebUSB device with the Daisy bootloader's two regions
+ * (internal flash, QSPI flash with 4KB sectors) and the DfuSe state
+ * machine: commands and data blocks go through DNLOAD / GETSTATUS with a
+ * busy state, flash bits only clear until erased, uploads only from idle.
+ * Protocol slips (a download while uploading, an address outside the
+ * selected region, an unknown command) are counted, not forgiven.
+ *
+ * Checks:
+ *   - connect() finds the DFU interface and both regions
+ *   - writeRegion() of a config.js settings block erases only the
+ *     settings sector, writes and reads it back, leaves DFU; every other
+ *     byte of both flashes is unchanged (sector-only write)
+ *   - a block spanning several transfers lands in order
+ *   - a stuck flash bit fails the verify
+ *   - a bootloader without the QSPI region is refused before erasing
+ *   - flash() after a sector write goes back to the internal flash
+ *
+ * With a path, the written sector is saved there (config/ parses it).
+ */
+
+import { writeFileSync } from 'node:fs';
+
+import { DFUDevice, DFU_STATE, DFU_STATUS } from './dfu.js';
+import { CONFIG_ADDRESS, defaultSettings, encodeConfig } from './config.js';
+
+const TRANSFER_SIZE = 1024;  // wTransferSize, as DFUDevice uses
+
+const REQUEST = { DNLOAD: 1, UPLOAD: 2, GETSTATUS: 3, CLRSTATUS: 4, GETSTATE: 5, ABORT: 6 };
+
+// ============================================
+// Simulated DfuSe device
+// ============================================
+class Region {
+    // "@Name /0xBASE/COUNT*SIZEKx": x = a (read only), g (read/erase/write)
+    constructor(alternateSetting, name, implicitErase) {
+        const m = /\/0x([0-9a-fA-F]+)\/(\d+)\*(\d+)K(\w)/.exec(name);
+        this.alternateSetting = alternateSetting;
+        this.name = name;
+        this.base = parseInt(m[1], 16);
+        this.sector = Number(m[3]) * 1024;
+        this.size = Number(m[2]) * this.sector;
+        this.implicitErase = implicitErase;  // Bootloader erases as it writes
+        this.memory = new Uint8Array(this.size);
+    }
+
+    contains(address, length = 1) {
+        return address >= this.base && address + length <= this.base + this.size;
+    }
+}
+
+class MockDfuSe {
+    constructor({ qspi = true } = {}) {
+        this.regions = [new Region(0, '@Internal Flash   /0x08000000/01*128Kg', true)];
+        if (qspi) {
+            this.regions.push(new Region(1, '@Flash   /0x90000000/2048*4Kg', false));
+        }
+        // Something in every byte: firmware, samples, an old settings block
+        for (const r of this.regions) {
+            for (let i = 0; i < r.size; i++) r.memory[i] = (i * 131 + 7) & 0xFF;
+        }
+        this.stuck = null;  // { address, mask }: bits that never clear
+        this.reset();
+    }
+
+    reset() {
+        this.alt = 0;
+        this.state = DFU_STATE.DFU_IDLE;
+        this.status = DFU_STATUS.OK;
+        this.pointer = 0;
+        this.pending = null;
+        this.gone = false;
+        this.erased = [];
+        this.errors = [];
+        this.manifested = false;
+    }
+
+    snapshot() {
+        return this.regions.map((r) => r.memory.slice());
+    }
+
+    region() {
+        return this.regions[this.alt];
+    }
+
+    fail(status, why) {
+        this.errors.push(why);
+        this.state = DFU_STATE.DFU_ERROR;
+        this.status = status;
+    }
+
+    // WebUSB surface
+    get configuration() {
+        return {
+            interfaces: [{
+                interfaceNumber: 0,
+                alternates: this.regions.map((r) => ({
+                    alternateSetting: r.alternateSetting,
+                    interfaceClass: 0xFE,
+                    interfaceSubclass: 0x01,
+                    interfaceName: r.name
+                }))
+            }]
+        };
+    }
+
+    get vendorId() { return 0x0483; }
+    get productId() { return 0xdf11; }
+    get manufacturerName() { return 'Electrosmith'; }
+    get productName() { return 'Daisy Bootloader (simulated)'; }
+
+    async open() {}
+    async close() {}
+    async claimInterface() {}
+    async releaseInterface() {}
+
+    async selectAlternateInterface(iface, alt) {
+        if (alt >= this.regions.length) throw new Error(`no alternate ${alt}`);
+        this.alt = alt;
+    }
+
+    async controlTransferOut(setup, data = new Uint8Array(0)) {
+        if (this.gone) throw new Error('device disconnected');
+        const bytes = new Uint8Array(data.buffer ? data.buffer.slice(data.byteOffset, data.byteOffset + data.byteLength) : data);
+        switch (setup.request) {
+            case REQUEST.DNLOAD: this.dnload(setup.value, bytes); break;
+            case REQUEST.CLRSTATUS: this.state = DFU_STATE.DFU_IDLE; this.status = DFU_STATUS.OK; break;
+            case REQUEST.ABORT: this.state = DFU_STATE.DFU_IDLE; this.pending = null; break;
+            default: this.fail(DFU_STATUS.ERR_STALLEDPKT, `OUT request ${setup.request}`);
+        }
+        return { status: 'ok', bytesWritten: bytes.length };
+    }
+
+    async controlTransferIn(setup, length) {
+        if (this.gone) throw new Error('device disconnected');
+        let out;
+        if (setup.request === REQUEST.GETSTATUS) {
+            out = this.getStatus();
+        } else if (setup.request === REQUEST.UPLOAD) {
+            out = this.upload(setup.value, length);
+            if (!out) return { status: 'stall', data: new DataView(new ArrayBuffer(0)) };
+        } else if (setup.request === REQUEST.GETSTATE) {
+            out = new Uint8Array([this.state]);
+        } else {
+            this.fail(DFU_STATUS.ERR_STALLEDPKT, `IN request ${setup.request}`);
+            return { status: 'stall', data: new DataView(new ArrayBuffer(0)) };
+        }
+        const buffer = new ArrayBuffer(out.length);
+        new Uint8Array(buffer).set(out);
+        return { status: 'ok', data: new DataView(buffer) };
+    }
+
+    dnload(block, bytes) {
+        if (this.state !== DFU_STATE.DFU_IDLE && this.state !== DFU_STATE.DFU_DNLOAD_IDLE) {
+            this.fail(DFU_STATUS.ERR_STALLEDPKT, `DNLOAD in state ${this.state}`);
+            return;
+        }
+        if (bytes.length === 0) {
+            this.state = DFU_STATE.DFU_MANIFEST_SYNC;
+            this.pending = { leave: true };
+            return;
+        }
+        this.pending = { block, bytes };
+        this.state = DFU_STATE.DFU_DNLOAD_SYNC;
+    }
+
+    // GETSTATUS runs a pending download: busy once, then idle (or error)
+    getStatus() {
+        let pollTimeout = 0;
+        if (this.state === DFU_STATE.DFU_DNLOAD_SYNC) {
+            pollTimeout = this.execute(this.pending) ? 5 : 1;
+            this.pending = null;
+            if (this.state !== DFU_STATE.DFU_ERROR) this.state = DFU_STATE.DFU_DNBUSY;
+        } else if (this.state === DFU_STATE.DFU_DNBUSY) {
+            this.state = DFU_STATE.DFU_DNLOAD_IDLE;
+        } else if (this.state === DFU_STATE.DFU_MANIFEST_SYNC) {
+            this.manifested = true;
+            this.gone = true;  // Runs the firmware: USB drops
+            this.state = DFU_STATE.DFU_MANIFEST;
+        }
+        return new Uint8Array([this.status, pollTimeout & 0xFF, (pollTimeout >> 8) & 0xFF, 0, this.state, 0]);
+    }
+
+    // True for an erase (slow)
+    execute({ block, bytes }) {
+        const r = this.region();
+        if (block === 0) {
+            const target = (bytes[1] | (bytes[2] << 8) | (bytes[3] << 16) | (bytes[4] << 24)) >>> 0;
+            if (bytes.length !== 5 || (bytes[0] !== 0x21 && bytes[0] !== 0x41)) {
+                this.fail(DFU_STATUS.ERR_STALLEDPKT, `unknown command 0x${bytes[0].toString(16)}`);
+                return false;
+            }
+            if (!r.contains(target)) {
+                this.fail(DFU_STATUS.ERR_ADDRESS, `0x${target.toString(16)} outside ${r.name.trim()}`);
+                return false;
+            }
+            if (bytes[0] === 0x21) {
+                this.pointer = target;
+                return false;
+            }
+            const start = target - ((target - r.base) % r.sector);
+            r.memory.fill(0xFF, start - r.base, start - r.base + r.sector);
+            this.erased.push(start);
+            return true;
+        }
+        if (block === 1) {
+            this.fail(DFU_STATUS.ERR_STALLEDPKT, 'DNLOAD block 1');
+            return false;
+        }
+        const address = this.pointer + (block - 2) * TRANSFER_SIZE;
+        if (!r.contains(address, bytes.length)) {
+            this.fail(DFU_STATUS.ERR_ADDRESS, `write 0x${address.toString(16)} outside ${r.name.trim()}`);
+            return false;
+        }
+        for (let i = 0; i < bytes.length; i++) {
+            const o = address - r.base + i;
+            let v = r.implicitErase ? bytes[i] : r.memory[o] & bytes[i];  // NOR flash: bits only clear
+            if (this.stuck && this.stuck.address === address + i) v |= this.stuck.mask;
+            r.memory[o] = v;
+        }
+        return false;
+    }
+
+    upload(block, length) {
+        if (this.state !== DFU_STATE.DFU_IDLE && this.state !== DFU_STATE.DFU_UPLOAD_IDLE) {
+            this.fail(DFU_STATUS.ERR_STALLEDPKT, `UPLOAD in state ${this.state}`);
+            return null;
+        }
+        const r = this.region();
+        const address = this.pointer + (block - 2) * TRANSFER_SIZE;
+        if (block < 2 || !r.contains(address, length)) {
+            this.fail(DFU_STATUS.ERR_ADDRESS, `read 0x${address.toString(16)} outside ${r.name.trim()}`);
+            return null;
+        }
+        this.state = DFU_STATE.DFU_UPLOAD_IDLE;
+        return r.memory.slice(address - r.base, address - r.base + length);
+    }
+}
+
+// ============================================
+// Helpers
+// ============================================
+let failures = 0;
+
+function check(name, ok, detail = '') {
+    console.info(`${name.padEnd(52)} ${ok ? 'ok' : 'WRONG'}${detail ? '  ' + detail : ''}`);
+    if (!ok) failures++;
+}
+
+async function connect(mock) {
+    Object.defineProperty(globalThis, 'navigator', {
+        value: { usb: { requestDevice: async () => mock } },
+        configurable: true
+    });
+    const dfu = new DFUDevice();
+    await dfu.connect();
+    return dfu;
+}
+
+// Bytes that differ from `before`, outside [start, end) of the QSPI region
+function changedOutside(mock, before, start, end) {
+    let changed = 0;
+    mock.regions.forEach((r, k) => {
+        for (let i = 0; i < r.size; i++) {
+            const a = r.base + i;
+            if ((a < start || a >= end) && r.memory[i] !== before[k][i]) changed++;
+        }
+    });
+    return changed;
+}
+
+function sector(mock, address) {
+    const r = mock.regions[1];
+    const start = address - ((address - r.base) % r.sector);
+    return r.memory.slice(start - r.base, start - r.base + r.sector);
+}
+
+// Sector holds `data` at `address`, erased bytes around it
+function sectorHolds(mock, address, data) {
+    const s = sector(mock, address);
+    const o = (address - mock.regions[1].base) % mock.regions[1].sector;
+    for (let i = 0; i < s.length; i++) {
+        const want = i >= o && i < o + data.length ? data[i - o] : 0xFF;
+        if (s[i] !== want) return false;
+    }
+    return true;
+}
+
+async function writeSector(address, data, mockOptions = {}, setup = () => {}) {
+    const mock = new MockDfuSe(mockOptions);
+    setup(mock);
+    const dfu = await connect(mock);
+    const before = mock.snapshot();
+    const stages = [];
+    let error = null;
+    try {
+        await dfu.writeRegion(address, data, (p) => stages.push(p.stage));
+    } catch (e) {
+        error = e;
+    }
+    return { mock, dfu, before, stages, error };
+}
+
+// ============================================
+// Cases
+// ============================================
+const quiet = console.log;
+console.log = () => {};  // dfu.js logs every busy poll
+
+const settings = defaultSettings();
+settings.sampleRateKhz = 96;
+settings.potsFitted = 0x2B;
+settings.potValues[2] = 0.25;
+settings.buttonPins[0] = 22;
+settings.customScaleSlot = 3;
+settings.customScaleName = 'Hijaz';
+settings.customNoteNames = ['D3', 'Eb3', 'F#3', 'G3', 'A3', 'Bb3', 'C4'];
+settings.customFreqs = [146.83, 155.56, 185, 196, 220, 233.08, 261.63];
+const block = encodeConfig(settings);
+
+// Connect
+{
+    const mock = new MockDfuSe();
+    const dfu = await connect(mock);
+    const bases = dfu.regions.map((r) => r.base.toString(16)).join(', ');
+    check('connect: DFU interface, regions', dfu.regions.length === 2 && bases === '8000000, 90000000', bases);
+}
+
+// Settings sector
+{
+    const { mock, before, stages, error } = await writeSector(CONFIG_ADDRESS, block);
+    const sectorSize = mock.regions[1].sector;
+    check('settings block written without error', !error, error ? error.message : `${block.length} bytes`);
+    check('one erase, of the settings sector only',
+          mock.erased.length === 1 && mock.erased[0] === CONFIG_ADDRESS,
+          mock.erased.map((a) => '0x' + a.toString(16)).join(' '));
+    check('sector = block, rest erased', sectorHolds(mock, CONFIG_ADDRESS, block));
+    const changed = changedOutside(mock, before, CONFIG_ADDRESS, CONFIG_ADDRESS + sectorSize);
+    check('every other byte of both flashes unchanged', changed === 0, `${changed} changed`);
+    check('verified, left DFU', stages.includes('verify') && stages.at(-1) === 'complete' && mock.manifested);
+    check('no protocol errors', mock.errors.length === 0, mock.errors.join('; '));
+    if (process.argv[2]) writeFileSync(process.argv[2], sector(mock, CONFIG_ADDRESS));
+}
+
+// Several transfers
+{
+    const data = new Uint8Array(2500).map((_, i) => (i * 7 + 3) & 0xFF);
+    const { mock, error } = await writeSector(CONFIG_ADDRESS, data);
+    check('2500 bytes (3 transfers) in order', !error && sectorHolds(mock, CONFIG_ADDRESS, data) &&
+          mock.errors.length === 0, error ? error.message : '');
+}
+
+// Stuck bit
+{
+    const { error } = await writeSector(CONFIG_ADDRESS, block, {}, (m) => {
+        m.stuck = { address: CONFIG_ADDRESS + 20, mask: ~block[20] & 0xFF };  // A bit the block clears
+    });
+    check('stuck flash bit fails the verify', !!error && /Verify failed at 0x907f0014/.test(error.message),
+          error ? error.message : 'no error');
+}
+
+// No QSPI region
+{
+    const { mock, error } = await writeSector(CONFIG_ADDRESS, block, { qspi: false });
+    check('no QSPI region: refused before erasing', !!error && /No DFU region/.test(error.message) &&
+          mock.erased.length === 0, error ? error.message : 'no error');
+}
+
+// Full flash after a sector write goes back to internal flash
+{
+    const mock = new MockDfuSe();
+    const dfu = await connect(mock);
+    await dfu.selectRegion(CONFIG_ADDRESS);  // Left on QSPI by a sector write
+    const before = mock.snapshot();
+    const firmware = new Uint8Array(5000).map((_, i) => (i * 13) & 0xFF);
+    let error = null;
+    try {
+        await dfu.flash(firmware.buffer, () => {});
+    } catch (e) {
+        error = e;
+    }
+    const internal = mock.regions[0].memory.subarray(0, firmware.length);
+    const qspiSame = mock.regions[1].memory.every((v, i) => v === before[1][i]);
+    check('flash() after a sector write: internal flash only',
+          !error && internal.every((v, i) => v === firmware[i]) && qspiSame && mock.errors.length === 0,
+          error ? error.message : mock.errors.join('; '));
+}
+
+console.log = quiet;
+console.info(failures === 0 ? 'PASS' : 'FAIL');
+process.exit(failures === 0 ? 0 : 1);
@@ -91,6 +91,17 @@ class DFUDevice {
 
             await this.device.claimInterface(this.interfaceNumber);
 
+            // Memory regions, one per alternate setting (DfuSe names like
+            // "@Internal Flash /0x08000000/01*128Ka")
+            this.regions = dfuInterface.alternates.map((alt) => {
+                const match = /\/0x([0-9a-fA-F]+)\//.exec(alt.interfaceName || '');
+                return {
+                    alternateSetting: alt.alternateSetting,
+                    name: alt.interfaceName || '',
+                    base: match ? parseInt(match[1], 16) : null
+                };
+            });
+
             // Clear any previous DFU errors
             await this.clearStatus();
 
@@ -199,6 +210,55 @@ class DFUDevice {
         return status;
     }
 
+    /**
+     * Select the alternate setting whose region contains `address`
+     * (highest base address not above it)
+     */
+    async selectRegion(address) {
+        let best = null;
+        for (const region of this.regions || []) {
+            if (region.base !== null && region.base <= address && (!best || region.base > best.base)) {
+                best = region;
+            }
+        }
+        if (!best || (address - best.base) >= 0x08000000) {
+            throw new Error(`No DFU region for 0x${address.toString(16)} on this bootloader`);
+        }
+        await this.device.selectAlternateInterface(this.interfaceNumber, best.alternateSetting);
+        return best;
+    }
+
+    /**
+     * Abort the current transfer, back to DFU_IDLE
+     */
+    async abort() {
+        await this.device.controlTransferOut({
+            requestType: 'class',
+            recipient: 'interface',
+            request: DFU_COMMANDS.ABORT,
+            value: 0,
+            index: this.interfaceNumber
+        });
+    }
+
+    /**
+     * Upload (read) one block from the device
+     */
+    async upload(length, blockNum) {
+        const response = await this.device.controlTransferIn({
+            requestType: 'class',
+            recipient: 'interface',
+            request: DFU_COMMANDS.UPLOAD,
+            value: blockNum,
+            index: this.interfaceNumber
+        }, length);
+
+        if (response.status !== 'ok') {
+            throw new Error('Upload failed');
+        }
+        return new Uint8Array(response.data.buffer);
+    }
+
     /**
      * Download (write) data to device
      */
@@ -257,6 +317,11 @@ class DFUDevice {
         try {
             progressCallback({ stage: 'init', percent: 0, message: 'Initializing...' });
 
+            // Back to the internal flash region if a sector write moved away
+            if (this.regions && this.regions.some((r) => r.base !== null)) {
+                await this.selectRegion(this.startAddress);
+            }
+
             // Set address to flash start
             await this.setAddress(this.startAddress);
             
@@ -285,29 +350,95 @@ class DFUDevice {
 
             // Send zero-length download to exit DFU mode
             progressCallback({ stage: 'finalize', percent: 100, message: 'Finalizing...' });
-            try {
-                await this.download(new Uint8Array(0), 0);
-            } catch (e) {
-                // Ignore errors here - device might reboot immediately
+            await this.leave();
+
+            progressCallback({ stage: 'complete', percent: 100, message: 'Flash complete!' });
+
+        } catch (error) {
+            throw new Error(`Flash failed: ${error.message}`);
+        }
+    }
+
+    /**
+     * Rewrite one erase sector only (e.g. the settings block): erase,
+     * write, read back and compare. `data` must fit in one sector.
+     */
+    async writeRegion(address, data, progressCallback) {
+        try {
+            const bytes = new Uint8Array(data);
+            const region = await this.selectRegion(address);
+            progressCallback({ stage: 'init', percent: 0, message: `Region ${region.name.trim()}` });
+
+            await this.clearStatus();
+            progressCallback({ stage: 'erase', percent: 10, message: `Erasing sector 0x${address.toString(16)}...` });
+            await this.erase(address);
+
+            await this.setAddress(address);
+            const totalBlocks = Math.ceil(bytes.length / this.transferSize);
+            for (let i = 0, offset = 0; offset < bytes.length; i++, offset += this.transferSize) {
+                await this.download(bytes.subarray(offset, offset + this.transferSize), i + 2);
+                await this.waitForReady();
+                progressCallback({
+                    stage: 'download',
+                    percent: 30 + Math.floor((i + 1) / totalBlocks * 40),
+                    message: `Writing block ${i + 1}/${totalBlocks}...`
+                });
             }
 
-            // Wait for manifest - but be tolerant of disconnection
-            try {
-                let status = await this.getStatus();
-                while (status.state === DFU_STATE.DFU_MANIFEST_SYNC ||
-                       status.state === DFU_STATE.DFU_MANIFEST) {
-                    await new Promise(resolve => setTimeout(resolve, 100));
-                    status = await this.getStatus();
+            progressCallback({ stage: 'verify', percent: 80, message: 'Verifying...' });
+            const readBack = await this.readRegion(address, bytes.length);
+            for (let i = 0; i < bytes.length; i++) {
+                if (readBack[i] !== bytes[i]) {
+                    throw new Error(`Verify failed at 0x${(address + i).toString(16)}`);
                 }
-            } catch (e) {
-                // Device disconnected/rebooted - this is expected success!
-                console.log('Device rebooted successfully');
             }
 
-            progressCallback({ stage: 'complete', percent: 100, message: 'Flash complete!' });
+            progressCallback({ stage: 'finalize', percent: 100, message: 'Restarting...' });
+            await this.leave();
+            progressCallback({ stage: 'complete', percent: 100, message: 'Sector written!' });
 
         } catch (error) {
-            throw new Error(`Flash failed: ${error.message}`);
+            throw new Error(`Sector write failed: ${error.message}`);
+        }
+    }
+
+    /**
+     * Read `length` bytes from `address` (DfuSe upload, blocks from 2)
+     */
+    async readRegion(address, length) {
+        await this.setAddress(address);
+        await this.abort();
+
+        const out = new Uint8Array(length);
+        for (let i = 0, offset = 0; offset < length; i++, offset += this.transferSize) {
+            const n = Math.min(this.transferSize, length - offset);
+            out.set((await this.upload(n, i + 2)).subarray(0, n), offset);
+        }
+        await this.abort();
+        return out;
+    }
+
+    /**
+     * Zero-length download: leave DFU and run the firmware
+     */
+    async leave() {
+        try {
+            await this.download(new Uint8Array(0), 0);
+        } catch (e) {
+            // Ignore errors here - device might reboot immediately
+        }
+
+        // Wait for manifest - but be tolerant of disconnection
+        try {
+            let status = await this.getStatus();
+            while (status.state === DFU_STATE.DFU_MANIFEST_SYNC ||
+                   status.state === DFU_STATE.DFU_MANIFEST) {
+                await new Promise(resolve => setTimeout(resolve, 100));
+                status = await this.getStatus();
+            }
+        } catch (e) {
+            // Device disconnected/rebooted - this is expected success!
+            console.log('Device rebooted successfully');
         }
     }
 }
@@ -3,6 +3,7 @@
  */
 
 import { DFUDevice } from './dfu.js';
+import { CONFIG_ADDRESS, NUM_POTS, NUM_STRINGS, defaultSettings, encodeConfig } from './config.js';
 
 // State
 let dfuDevice = null;
@@ -11,6 +12,11 @@ let firmwareData = null;
 // Firmware URL
 const FIRMWARE_URL = 'firmware/DigitalKalimba.bin';
 
+// Settings form labels (firmware defaults in KalimbaConfig.h)
+const POT_NAMES = ['A0 Brightness', 'A1 Decay', 'A2 Octave', 'A3 Scale', 'A4 Reverb Mix', 'A5 Reverb Time'];
+const MIN_FREQ = 20;
+const MAX_FREQ = 4000;
+
 // DOM elements
 const elements = {
     connectBtn: document.getElementById('connect-btn'),
@@ -23,7 +29,15 @@ const elements = {
     logOutput: document.getElementById('log-output'),
     customFirmware: document.getElementById('custom-firmware'),
     customFilename: document.getElementById('custom-filename'),
-    compatibilityWarning: document.getElementById('compatibility-warning')
+    compatibilityWarning: document.getElementById('compatibility-warning'),
+    configPots: document.getElementById('config-pots'),
+    configPins: document.getElementById('config-pins'),
+    configNotes: document.getElementById('config-notes'),
+    configScaleSlot: document.getElementById('config-scale-slot'),
+    configScaleName: document.getElementById('config-scale-name'),
+    configSampleRate: document.getElementById('config-sample-rate'),
+    configWriteBtn: document.getElementById('config-write-btn'),
+    configResetBtn: document.getElementById('config-reset-btn')
 };
 
 /**
@@ -42,6 +56,11 @@ function init() {
     elements.connectBtn.addEventListener('click', handleConnect);
     elements.flashBtn.addEventListener('click', handleFlash);
     elements.customFirmware.addEventListener('change', handleCustomFirmware);
+    elements.configWriteBtn.addEventListener('click', handleWriteConfig);
+    elements.configResetBtn.addEventListener('click', () => fillConfigForm(defaultSettings()));
+
+    buildConfigForm();
+    fillConfigForm(defaultSettings());
 
     log('Multi-Scale Synthesizer - Ready to flash!', 'info');
     log('Ready to connect to Daisy Seed', 'info');
@@ -66,6 +85,7 @@ async function handleConnect() {
         elements.deviceStatus.style.color = 'var(--success-color)';
         elements.connectBtn.textContent = '✓ Connected';
         elements.flashBtn.disabled = false;
+        elements.configWriteBtn.disabled = false;
 
     } catch (error) {
         log(`Connection failed: ${error.message}`, 'error');
@@ -113,6 +133,129 @@ async function handleFlash() {
     }
 }
 
+/**
+ * Write the settings sector only (no firmware reflash)
+ */
+async function handleWriteConfig() {
+    if (!dfuDevice) {
+        log('No device connected', 'error');
+        return;
+    }
+
+    let block;
+    try {
+        block = encodeConfig(readConfigForm());
+    } catch (error) {
+        log(`Settings not written: ${error.message}`, 'error');
+        return;
+    }
+
+    try {
+        elements.configWriteBtn.disabled = true;
+        elements.flashBtn.disabled = true;
+        log(`Writing settings (${block.length} bytes) to 0x${CONFIG_ADDRESS.toString(16)}...`, 'warning');
+        elements.progressContainer.classList.remove('hidden');
+
+        await dfuDevice.writeRegion(CONFIG_ADDRESS, block, updateProgress);
+
+        log('Settings written and verified! 🎉', 'success');
+        log('The firmware applies them at the next boot', 'success');
+
+    } catch (error) {
+        log(error.message, 'error');
+        log('Settings need the Daisy bootloader (QSPI flash in DFU mode)', 'warning');
+    } finally {
+        elements.configWriteBtn.disabled = false;
+        elements.flashBtn.disabled = false;
+    }
+}
+
+/**
+ * Settings form: one row per pot, button and custom note
+ */
+function buildConfigForm() {
+    for (let p = 0; p < NUM_POTS; p++) {
+        const label = document.createElement('label');
+        label.innerHTML = `<span><input type="checkbox" data-pot-fitted="${p}"> ${POT_NAMES[p]}</span>` +
+            `<input type="range" data-pot-value="${p}" min="0" max="1" step="0.001">`;
+        elements.configPots.appendChild(label);
+    }
+    for (let s = 0; s < NUM_STRINGS; s++) {
+        const pin = document.createElement('label');
+        pin.innerHTML = `Button ${s + 1}<input type="number" data-pin="${s}" min="0" max="32" placeholder="default">`;
+        elements.configPins.appendChild(pin);
+
+        const note = document.createElement('label');
+        note.innerHTML = `String ${s + 1}<input type="text" data-note="${s}" maxlength="3" placeholder="Note">` +
+            `<input type="number" data-freq="${s}" min="${MIN_FREQ}" max="${MAX_FREQ}" step="0.01" placeholder="Hz">`;
+        elements.configNotes.appendChild(note);
+    }
+}
+
+function configInput(attr, index) {
+    return document.querySelector(`[data-${attr}="${index}"]`);
+}
+
+function fillConfigForm(settings) {
+    for (let p = 0; p < NUM_POTS; p++) {
+        configInput('pot-fitted', p).checked = (settings.potsFitted >> p) & 1;
+        configInput('pot-value', p).value = settings.potValues[p];
+    }
+    for (let s = 0; s < NUM_STRINGS; s++) {
+        configInput('pin', s).value = settings.buttonPins[s] === null ? '' : settings.buttonPins[s];
+        configInput('note', s).value = settings.customNoteNames[s];
+        configInput('freq', s).value = settings.customFreqs[s] || '';
+    }
+    elements.configScaleSlot.value = settings.customScaleSlot === null ? '' : settings.customScaleSlot;
+    elements.configScaleName.value = settings.customScaleName;
+    elements.configSampleRate.value = settings.sampleRateKhz;
+}
+
+/**
+ * Form → settings. Throws on values the firmware would reject (it would
+ * fall back to all defaults); reserved pins are checked by the firmware.
+ */
+function readConfigForm() {
+    const settings = defaultSettings();
+
+    settings.potsFitted = 0;
+    for (let p = 0; p < NUM_POTS; p++) {
+        if (configInput('pot-fitted', p).checked) settings.potsFitted |= 1 << p;
+        settings.potValues[p] = Number(configInput('pot-value', p).value);
+    }
+
+    settings.sampleRateKhz = Number(elements.configSampleRate.value);
+
+    const used = new Set();
+    for (let s = 0; s < NUM_STRINGS; s++) {
+        const text = configInput('pin', s).value.trim();
+        if (text === '') continue;
+        const pin = Number(text);
+        if (!Number.isInteger(pin) || pin < 0 || pin > 32) {
+            throw new Error(`Button ${s + 1}: pin must be D0-D32`);
+        }
+        if (used.has(pin)) {
+            throw new Error(`Button ${s + 1}: D${pin} is already used by another button`);
+        }
+        used.add(pin);
+        settings.buttonPins[s] = pin;
+    }
+
+    if (elements.configScaleSlot.value !== '') {
+        settings.customScaleSlot = Number(elements.configScaleSlot.value);
+        settings.customScaleName = elements.configScaleName.value.trim() || 'Custom';
+        for (let s = 0; s < NUM_STRINGS; s++) {
+            const freq = Number(configInput('freq', s).value);
+            if (!(freq >= MIN_FREQ && freq <= MAX_FREQ)) {
+                throw new Error(`String ${s + 1}: frequency must be ${MIN_FREQ}-${MAX_FREQ} Hz`);
+            }
+            settings.customFreqs[s] = freq;
+            settings.customNoteNames[s] = configInput('note', s).value.trim();
+        }
+    }
+    return settings;
+}
+
 /**
  * Load firmware binary
  */
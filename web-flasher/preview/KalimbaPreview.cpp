@@ -0,0 +1,203 @@
+/*
+ * KALIMBA PREVIEW - The firmware's synthesis engine for the browser
+ *
+ * Compiled to WebAssembly (SIMD) and run in an AudioWorklet by the web
+ * flasher, so a scale or setting can be heard before flashing. Uses the
+ * exact KalimbaEngine the Daisy runs, with the pot mappings and scales
+ * from KalimbaScales.h - pots A0-A5 and strings 1-7 behave like the
+ * hardware.
+ *
+ * EXPORTS (plain C, no Emscripten JS glue):
+ *   kp_init(sample_rate, voices)   7 (firmware), 16 or 32 voices
+ *   kp_set_pot(pot, value)         A0-A5, 0.0 - 1.0
+ *   kp_pluck(string, level)        lands on the next kp_process()
+ *   kp_process(frames)             renders into kp_output() (up to 128)
+ *   kp_reference_step(quantum)     events of the fixed reference render
+ *   kp_scale_name(), kp_note_name(s), kp_octave()  for the UI
+ *
+ * Voices beyond 7 repeat the scale an octave up (as in SelfBench.h), they
+ * only exist to measure headroom.
+ *
+ * NATIVE BUILD (-DKALIMBA_PREVIEW_NATIVE): main() writes the reference
+ * render as raw float32, for comparison with the WebAssembly one
+ * (render.mjs), and prints its headroom per 128-frame quantum in the same
+ * form as render.mjs - the native side of the comparison.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../../KalimbaEngine.h"
+#include "../../KalimbaScales.h"
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten/emscripten.h>
+#define KP_EXPORT extern "C" EMSCRIPTEN_KEEPALIVE
+#else
+#define KP_EXPORT extern "C"
+#endif
+
+const int   QUANTUM  = 128;       // AudioWorklet render quantum
+const int   NUM_POTS = 6;
+const float LP_FREQ  = 10000.0f;  // Firmware: reverb LP fixed at 10kHz
+
+// Reference render: 10s at 48kHz, a pluck every REF_PLUCK_QUANTA quanta,
+// pots swept through every scale and octave on the way
+const int REF_QUANTA       = 3750;
+const int REF_PLUCK_QUANTA = 25;
+
+// Engines are large (one delay line per string): static, one per size
+KalimbaEngine<7>  engine_7;
+KalimbaEngine<16> engine_16;
+KalimbaEngine<32> engine_32;
+
+int   voices = 7;
+float pots[NUM_POTS];
+int   current_scale;
+int   octave_offset;
+float output[QUANTUM];
+
+// ============================================
+// Engine dispatch (voice count chosen at kp_init)
+// ============================================
+
+template <int N>
+void ApplyPots(KalimbaEngine<N>& engine) {
+    engine.SetBrightness(PotToBrightness(pots[0]));
+    engine.SetDecay(PotToDecay(pots[1]));
+    engine.SetReverb(PotToReverbMix(pots[4]), PotToReverbFeedback(pots[5]), LP_FREQ);
+
+    current_scale = PotToScale(pots[3]);
+    octave_offset = PotToOctave(pots[2]);
+    for (int v = 0; v < N; v++) {
+        float ratio = OctaveRatio(octave_offset) * (float)(1 << ((v / NUM_STRINGS) % 3));
+        engine.SetVoiceFreq(v, scale_frequencies[current_scale][v % NUM_STRINGS] * ratio);
+    }
+}
+
+template <int N>
+void Init(KalimbaEngine<N>& engine, float sample_rate) {
+    engine.Init(sample_rate);
+    ApplyPots(engine);
+}
+
+// fn(engine) on the active engine
+template <typename Fn>
+void WithEngine(Fn fn) {
+    switch (voices) {
+        case 16: fn(engine_16); break;
+        case 32: fn(engine_32); break;
+        default: fn(engine_7); break;
+    }
+}
+
+// ============================================
+// Exports
+// ============================================
+
+KP_EXPORT void kp_init(float sample_rate, int num_voices) {
+    voices = (num_voices == 16 || num_voices == 32) ? num_voices : 7;
+
+    // Firmware power-on values: brightness .75, decay .95, reverb .3 / .85
+    pots[0] = 0.5f;
+    pots[1] = 0.9f;
+    pots[2] = 0.5f;   // Octave 0
+    pots[3] = 0.0f;   // Pentatonic Major
+    pots[4] = 0.3f;
+    pots[5] = 0.626f;
+
+    WithEngine([&](auto& e) { Init(e, sample_rate); });
+}
+
+KP_EXPORT void kp_set_pot(int pot, float value) {
+    if (pot < 0 || pot >= NUM_POTS) return;
+    pots[pot] = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+    WithEngine([](auto& e) { ApplyPots(e); });
+}
+
+KP_EXPORT void kp_pluck(int string, float level) {
+    if (string < 0 || string >= voices) return;
+    WithEngine([&](auto& e) { e.Trigger(string, level); });
+}
+
+KP_EXPORT float* kp_output() { return output; }
+
+KP_EXPORT void kp_process(int frames) {
+    if (frames > QUANTUM) frames = QUANTUM;
+    WithEngine([&](auto& e) { e.Process(output, frames); });
+}
+
+KP_EXPORT int kp_reference_quanta() { return REF_QUANTA; }
+
+// Events of one quantum of the reference render (call before kp_process)
+KP_EXPORT void kp_reference_step(int quantum) {
+    if (quantum == 0) {
+        for (int v = 0; v < voices; v++) kp_pluck(v, 1.0f);
+    } else if (quantum % REF_PLUCK_QUANTA == 0) {
+        int n = quantum / REF_PLUCK_QUANTA;
+        kp_pluck(n % voices, 0.8f);
+        if (n % 8 == 0) {
+            // Every 8th pluck: next scale / octave, brightness + decay sweep
+            kp_set_pot(3, (float)((n / 8) % NUM_SCALES) / (NUM_SCALES - 1));
+            kp_set_pot(2, (float)((n / 8) % 5) / 4.0f);
+            kp_set_pot(0, (float)(n % 11) / 10.0f);
+            kp_set_pot(1, 0.7f + (float)(n % 7) / 20.0f);
+        }
+    }
+}
+
+KP_EXPORT const char* kp_scale_name() { return scale_names[current_scale]; }
+
+KP_EXPORT const char* kp_note_name(int string) {
+    if (string < 0 || string >= NUM_STRINGS) return "";
+    return scale_note_names[current_scale][string];
+}
+
+KP_EXPORT int kp_octave() { return octave_offset; }
+
+// ============================================
+// Native reference render
+// ============================================
+#ifdef KALIMBA_PREVIEW_NATIVE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+// kalimba_preview_native <out.f32> [voices] [sample_rate]
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s out.f32 [voices] [sample_rate]\n", argv[0]);
+        return 1;
+    }
+    int   num_voices  = argc > 2 ? atoi(argv[2]) : 7;
+    float sample_rate = argc > 3 ? (float)atof(argv[3]) : 48000.0f;
+
+    FILE* f = fopen(argv[1], "wb");
+    if (!f) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    // Timed like renderReference() in kalimba-wasm.js: process() only
+    typedef std::chrono::steady_clock Clock;
+    double busy = 0.0, worst = 0.0;
+    kp_init(sample_rate, num_voices);
+    for (int q = 0; q < REF_QUANTA; q++) {
+        kp_reference_step(q);
+        Clock::time_point t0 = Clock::now();
+        kp_process(QUANTUM);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        busy += ms;
+        worst = ms > worst ? ms : worst;
+        fwrite(output, sizeof(float), QUANTUM, f);
+    }
+    fclose(f);
+
+    double budget = QUANTUM / sample_rate * 1000.0, mean = busy / REF_QUANTA;
+    printf("%2d voices: %.1f%% of the %.2f ms quantum (worst %.1f%%), %.1fx real time (native)\n", voices,
+           mean / budget * 100.0, budget, worst / budget * 100.0, budget / mean);
+    return 0;
+}
+
+#endif  // KALIMBA_PREVIEW_NATIVE
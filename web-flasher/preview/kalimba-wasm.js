@@ -0,0 +1,124 @@
+/**
+ * Kalimba engine WebAssembly wrapper, shared by the AudioWorklet, the
+ * page (headroom) and the headless node renderer
+ */
+
+export const QUANTUM = 128;
+export const VOICE_COUNTS = [7, 16, 32];
+
+/**
+ * Instantiate a compiled kalimba.wasm (synchronous, works in a worklet).
+ * The module is standalone: any WASI/env import it still references is
+ * stubbed, the engine never calls them.
+ */
+export function instantiate(module) {
+    const imports = {};
+    for (const imp of WebAssembly.Module.imports(module)) {
+        imports[imp.module] = imports[imp.module] || {};
+        if (imp.kind === 'function') {
+            imports[imp.module][imp.name] = () => 0;
+        }
+    }
+    const instance = new WebAssembly.Instance(module, imports);
+    if (instance.exports._initialize) {
+        instance.exports._initialize();  // Static constructors
+    }
+    return new KalimbaWasm(instance.exports);
+}
+
+export class KalimbaWasm {
+    constructor(exports) {
+        this.exports = exports;
+        this.output = null;
+    }
+
+    init(sampleRate, voices = 7) {
+        this.exports.kp_init(sampleRate, voices);
+        this.voices = voices;
+    }
+
+    setPot(pot, value) {
+        this.exports.kp_set_pot(pot, value);
+    }
+
+    pluck(string, level = 1.0) {
+        this.exports.kp_pluck(string, level);
+    }
+
+    /** Render `frames` (<= QUANTUM) samples, returns a view of the output */
+    process(frames = QUANTUM) {
+        this.exports.kp_process(frames);
+        // Re-create the view if memory was replaced
+        const ptr = this.exports.kp_output();
+        if (!this.output || this.output.buffer !== this.exports.memory.buffer) {
+            this.output = new Float32Array(this.exports.memory.buffer, ptr, QUANTUM);
+        }
+        return frames === QUANTUM ? this.output : this.output.subarray(0, frames);
+    }
+
+    scaleName() {
+        return this.readString(this.exports.kp_scale_name());
+    }
+
+    noteName(string) {
+        return this.readString(this.exports.kp_note_name(string));
+    }
+
+    octave() {
+        return this.exports.kp_octave();
+    }
+
+    /** C string (ASCII names only, no TextDecoder in worklets) */
+    readString(ptr) {
+        const bytes = new Uint8Array(this.exports.memory.buffer, ptr);
+        let str = '';
+        for (let i = 0; bytes[i] !== 0; i++) str += String.fromCharCode(bytes[i]);
+        return str;
+    }
+}
+
+/**
+ * Fixed reference render (same events as the native build), into one
+ * Float32Array. Also returns the time spent inside process().
+ */
+export function renderReference(kalimba, sampleRate, voices, now) {
+    kalimba.init(sampleRate, voices);
+    const quanta = kalimba.exports.kp_reference_quanta();
+    const out = new Float32Array(quanta * QUANTUM);
+    let busy = 0;
+    let worst = 0;
+    for (let q = 0; q < quanta; q++) {
+        kalimba.exports.kp_reference_step(q);
+        const t0 = now();
+        const buf = kalimba.process(QUANTUM);
+        const t = now() - t0;
+        busy += t;
+        if (t > worst) worst = t;
+        out.set(buf, q * QUANTUM);
+    }
+    return { samples: out, voices, quanta, busy, worst };
+}
+
+/**
+ * Real-time headroom of one render: how many times faster than real time
+ * it ran, and the share of the 128-frame budget used (mean / worst quantum)
+ */
+export function headroom(render, sampleRate) {
+    const budgetMs = QUANTUM / sampleRate * 1000;
+    const meanMs = render.busy / render.quanta;
+    return {
+        voices: render.voices,
+        budgetMs,
+        meanMs,
+        worstMs: render.worst,
+        load: meanMs / budgetMs,
+        worstLoad: render.worst / budgetMs,
+        realtime: budgetMs / meanMs
+    };
+}
+
+export function formatHeadroom(h) {
+    return `${String(h.voices).padStart(2)} voices: ` +
+        `${(h.load * 100).toFixed(1)}% of the ${h.budgetMs.toFixed(2)} ms quantum ` +
+        `(worst ${(h.worstLoad * 100).toFixed(1)}%), ${h.realtime.toFixed(1)}x real time`;
+}
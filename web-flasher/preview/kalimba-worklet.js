@@ -0,0 +1,48 @@
+/**
+ * AudioWorklet processor running the Kalimba engine (kalimba.wasm)
+ *
+ * The page compiles the module and passes it in processorOptions; pots
+ * and plucks arrive as port messages and land on the next quantum, like
+ * the firmware's once-per-block control reads.
+ */
+
+import { instantiate, QUANTUM } from './kalimba-wasm.js';
+
+class KalimbaProcessor extends AudioWorkletProcessor {
+    constructor(options) {
+        super();
+        this.kalimba = instantiate(options.processorOptions.module);
+        this.kalimba.init(sampleRate, 7);
+
+        this.port.onmessage = (event) => {
+            const msg = event.data;
+            if (msg.type === 'pot') {
+                this.kalimba.setPot(msg.pot, msg.value);
+                this.port.postMessage({
+                    type: 'display',
+                    scale: this.kalimba.scaleName(),
+                    octave: this.kalimba.octave(),
+                    notes: [0, 1, 2, 3, 4, 5, 6].map((s) => this.kalimba.noteName(s))
+                });
+            } else if (msg.type === 'pluck') {
+                this.kalimba.pluck(msg.string, msg.level);
+            }
+        };
+    }
+
+    process(inputs, outputs) {
+        const output = outputs[0];
+        const frames = output[0].length;
+        for (let offset = 0; offset < frames; offset += QUANTUM) {
+            const n = Math.min(QUANTUM, frames - offset);
+            const buf = this.kalimba.process(n);
+            // Mono engine: same signal on every channel
+            for (const channel of output) {
+                channel.set(buf, offset);
+            }
+        }
+        return true;
+    }
+}
+
+registerProcessor('kalimba-processor', KalimbaProcessor);
@@ -0,0 +1,176 @@
+/**
+ * In-browser preview of the Digital Kalimba firmware sound
+ *
+ * kalimba.wasm (the firmware's KalimbaEngine, see KalimbaPreview.cpp)
+ * runs in an AudioWorklet at 48kHz; sliders are pots A0-A5, the 7 string
+ * buttons (or keys 1-7) pluck.
+ */
+
+import { instantiate, renderReference, headroom, formatHeadroom, VOICE_COUNTS } from './kalimba-wasm.js';
+
+const WASM_URL = new URL('kalimba.wasm', import.meta.url);
+const WORKLET_URL = new URL('kalimba-worklet.js', import.meta.url);
+const SAMPLE_RATE = 48000;  // Same as the firmware
+const NUM_STRINGS = 7;
+
+// State
+let wasmModule = null;
+let audioContext = null;
+let workletNode = null;
+
+// DOM elements
+const elements = {
+    startBtn: document.getElementById('preview-start-btn'),
+    benchBtn: document.getElementById('preview-bench-btn'),
+    scale: document.getElementById('preview-scale'),
+    octave: document.getElementById('preview-octave'),
+    strings: document.getElementById('preview-strings'),
+    pots: document.querySelectorAll('.preview-pots input[type="range"]'),
+    headroom: document.getElementById('preview-headroom')
+};
+
+/**
+ * Initialize preview controls
+ */
+function init() {
+    if (!window.AudioWorkletNode || !window.WebAssembly) {
+        elements.startBtn.disabled = true;
+        elements.benchBtn.disabled = true;
+        showHeadroom(['Preview needs AudioWorklet and WebAssembly support']);
+        return;
+    }
+
+    const stringButtons = [];
+    for (let s = 0; s < NUM_STRINGS; s++) {
+        const btn = document.createElement('button');
+        btn.className = 'btn';
+        btn.innerHTML = `<span class="note-name">-</span><span class="key">${s + 1}</span>`;
+        btn.addEventListener('pointerdown', () => pluck(s));
+        elements.strings.appendChild(btn);
+        stringButtons.push(btn);
+    }
+    elements.stringButtons = stringButtons;
+
+    elements.startBtn.addEventListener('click', handleStart);
+    elements.benchBtn.addEventListener('click', handleBench);
+    elements.pots.forEach((pot) => pot.addEventListener('input', () => sendPot(pot)));
+
+    document.addEventListener('keydown', (event) => {
+        const s = Number(event.key) - 1;
+        if (!event.repeat && s >= 0 && s < NUM_STRINGS) pluck(s);
+    });
+}
+
+/**
+ * Fetch + compile kalimba.wasm once (shared by the worklet and the bench)
+ */
+async function loadModule() {
+    if (!wasmModule) {
+        const response = await fetch(WASM_URL);
+        if (!response.ok) {
+            throw new Error(`kalimba.wasm not found (build it with make in web-flasher/preview)`);
+        }
+        wasmModule = await WebAssembly.compile(await response.arrayBuffer());
+    }
+    return wasmModule;
+}
+
+/**
+ * Start / stop audio
+ */
+async function handleStart() {
+    try {
+        if (audioContext) {
+            await audioContext.close();
+            audioContext = null;
+            workletNode = null;
+            elements.startBtn.lastChild.textContent = ' Start Preview';
+            return;
+        }
+
+        const module = await loadModule();
+        audioContext = new AudioContext({ sampleRate: SAMPLE_RATE, latencyHint: 'interactive' });
+        await audioContext.audioWorklet.addModule(WORKLET_URL);
+        workletNode = new AudioWorkletNode(audioContext, 'kalimba-processor', {
+            numberOfInputs: 0,
+            outputChannelCount: [2],
+            processorOptions: { module }
+        });
+        workletNode.port.onmessage = (event) => updateDisplay(event.data);
+        workletNode.connect(audioContext.destination);
+
+        elements.pots.forEach(sendPot);
+        elements.startBtn.lastChild.textContent = ' Stop Preview';
+    } catch (error) {
+        showHeadroom([`Preview failed: ${error.message}`]);
+    }
+}
+
+/**
+ * Render the reference sequence offline on this thread for each voice
+ * count and report how much of the 128-frame budget it takes
+ */
+async function handleBench() {
+    try {
+        elements.benchBtn.disabled = true;
+        showHeadroom(['Measuring...']);
+        const kalimba = instantiate(await loadModule());
+
+        const lines = [];
+        for (const voices of VOICE_COUNTS) {
+            // Yield so the page stays responsive between runs
+            await new Promise((resolve) => setTimeout(resolve, 0));
+            const render = renderReference(kalimba, SAMPLE_RATE, voices, () => performance.now());
+            lines.push(formatHeadroom(headroom(render, SAMPLE_RATE)));
+        }
+        lines.push('Main thread timing; the audio thread usually runs a little faster.');
+        showHeadroom(lines);
+    } catch (error) {
+        showHeadroom([`Measurement failed: ${error.message}`]);
+    } finally {
+        elements.benchBtn.disabled = false;
+    }
+}
+
+function pluck(s) {
+    if (!workletNode) return;
+    workletNode.port.postMessage({ type: 'pluck', string: s, level: 1.0 });
+    const btn = elements.stringButtons[s];
+    btn.classList.add('active');
+    setTimeout(() => btn.classList.remove('active'), 150);
+}
+
+function sendPot(pot) {
+    if (!workletNode) return;
+    workletNode.port.postMessage({ type: 'pot', pot: Number(pot.dataset.pot), value: Number(pot.value) });
+}
+
+/**
+ * Scale / octave / note names, as the OLED shows them
+ */
+function updateDisplay(msg) {
+    if (msg.type !== 'display') return;
+    elements.scale.textContent = msg.scale;
+    elements.octave.textContent = msg.octave >= 0 ? `+${msg.octave}` : `${msg.octave}`;
+    msg.notes.forEach((name, s) => {
+        elements.stringButtons[s].querySelector('.note-name').textContent = name;
+    });
+}
+
+function showHeadroom(lines) {
+    elements.headroom.classList.remove('hidden');
+    elements.headroom.textContent = '';
+    for (const line of lines) {
+        const entry = document.createElement('div');
+        entry.className = 'log-entry info';
+        entry.textContent = line;
+        elements.headroom.appendChild(entry);
+    }
+}
+
+// Initialize when DOM is ready
+if (document.readyState === 'loading') {
+    document.addEventListener('DOMContentLoaded', init);
+} else {
+    init();
+}
@@ -0,0 +1,75 @@
+/**
+ * Headless Kalimba preview renderer (node 18+)
+ *
+ *   node render.mjs                       headroom of kalimba.wasm, 7/16/32 voices
+ *   node render.mjs --compare build 7 16  also compare against the native
+ *                                         renders build/reference_<voices>.f32
+ *   node render.mjs --write out.f32 [v]   write the wasm render (e.g. to listen)
+ *
+ * Both builds use the same C++ and IEEE float ops, but libm differs
+ * (musl vs glibc sinf / tanhf), so renders agree to a tolerance rather
+ * than bit for bit.
+ */
+
+import { readFileSync, writeFileSync } from 'node:fs';
+import { performance } from 'node:perf_hooks';
+import { fileURLToPath } from 'node:url';
+import { dirname, join } from 'node:path';
+
+import { instantiate, renderReference, headroom, formatHeadroom, VOICE_COUNTS } from './kalimba-wasm.js';
+
+const SAMPLE_RATE = 48000;
+const MAX_ABS_ERROR = 1e-3;  // ~-60 dBFS
+const MIN_SNR_DB = 60;
+
+const here = dirname(fileURLToPath(import.meta.url));
+const module = new WebAssembly.Module(readFileSync(join(here, 'kalimba.wasm')));
+const kalimba = instantiate(module);
+
+function compare(render, reference) {
+    if (reference.length !== render.length) {
+        return { ok: false, text: `length ${render.length} != reference ${reference.length}` };
+    }
+    let maxErr = 0;
+    let signal = 0;
+    let noise = 0;
+    for (let i = 0; i < render.length; i++) {
+        const err = Math.abs(render[i] - reference[i]);
+        if (err > maxErr) maxErr = err;
+        signal += reference[i] * reference[i];
+        noise += err * err;
+    }
+    const snr = noise > 0 ? 10 * Math.log10(signal / noise) : Infinity;
+    const ok = maxErr <= MAX_ABS_ERROR && snr >= MIN_SNR_DB && signal > 0;
+    return { ok, text: `max error ${maxErr.toExponential(2)}, SNR ${snr.toFixed(1)} dB` };
+}
+
+const args = process.argv.slice(2);
+let failed = false;
+
+if (args[0] === '--write') {
+    const voices = Number(args[2] || 7);
+    const render = renderReference(kalimba, SAMPLE_RATE, voices, () => performance.now());
+    writeFileSync(args[1], Buffer.from(render.samples.buffer));
+    console.log(`${args[1]}: ${render.samples.length} samples, ${voices} voices, ${SAMPLE_RATE} Hz float32`);
+} else {
+    const compareDir = args[0] === '--compare' ? args[1] : null;
+    const voiceCounts = compareDir && args.length > 2 ? args.slice(2).map(Number) : VOICE_COUNTS;
+
+    console.log(`Kalimba preview (kalimba.wasm, node ${process.version}, ${SAMPLE_RATE} Hz, 128-frame quantum)`);
+    for (const voices of voiceCounts) {
+        const render = renderReference(kalimba, SAMPLE_RATE, voices, () => performance.now());
+        let line = formatHeadroom(headroom(render, SAMPLE_RATE));
+        if (compareDir) {
+            const file = join(compareDir, `reference_${voices}.f32`);
+            const bytes = readFileSync(file);
+            const reference = new Float32Array(bytes.buffer, bytes.byteOffset, bytes.length / 4);
+            const result = compare(render.samples, reference);
+            line += `  native: ${result.ok ? 'match' : 'MISMATCH'} (${result.text})`;
+            failed = failed || !result.ok;
+        }
+        console.log(line);
+    }
+}
+
+process.exit(failed ? 1 : 0);